@@ -0,0 +1,405 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *      Asynchronous CoAP client
+ */
+
+#include <string.h>
+
+#include "er-coap.h"
+#include "er-coap-transactions.h"
+#include "er-coap-async-client.h"
+#include "lib/random.h"
+
+/* Compile this code only if the asynchronous client is required */
+#if COAP_ASYNC_CLIENT
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#define PRINT6ADDR(addr) PRINTF("[%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x:%02x%02x]", ((uint8_t *)addr)[0], ((uint8_t *)addr)[1], ((uint8_t *)addr)[2], ((uint8_t *)addr)[3], ((uint8_t *)addr)[4], ((uint8_t *)addr)[5], ((uint8_t *)addr)[6], ((uint8_t *)addr)[7], ((uint8_t *)addr)[8], ((uint8_t *)addr)[9], ((uint8_t *)addr)[10], ((uint8_t *)addr)[11], ((uint8_t *)addr)[12], ((uint8_t *)addr)[13], ((uint8_t *)addr)[14], ((uint8_t *)addr)[15])
+#else
+#define PRINTF(...)
+#define PRINT6ADDR(addr)
+#endif
+
+#define STATE_QUEUED  0         /* waiting for a free NSTART slot */
+#define STATE_SENT    1         /* waiting for the ACK or the response */
+#define STATE_ACKED   2         /* waiting for a separate response */
+
+#define TOKEN_LEN     4
+
+/* How long to wait for a separate response after its empty ACK */
+#define SEPARATE_RESPONSE_TIMEOUT \
+  (COAP_RESPONSE_TIMEOUT_TICKS << COAP_MAX_RETRANSMIT)
+
+#define TOKEN_HASH(token)   ((token)[TOKEN_LEN - 1] % COAP_ASYNC_HASH_SIZE)
+#define MID_HASH(mid)       ((mid) % COAP_ASYNC_HASH_SIZE)
+
+MEMB(requests_memb, coap_async_request_t, COAP_MAX_ASYNC_REQUESTS);
+LIST(requests_list);
+
+static coap_async_request_t *token_table[COAP_ASYNC_HASH_SIZE];
+static coap_async_request_t *mid_table[COAP_ASYNC_HASH_SIZE];
+static uint32_t next_token;
+static uint8_t packet[COAP_MAX_PACKET_SIZE + 1];
+
+static void retransmit(void *ptr);
+/*---------------------------------------------------------------------------*/
+static void
+mid_remove(coap_async_request_t *r)
+{
+  coap_async_request_t **p;
+
+  for(p = &mid_table[MID_HASH(r->request.mid)]; *p; p = &(*p)->mid_next) {
+    if(*p == r) {
+      *p = r->mid_next;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+token_remove(coap_async_request_t *r)
+{
+  coap_async_request_t **p;
+
+  for(p = &token_table[TOKEN_HASH(r->request.token)]; *p;
+      p = &(*p)->token_next) {
+    if(*p == r) {
+      *p = r->token_next;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_free(coap_async_request_t *r)
+{
+  ctimer_stop(&r->retrans_timer);
+  if(r->state == STATE_SENT) {
+    mid_remove(r);
+  }
+  token_remove(r);
+  list_remove(requests_list, r);
+  memb_free(&requests_memb, r);
+}
+/*---------------------------------------------------------------------------*/
+static void
+transmit(coap_async_request_t *r)
+{
+  uint16_t len;
+
+  len = coap_serialize_message(&r->request, packet);
+  if(len) {
+    coap_send_message(&r->addr, r->port, packet, len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_start(coap_async_request_t *r)
+{
+  r->request.mid = coap_get_mid();
+  r->mid_next = mid_table[MID_HASH(r->request.mid)];
+  mid_table[MID_HASH(r->request.mid)] = r;
+  r->state = STATE_SENT;
+  r->retrans_counter = 0;
+  r->retrans_interval = COAP_RESPONSE_TIMEOUT_TICKS
+    + (random_rand() % (clock_time_t)COAP_RESPONSE_TIMEOUT_BACKOFF_MASK);
+
+  PRINTF("Async: sending MID %u to ", r->request.mid);
+  PRINT6ADDR(&r->addr);
+  PRINTF("\n");
+
+  transmit(r);
+  ctimer_set(&r->retrans_timer, r->retrans_interval, retransmit, r);
+}
+/*---------------------------------------------------------------------------*/
+/* Non-zero if a new request to the server has to wait */
+static int
+server_busy(uip_ipaddr_t *addr, uint16_t port)
+{
+  coap_async_request_t *r;
+  int in_flight = 0;
+
+  for(r = list_head(requests_list); r; r = r->next) {
+    if(r->port == port && uip_ipaddr_cmp(&r->addr, addr)) {
+      if(r->state == STATE_QUEUED) {
+        return 1;
+      }
+      in_flight++;
+    }
+  }
+  return in_flight >= COAP_NSTART;
+}
+/*---------------------------------------------------------------------------*/
+/* Sends the requests to the server that wait for a free NSTART slot */
+static void
+server_dispatch(uip_ipaddr_t *addr, uint16_t port)
+{
+  coap_async_request_t *r;
+  int in_flight = 0;
+
+  for(r = list_head(requests_list); r; r = r->next) {
+    if(r->port == port && uip_ipaddr_cmp(&r->addr, addr)
+       && r->state != STATE_QUEUED) {
+      in_flight++;
+    }
+  }
+  for(r = list_head(requests_list); r && in_flight < COAP_NSTART;
+      r = r->next) {
+    if(r->port == port && uip_ipaddr_cmp(&r->addr, addr)
+       && r->state == STATE_QUEUED) {
+      request_start(r);
+      in_flight++;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Frees the request and tells its owner that it failed */
+static void
+request_fail(coap_async_request_t *r)
+{
+  restful_response_handler callback = r->callback;
+  void *callback_data = r->callback_data;
+  uip_ipaddr_t addr;
+  uint16_t port;
+
+  uip_ipaddr_copy(&addr, &r->addr);
+  port = r->port;
+  request_free(r);
+  server_dispatch(&addr, port);
+
+  if(callback) {
+    callback(callback_data, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+retransmit(void *ptr)
+{
+  coap_async_request_t *r = ptr;
+
+  if(r->state == STATE_SENT && r->retrans_counter < COAP_MAX_RETRANSMIT) {
+    ++(r->retrans_counter);
+    r->retrans_interval <<= 1;
+    PRINTF("Async: retransmitting MID %u (%u)\n", r->request.mid,
+           r->retrans_counter);
+    if(r->request.type == COAP_TYPE_CON) {
+      transmit(r);
+    }
+    ctimer_set(&r->retrans_timer, r->retrans_interval, retransmit, r);
+  } else {
+    PRINTF("Async: MID %u timed out\n", r->request.mid);
+    request_fail(r);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static coap_async_request_t *
+lookup_mid(uip_ipaddr_t *addr, uint16_t port, uint16_t mid)
+{
+  coap_async_request_t *r;
+
+  for(r = mid_table[MID_HASH(mid)]; r; r = r->mid_next) {
+    if(r->request.mid == mid && r->port == port
+       && uip_ipaddr_cmp(&r->addr, addr)) {
+      return r;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static coap_async_request_t *
+lookup_token(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token,
+             uint8_t token_len)
+{
+  coap_async_request_t *r;
+
+  if(token_len != TOKEN_LEN) {
+    return NULL;
+  }
+  for(r = token_table[TOKEN_HASH(token)]; r; r = r->token_next) {
+    if(memcmp(r->request.token, token, TOKEN_LEN) == 0
+       && r->state != STATE_QUEUED && r->port == port
+       && uip_ipaddr_cmp(&r->addr, addr)) {
+      return r;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/*- Client API --------------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+coap_async_request_t *
+coap_async_request(uip_ipaddr_t *addr, uint16_t port, coap_packet_t *request,
+                   restful_response_handler callback, void *callback_data)
+{
+  coap_async_request_t *r;
+  uint8_t token[TOKEN_LEN];
+
+  r = memb_alloc(&requests_memb);
+  if(r == NULL) {
+    PRINTF("Async: no free request\n");
+    return NULL;
+  }
+
+  memcpy(&r->request, request, sizeof(coap_packet_t));
+  ++next_token;
+  token[0] = (uint8_t)(next_token >> 24);
+  token[1] = (uint8_t)(next_token >> 16);
+  token[2] = (uint8_t)(next_token >> 8);
+  token[3] = (uint8_t)next_token;
+  coap_set_token(&r->request, token, TOKEN_LEN);
+
+  uip_ipaddr_copy(&r->addr, addr);
+  r->port = port;
+  r->callback = callback;
+  r->callback_data = callback_data;
+  r->state = STATE_QUEUED;
+
+  r->token_next = token_table[TOKEN_HASH(token)];
+  token_table[TOKEN_HASH(token)] = r;
+
+  if(server_busy(addr, port)) {
+    PRINTF("Async: queueing request\n");
+    list_add(requests_list, r);
+  } else {
+    list_add(requests_list, r);
+    request_start(r);
+  }
+  return r;
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_async_cancel(coap_async_request_t *r)
+{
+  uip_ipaddr_t addr;
+  uint16_t port;
+
+  uip_ipaddr_copy(&addr, &r->addr);
+  port = r->port;
+  request_free(r);
+  server_dispatch(&addr, port);
+}
+/*---------------------------------------------------------------------------*/
+/*- Internal API ------------------------------------------------------------*/
+/*---------------------------------------------------------------------------*/
+int
+coap_async_handle_response(uip_ipaddr_t *addr, uint16_t port,
+                           coap_packet_t *response)
+{
+  coap_async_request_t *r;
+  coap_packet_t ack[1];
+  uip_ipaddr_t from;
+  uint8_t token[TOKEN_LEN];
+  coap_message_type_t type;
+  uint32_t block_num;
+  uint16_t block_size;
+  uint16_t mid;
+  uint8_t more;
+
+  if(response->code == 0) {
+    if(response->type != COAP_TYPE_ACK && response->type != COAP_TYPE_RST) {
+      return 0;
+    }
+    /* empty ACK or RST to a request */
+    r = lookup_mid(addr, port, response->mid);
+    if(r == NULL) {
+      return 0;
+    }
+    if(response->type == COAP_TYPE_RST) {
+      request_fail(r);
+    } else {
+      PRINTF("Async: MID %u acknowledged\n", response->mid);
+      mid_remove(r);
+      r->state = STATE_ACKED;
+      ctimer_set(&r->retrans_timer, SEPARATE_RESPONSE_TIMEOUT, retransmit, r);
+    }
+    return 1;
+  }
+
+  r = lookup_token(addr, port, response->token, response->token_len);
+  if(r == NULL) {
+    return 0;
+  }
+
+  /* the callback may send, which overwrites the uIP buffer */
+  uip_ipaddr_copy(&from, addr);
+  type = response->type;
+  mid = response->mid;
+
+  more = 0;
+  if(coap_get_header_block2(response, &block_num, &more, &block_size, NULL)
+     && more) {
+    /* keep the request for the next block */
+    ctimer_stop(&r->retrans_timer);
+    if(r->state == STATE_SENT) {
+      mid_remove(r);
+    }
+    r->state = STATE_ACKED;
+    if(r->callback) {
+      /* the callback may cancel the request, so look it up again */
+      memcpy(token, r->request.token, TOKEN_LEN);
+      r->callback(r->callback_data, response);
+      r = lookup_token(&from, port, token, TOKEN_LEN);
+    }
+  } else {
+    restful_response_handler callback = r->callback;
+    void *callback_data = r->callback_data;
+
+    request_free(r);
+    r = NULL;
+    if(callback) {
+      callback(callback_data, response);
+    }
+  }
+
+  /* the payload of the response is in the uIP buffer, so answer only
+     after the callback has used it */
+  if(type == COAP_TYPE_CON) {
+    coap_init_message(ack, COAP_TYPE_ACK, 0, mid);
+    coap_send_message(&from, port, packet, coap_serialize_message(ack, packet));
+  }
+
+  if(r != NULL) {
+    coap_set_header_block2(&r->request, block_num + 1, 0, block_size);
+    request_start(r);
+  } else {
+    server_dispatch(&from, port);
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* COAP_ASYNC_CLIENT */
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *      Asynchronous CoAP client: many requests in flight at the same
+ *      time, at most COAP_NSTART of them to each server, with the
+ *      following blocks of a Block2 response requested automatically.
+ */
+
+#ifndef COAP_ASYNC_CLIENT_H_
+#define COAP_ASYNC_CLIENT_H_
+
+#include "er-coap.h"
+
+#ifndef COAP_ASYNC_CLIENT
+#define COAP_ASYNC_CLIENT 0
+#endif
+
+/* Number of requests that can be in flight or waiting to be sent */
+#ifdef COAP_CONF_MAX_ASYNC_REQUESTS
+#define COAP_MAX_ASYNC_REQUESTS COAP_CONF_MAX_ASYNC_REQUESTS
+#else
+#define COAP_MAX_ASYNC_REQUESTS 16
+#endif /* COAP_CONF_MAX_ASYNC_REQUESTS */
+
+/* Requests in flight to one server, NSTART of RFC 7252 */
+#ifdef COAP_CONF_NSTART
+#define COAP_NSTART COAP_CONF_NSTART
+#else
+#define COAP_NSTART 1
+#endif /* COAP_CONF_NSTART */
+
+/* Buckets of the tables that find a request by token and by MID */
+#ifdef COAP_CONF_ASYNC_HASH_SIZE
+#define COAP_ASYNC_HASH_SIZE COAP_CONF_ASYNC_HASH_SIZE
+#else
+#define COAP_ASYNC_HASH_SIZE 16
+#endif /* COAP_CONF_ASYNC_HASH_SIZE */
+
+/*----------------------------------------------------------------------------*/
+typedef struct coap_async_request {
+  struct coap_async_request *next;        /* for LIST, in order of arrival */
+  struct coap_async_request *token_next;  /* hash chain by token */
+  struct coap_async_request *mid_next;    /* hash chain by MID, while sent */
+
+  uip_ipaddr_t addr;
+  uint16_t port;
+  uint8_t state;
+  uint8_t retrans_counter;
+  struct ctimer retrans_timer;
+  clock_time_t retrans_interval;
+
+  restful_response_handler callback;
+  void *callback_data;
+
+  coap_packet_t request;
+} coap_async_request_t;
+
+/*----------------------------------------------------------------------------*/
+/**
+ * \brief Sends a request without waiting for the response
+ * \param addr Address of the server
+ * \param port Port of the server, in network byte order
+ * \param request The request; its options and payload must stay valid
+ *                until the last call of the callback
+ * \param callback Called with every block of the response, and with
+ *                 NULL if the server does not respond
+ * \param callback_data Passed to the callback
+ * \return The request, or NULL if COAP_MAX_ASYNC_REQUESTS are in use
+ *
+ * The request is sent at once if fewer than COAP_NSTART requests to the
+ * server are in flight, and otherwise when one of them completes. If a
+ * response has a Block2 option with the more flag set, the next block
+ * is requested after the callback returns.
+ */
+coap_async_request_t *coap_async_request(uip_ipaddr_t *addr, uint16_t port,
+                                         coap_packet_t *request,
+                                         restful_response_handler callback,
+                                         void *callback_data);
+
+/**
+ * \brief Forgets a request without calling its callback
+ *
+ * May be called from the callback of the request, which then does not
+ * request the next block.
+ */
+void coap_async_cancel(coap_async_request_t *r);
+
+/**
+ * \brief Hands a response to the request it answers
+ * \return 1 if the response belongs to an asynchronous request, else 0
+ */
+int coap_async_handle_response(uip_ipaddr_t *addr, uint16_t port,
+                               coap_packet_t *response);
+
+#endif /* COAP_ASYNC_CLIENT_H_ */
@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *      Blockwise transfers between CoAP resources and CFS files
+ */
+
+#include <string.h>
+
+#include "er-coap.h"
+#include "er-coap-block-cfs.h"
+#include "cfs/cfs.h"
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else
+#define PRINTF(...)
+#endif
+
+/*----------------------------------------------------------------------------*/
+static void
+block1_close(coap_block1_cfs_t *state)
+{
+  if(state->size) {
+    cfs_close(state->fd);
+    state->size = 0;
+  }
+}
+/*----------------------------------------------------------------------------*/
+static int
+block1_error(coap_block1_cfs_t *state, unsigned int code, char *message)
+{
+  block1_close(state);
+  erbium_status_code = code;
+  coap_error_message = message;
+  return -1;
+}
+/*----------------------------------------------------------------------------*/
+/* Seeks to offset, writing zeros up to it on a file system that does
+   not seek past the end of the file, like cfs-fat */
+static int
+block1_seek(int fd, cfs_offset_t offset)
+{
+  static const uint8_t zeros[64];
+  cfs_offset_t pos;
+  int len;
+
+  pos = cfs_seek(fd, offset, CFS_SEEK_SET);
+  while(pos >= 0 && pos < offset) {
+    len = MIN(sizeof(zeros), offset - pos);
+    if(cfs_write(fd, zeros, len) != len) {
+      return -1;
+    }
+    pos += len;
+  }
+  return pos == offset ? 0 : -1;
+}
+/*----------------------------------------------------------------------------*/
+int
+coap_block1_cfs_handler(void *request, void *response,
+                        coap_block1_cfs_t *state, const char *filename,
+                        uint32_t max_len)
+{
+  coap_packet_t *const packet = (coap_packet_t *)request;
+  const uint8_t *payload = 0;
+  uint32_t num;
+  uint16_t size;
+  uint8_t more;
+  int pay_len;
+
+  pay_len = REST.get_request_payload(request, &payload);
+  if(!pay_len || !payload) {
+    erbium_status_code = REST.status.BAD_REQUEST;
+    coap_error_message = "NoPayload";
+    return -1;
+  }
+
+  if(!IS_OPTION(packet, COAP_OPTION_BLOCK1)) {
+    /* the whole file in one request */
+    num = 0;
+    more = 0;
+    size = pay_len;
+  } else {
+    num = packet->block1_num;
+    more = packet->block1_more;
+    size = packet->block1_size;
+  }
+
+  PRINTF("Block CFS: block 1 Num: %lu, More: %u, Size: %u\n",
+         (unsigned long)num, more, size);
+
+  if(num == 0 && IS_OPTION(packet, COAP_OPTION_BLOCK1)
+     && state->size != 0 && state->size == size && state->base > 0
+     && state->port == UIP_UDP_BUF->srcport
+     && uip_ipaddr_cmp(&state->addr, &UIP_IP_BUF->srcipaddr)) {
+    /* a retransmission of the first block of the open upload, which
+       must not truncate the blocks that followed it */
+    PRINTF("Block CFS: duplicate block 0\n");
+  } else if(num == 0) {
+    /* a new upload replaces any open one */
+    block1_close(state);
+    state->fd = cfs_open(filename, CFS_WRITE);
+    if(state->fd < 0) {
+      return block1_error(state, INTERNAL_SERVER_ERROR_5_00, "OpenFailed");
+    }
+    uip_ipaddr_copy(&state->addr, &UIP_IP_BUF->srcipaddr);
+    state->port = UIP_UDP_BUF->srcport;
+    state->size = size ? size : 1;
+    state->base = 0;
+    state->window = 0;
+    state->end = 0;
+  } else if(state->size == 0 || state->size != size
+            || state->port != UIP_UDP_BUF->srcport
+            || !uip_ipaddr_cmp(&state->addr, &UIP_IP_BUF->srcipaddr)) {
+    erbium_status_code = REQUEST_ENTITY_INCOMPLETE_4_08;
+    coap_error_message = "NoUpload";
+    return -1;
+  }
+
+  if(num >= state->base + COAP_BLOCK_CFS_WINDOW) {
+    erbium_status_code = REQUEST_ENTITY_INCOMPLETE_4_08;
+    coap_error_message = "OutOfWindow";
+    return -1;
+  }
+
+  if(num * state->size + pay_len > max_len) {
+    return block1_error(state, REQUEST_ENTITY_TOO_LARGE_4_13,
+                        "Message to big");
+  }
+
+  if(num >= state->base && !(state->window & (1UL << (num - state->base)))) {
+    if(block1_seek(state->fd, num * state->size) < 0
+       || cfs_write(state->fd, payload, pay_len) != pay_len) {
+      return block1_error(state, INTERNAL_SERVER_ERROR_5_00, "WriteFailed");
+    }
+    state->window |= 1UL << (num - state->base);
+    while(state->window & 1) {
+      state->window >>= 1;
+      state->base++;
+    }
+  }
+  if(!more) {
+    state->end = num + 1;
+  }
+
+  if(IS_OPTION(packet, COAP_OPTION_BLOCK1)) {
+    coap_set_header_block1(response, num, more, size);
+  }
+
+  if(state->end && state->base >= state->end) {
+    PRINTF("Block CFS: upload of %lu blocks complete\n",
+           (unsigned long)state->end);
+    block1_close(state);
+    return 0;
+  }
+
+  coap_set_status_code(response, CONTINUE_2_31);
+  return 1;
+}
+/*----------------------------------------------------------------------------*/
+int
+coap_block2_cfs_handler(void *request, void *response,
+                        const char *filename, uint8_t *buffer,
+                        uint16_t preferred_size, int32_t *offset)
+{
+  cfs_offset_t file_size;
+  int fd;
+  int len;
+
+  fd = cfs_open(filename, CFS_READ);
+  if(fd < 0) {
+    erbium_status_code = REST.status.NOT_FOUND;
+    coap_error_message = "NoFile";
+    return -1;
+  }
+
+  file_size = cfs_seek(fd, 0, CFS_SEEK_END);
+  if(file_size < 0 || *offset > file_size) {
+    cfs_close(fd);
+    erbium_status_code = REST.status.BAD_OPTION;
+    coap_error_message = "BlockOutOfScope";
+    return -1;
+  }
+
+  len = 0;
+  if(cfs_seek(fd, *offset, CFS_SEEK_SET) == *offset) {
+    len = cfs_read(fd, buffer, preferred_size);
+  }
+  cfs_close(fd);
+  if(len < 0) {
+    len = 0;
+  }
+
+  REST.set_header_content_type(response, REST.type.APPLICATION_OCTET_STREAM);
+  REST.set_response_payload(response, buffer, len);
+  if(*offset == 0) {
+    coap_set_header_size2(response, file_size);
+  }
+
+  *offset += len;
+  if(*offset >= file_size) {
+    *offset = -1;
+  }
+  return len;
+}
+/*----------------------------------------------------------------------------*/
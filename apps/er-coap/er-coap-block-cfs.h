@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *      Blockwise transfers between CoAP resources and CFS files: Block1
+ *      uploads are written to a file and Block2 downloads are read from
+ *      one, so that resources can be larger than RAM.
+ */
+
+#ifndef COAP_BLOCK_CFS_H_
+#define COAP_BLOCK_CFS_H_
+
+#include "er-coap.h"
+
+/*
+ * Blocks of an upload that may arrive before the first missing one.
+ * At most 32.
+ */
+#ifdef COAP_CONF_BLOCK_CFS_WINDOW
+#define COAP_BLOCK_CFS_WINDOW COAP_CONF_BLOCK_CFS_WINDOW
+#else
+#define COAP_BLOCK_CFS_WINDOW 8
+#endif /* COAP_CONF_BLOCK_CFS_WINDOW */
+
+/* State of an upload, kept by the resource; zero when idle */
+typedef struct coap_block1_cfs {
+  int fd;
+  uip_ipaddr_t addr;
+  uint16_t port;
+  uint16_t size;        /* block size, 0 when no upload is open */
+  uint32_t base;        /* first block that has not been written */
+  uint32_t window;      /* blocks base..base+31 that have been written */
+  uint32_t end;         /* number of blocks, 0 until the last one came */
+} coap_block1_cfs_t;
+
+/**
+ * \brief Writes the payload of a PUT or POST request to a file
+ * \param request  Request pointer from the handler
+ * \param response Response pointer from the handler
+ * \param state    State of the upload to this resource
+ * \param filename File to write; block 0 truncates it
+ * \param max_len  Largest file that is accepted
+ * \return 0 when the file is complete, 1 if more blocks will follow,
+ *         -1 on error, with the error response set
+ *
+ * Each block is written at its own offset, so blocks within
+ * COAP_BLOCK_CFS_WINDOW of the first missing one may arrive in any
+ * order. On a file system that cannot seek past the end of a file,
+ * like cfs-fat, the gap before such a block is filled with zeros until
+ * the missing blocks overwrite it. A block that arrives before earlier
+ * ones is answered with 2.31 Continue, even if it is the last one; the
+ * request that completes the file gets the final response. The file
+ * stays open from block 0 until the upload is complete or block 0 of a
+ * new one arrives.
+ */
+int coap_block1_cfs_handler(void *request, void *response,
+                            coap_block1_cfs_t *state, const char *filename,
+                            uint32_t max_len);
+
+/**
+ * \brief Answers a GET request with a block of a file
+ * \param request        Request pointer from the handler
+ * \param response       Response pointer from the handler
+ * \param filename       File to read
+ * \param buffer         Buffer from the handler
+ * \param preferred_size Block size from the handler
+ * \param offset         Offset from the handler
+ * \return Length of the block, or -1 if the file cannot be read
+ *
+ * The block at *offset is read from the file, and *offset is set to the
+ * next block, or to -1 after the last one. No state is kept between
+ * blocks, so clients may request them in any order and several at once.
+ */
+int coap_block2_cfs_handler(void *request, void *response,
+                            const char *filename, uint8_t *buffer,
+                            uint16_t preferred_size, int32_t *offset);
+
+#endif /* COAP_BLOCK_CFS_H_ */
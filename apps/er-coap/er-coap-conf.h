@@ -68,6 +68,35 @@
 #define COAP_MAX_OBSERVERS    COAP_MAX_OPEN_TRANSACTIONS - 1
 #endif /* COAP_MAX_OBSERVERS */
 
+/*
+ * Render a notification once for all observers of a resource and patch in
+ * the token, MID and Observe option of each observer when sending it.
+ * Confirmable notifications are retransmitted from the observer record
+ * instead of a transaction, so observers do not take packet buffers.
+ */
+#ifndef COAP_OBSERVE_SHARED_NOTIFY
+#define COAP_OBSERVE_SHARED_NOTIFY     0
+#endif /* COAP_OBSERVE_SHARED_NOTIFY */
+
+/* Number of rendered notifications that can be in use at the same time */
+#ifndef COAP_MAX_OBSERVE_NOTIFICATIONS
+#define COAP_MAX_OBSERVE_NOTIFICATIONS 2
+#endif /* COAP_MAX_OBSERVE_NOTIFICATIONS */
+
+/*
+ * Offer coap_index_message(), which records where the options of a
+ * message are instead of decoding them, and serialize responses in
+ * front of the payload the resource wrote instead of moving it.
+ */
+#ifndef COAP_ZERO_COPY
+#define COAP_ZERO_COPY                 0
+#endif /* COAP_ZERO_COPY */
+
+/* Number of options coap_index_message() can record */
+#ifndef COAP_MAX_INDEXED_OPTIONS
+#define COAP_MAX_INDEXED_OPTIONS       8
+#endif /* COAP_MAX_INDEXED_OPTIONS */
+
 /* Interval in notifies in which NON notifies are changed to CON notifies to check client. */
 #define COAP_OBSERVE_REFRESH_INTERVAL  20
 
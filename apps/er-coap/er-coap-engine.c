@@ -208,12 +208,24 @@ coap_receive(void)
                 /* serialize response */
             }
             if(erbium_status_code == NO_ERROR) {
+#if COAP_ZERO_COPY
+              /* the payload stays where the resource wrote it */
+              if((transaction->packet_len =
+                    coap_serialize_message_in_place(response,
+                                                    transaction->packet))) {
+                transaction->packet_offset = response->buffer -
+                  transaction->packet;
+              } else {
+                erbium_status_code = PACKET_SERIALIZATION_ERROR;
+              }
+#else
               if((transaction->packet_len = coap_serialize_message(response,
                                                                    transaction->
                                                                    packet)) ==
                  0) {
                 erbium_status_code = PACKET_SERIALIZATION_ERROR;
               }
+#endif /* COAP_ZERO_COPY */
             }
           } else {
             erbium_status_code = NOT_IMPLEMENTED_5_01;
@@ -233,6 +245,10 @@ coap_receive(void)
         } else if(message->type == COAP_TYPE_ACK) {
           /* transactions are closed through lookup below */
           PRINTF("Received ACK\n");
+#if COAP_OBSERVE_SHARED_NOTIFY
+          coap_observe_acked(&UIP_IP_BUF->srcipaddr, UIP_UDP_BUF->srcport,
+                             message->mid);
+#endif /* COAP_OBSERVE_SHARED_NOTIFY */
         } else if(message->type == COAP_TYPE_RST) {
           PRINTF("Received RST\n");
           /* cancel possible subscriptions */
@@ -240,6 +256,12 @@ coap_receive(void)
                                       UIP_UDP_BUF->srcport, message->mid);
         }
 
+#if COAP_ASYNC_CLIENT
+        if(coap_async_handle_response(&UIP_IP_BUF->srcipaddr,
+                                      UIP_UDP_BUF->srcport, message)) {
+          PRINTF("Response to an asynchronous request\n");
+        } else
+#endif /* COAP_ASYNC_CLIENT */
         if((transaction = coap_get_transaction_by_mid(message->mid))) {
           /* free transaction memory before callback, as it may create a new transaction */
           restful_response_handler callback = transaction->callback;
@@ -350,6 +372,9 @@ PROCESS_THREAD(coap_engine, ev, data)
     } else if(ev == PROCESS_EVENT_TIMER) {
       /* retransmissions are handled here */
       coap_check_transactions();
+#if COAP_OBSERVE_SHARED_NOTIFY
+      coap_check_notifications();
+#endif /* COAP_OBSERVE_SHARED_NOTIFY */
     }
   } /* while (1) */
 
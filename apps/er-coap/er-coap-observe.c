@@ -55,6 +55,159 @@
 /*---------------------------------------------------------------------------*/
 MEMB(observers_memb, coap_observer_t, COAP_MAX_OBSERVERS);
 LIST(observers_list);
+
+#if COAP_OBSERVE_SHARED_NOTIFY
+/* A notification serialized once without token and with an empty Observe
+ * option, which is replaced by the one of each observer when sending. */
+typedef struct coap_notification {
+  uint8_t refcount;
+  uint8_t observe_delta;        /* option delta of Observe, 0 if absent */
+  uint16_t observe_start;       /* Observe option in packet */
+  uint16_t observe_end;
+  uint16_t packet_len;
+  uint8_t packet[COAP_MAX_PACKET_SIZE + 1];
+} coap_notification_t;
+
+MEMB(notifications_memb, coap_notification_t, COAP_MAX_OBSERVE_NOTIFICATIONS);
+
+PROCESS_NAME(coap_engine);
+#endif /* COAP_OBSERVE_SHARED_NOTIFY */
+#if COAP_OBSERVE_SHARED_NOTIFY
+/*---------------------------------------------------------------------------*/
+static void
+notification_release(coap_notification_t *n)
+{
+  if(--n->refcount == 0) {
+    memb_free(&notifications_memb, n);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static coap_notification_t *
+render_notification(resource_t *resource)
+{
+  coap_packet_t notification[1];
+  coap_notification_t *n;
+  unsigned int number, delta, length, start, pos;
+
+  n = memb_alloc(&notifications_memb);
+  if(n == NULL) {
+    return NULL;
+  }
+
+  coap_init_message(notification, COAP_TYPE_NON, CONTENT_2_05, 0);
+  resource->get_handler(NULL, notification,
+                        n->packet + COAP_MAX_HEADER_SIZE,
+                        REST_MAX_CHUNK_SIZE, NULL);
+  if(notification->code < BAD_REQUEST_4_00) {
+    coap_set_header_observe(notification, 0);
+  }
+  n->packet_len = coap_serialize_message(notification, n->packet);
+  if(n->packet_len == 0) {
+    memb_free(&notifications_memb, n);
+    return NULL;
+  }
+
+  /* find the Observe option */
+  n->refcount = 1;
+  n->observe_delta = 0;
+  n->observe_start = n->observe_end = COAP_HEADER_LEN;
+  number = 0;
+  pos = COAP_HEADER_LEN;
+  while(pos < n->packet_len && n->packet[pos] != 0xFF) {
+    start = pos;
+    delta = n->packet[pos] >> 4;
+    length = n->packet[pos] & 0x0F;
+    ++pos;
+    if(delta == 13) {
+      delta = 13 + n->packet[pos++];
+    } else if(delta == 14) {
+      delta = 269 + ((n->packet[pos] << 8) | n->packet[pos + 1]);
+      pos += 2;
+    }
+    if(length == 13) {
+      length = 13 + n->packet[pos++];
+    } else if(length == 14) {
+      length = 269 + ((n->packet[pos] << 8) | n->packet[pos + 1]);
+      pos += 2;
+    }
+    pos += length;
+    number += delta;
+    if(number == COAP_OPTION_OBSERVE) {
+      n->observe_delta = delta;
+      n->observe_start = start;
+      n->observe_end = pos;
+      break;
+    }
+    n->observe_start = n->observe_end = pos;
+  }
+  if(n->observe_delta == 0) {
+    /* no Observe option: the token goes right after the header */
+    n->observe_start = n->observe_end = COAP_HEADER_LEN;
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_notification(coap_observer_t *obs, coap_notification_t *n,
+                  coap_message_type_t type, uint32_t observe)
+{
+  static uint8_t packet[COAP_MAX_PACKET_SIZE + 1];
+  uint16_t len;
+  uint8_t observe_len;
+
+  /* a retransmission keeps the MID unless the state was replaced */
+  if(!obs->notification || obs->replaced) {
+    /* update last MID for RST matching */
+    obs->last_mid = coap_get_mid();
+    obs->replaced = 0;
+  }
+  packet[0] = (n->packet[0] & COAP_HEADER_VERSION_MASK)
+    | (COAP_HEADER_TYPE_MASK & type << COAP_HEADER_TYPE_POSITION)
+    | (COAP_HEADER_TOKEN_LEN_MASK & obs->token_len);
+  packet[1] = n->packet[1];
+  packet[2] = (uint8_t)(obs->last_mid >> 8);
+  packet[3] = (uint8_t)obs->last_mid;
+  len = COAP_HEADER_LEN;
+  memcpy(packet + len, obs->token, obs->token_len);
+  len += obs->token_len;
+
+  memcpy(packet + len, n->packet + COAP_HEADER_LEN,
+         n->observe_start - COAP_HEADER_LEN);
+  len += n->observe_start - COAP_HEADER_LEN;
+  if(n->observe_delta) {
+    for(observe_len = 0; observe_len < 4 && (observe >> (8 * observe_len));
+        ++observe_len);
+    packet[len++] = (n->observe_delta << 4) | observe_len;
+    while(observe_len > 0) {
+      packet[len++] = (uint8_t)(observe >> (8 * --observe_len));
+    }
+  }
+  memcpy(packet + len, n->packet + n->observe_end,
+         n->packet_len - n->observe_end);
+  len += n->packet_len - n->observe_end;
+
+  coap_send_message(&obs->addr, obs->port, packet, len);
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_retrans_timer(coap_observer_t *obs)
+{
+  clock_time_t interval;
+
+  if(obs->retrans_counter == 0) {
+    interval = COAP_RESPONSE_TIMEOUT_TICKS
+      + (random_rand() % (clock_time_t)COAP_RESPONSE_TIMEOUT_BACKOFF_MASK);
+  } else {
+    interval = obs->retrans_timer.timer.interval << 1;
+  }
+
+  /* the timer events go to the engine, which calls
+     coap_check_notifications() */
+  PROCESS_CONTEXT_BEGIN(&coap_engine);
+  etimer_set(&obs->retrans_timer, interval);
+  PROCESS_CONTEXT_END(&coap_engine);
+}
+#endif /* COAP_OBSERVE_SHARED_NOTIFY */
 /*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
@@ -74,6 +227,10 @@ coap_add_observer(uip_ipaddr_t *addr, uint16_t port, const uint8_t *token,
     o->token_len = token_len;
     memcpy(o->token, token, token_len);
     o->last_mid = 0;
+#if COAP_OBSERVE_SHARED_NOTIFY
+    o->notification = NULL;
+    o->replaced = 0;
+#endif /* COAP_OBSERVE_SHARED_NOTIFY */
 
     PRINTF("Adding observer (%u/%u) for /%s [0x%02X%02X]\n",
            list_length(observers_list) + 1, COAP_MAX_OBSERVERS,
@@ -92,6 +249,13 @@ coap_remove_observer(coap_observer_t *o)
   PRINTF("Removing observer for /%s [0x%02X%02X]\n", o->url, o->token[0],
          o->token[1]);
 
+#if COAP_OBSERVE_SHARED_NOTIFY
+  if(o->notification) {
+    etimer_stop(&o->retrans_timer);
+    notification_release(o->notification);
+  }
+#endif /* COAP_OBSERVE_SHARED_NOTIFY */
+
   memb_free(&observers_memb, o);
   list_remove(observers_list, o);
 }
@@ -175,6 +339,102 @@ coap_remove_observer_by_mid(uip_ipaddr_t *addr, uint16_t port, uint16_t mid)
 /*---------------------------------------------------------------------------*/
 /*- Notification ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
+#if COAP_OBSERVE_SHARED_NOTIFY
+void
+coap_notify_observers(resource_t *resource)
+{
+  coap_notification_t *n = NULL;
+  coap_observer_t *obs = NULL;
+  coap_message_type_t type;
+  uint32_t observe;
+
+  PRINTF("Observe: Notification from %s\n", resource->url);
+
+  /* iterate over observers */
+  for(obs = (coap_observer_t *)list_head(observers_list); obs;
+      obs = obs->next) {
+    if(obs->url == resource->url) {     /* using RESOURCE url pointer as handle */
+      if(n == NULL && (n = render_notification(resource)) == NULL) {
+        PRINTF("           No memory to render notification\n");
+        return;
+      }
+
+      PRINTF("           Observer ");
+      PRINT6ADDR(&obs->addr);
+      PRINTF(":%u\n", obs->port);
+
+      type = obs->obs_counter % COAP_OBSERVE_REFRESH_INTERVAL == 0 ?
+        COAP_TYPE_CON : COAP_TYPE_NON;
+      observe = n->observe_delta ? (obs->obs_counter)++ : 0;
+
+      if(obs->notification) {
+        /* the new state replaces the unacknowledged one and goes out
+           with its next retransmission */
+        notification_release(obs->notification);
+        obs->notification = n;
+        ++n->refcount;
+        obs->replaced = 1;
+      } else if(type == COAP_TYPE_CON) {
+        PRINTF("           Force Confirmable\n");
+        obs->retrans_counter = 0;
+        set_retrans_timer(obs);
+        send_notification(obs, n, COAP_TYPE_CON, observe);
+        obs->notification = n;
+        ++n->refcount;
+      } else {
+        send_notification(obs, n, type, observe);
+      }
+    }
+  }
+
+  if(n) {
+    notification_release(n);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_observe_acked(uip_ipaddr_t *addr, uint16_t port, uint16_t mid)
+{
+  coap_observer_t *obs = NULL;
+
+  for(obs = (coap_observer_t *)list_head(observers_list); obs;
+      obs = obs->next) {
+    if(obs->notification && obs->last_mid == mid
+       && uip_ipaddr_cmp(&obs->addr, addr) && obs->port == port) {
+      PRINTF("Notification %u acknowledged\n", mid);
+      etimer_stop(&obs->retrans_timer);
+      notification_release(obs->notification);
+      obs->notification = NULL;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+coap_check_notifications(void)
+{
+  coap_observer_t *obs = NULL;
+  coap_observer_t *next = NULL;
+
+  for(obs = (coap_observer_t *)list_head(observers_list); obs; obs = next) {
+    next = obs->next;
+    if(obs->notification && etimer_expired(&obs->retrans_timer)) {
+      if(obs->retrans_counter < COAP_MAX_RETRANSMIT) {
+        ++(obs->retrans_counter);
+        PRINTF("Retransmitting notification %u (%u)\n", obs->last_mid,
+               obs->retrans_counter);
+        set_retrans_timer(obs);
+        send_notification(obs, obs->notification, COAP_TYPE_CON,
+                          obs->obs_counter - 1);
+      } else {
+        PRINTF("Notification timeout\n");
+        coap_remove_observer_by_client(&obs->addr, obs->port);
+        /* other observers may have been removed, start over */
+        next = (coap_observer_t *)list_head(observers_list);
+      }
+    }
+  }
+}
+#else /* COAP_OBSERVE_SHARED_NOTIFY */
 void
 coap_notify_observers(resource_t *resource)
 {
@@ -218,14 +478,24 @@ coap_notify_observers(resource_t *resource)
         }
         coap_set_token(notification, obs->token, obs->token_len);
 
+#if COAP_ZERO_COPY
+        transaction->packet_len =
+          coap_serialize_message_in_place(notification, transaction->packet);
+        if(transaction->packet_len) {
+          transaction->packet_offset = notification->buffer -
+            transaction->packet;
+        }
+#else
         transaction->packet_len =
           coap_serialize_message(notification, transaction->packet);
+#endif /* COAP_ZERO_COPY */
 
         coap_send_transaction(transaction);
       }
     }
   }
 }
+#endif /* COAP_OBSERVE_SHARED_NOTIFY */
 /*---------------------------------------------------------------------------*/
 void
 coap_observe_handler(resource_t *resource, void *request, void *response)
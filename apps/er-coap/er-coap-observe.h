@@ -51,6 +51,8 @@ typedef struct coap_observable {
   uint8_t buffer[COAP_MAX_PACKET_SIZE + 1];
 } coap_observable_t;
 
+struct coap_notification;
+
 typedef struct coap_observer {
   struct coap_observer *next;   /* for LIST */
 
@@ -65,6 +67,13 @@ typedef struct coap_observer {
 
   struct etimer retrans_timer;
   uint8_t retrans_counter;
+#if COAP_OBSERVE_SHARED_NOTIFY
+  /* confirmable notification waiting for an ACK */
+  struct coap_notification *notification;
+  /* the notification changed since it was last sent, so its next
+     retransmission needs a new MID */
+  uint8_t replaced;
+#endif /* COAP_OBSERVE_SHARED_NOTIFY */
 } coap_observer_t;
 
 list_t coap_get_observers(void);
@@ -83,6 +92,10 @@ int coap_remove_observer_by_mid(uip_ipaddr_t *addr, uint16_t port,
                                 uint16_t mid);
 
 void coap_notify_observers(resource_t *resource);
+#if COAP_OBSERVE_SHARED_NOTIFY
+void coap_observe_acked(uip_ipaddr_t *addr, uint16_t port, uint16_t mid);
+void coap_check_notifications(void);
+#endif /* COAP_OBSERVE_SHARED_NOTIFY */
 
 void coap_observe_handler(resource_t *resource, void *request,
                           void *response);
@@ -75,6 +75,9 @@ coap_new_transaction(uint16_t mid, uip_ipaddr_t *addr, uint16_t port)
   if(t) {
     t->mid = mid;
     t->retrans_counter = 0;
+#if COAP_ZERO_COPY
+    t->packet_offset = 0;
+#endif /* COAP_ZERO_COPY */
 
     /* save client address */
     uip_ipaddr_copy(&t->addr, addr);
@@ -91,10 +94,16 @@ coap_send_transaction(coap_transaction_t *t)
 {
   PRINTF("Sending transaction %u\n", t->mid);
 
-  coap_send_message(&t->addr, t->port, t->packet, t->packet_len);
+#if COAP_ZERO_COPY
+  uint8_t *packet = t->packet + t->packet_offset;
+#else
+  uint8_t *packet = t->packet;
+#endif /* COAP_ZERO_COPY */
+
+  coap_send_message(&t->addr, t->port, packet, t->packet_len);
 
   if(COAP_TYPE_CON ==
-     ((COAP_HEADER_TYPE_MASK & t->packet[0]) >> COAP_HEADER_TYPE_POSITION)) {
+     ((COAP_HEADER_TYPE_MASK & packet[0]) >> COAP_HEADER_TYPE_POSITION)) {
     if(t->retrans_counter < COAP_MAX_RETRANSMIT) {
       /* not timed out yet */
       PRINTF("Keeping transaction %u\n", t->mid);
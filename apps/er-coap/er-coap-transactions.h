@@ -63,6 +63,9 @@ typedef struct coap_transaction {
   void *callback_data;
 
   uint16_t packet_len;
+#if COAP_ZERO_COPY
+  uint8_t packet_offset;        /* message serialized in place starts here */
+#endif /* COAP_ZERO_COPY */
   uint8_t packet[COAP_MAX_PACKET_SIZE + 1];     /* +1 for the terminating '\0' which will not be sent
                                                  * Use snprintf(buf, len+1, "", ...) to completely fill payload */
 } coap_transaction_t;
@@ -271,6 +271,29 @@ coap_get_variable(const char *buffer, size_t length, const char *name,
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+#if COAP_ZERO_COPY
+static uint8_t *
+coap_index_option_field(uint8_t *current, uint8_t *end, unsigned int *x)
+{
+  if(*x == 13) {
+    if(current + 1 > end) {
+      return NULL;
+    }
+    *x = 13 + current[0];
+    return current + 1;
+  } else if(*x == 14) {
+    if(current + 2 > end) {
+      return NULL;
+    }
+    *x = 269 + (current[0] << 8 | current[1]);
+    return current + 2;
+  } else if(*x == 15) {
+    return NULL;
+  }
+  return current;
+}
+#endif /* COAP_ZERO_COPY */
+/*---------------------------------------------------------------------------*/
 /*- Internal API ------------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
 void
@@ -418,6 +441,43 @@ coap_serialize_message(void *packet, uint8_t *buffer)
   return (option - buffer) + coap_pkt->payload_len; /* packet length */
 }
 /*---------------------------------------------------------------------------*/
+#if COAP_ZERO_COPY
+size_t
+coap_serialize_message_in_place(void *packet, uint8_t *buffer)
+{
+  coap_packet_t *const coap_pkt = (coap_packet_t *)packet;
+  uint16_t payload_len = coap_pkt->payload_len;
+  size_t header_len;
+  uint8_t *start;
+
+  /* only a payload in the headroom of the buffer can stay where it is */
+  if(!coap_pkt->code || !payload_len
+     || coap_pkt->payload != buffer + COAP_MAX_HEADER_SIZE) {
+    return coap_serialize_message(packet, buffer);
+  }
+
+  /* write header and options at the start of the headroom */
+  coap_pkt->payload_len = 0;
+  header_len = coap_serialize_message(packet, buffer);
+  coap_pkt->payload_len = payload_len;
+  if(header_len == 0 || header_len + 1 > COAP_MAX_HEADER_SIZE) {
+    /* no room for the payload marker */
+    return coap_serialize_message(packet, buffer);
+  }
+
+  /* and move them in front of the payload marker */
+  start = coap_pkt->payload - 1 - header_len;
+  memmove(start, buffer, header_len);
+  start[header_len] = 0xFF;
+  coap_pkt->buffer = start;
+
+  PRINTF("-Done %u B in place at offset %u-\n", header_len + 1 + payload_len,
+         start - buffer);
+
+  return header_len + 1 + payload_len;
+}
+#endif /* COAP_ZERO_COPY */
+/*---------------------------------------------------------------------------*/
 void
 coap_send_message(uip_ipaddr_t *addr, uint16_t port, uint8_t *data,
                   uint16_t length)
@@ -679,6 +739,117 @@ coap_parse_message(void *packet, uint8_t *data, uint16_t data_len)
   return NO_ERROR;
 }
 /*---------------------------------------------------------------------------*/
+#if COAP_ZERO_COPY
+coap_status_t
+coap_index_message(coap_index_t *index, uint8_t *data, uint16_t data_len)
+{
+  uint8_t *current_option = data + COAP_HEADER_LEN;
+  uint8_t *end = data + data_len;
+  unsigned int option_number = 0;
+  unsigned int option_delta;
+  unsigned int option_length;
+  coap_option_ref_t *ref;
+
+  if(data_len < COAP_HEADER_LEN) {
+    coap_error_message = "Message too short";
+    return BAD_REQUEST_4_00;
+  }
+
+  /* parse header fields */
+  index->buffer = data;
+  index->type = (COAP_HEADER_TYPE_MASK & data[0]) >> COAP_HEADER_TYPE_POSITION;
+  index->token_len = (COAP_HEADER_TOKEN_LEN_MASK & data[0])
+    >> COAP_HEADER_TOKEN_LEN_POSITION;
+  index->code = data[1];
+  index->mid = data[2] << 8 | data[3];
+  index->option_count = 0;
+  index->payload = NULL;
+  index->payload_len = 0;
+
+  if(((COAP_HEADER_VERSION_MASK & data[0]) >> COAP_HEADER_VERSION_POSITION)
+     != 1) {
+    coap_error_message = "CoAP version must be 1";
+    return BAD_REQUEST_4_00;
+  }
+  if(index->token_len > COAP_TOKEN_LEN
+     || current_option + index->token_len > end) {
+    coap_error_message = "Invalid token";
+    return BAD_REQUEST_4_00;
+  }
+  current_option += index->token_len;
+
+  /* only record where the options are */
+  while(current_option < end) {
+    if(current_option[0] == 0xFF) {
+      index->payload = current_option + 1;
+      index->payload_len = end - index->payload;
+      break;
+    }
+
+    option_delta = current_option[0] >> 4;
+    option_length = current_option[0] & 0x0F;
+    ++current_option;
+    current_option = coap_index_option_field(current_option, end,
+                                             &option_delta);
+    if(current_option) {
+      current_option = coap_index_option_field(current_option, end,
+                                               &option_length);
+    }
+    if(current_option == NULL || current_option + option_length > end) {
+      coap_error_message = "Invalid option";
+      return BAD_OPTION_4_02;
+    }
+    if(index->option_count == COAP_MAX_INDEXED_OPTIONS) {
+      coap_error_message = "Too many options";
+      return BAD_OPTION_4_02;
+    }
+
+    option_number += option_delta;
+    ref = &index->options[index->option_count++];
+    ref->number = option_number;
+    ref->offset = current_option - data;
+    ref->length = option_length;
+
+    current_option += option_length;
+  }
+
+  return NO_ERROR;
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_index_get_option(coap_index_t *index, unsigned int number,
+                      unsigned int n, const uint8_t **value)
+{
+  coap_option_ref_t *ref;
+
+  for(ref = index->options;
+      ref < index->options + index->option_count && ref->number <= number;
+      ++ref) {
+    if(ref->number == number && n-- == 0) {
+      if(value) {
+        *value = index->buffer + ref->offset;
+      }
+      return ref->length;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+int
+coap_index_get_int_option(coap_index_t *index, unsigned int number,
+                          uint32_t *value)
+{
+  const uint8_t *bytes;
+  int length = coap_index_get_option(index, number, 0, &bytes);
+
+  if(length < 0 || length > 4) {
+    return 0;
+  }
+  *value = coap_parse_int_option((uint8_t *)bytes, length);
+  return 1;
+}
+#endif /* COAP_ZERO_COPY */
+/*---------------------------------------------------------------------------*/
 /*- REST Engine API ---------------------------------------------------------*/
 /*---------------------------------------------------------------------------*/
 int
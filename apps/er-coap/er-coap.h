@@ -132,6 +132,31 @@ typedef struct {
   uint8_t *payload;
 } coap_packet_t;
 
+#if COAP_ZERO_COPY
+/* position of an option value in the buffer of an indexed message */
+typedef struct {
+  uint16_t number;
+  uint16_t offset;
+  uint16_t length;
+} coap_option_ref_t;
+
+/* message of which only the header and the option positions are parsed */
+typedef struct {
+  uint8_t *buffer; /* the token starts at buffer + COAP_HEADER_LEN */
+
+  uint8_t type;
+  uint8_t code;
+  uint16_t mid;
+  uint8_t token_len;
+
+  uint8_t option_count;
+  coap_option_ref_t options[COAP_MAX_INDEXED_OPTIONS]; /* in the order of their number */
+
+  uint16_t payload_len;
+  uint8_t *payload;
+} coap_index_t;
+#endif /* COAP_ZERO_COPY */
+
 /* option format serialization */
 #define COAP_SERIALIZE_INT_OPTION(number, field, text) \
   if(IS_OPTION(coap_pkt, number)) { \
@@ -187,6 +212,16 @@ void coap_send_message(uip_ipaddr_t *addr, uint16_t port, uint8_t *data,
 coap_status_t coap_parse_message(void *request, uint8_t *data,
                                  uint16_t data_len);
 
+#if COAP_ZERO_COPY
+size_t coap_serialize_message_in_place(void *packet, uint8_t *buffer); /* message starts at packet->buffer */
+coap_status_t coap_index_message(coap_index_t *index, uint8_t *data,
+                                 uint16_t data_len); /* buffer is not modified */
+int coap_index_get_option(coap_index_t *index, unsigned int number,
+                          unsigned int n, const uint8_t **value); /* n-th option of that number, returns length or -1 */
+int coap_index_get_int_option(coap_index_t *index, unsigned int number,
+                              uint32_t *value);
+#endif /* COAP_ZERO_COPY */
+
 int coap_get_query_variable(void *packet, const char *name,
                             const char **output);
 int coap_get_post_variable(void *packet, const char *name,
@@ -54,6 +54,9 @@
 #include "dev/leds.h"
 
 #include "tcp-socket.h"
+#if MQTT_SPOOL
+#include "cfs/cfs.h"
+#endif /* MQTT_SPOOL */
 
 #include "lib/assert.h"
 #include "lib/list.h"
@@ -125,8 +128,28 @@ typedef enum {
 /*---------------------------------------------------------------------------*/
 #define RESPONSE_WAIT_TIMEOUT (CLOCK_SECOND * 10)
 /*---------------------------------------------------------------------------*/
+#if MQTT_SPOOL
+#define MQTT_SPOOL_HEAD_FILE MQTT_SPOOL_FILE ".head"
+#endif /* MQTT_SPOOL */
+/*---------------------------------------------------------------------------*/
 #define INCREMENT_MID(conn)   (conn)->mid_counter += 2
 #define MQTT_STRING_LENGTH(s) (((s)->length) == 0 ? 0 : (MQTT_STRING_LEN_SIZE + (s)->length))
+#define IN_PACKET_LENGTH(conn)                                                 \
+  (MQTT_FHDR_SIZE + (conn)->in_packet.remaining_length_bytes +                 \
+   (conn)->in_packet.remaining_length)
+/*---------------------------------------------------------------------------*/
+#if MQTT_PUBLISH_WINDOW
+/*
+ * A queued PUBLISH takes its message ID from its offset in the queue, so that
+ * it keeps the ID when it is sent again after a reconnect or a reboot. These
+ * IDs are even and those from INCREMENT_MID odd. The messages in flight span
+ * less than 32767 bytes, so their IDs differ.
+ */
+#define QUEUE_MID(offset)     ((uint16_t)(((offset) % 32767 + 1) << 1))
+#if MQTT_MAX_INFLIGHT * MQTT_TCP_OUTPUT_BUFF_SIZE >= 32767
+#error MQTT_MAX_INFLIGHT * MQTT_TCP_OUTPUT_BUFF_SIZE must be below 32767
+#endif
+#endif /* MQTT_PUBLISH_WINDOW */
 /*---------------------------------------------------------------------------*/
 /* Protothread send macros */
 #define PT_MQTT_WRITE_BYTES(conn, data, len)                                   \
@@ -220,6 +243,17 @@ abort_connection(struct mqtt_connection *conn)
   /* Reset outgoing packet */
   memset(&conn->out_packet, 0, sizeof(conn->out_packet));
 
+#if MQTT_PUBLISH_WINDOW
+  /* Send the messages that are not complete again after reconnecting */
+  conn->inflight_count = 0;
+  conn->pending_event = 0;
+  conn->publish_posted = 0;
+  if(conn->queue_send > conn->queue_resend) {
+    conn->queue_resend = conn->queue_send;
+  }
+  conn->queue_send = conn->queue_head;
+#endif /* MQTT_PUBLISH_WINDOW */
+
   tcp_socket_close(&conn->socket);
   tcp_socket_unregister(&conn->socket);
 
@@ -623,6 +657,7 @@ PT_THREAD(unsubscribe_pt(struct pt *pt, struct mqtt_connection *conn))
   PT_END(pt);
 }
 /*---------------------------------------------------------------------------*/
+#if !MQTT_PUBLISH_WINDOW
 static
 PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
 {
@@ -710,6 +745,368 @@ PT_THREAD(publish_pt(struct pt *pt, struct mqtt_connection *conn))
 
   PT_END(pt);
 }
+#endif /* !MQTT_PUBLISH_WINDOW */
+/*---------------------------------------------------------------------------*/
+#if MQTT_PUBLISH_WINDOW
+/*
+ * The queue holds PUBLISH packets, each preceded by its length in two bytes.
+ * Offsets into the queue only grow until it is drained. The message ID is
+ * written when a packet is sent.
+ */
+static int
+queue_write(struct mqtt_connection *conn, int fd, const uint8_t *data,
+            uint16_t len)
+{
+#if MQTT_SPOOL
+  if(cfs_write(fd, data, len) != len) {
+    return -1;
+  }
+#else
+  uint16_t offset;
+  uint16_t first;
+
+  offset = conn->queue_tail % MQTT_QUEUE_SIZE;
+  first = MIN(len, MQTT_QUEUE_SIZE - offset);
+  memcpy(&conn->queue[offset], data, first);
+  memcpy(conn->queue, data + first, len - first);
+#endif /* MQTT_SPOOL */
+  conn->queue_tail += len;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+queue_read(struct mqtt_connection *conn, uint32_t offset, uint8_t *data,
+           uint16_t len)
+{
+#if MQTT_SPOOL
+  int fd;
+  int ret = -1;
+
+  fd = cfs_open(MQTT_SPOOL_FILE, CFS_READ);
+  if(fd < 0) {
+    return -1;
+  }
+  if(cfs_seek(fd, offset, CFS_SEEK_SET) == (cfs_offset_t)offset &&
+     cfs_read(fd, data, len) == len) {
+    ret = 0;
+  }
+  cfs_close(fd);
+  return ret;
+#else
+  uint16_t first;
+
+  offset %= MQTT_QUEUE_SIZE;
+  first = MIN(len, MQTT_QUEUE_SIZE - offset);
+  memcpy(data, &conn->queue[offset], first);
+  memcpy(data + first, conn->queue, len - first);
+  return 0;
+#endif /* MQTT_SPOOL */
+}
+/*---------------------------------------------------------------------------*/
+#if MQTT_SPOOL
+static void
+spool_save_head(struct mqtt_connection *conn)
+{
+  uint8_t head[4];
+  int fd;
+
+  head[0] = conn->queue_head >> 24;
+  head[1] = conn->queue_head >> 16;
+  head[2] = conn->queue_head >> 8;
+  head[3] = conn->queue_head;
+
+  fd = cfs_open(MQTT_SPOOL_HEAD_FILE, CFS_WRITE);
+  if(fd < 0) {
+    PRINTF("MQTT - Error, could not save the spool head\n");
+    return;
+  }
+  cfs_write(fd, head, sizeof(head));
+  cfs_close(fd);
+}
+/*---------------------------------------------------------------------------*/
+/* Pick up the messages that were not complete before a reboot */
+static void
+spool_recover(struct mqtt_connection *conn)
+{
+  uint8_t head[4];
+  uint32_t offset = 0;
+  cfs_offset_t tail = 0;
+  int fd;
+
+  fd = cfs_open(MQTT_SPOOL_HEAD_FILE, CFS_READ);
+  if(fd >= 0) {
+    if(cfs_read(fd, head, sizeof(head)) == sizeof(head)) {
+      offset = (uint32_t)head[0] << 24 | (uint32_t)head[1] << 16 |
+        (uint32_t)head[2] << 8 | head[3];
+    }
+    cfs_close(fd);
+  }
+  fd = cfs_open(MQTT_SPOOL_FILE, CFS_READ);
+  if(fd >= 0) {
+    tail = cfs_seek(fd, 0, CFS_SEEK_END);
+    cfs_close(fd);
+  }
+
+  if(tail <= 0 || offset >= (uint32_t)tail) {
+    cfs_remove(MQTT_SPOOL_FILE);
+    cfs_remove(MQTT_SPOOL_HEAD_FILE);
+    return;
+  }
+
+  DBG("MQTT - Recovered %lu bytes from the spool\n",
+      (unsigned long)(tail - offset));
+
+  /* All of them may have been sent before */
+  conn->queue_head = offset;
+  conn->queue_send = offset;
+  conn->queue_tail = tail;
+  conn->queue_resend = tail;
+}
+#endif /* MQTT_SPOOL */
+/*---------------------------------------------------------------------------*/
+/*
+ * Posts the publish event unless it is pending already. The sending loops
+ * post the events they do not handle again, so every extra one would stay
+ * around until they are done.
+ */
+static void
+post_publish(struct mqtt_connection *conn)
+{
+  if(!conn->publish_posted) {
+    conn->publish_posted =
+      process_post(&mqtt_process, mqtt_do_publish_event, conn) ==
+      PROCESS_ERR_OK;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Remove the complete messages at the head of the queue */
+static void
+queue_advance(struct mqtt_connection *conn)
+{
+  struct mqtt_inflight *slot;
+  uint32_t head = conn->queue_head;
+
+  while(conn->inflight_count > 0) {
+    slot = &conn->inflight[conn->inflight_first];
+    if(slot->qos_state != MQTT_QOS_STATE_GOT_ACK) {
+      break;
+    }
+    conn->queue_head = slot->offset + slot->length;
+    conn->inflight_first = (conn->inflight_first + 1) % MQTT_MAX_INFLIGHT;
+    conn->inflight_count--;
+  }
+
+  if(conn->queue_head == head) {
+    return;
+  }
+
+  if(conn->queue_head == conn->queue_tail) {
+    conn->queue_head = 0;
+    conn->queue_send = 0;
+    conn->queue_tail = 0;
+    conn->queue_resend = 0;
+#if MQTT_SPOOL
+    cfs_remove(MQTT_SPOOL_FILE);
+    cfs_remove(MQTT_SPOOL_HEAD_FILE);
+  } else {
+    spool_save_head(conn);
+#endif /* MQTT_SPOOL */
+  }
+
+  /* There is room for more messages */
+  process_post(conn->app_process, mqtt_update_event, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static struct mqtt_inflight *
+inflight_find(struct mqtt_connection *conn, uint16_t mid,
+              mqtt_qos_level_t qos, mqtt_qos_state_t qos_state)
+{
+  struct mqtt_inflight *slot;
+  uint8_t i;
+
+  for(i = 0; i < conn->inflight_count; i++) {
+    slot = &conn->inflight[(conn->inflight_first + i) % MQTT_MAX_INFLIGHT];
+    if(slot->mid == mid && slot->qos == qos &&
+       slot->qos_state == qos_state) {
+      return slot;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Fills the out buffer with the PUBRELs that are due and then with as many
+ * queued messages as fit and the window allows, and sends it.
+ */
+static void
+send_queue(struct mqtt_connection *conn)
+{
+  struct mqtt_inflight *slot;
+  uint8_t *packet;
+  uint8_t *read_ptr;
+  uint8_t *read_end;
+  uint16_t length;
+  uint16_t pos;
+  uint8_t i;
+
+  conn->out_buffer_ptr = conn->out_buffer;
+
+  for(i = 0; i < conn->inflight_count; i++) {
+    slot = &conn->inflight[(conn->inflight_first + i) % MQTT_MAX_INFLIGHT];
+    if(slot->qos_state == MQTT_QOS_STATE_GOT_PUBREC &&
+       &conn->out_buffer[MQTT_TCP_OUTPUT_BUFF_SIZE] - conn->out_buffer_ptr >=
+       MQTT_FHDR_SIZE + 1 + MQTT_MID_SIZE) {
+      conn->out_buffer_ptr[0] = MQTT_FHDR_MSG_TYPE_PUBREL |
+        MQTT_FHDR_QOS_LEVEL_1;
+      conn->out_buffer_ptr[1] = MQTT_MID_SIZE;
+      conn->out_buffer_ptr[2] = slot->mid >> 8;
+      conn->out_buffer_ptr[3] = slot->mid & 0x00FF;
+      conn->out_buffer_ptr += MQTT_FHDR_SIZE + 1 + MQTT_MID_SIZE;
+      slot->qos_state = MQTT_QOS_STATE_SENT_PUBREL;
+    }
+  }
+
+  /*
+   * Read what fits into the rest of the buffer at once and move the packets
+   * down over their length fields.
+   */
+  read_ptr = conn->out_buffer_ptr;
+  read_end = read_ptr +
+    MIN(&conn->out_buffer[MQTT_TCP_OUTPUT_BUFF_SIZE] - read_ptr,
+        conn->queue_tail - conn->queue_send);
+  if(read_end > read_ptr &&
+     queue_read(conn, conn->queue_send, read_ptr, read_end - read_ptr)) {
+    PRINTF("MQTT - Error, could not read the queue\n");
+    read_end = read_ptr;
+  }
+
+  while(read_end - read_ptr >= 2) {
+    if(conn->inflight_count == MQTT_MAX_INFLIGHT) {
+      queue_advance(conn);
+      if(conn->inflight_count == MQTT_MAX_INFLIGHT) {
+        break;
+      }
+    }
+    length = read_ptr[0] << 8 | read_ptr[1];
+    if(read_end - read_ptr < 2 + length) {
+      break;
+    }
+    packet = conn->out_buffer_ptr;
+    memmove(packet, read_ptr + 2, length);
+    read_ptr += 2 + length;
+
+    slot = &conn->inflight[(conn->inflight_first + conn->inflight_count) %
+                           MQTT_MAX_INFLIGHT];
+    conn->inflight_count++;
+    slot->offset = conn->queue_send;
+    slot->length = 2 + length;
+    slot->qos = (packet[0] >> 1) & 0x03;
+    slot->mid = 0;
+    if(slot->qos == MQTT_QOS_LEVEL_0) {
+      slot->qos_state = MQTT_QOS_STATE_GOT_ACK;
+    } else {
+      /* Skip the remaining length and the topic */
+      pos = MQTT_FHDR_SIZE;
+      while(packet[pos++] & 0x80);
+      pos += MQTT_STRING_LEN_SIZE + (packet[pos] << 8 | packet[pos + 1]);
+
+      slot->mid = QUEUE_MID(conn->queue_send);
+      packet[pos] = slot->mid >> 8;
+      packet[pos + 1] = slot->mid & 0x00FF;
+      slot->qos_state = MQTT_QOS_STATE_NO_ACK;
+      if(conn->queue_send < conn->queue_resend) {
+        packet[0] |= MQTT_FHDR_DUP_FLAG;
+      }
+    }
+
+    conn->out_buffer_ptr += length;
+    conn->queue_send += 2 + length;
+  }
+
+  /* QoS 0 messages are complete once written */
+  queue_advance(conn);
+
+  send_out_buffer(conn);
+}
+/*---------------------------------------------------------------------------*/
+static mqtt_status_t
+queue_publish(struct mqtt_connection *conn, char *topic, uint8_t *payload,
+              uint32_t payload_size, mqtt_qos_level_t qos_level,
+              mqtt_retain_t retain)
+{
+  uint8_t header[2 + MQTT_FHDR_SIZE + 4 + MQTT_STRING_LEN_SIZE];
+  uint8_t mid[MQTT_MID_SIZE] = { 0, 0 };
+  uint8_t remaining_length_bytes;
+  uint32_t remaining_length;
+  uint32_t length;
+  uint16_t topic_length;
+  uint8_t *ptr;
+  int fd = -1;
+
+  topic_length = strlen(topic);
+  remaining_length = MQTT_STRING_LEN_SIZE + topic_length + payload_size;
+  if(qos_level > MQTT_QOS_LEVEL_0) {
+    remaining_length += MQTT_MID_SIZE;
+  }
+  encode_remaining_length(&header[2 + MQTT_FHDR_SIZE],
+                          &remaining_length_bytes, remaining_length);
+  length = MQTT_FHDR_SIZE + remaining_length_bytes + remaining_length;
+
+  if(qos_level > MQTT_QOS_LEVEL_2 ||
+     2 + length > MQTT_TCP_OUTPUT_BUFF_SIZE) {
+    return MQTT_STATUS_INVALID_ARGS_ERROR;
+  }
+#if MQTT_SPOOL
+  if(conn->queue_tail + 2 + length > MQTT_SPOOL_SIZE) {
+#else
+  if(conn->queue_tail - conn->queue_head + 2 + length > MQTT_QUEUE_SIZE) {
+#endif /* MQTT_SPOOL */
+    DBG("MQTT - Not accepted!\n");
+    return MQTT_STATUS_OUT_QUEUE_FULL;
+  }
+
+  header[0] = length >> 8;
+  header[1] = length & 0x00FF;
+  header[2] = MQTT_FHDR_MSG_TYPE_PUBLISH | qos_level << 1;
+  if(retain == MQTT_RETAIN_ON) {
+    header[2] |= MQTT_FHDR_RETAIN_FLAG;
+  }
+  ptr = &header[2 + MQTT_FHDR_SIZE + remaining_length_bytes];
+  *ptr++ = topic_length >> 8;
+  *ptr++ = topic_length & 0x00FF;
+
+#if MQTT_SPOOL
+  fd = cfs_open(MQTT_SPOOL_FILE, CFS_WRITE | CFS_APPEND);
+  if(fd < 0) {
+    PRINTF("MQTT - Error, could not open the spool\n");
+    return MQTT_STATUS_ERROR;
+  }
+#endif /* MQTT_SPOOL */
+
+  if(queue_write(conn, fd, header, ptr - header) ||
+     queue_write(conn, fd, (uint8_t *)topic, topic_length) ||
+     (qos_level > MQTT_QOS_LEVEL_0 &&
+      queue_write(conn, fd, mid, MQTT_MID_SIZE)) ||
+     queue_write(conn, fd, payload, payload_size)) {
+    PRINTF("MQTT - Error, could not write the spool\n");
+#if MQTT_SPOOL
+    cfs_close(fd);
+#endif /* MQTT_SPOOL */
+    return MQTT_STATUS_ERROR;
+  }
+
+#if MQTT_SPOOL
+  cfs_close(fd);
+#endif /* MQTT_SPOOL */
+
+  DBG("MQTT - Accepted!\n");
+
+  if(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
+    post_publish(conn);
+  }
+  return MQTT_STATUS_OK;
+}
+#endif /* MQTT_PUBLISH_WINDOW */
 /*---------------------------------------------------------------------------*/
 static
 PT_THREAD(pingreq_pt(struct pt *pt, struct mqtt_connection *conn))
@@ -761,6 +1158,10 @@ handle_connack(struct mqtt_connection *conn)
   /* Always reset packet before callback since it might be used directly */
   conn->state = MQTT_CONN_STATE_CONNECTED_TO_BROKER;
   call_event(conn, MQTT_EVENT_CONNECTED, NULL);
+
+#if MQTT_PUBLISH_WINDOW
+  post_publish(conn);
+#endif /* MQTT_PUBLISH_WINDOW */
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -820,13 +1221,80 @@ handle_puback(struct mqtt_connection *conn)
 {
   DBG("MQTT - Got PUBACK\n");
 
-  conn->out_packet.qos_state = MQTT_QOS_STATE_GOT_ACK;
   conn->in_packet.mid = (conn->in_packet.payload[0] << 8) |
     (conn->in_packet.payload[1]);
 
+#if MQTT_PUBLISH_WINDOW
+  {
+    struct mqtt_inflight *slot;
+
+    slot = inflight_find(conn, conn->in_packet.mid, MQTT_QOS_LEVEL_1,
+                         MQTT_QOS_STATE_NO_ACK);
+    if(slot == NULL) {
+      DBG("MQTT - Warning, got PUBACK for unknown MID %u\n",
+          conn->in_packet.mid);
+      return;
+    }
+    slot->qos_state = MQTT_QOS_STATE_GOT_ACK;
+    queue_advance(conn);
+    post_publish(conn);
+  }
+#else
+  conn->out_packet.qos_state = MQTT_QOS_STATE_GOT_ACK;
+#endif /* MQTT_PUBLISH_WINDOW */
+
   call_event(conn, MQTT_EVENT_PUBACK, &conn->in_packet.mid);
 }
 /*---------------------------------------------------------------------------*/
+#if MQTT_PUBLISH_WINDOW
+static void
+handle_pubrec(struct mqtt_connection *conn)
+{
+  struct mqtt_inflight *slot;
+
+  DBG("MQTT - Got PUBREC\n");
+
+  conn->in_packet.mid = (conn->in_packet.payload[0] << 8) |
+    (conn->in_packet.payload[1]);
+
+  slot = inflight_find(conn, conn->in_packet.mid, MQTT_QOS_LEVEL_2,
+                       MQTT_QOS_STATE_NO_ACK);
+  if(slot == NULL) {
+    DBG("MQTT - Warning, got PUBREC for unknown MID %u\n",
+        conn->in_packet.mid);
+    return;
+  }
+
+  /* The PUBREL is sent with the next queued messages */
+  slot->qos_state = MQTT_QOS_STATE_GOT_PUBREC;
+  post_publish(conn);
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_pubcomp(struct mqtt_connection *conn)
+{
+  struct mqtt_inflight *slot;
+
+  DBG("MQTT - Got PUBCOMP\n");
+
+  conn->in_packet.mid = (conn->in_packet.payload[0] << 8) |
+    (conn->in_packet.payload[1]);
+
+  slot = inflight_find(conn, conn->in_packet.mid, MQTT_QOS_LEVEL_2,
+                       MQTT_QOS_STATE_SENT_PUBREL);
+  if(slot == NULL) {
+    DBG("MQTT - Warning, got PUBCOMP for unknown MID %u\n",
+        conn->in_packet.mid);
+    return;
+  }
+  slot->qos_state = MQTT_QOS_STATE_GOT_ACK;
+  queue_advance(conn);
+  post_publish(conn);
+
+  call_event(conn, MQTT_EVENT_PUBCOMP, &conn->in_packet.mid);
+}
+#endif /* MQTT_PUBLISH_WINDOW */
+/*---------------------------------------------------------------------------*/
 static void
 handle_publish(struct mqtt_connection *conn)
 {
@@ -907,13 +1375,12 @@ parse_publish_vhdr(struct mqtt_connection *conn,
   }
 }
 /*---------------------------------------------------------------------------*/
-static int
-tcp_input(struct tcp_socket *s,
-          void *ptr,
-          const uint8_t *input_data_ptr,
-          int input_data_len)
+/* Reads one packet, or what there is of it, and returns the bytes read */
+static uint32_t
+read_packet(struct mqtt_connection *conn,
+            const uint8_t *input_data_ptr,
+            int input_data_len)
 {
-  struct mqtt_connection *conn = ptr;
   uint32_t pos = 0;
   uint32_t copy_bytes = 0;
   uint8_t byte;
@@ -936,7 +1403,7 @@ tcp_input(struct tcp_socket *s,
     DBG("MQTT - Read VHDR '%02X'\n", conn->in_packet.fhdr);
 
     if(pos >= input_data_len) {
-      return 0;
+      return input_data_len;
     }
   }
 
@@ -944,7 +1411,7 @@ tcp_input(struct tcp_socket *s,
   if(!conn->in_packet.has_remaining_length) {
     do {
       if(pos >= input_data_len) {
-        return 0;
+        return input_data_len;
       }
 
       byte = input_data_ptr[pos++];
@@ -955,7 +1422,7 @@ tcp_input(struct tcp_socket *s,
       if(conn->in_packet.byte_counter > 5) {
         call_event(conn, MQTT_EVENT_ERROR, NULL);
         DBG("Received more then 4 byte 'remaining lenght'.");
-        return 0;
+        return input_data_len;
       }
 
       conn->in_packet.remaining_length +=
@@ -980,10 +1447,10 @@ tcp_input(struct tcp_socket *s,
 
     conn->in_packet.byte_counter += input_data_len;
     if(conn->in_packet.byte_counter >=
-       (MQTT_FHDR_SIZE + conn->in_packet.remaining_length)) {
+       IN_PACKET_LENGTH(conn)) {
       conn->in_packet.packet_received = 1;
     }
-    return 0;
+    return input_data_len;
   }
 
   /*
@@ -993,7 +1460,7 @@ tcp_input(struct tcp_socket *s,
    *       this loop.
    */
   while(conn->in_packet.byte_counter <
-        (MQTT_FHDR_SIZE + conn->in_packet.remaining_length)) {
+        IN_PACKET_LENGTH(conn)) {
 
     if((conn->in_packet.fhdr & 0xF0) == MQTT_FHDR_MSG_TYPE_PUBLISH &&
        conn->in_packet.topic_received == 0) {
@@ -1003,6 +1470,8 @@ tcp_input(struct tcp_socket *s,
     /* Read in as much as we can into the packet payload */
     copy_bytes = MIN(input_data_len - pos,
                      MQTT_INPUT_BUFF_SIZE - conn->in_packet.payload_pos);
+    copy_bytes = MIN(copy_bytes,
+                     IN_PACKET_LENGTH(conn) - conn->in_packet.byte_counter);
     DBG("- Copied %lu payload bytes\n", copy_bytes);
     memcpy(&conn->in_packet.payload[conn->in_packet.payload_pos],
            &input_data_ptr[pos],
@@ -1031,8 +1500,8 @@ tcp_input(struct tcp_socket *s,
     }
 
     if(pos >= input_data_len &&
-       (conn->in_packet.byte_counter < (MQTT_FHDR_SIZE + conn->in_packet.remaining_length))) {
-      return 0;
+       (conn->in_packet.byte_counter < IN_PACKET_LENGTH(conn))) {
+      return input_data_len;
     }
   }
 
@@ -1042,7 +1511,7 @@ tcp_input(struct tcp_socket *s,
   DBG("MQTT - Finished reading packet!\n");
   /* What to return? */
   DBG("MQTT - total data was %i bytes of data. \n",
-      (MQTT_FHDR_SIZE + conn->in_packet.remaining_length));
+      IN_PACKET_LENGTH(conn));
 
   /* Handle packet here. */
   switch(conn->in_packet.fhdr & 0xF0) {
@@ -1069,10 +1538,19 @@ tcp_input(struct tcp_socket *s,
     handle_pingresp(conn);
     break;
 
+#if MQTT_PUBLISH_WINDOW
+  case MQTT_FHDR_MSG_TYPE_PUBREC:
+    handle_pubrec(conn);
+    break;
+  case MQTT_FHDR_MSG_TYPE_PUBCOMP:
+    handle_pubcomp(conn);
+    break;
+#else
   /* QoS 2 not implemented yet */
   case MQTT_FHDR_MSG_TYPE_PUBREC:
-  case MQTT_FHDR_MSG_TYPE_PUBREL:
   case MQTT_FHDR_MSG_TYPE_PUBCOMP:
+#endif /* MQTT_PUBLISH_WINDOW */
+  case MQTT_FHDR_MSG_TYPE_PUBREL:
     call_event(conn, MQTT_EVENT_NOT_IMPLEMENTED_ERROR, NULL);
     PRINTF("MQTT - Got unhandled MQTT Message Type '%i'",
            (conn->in_packet.fhdr & 0xF0));
@@ -1086,6 +1564,23 @@ tcp_input(struct tcp_socket *s,
 
   conn->in_packet.packet_received = 1;
 
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static int
+tcp_input(struct tcp_socket *s,
+          void *ptr,
+          const uint8_t *input_data_ptr,
+          int input_data_len)
+{
+  struct mqtt_connection *conn = ptr;
+  uint32_t pos = 0;
+
+  /* A segment may carry several packets */
+  while(pos < input_data_len) {
+    pos += read_packet(conn, &input_data_ptr[pos], input_data_len - pos);
+  }
+
   return 0;
 }
 /*---------------------------------------------------------------------------*/
@@ -1131,6 +1626,15 @@ tcp_event(struct tcp_socket *s, void *ptr, tcp_socket_event_t event)
     if(conn->socket.output_data_len == 0) {
       conn->out_buffer_sent = 1;
       conn->out_buffer_ptr = conn->out_buffer;
+#if MQTT_PUBLISH_WINDOW
+      if(conn->pending_event) {
+        process_post(&mqtt_process, conn->pending_event, conn);
+        conn->pending_event = 0;
+      }
+      if(conn->queue_send < conn->queue_tail || conn->inflight_count > 0) {
+        post_publish(conn);
+      }
+#endif /* MQTT_PUBLISH_WINDOW */
     }
 
     ctimer_restart(&conn->keep_alive_timer);
@@ -1221,6 +1725,11 @@ PROCESS_THREAD(mqtt_process, ev, data)
               conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
           PT_MQTT_WAIT_SEND();
         }
+#if MQTT_PUBLISH_WINDOW
+      } else if(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
+        /* Posted again once the queued messages are sent */
+        conn->pending_event = ev;
+#endif /* MQTT_PUBLISH_WINDOW */
       }
     }
     if(ev == mqtt_do_unsubscribe_event) {
@@ -1234,12 +1743,24 @@ PROCESS_THREAD(mqtt_process, ev, data)
               conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
           PT_MQTT_WAIT_SEND();
         }
+#if MQTT_PUBLISH_WINDOW
+      } else if(conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
+        /* Posted again once the queued messages are sent */
+        conn->pending_event = ev;
+#endif /* MQTT_PUBLISH_WINDOW */
       }
     }
     if(ev == mqtt_do_publish_event) {
       conn = data;
       DBG("MQTT - Got mqtt_do_publish_mqtt_event!\n");
 
+#if MQTT_PUBLISH_WINDOW
+      conn->publish_posted = 0;
+      if(conn->out_buffer_sent == 1 &&
+         conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
+        send_queue(conn);
+      }
+#else
       if(conn->out_buffer_sent == 1 &&
          conn->state == MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
         PT_INIT(&conn->out_proto_thread);
@@ -1248,6 +1769,7 @@ PROCESS_THREAD(mqtt_process, ev, data)
           PT_MQTT_WAIT_SEND();
         }
       }
+#endif /* MQTT_PUBLISH_WINDOW */
     }
   }
   PROCESS_END();
@@ -1296,6 +1818,9 @@ mqtt_register(struct mqtt_connection *conn, struct process *app_process,
   conn->auto_reconnect = 1;
   conn->max_segment_size = max_segment_size;
   reset_defaults(conn);
+#if MQTT_PUBLISH_WINDOW && MQTT_SPOOL
+  spool_recover(conn);
+#endif /* MQTT_PUBLISH_WINDOW && MQTT_SPOOL */
 
   mqtt_init();
   list_add(mqtt_conn_list, conn);
@@ -1415,6 +1940,11 @@ mqtt_publish(struct mqtt_connection *conn, uint16_t *mid, char *topic,
              uint8_t *payload, uint32_t payload_size,
              mqtt_qos_level_t qos_level, mqtt_retain_t retain)
 {
+#if MQTT_PUBLISH_WINDOW
+  DBG("MQTT - Call to mqtt_publish...\n");
+
+  return queue_publish(conn, topic, payload, payload_size, qos_level, retain);
+#else
   if(conn->state != MQTT_CONN_STATE_CONNECTED_TO_BROKER) {
     return MQTT_STATUS_NOT_CONNECTED_ERROR;
   }
@@ -1440,6 +1970,7 @@ mqtt_publish(struct mqtt_connection *conn, uint16_t *mid, char *topic,
 
   process_post(&mqtt_process, mqtt_do_publish_event, conn);
   return MQTT_STATUS_OK;
+#endif /* MQTT_PUBLISH_WINDOW */
 }
 /*----------------------------------------------------------------------------*/
 void
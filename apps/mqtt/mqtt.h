@@ -35,7 +35,8 @@
  * \defgroup mqtt-engine An implementation of MQTT v3.1
  * @{
  *
- * This application is an engine for MQTT v3.1. It supports QoS Levels 0 and 1.
+ * This application is an engine for MQTT v3.1. It supports QoS Levels 0 and 1,
+ * and 2 for PUBLISH with MQTT_PUBLISH_WINDOW.
  *
  * MQTT is a Client Server publish/subscribe messaging transport protocol.
  * It is light weight, open, simple, and designed so as to be easy to implement.
@@ -117,6 +118,56 @@
 #define MQTT_PROTOCOL_VERSION 3
 #define MQTT_PROTOCOL_NAME "MQIsdp"
 #define MQTT_TOPIC_MAX_LENGTH 128
+
+/*
+ * Queue PUBLISH messages and keep up to MQTT_MAX_INFLIGHT of them waiting for
+ * PUBACK or PUBCOMP, instead of one at a time. Messages are queued even while
+ * not connected, as many as fit are sent in one TCP segment, and those not
+ * acknowledged are sent again after a reconnect. Enables QoS 2 for PUBLISH.
+ */
+#ifdef MQTT_CONF_PUBLISH_WINDOW
+#define MQTT_PUBLISH_WINDOW MQTT_CONF_PUBLISH_WINDOW
+#else
+#define MQTT_PUBLISH_WINDOW 0
+#endif /* MQTT_CONF_PUBLISH_WINDOW */
+
+/* Sent messages that are not complete yet */
+#ifdef MQTT_CONF_MAX_INFLIGHT
+#define MQTT_MAX_INFLIGHT MQTT_CONF_MAX_INFLIGHT
+#else
+#define MQTT_MAX_INFLIGHT 8
+#endif /* MQTT_CONF_MAX_INFLIGHT */
+
+/* Bytes of RAM for the queued messages */
+#ifdef MQTT_CONF_QUEUE_SIZE
+#define MQTT_QUEUE_SIZE MQTT_CONF_QUEUE_SIZE
+#else
+#define MQTT_QUEUE_SIZE 1024
+#endif /* MQTT_CONF_QUEUE_SIZE */
+
+/*
+ * Keep the queue in a CFS file instead of RAM, so that messages that are not
+ * complete survive a reboot. The file is removed whenever it is drained. The
+ * spool serves a single connection.
+ */
+#ifdef MQTT_CONF_SPOOL
+#define MQTT_SPOOL MQTT_CONF_SPOOL
+#else
+#define MQTT_SPOOL 0
+#endif /* MQTT_CONF_SPOOL */
+
+#ifdef MQTT_CONF_SPOOL_FILE
+#define MQTT_SPOOL_FILE MQTT_CONF_SPOOL_FILE
+#else
+#define MQTT_SPOOL_FILE "mqtt-spool"
+#endif /* MQTT_CONF_SPOOL_FILE */
+
+/* Largest size of the spool file */
+#ifdef MQTT_CONF_SPOOL_SIZE
+#define MQTT_SPOOL_SIZE MQTT_CONF_SPOOL_SIZE
+#else
+#define MQTT_SPOOL_SIZE 16384
+#endif /* MQTT_CONF_SPOOL_SIZE */
 /*---------------------------------------------------------------------------*/
 /*
  * Debug configuration, this is similar but not exactly like the Debugging
@@ -151,6 +202,7 @@ typedef enum {
   MQTT_EVENT_UNSUBACK,
   MQTT_EVENT_PUBLISH,
   MQTT_EVENT_PUBACK,
+  MQTT_EVENT_PUBCOMP,
 
   /* Errors */
   MQTT_EVENT_ERROR = 0x80,
@@ -183,7 +235,9 @@ typedef enum {
   MQTT_QOS_STATE_NO_ACK,
   MQTT_QOS_STATE_GOT_ACK,
 
-  /* Expand for QoS 2 */
+  /* QoS 2 */
+  MQTT_QOS_STATE_GOT_PUBREC,
+  MQTT_QOS_STATE_SENT_PUBREL,
 } mqtt_qos_state_t;
 /*---------------------------------------------------------------------------*/
 /*
@@ -284,6 +338,16 @@ struct mqtt_out_packet {
   mqtt_qos_state_t qos_state;
   mqtt_retain_t retain;
 };
+#if MQTT_PUBLISH_WINDOW
+/* A sent PUBLISH message in the queue. GOT_ACK means complete. */
+struct mqtt_inflight {
+  uint32_t offset;
+  uint16_t length;
+  uint16_t mid;
+  mqtt_qos_level_t qos;
+  mqtt_qos_state_t qos_state;
+};
+#endif /* MQTT_PUBLISH_WINDOW */
 /*---------------------------------------------------------------------------*/
 /**
  * \brief           MQTT event callback function
@@ -349,6 +413,23 @@ struct mqtt_connection {
   uint32_t out_write_pos;
   uint16_t max_segment_size;
 
+#if MQTT_PUBLISH_WINDOW
+  /* Queued PUBLISH messages, at increasing offsets */
+  struct mqtt_inflight inflight[MQTT_MAX_INFLIGHT];
+  uint8_t inflight_first;
+  uint8_t inflight_count;
+  uint32_t queue_head;          /* first message that is not complete */
+  uint32_t queue_send;          /* first message that is not sent */
+  uint32_t queue_tail;          /* end of the last message */
+  uint32_t queue_resend;        /* messages before were sent before */
+  /* SUBSCRIBE or UNSUBSCRIBE waiting for the out buffer */
+  process_event_t pending_event;
+  uint8_t publish_posted;       /* the publish event is in the event queue */
+#if !MQTT_SPOOL
+  uint8_t queue[MQTT_QUEUE_SIZE];
+#endif /* !MQTT_SPOOL */
+#endif /* MQTT_PUBLISH_WINDOW */
+
   /* Incoming data related */
   uint8_t in_buffer[MQTT_TCP_INPUT_BUFF_SIZE];
   struct mqtt_in_packet in_packet;
@@ -443,7 +524,8 @@ mqtt_status_t mqtt_unsubscribe(struct mqtt_connection *conn,
  * \param topic A pointer to the topic to subscribe to.
  * \param payload A pointer to the topic payload.
  * \param payload_size Payload size.
- * \param qos_level Quality Of Service level to use. Currently supports 0, 1.
+ * \param qos_level Quality Of Service level to use. Currently supports 0, 1,
+ *        and 2 with MQTT_PUBLISH_WINDOW.
  * \param retain If the RETAIN flag is set to 1, in a PUBLISH Packet sent by a
  *        Client to a Server, the Server MUST store the Application Message
  *        and its QoS, so that it can be delivered to future subscribers whose
@@ -451,6 +533,13 @@ mqtt_status_t mqtt_unsubscribe(struct mqtt_connection *conn,
  * \return MQTT_STATUS_OK or some error status
  *
  * This function publishes to a topic on a MQTT broker.
+ *
+ * With MQTT_PUBLISH_WINDOW, the message is copied to the queue, also when
+ * not connected, and MQTT_STATUS_OUT_QUEUE_FULL is returned while there is
+ * no room. The message ID is chosen when the message is sent, so mid is not
+ * set. A message must fit into MQTT_TCP_OUTPUT_BUFF_SIZE - 2 bytes. As the
+ * session is clean, a message sent again after a reconnect may arrive
+ * twice, even with QoS 2.
  */
 mqtt_status_t mqtt_publish(struct mqtt_connection *conn,
                            uint16_t *mid,
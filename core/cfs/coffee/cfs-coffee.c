@@ -59,6 +59,7 @@
 #include "cfs/cfs.h"
 #include "cfs-coffee-arch.h"
 #include "cfs/coffee/cfs-coffee.h"
+#include "sys/process.h"
 
 /* Micro logs enable modifications on storage types that do not support
    in-place updates. This applies primarily to flash memories. */
@@ -91,6 +92,33 @@
 #define COFFEE_EXTENDED_WEAR_LEVELLING  1
 #endif
 
+/*
+ * Keep the status of every page in RAM, two bits per page, and remember
+ * the first pages of recently used files. Looking for files, free pages
+ * and garbage then needs few or no header reads.
+ */
+#ifndef COFFEE_PAGE_INDEX
+#define COFFEE_PAGE_INDEX 0
+#endif
+
+/* Number of file names whose first page is remembered by the page index. */
+#ifndef COFFEE_NAME_CACHE_SIZE
+#define COFFEE_NAME_CACHE_SIZE 8
+#endif
+
+/*
+ * Collect garbage in a background process after files have been removed,
+ * one sector each time the process is scheduled, instead of all at once
+ * when a reservation fails.
+ */
+#ifndef COFFEE_INCREMENTAL_GC
+#define COFFEE_INCREMENTAL_GC 0
+#endif
+
+#if COFFEE_INCREMENTAL_GC && !COFFEE_PAGE_INDEX
+#error "COFFEE_INCREMENTAL_GC requires COFFEE_PAGE_INDEX."
+#endif
+
 #if COFFEE_START & (COFFEE_SECTOR_SIZE - 1)
 #error COFFEE_START must point to the first byte in a sector.
 #endif
@@ -155,6 +183,19 @@
 #define COFFEE_PAGES_PER_SECTOR \
   ((coffee_page_t)(COFFEE_SECTOR_SIZE / COFFEE_PAGE_SIZE))
 
+#if COFFEE_PAGE_INDEX
+/* Page status in the page index. */
+#define PAGE_FREE     0
+#define PAGE_ACTIVE   1
+#define PAGE_OBSOLETE 2
+
+/* First page of a file, found by the hash of its name. */
+struct name_hint {
+  uint16_t hash;
+  coffee_page_t page;
+};
+#endif /* COFFEE_PAGE_INDEX */
+
 /* This structure is used for garbage collection statistics. */
 struct sector_status {
   coffee_page_t active;
@@ -212,11 +253,28 @@ static struct protected_mem_t {
   struct file_desc coffee_fd_set[COFFEE_FD_SET_SIZE];
   coffee_page_t next_free;
   char gc_wait;
+#if COFFEE_PAGE_INDEX
+  uint8_t page_index[(COFFEE_PAGE_COUNT + 3) / 4];
+  struct name_hint name_cache[COFFEE_NAME_CACHE_SIZE];
+  char page_index_valid;
+#endif
 } protected_mem;
 static struct file *const coffee_files = protected_mem.coffee_files;
 static struct file_desc *const coffee_fd_set = protected_mem.coffee_fd_set;
 static coffee_page_t *const next_free = &protected_mem.next_free;
 static char *const gc_wait = &protected_mem.gc_wait;
+#if COFFEE_PAGE_INDEX
+static uint8_t *const page_index = protected_mem.page_index;
+static struct name_hint *const name_cache = protected_mem.name_cache;
+static char *const page_index_valid = &protected_mem.page_index_valid;
+static uint8_t name_cache_next;
+#endif
+
+#if COFFEE_INCREMENTAL_GC
+PROCESS(coffee_gc_process, "Coffee GC");
+static char gc_requested;
+static uint16_t gc_sector;
+#endif
 
 /*---------------------------------------------------------------------------*/
 static void
@@ -244,7 +302,135 @@ absolute_offset(coffee_page_t page, cfs_offset_t offset)
 {
   return page * COFFEE_PAGE_SIZE + sizeof(struct file_header) + offset;
 }
+#if COFFEE_PAGE_INDEX
+static coffee_page_t next_file(coffee_page_t page, struct file_header *hdr);
+/*---------------------------------------------------------------------------*/
+static int
+page_status(coffee_page_t page)
+{
+  return (page_index[page >> 2] >> ((page & 3) << 1)) & 3;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_page_status(coffee_page_t start, coffee_page_t count, int status)
+{
+  coffee_page_t page;
+  uint8_t shift;
+
+  for(page = start; page < start + count && page < COFFEE_PAGE_COUNT; page++) {
+    shift = (page & 3) << 1;
+    page_index[page >> 2] = (page_index[page >> 2] & ~(3 << shift)) |
+                            (status << shift);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+check_page_index(void)
+{
+  struct file_header hdr;
+  coffee_page_t page, next;
+
+  if(*page_index_valid) {
+    return;
+  }
+
+  /* Walk over the file extents once, like the garbage collector does. */
+  memset(page_index, 0, sizeof(protected_mem.page_index));
+  for(page = 0; page < COFFEE_PAGE_COUNT; page = next) {
+    read_header(&hdr, page);
+    next = next_file(page, &hdr);
+    if(HDR_ACTIVE(hdr)) {
+      set_page_status(page, next - page, PAGE_ACTIVE);
+    } else if(!HDR_FREE(hdr)) {
+      set_page_status(page, next - page, PAGE_OBSOLETE);
+    }
+  }
+  *page_index_valid = 1;
+  PRINTF("Coffee: Built the page index\n");
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+name_hash(const char *name)
+{
+  uint16_t hash;
+
+  for(hash = 0; *name != '\0'; name++) {
+    hash = hash * 31 + (unsigned char)*name;
+  }
+  return hash;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remember_file(const char *name, coffee_page_t page)
+{
+  uint16_t hash;
+  int i;
+
+  hash = name_hash(name);
+  for(i = 0; i < COFFEE_NAME_CACHE_SIZE; i++) {
+    if(name_cache[i].hash == hash) {
+      name_cache[i].page = page;
+      return;
+    }
+  }
+  name_cache[name_cache_next].hash = hash;
+  name_cache[name_cache_next].page = page;
+  name_cache_next = (name_cache_next + 1) % COFFEE_NAME_CACHE_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+forget_file(coffee_page_t page)
+{
+  int i;
+
+  for(i = 0; i < COFFEE_NAME_CACHE_SIZE; i++) {
+    if(name_cache[i].page == page) {
+      name_cache[i].page = INVALID_PAGE;
+    }
+  }
+}
+#endif /* COFFEE_PAGE_INDEX */
 /*---------------------------------------------------------------------------*/
+#if COFFEE_PAGE_INDEX
+static coffee_page_t
+get_sector_status(uint16_t sector, struct sector_status *stats)
+{
+  coffee_page_t page, sector_start, sector_end;
+
+  memset(stats, 0, sizeof(*stats));
+
+  sector_start = sector * COFFEE_PAGES_PER_SECTOR;
+  sector_end = sector_start + COFFEE_PAGES_PER_SECTOR;
+  for(page = sector_start; page < sector_end; page++) {
+    switch(page_status(page)) {
+    case PAGE_ACTIVE:
+      stats->active++;
+      break;
+    case PAGE_OBSOLETE:
+      stats->obsolete++;
+      break;
+    default:
+      stats->free++;
+      break;
+    }
+  }
+
+  /*
+   * An obsolete file may extend into the next sector, where its pages
+   * have no header. Those pages, and any obsolete ones following them,
+   * are isolated before the sector is erased. If the whole next sector
+   * is obsolete, it is erasable itself and no isolation is needed.
+   */
+  if(stats->active > 0 || sector_end >= COFFEE_PAGE_COUNT ||
+     page_status(sector_end - 1) != PAGE_OBSOLETE) {
+    return 0;
+  }
+  for(page = sector_end; page < sector_end + COFFEE_PAGES_PER_SECTOR &&
+      page_status(page) == PAGE_OBSOLETE; page++);
+
+  return page - sector_end < COFFEE_PAGES_PER_SECTOR ? page - sector_end : 0;
+}
+#else /* COFFEE_PAGE_INDEX */
 static coffee_page_t
 get_sector_status(uint16_t sector, struct sector_status *stats)
 {
@@ -344,6 +530,7 @@ get_sector_status(uint16_t sector, struct sector_status *stats)
   return (last_pages_are_active || (skip_pages >= COFFEE_PAGES_PER_SECTOR)) ?
          0 : skip_pages;
 }
+#endif /* COFFEE_PAGE_INDEX */
 /*---------------------------------------------------------------------------*/
 static void
 isolate_pages(coffee_page_t start, coffee_page_t skip_pages)
@@ -365,14 +552,38 @@ isolate_pages(coffee_page_t start, coffee_page_t skip_pages)
 }
 /*---------------------------------------------------------------------------*/
 static void
+erase_sector(uint16_t sector, coffee_page_t isolation_count)
+{
+  coffee_page_t first_page;
+
+  first_page = sector * COFFEE_PAGES_PER_SECTOR;
+  if(first_page < *next_free) {
+    *next_free = first_page;
+  }
+
+  if(isolation_count > 0) {
+    isolate_pages(first_page + COFFEE_PAGES_PER_SECTOR, isolation_count);
+  }
+
+  COFFEE_ERASE(sector);
+#if COFFEE_PAGE_INDEX
+  set_page_status(first_page, COFFEE_PAGES_PER_SECTOR, PAGE_FREE);
+#endif
+  PRINTF("Coffee: Erased sector %d!\n", sector);
+}
+/*---------------------------------------------------------------------------*/
+static void
 collect_garbage(int mode)
 {
   uint16_t sector;
   struct sector_status stats;
-  coffee_page_t first_page, isolation_count;
+  coffee_page_t isolation_count;
 
   PRINTF("Coffee: Running the file system garbage collector in %s mode\n",
          mode == GC_RELUCTANT ? "reluctant" : "greedy");
+#if COFFEE_PAGE_INDEX
+  check_page_index();
+#endif
   /*
    * The garbage collector erases as many sectors as possible. A sector is
    * erasable if there are only free or obsolete pages in it.
@@ -389,24 +600,79 @@ collect_garbage(int mode)
 
     if((mode == GC_RELUCTANT && stats.free == 0) ||
        (mode == GC_GREEDY && stats.obsolete > 0)) {
-      first_page = sector * COFFEE_PAGES_PER_SECTOR;
-      if(first_page < *next_free) {
-        *next_free = first_page;
-      }
+      erase_sector(sector, isolation_count);
 
-      if(isolation_count > 0) {
-        isolate_pages(first_page + COFFEE_PAGES_PER_SECTOR, isolation_count);
+      if(mode == GC_RELUCTANT && isolation_count > 0) {
+        break;
       }
+    }
+  }
+}
+#if COFFEE_INCREMENTAL_GC
+/*---------------------------------------------------------------------------*/
+/* Erases the next sector holding only obsolete and free pages. Returns 0
+   if there is none left. */
+static int
+collect_garbage_step(void)
+{
+  struct sector_status stats;
+  coffee_page_t isolation_count;
+  int spill;
 
-      COFFEE_ERASE(sector);
-      PRINTF("Coffee: Erased sector %d!\n", sector);
+  check_page_index();
+  for(; gc_sector < COFFEE_SECTOR_COUNT; gc_sector++) {
+    isolation_count = get_sector_status(gc_sector, &stats);
+    if(stats.active > 0 || stats.obsolete == 0) {
+      continue;
+    }
 
-      if(mode == GC_RELUCTANT && isolation_count > 0) {
-        break;
+    /* An obsolete file extending over the whole next sector would be
+       left without a header, so that sector is erased right away. */
+    do {
+      spill = isolation_count == 0 &&
+        gc_sector + 1 < COFFEE_SECTOR_COUNT &&
+        page_status((gc_sector + 1) * COFFEE_PAGES_PER_SECTOR - 1) == PAGE_OBSOLETE &&
+        page_status((gc_sector + 1) * COFFEE_PAGES_PER_SECTOR) == PAGE_OBSOLETE;
+      erase_sector(gc_sector, isolation_count);
+      gc_sector++;
+      if(spill) {
+        isolation_count = get_sector_status(gc_sector, &stats);
+      }
+    } while(spill);
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_garbage_collection(void)
+{
+  gc_requested = 1;
+  if(!process_is_running(&coffee_gc_process)) {
+    process_start(&coffee_gc_process, NULL);
+  }
+  process_poll(&coffee_gc_process);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(coffee_gc_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(gc_requested);
+    while(gc_requested) {
+      gc_requested = 0;
+      gc_sector = 0;
+      PRINTF("Coffee: Collecting garbage in the background\n");
+      while(collect_garbage_step()) {
+        PROCESS_PAUSE();
       }
     }
   }
+
+  PROCESS_END();
 }
+#endif /* COFFEE_INCREMENTAL_GC */
 /*---------------------------------------------------------------------------*/
 static coffee_page_t
 next_file(coffee_page_t page, struct file_header *hdr)
@@ -477,6 +743,9 @@ find_file(const char *name)
   int i;
   struct file_header hdr;
   coffee_page_t page;
+#if COFFEE_PAGE_INDEX
+  uint16_t hash;
+#endif
 
   /* First check if the file metadata is cached. */
   for(i = 0; i < COFFEE_MAX_OPEN_FILES; i++) {
@@ -490,6 +759,38 @@ find_file(const char *name)
     }
   }
 
+#if COFFEE_PAGE_INDEX
+  /* Then check where files of this name were found before. */
+  hash = name_hash(name);
+  for(i = 0; i < COFFEE_NAME_CACHE_SIZE; i++) {
+    if(name_cache[i].hash != hash || name_cache[i].page == INVALID_PAGE) {
+      continue;
+    }
+    read_header(&hdr, name_cache[i].page);
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr) && strcmp(name, hdr.name) == 0) {
+      return load_file(name_cache[i].page, &hdr);
+    }
+  }
+
+  /* Scan the file headers otherwise, skipping free and obsolete pages. */
+  check_page_index();
+  for(page = 0; page < COFFEE_PAGE_COUNT;) {
+    switch(page_status(page)) {
+    case PAGE_FREE:
+      page = (page + COFFEE_PAGES_PER_SECTOR) & ~(COFFEE_PAGES_PER_SECTOR - 1);
+      continue;
+    case PAGE_OBSOLETE:
+      page++;
+      continue;
+    }
+    read_header(&hdr, page);
+    if(HDR_ACTIVE(hdr) && !HDR_LOG(hdr) && strcmp(name, hdr.name) == 0) {
+      remember_file(name, page);
+      return load_file(page, &hdr);
+    }
+    page = next_file(page, &hdr);
+  }
+#else /* COFFEE_PAGE_INDEX */
   /* Scan the flash memory sequentially otherwise. */
   for(page = 0; page < COFFEE_PAGE_COUNT; page = next_file(page, &hdr)) {
     read_header(&hdr, page);
@@ -497,6 +798,7 @@ find_file(const char *name)
       return load_file(page, &hdr);
     }
   }
+#endif /* COFFEE_PAGE_INDEX */
 
   return NULL;
 }
@@ -539,9 +841,40 @@ static coffee_page_t
 find_contiguous_pages(coffee_page_t amount)
 {
   coffee_page_t page, start;
+#if !COFFEE_PAGE_INDEX
   struct file_header hdr;
+#endif
 
   start = INVALID_PAGE;
+#if COFFEE_PAGE_INDEX
+  check_page_index();
+  for(page = *next_free; page < COFFEE_PAGE_COUNT;) {
+    if(page_status(page) == PAGE_FREE) {
+      if(start == INVALID_PAGE) {
+        start = page;
+        if(start + amount >= COFFEE_PAGE_COUNT) {
+          /* We can stop immediately if the remaining pages are not enough. */
+          break;
+        }
+      }
+
+      /* All remaining pages in this sector are free --
+         jump to the next sector. */
+      page = (page + COFFEE_PAGES_PER_SECTOR) & ~(COFFEE_PAGES_PER_SECTOR - 1);
+
+      if(start + amount <= page) {
+        if(start == *next_free) {
+          *next_free = start + amount;
+        }
+        return start;
+      }
+    } else {
+      start = INVALID_PAGE;
+      page++;
+    }
+  }
+  return INVALID_PAGE;
+#else /* COFFEE_PAGE_INDEX */
   for(page = *next_free; page < COFFEE_PAGE_COUNT;) {
     read_header(&hdr, page);
     if(HDR_FREE(hdr)) {
@@ -569,6 +902,7 @@ find_contiguous_pages(coffee_page_t amount)
     }
   }
   return INVALID_PAGE;
+#endif /* COFFEE_PAGE_INDEX */
 }
 /*---------------------------------------------------------------------------*/
 static int
@@ -591,6 +925,10 @@ remove_by_page(coffee_page_t page, int remove_log, int close_fds,
 
   hdr.flags |= HDR_FLAG_OBSOLETE;
   write_header(&hdr, page);
+#if COFFEE_PAGE_INDEX
+  set_page_status(page, hdr.max_pages, PAGE_OBSOLETE);
+  forget_file(page);
+#endif
 
   *gc_wait = 0;
 
@@ -611,7 +949,11 @@ remove_by_page(coffee_page_t page, int remove_log, int close_fds,
     }
   }
 
-#if !COFFEE_EXTENDED_WEAR_LEVELLING
+#if COFFEE_INCREMENTAL_GC
+  /* The background process never runs within a file operation, so it
+     may also be requested when garbage collection is not allowed here. */
+  request_garbage_collection();
+#elif !COFFEE_EXTENDED_WEAR_LEVELLING
   if(gc_allowed) {
     collect_garbage(GC_RELUCTANT);
   }
@@ -657,6 +999,12 @@ reserve(const char *name, coffee_page_t pages,
   hdr.max_pages = pages;
   hdr.flags = HDR_FLAG_ALLOCATED | flags;
   write_header(&hdr, page);
+#if COFFEE_PAGE_INDEX
+  set_page_status(page, pages, PAGE_ACTIVE);
+  if(!(flags & HDR_FLAG_LOG)) {
+    remember_file(name, page);
+  }
+#endif
 
   PRINTF("Coffee: Reserved %u pages starting from %u for file %s\n",
          pages, page, name);
@@ -1359,6 +1707,11 @@ cfs_coffee_format(void)
 
   /* Formatting invalidates the file information. */
   memset(&protected_mem, 0, sizeof(protected_mem));
+#if COFFEE_PAGE_INDEX
+  /* All pages are free now. */
+  memset(name_cache, 0xff, sizeof(protected_mem.name_cache));
+  *page_index_valid = 1;
+#endif
 
   PRINTF(" done!\n");
 
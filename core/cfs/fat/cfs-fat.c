@@ -80,7 +80,22 @@
 #define FAT_FLAG_FREE     0x00
 #define FAT_FLAG_DELETED  0xE5
 
+#if FAT_SECTOR_CACHE_SIZE > 1
+/* Buffered sectors. The entry of the sector currently in sector_buffer
+ * is only updated when another sector is selected. */
+static struct {
+  uint32_t addr;
+  uint16_t used;
+  uint8_t dirty;
+  uint8_t data;
+} sector_cache[FAT_SECTOR_CACHE_SIZE];
+static uint8_t sector_cache_buffers[FAT_SECTOR_CACHE_SIZE][512];
+static uint8_t sector_cache_current = 0;
+static uint16_t sector_cache_clock = 0;
+uint8_t *sector_buffer = sector_cache_buffers[0];
+#else /* FAT_SECTOR_CACHE_SIZE > 1 */
 uint8_t sector_buffer[512];
+#endif /* FAT_SECTOR_CACHE_SIZE > 1 */
 uint32_t sector_buffer_addr = 0;
 uint8_t sector_buffer_dirty = 0;
 
@@ -126,6 +141,10 @@ static uint32_t get_free_cluster(uint32_t start_cluster);
 static uint16_t _get_free_cluster_16();
 static uint16_t _get_free_cluster_32();
 static uint32_t find_nth_cluster(uint32_t start_cluster, uint32_t n);
+#if FAT_EXTENT_CACHE_SIZE
+static uint32_t find_file_cluster(int fd, uint32_t n);
+static void add_extent(struct file *file, uint32_t n, uint32_t cluster);
+#endif
 static void reset_cluster_chain(struct dir_entry *dir_ent);
 static void add_cluster_to_file(int fd);
 static uint32_t read_fat_entry(uint32_t cluster_num);
@@ -135,14 +154,22 @@ static uint8_t _make_valid_name(const char *path, uint8_t start, uint8_t end, ch
 static void pr_reset(struct PathResolver *rsolv);
 static uint8_t pr_get_next_path_part(struct PathResolver *rsolv);
 static uint8_t pr_is_current_path_part_a_file(struct PathResolver *rsolv);
+static uint8_t select_sector(uint32_t sector_addr, uint8_t data);
+static uint8_t load_sector(uint32_t sector_addr, uint8_t data);
 static uint8_t read_sector(uint32_t sector_addr);
+static void clear_sector(uint32_t sector_addr);
 static uint8_t read_next_sector();
 static uint8_t lookup(const char *name, struct dir_entry *dir_entry, uint32_t *dir_entry_sector, uint16_t *dir_entry_offset);
 static uint8_t get_dir_entry(const char *path, struct dir_entry *dir_ent, uint32_t *dir_entry_sector, uint16_t *dir_entry_offset, uint8_t create);
 static uint8_t add_directory_entry_to_current(struct dir_entry *dir_ent, uint32_t *dir_entry_sector, uint16_t *dir_entry_offset);
 static void update_dir_entry(int fd);
 static void remove_dir_entry(uint32_t dir_entry_sector, uint16_t dir_entry_offset);
+static uint32_t get_file_cluster(int fd, uint32_t clusters, uint8_t write);
 static uint8_t load_next_sector_of_file(int fd, uint32_t clusters, uint8_t clus_offset, uint8_t write);
+#if FAT_MULTI_BLOCK_WRITE && !defined(FAT_COOPERATIVE)
+static void drop_sectors(uint32_t sector_addr, uint32_t num);
+static uint32_t write_file_sectors(int fd, uint32_t clusters, uint8_t clus_offset, uint8_t *buffer, uint32_t num);
+#endif
 static void make_readable_entry(struct dir_entry *dir, struct cfs_dirent *dirent);
 static uint8_t _is_file(struct dir_entry *dir_ent);
 static uint8_t _cfs_flags_ok(int flags, struct dir_entry *dir_ent);
@@ -268,6 +295,85 @@ find_nth_cluster(uint32_t start_cluster, uint32_t n)
   PRINTF("\nfat.c: find_nth_cluster( start_cluster = %lu, n = %lu ) = %lu", start_cluster, n, cluster);
   return cluster;
 }
+#if FAT_EXTENT_CACHE_SIZE
+/*----------------------------------------------------------------------------*/
+/* Looks for the nth cluster in the cluster chain of an open file. Starts
+ * from the closest known cluster before it and remembers the extents
+ * passed on the way.
+ */
+static uint32_t
+find_file_cluster(int fd, uint32_t n)
+{
+  struct file *file = &fat_file_pool[fd];
+  struct cluster_extent *e;
+  uint32_t i = 0,
+          cluster = file->cluster,
+          next;
+  uint8_t k;
+
+  if (file->n <= n) {
+    i = file->n;
+    cluster = file->nth_cluster;
+  }
+
+  for (k = 0; k < file->num_extents; k++) {
+    e = &file->extents[k];
+    if (n < e->n) {
+      continue;
+    }
+    if (n < e->n + e->length) {
+      PRINTF("\nfat.c: find_file_cluster( fd = %d, n = %lu ) = %lu (cached)", fd, n, e->cluster + (n - e->n));
+      return e->cluster + (n - e->n);
+    }
+    if (e->n + e->length - 1 > i) {
+      i = e->n + e->length - 1;
+      cluster = e->cluster + e->length - 1;
+    }
+  }
+
+  for (; i < n && cluster >= 2 && !is_EOC(cluster); i++) {
+    next = read_fat_entry(cluster);
+    if (next >= 2 && !is_EOC(next)) {
+      add_extent(file, i + 1, next);
+    }
+    cluster = next;
+  }
+
+  PRINTF("\nfat.c: find_file_cluster( fd = %d, n = %lu ) = %lu", fd, n, cluster);
+  return cluster;
+}
+/*----------------------------------------------------------------------------*/
+/* Remembers that the nth cluster of a file is the given cluster. If the
+ * cache is full, the shortest extent is replaced.
+ */
+static void
+add_extent(struct file *file, uint32_t n, uint32_t cluster)
+{
+  struct cluster_extent *e, *victim = NULL;
+  uint8_t k;
+
+  for (k = 0; k < file->num_extents; k++) {
+    e = &file->extents[k];
+    if (n >= e->n && n < e->n + e->length) {
+      return;
+    }
+    if (e->n + e->length == n && e->cluster + e->length == cluster && e->length < 0xFFFF) {
+      e->length++;
+      return;
+    }
+    if (victim == NULL || e->length <= victim->length) {
+      victim = e;
+    }
+  }
+
+  if (file->num_extents < FAT_EXTENT_CACHE_SIZE) {
+    victim = &file->extents[file->num_extents++];
+  }
+  victim->n = n;
+  victim->cluster = cluster;
+  victim->length = 1;
+}
+#endif /* FAT_EXTENT_CACHE_SIZE */
 /*----------------------------------------------------------------------------*/
 /*
  * Iterates over a cluster chain corresponding to a given dir entry and removes all entries.
@@ -277,6 +383,16 @@ reset_cluster_chain(struct dir_entry *dir_ent)
 {
   uint32_t cluster = (((uint32_t) dir_ent->DIR_FstClusHI) << 16) + dir_ent->DIR_FstClusLO;
   uint32_t next_cluster = read_fat_entry(cluster);
+#if FAT_EXTENT_CACHE_SIZE
+  uint8_t i;
+
+  /* Drop extents kept for the file since it was last open */
+  for (i = 0; i < FAT_FD_POOL_SIZE; i++) {
+    if (fat_file_pool[i].cluster == cluster) {
+      fat_file_pool[i].num_extents = 0;
+    }
+  }
+#endif
 
   while (!is_EOC(cluster) && cluster >= 2) {
     write_fat_entry(cluster, 0L);
@@ -311,6 +427,9 @@ add_cluster_to_file(int fd)
     fat_file_pool[fd].cluster = free_cluster;
     fat_file_pool[fd].n = 0;
     fat_file_pool[fd].nth_cluster = free_cluster;
+#if FAT_EXTENT_CACHE_SIZE
+    add_extent(&fat_file_pool[fd], 0, free_cluster);
+#endif
 
     PRINTF("\n\tfat.c: File was empty, now has first cluster %lu added to Chain", free_cluster);
     return;
@@ -325,6 +444,9 @@ add_cluster_to_file(int fd)
   write_fat_entry(cluster, free_cluster);
   write_fat_entry(free_cluster, EOC);
   fat_file_pool[fd].nth_cluster = free_cluster;
+#if FAT_EXTENT_CACHE_SIZE
+  add_extent(&fat_file_pool[fd], fat_file_pool[fd].n, free_cluster);
+#endif
   PRINTF("\n\tfat.c: File was NOT empty, now has cluster %lu as %lu. cluster to Chain", free_cluster, fat_file_pool[fd].n);
 }
 /*----------------------------------------------------------------------------*/
@@ -607,16 +729,10 @@ pr_is_current_path_part_a_file(struct PathResolver *rsolv)
 }
 /*----------------------------------------------------------------------------*/
 /*Sector Buffer Functions*/
-/**
- * Writes the current buffered block back to the disk if it was changed.
- */
-void
-cfs_fat_flush()
+/* Writes a buffered sector back to the disk. */
+static void
+write_back_sector(uint32_t sector_addr, uint8_t *buffer)
 {
-  if (!sector_buffer_dirty) {
-    return;
-  }
-
 #ifdef FAT_COOPERATIVE
   if (!coop_step_allowed) {
     next_step_type = WRITE;
@@ -626,11 +742,113 @@ cfs_fat_flush()
   }
 #endif
 
-  PRINTF("\nfat.c: fat_flush(): Flushing sector %lu", sector_buffer_addr);
-  if (diskio_write_block(mounted.dev, sector_buffer_addr, sector_buffer) != DISKIO_SUCCESS) {
+  PRINTF("\nfat.c: fat_flush(): Flushing sector %lu", sector_addr);
+  if (diskio_write_block(mounted.dev, sector_addr, buffer) != DISKIO_SUCCESS) {
     PRINTERROR("\nfat.c: fat_flush(): DiskIO-Error occured");
   }
+}
+/*----------------------------------------------------------------------------*/
+/**
+ * Writes all buffered sectors back to the disk that were changed.
+ */
+void
+cfs_fat_flush()
+{
+#if FAT_SECTOR_CACHE_SIZE > 1
+  uint8_t i;
+
+  for (i = 0; i < FAT_SECTOR_CACHE_SIZE; i++) {
+    if (i != sector_cache_current && sector_cache[i].dirty) {
+      write_back_sector(sector_cache[i].addr, sector_cache_buffers[i]);
+      sector_cache[i].dirty = 0;
+    }
+  }
+#endif /* FAT_SECTOR_CACHE_SIZE > 1 */
 
+  if (!sector_buffer_dirty) {
+    return;
+  }
+
+  write_back_sector(sector_buffer_addr, sector_buffer);
+  sector_buffer_dirty = 0;
+}
+/*----------------------------------------------------------------------------*/
+/* Makes the sector at the given address the one in sector_buffer.
+ * data tells whether the sector holds file data.
+ * Returns 1 if the sector was buffered already, otherwise 0 and the
+ * content of sector_buffer is undefined.
+ */
+static uint8_t
+select_sector(uint32_t sector_addr, uint8_t data)
+{
+#if FAT_SECTOR_CACHE_SIZE > 1
+  uint8_t i, victim = FAT_SECTOR_CACHE_SIZE;
+  uint8_t found = 0;
+
+  if (sector_buffer_addr == sector_addr && sector_addr != 0) {
+    sector_cache[sector_cache_current].used = ++sector_cache_clock;
+    sector_cache[sector_cache_current].data = data;
+    return 1;
+  }
+
+  sector_cache[sector_cache_current].addr = sector_buffer_addr;
+  sector_cache[sector_cache_current].dirty = sector_buffer_dirty;
+
+  /* Look for the sector. Otherwise replace an empty entry, or the least
+   * recently used one, preferring file data over FAT and directory
+   * sectors which are needed again soon. */
+  for (i = 0; i < FAT_SECTOR_CACHE_SIZE; i++) {
+    if (sector_cache[i].addr == sector_addr && sector_addr != 0) {
+      found = 1;
+      break;
+    }
+    if (victim == FAT_SECTOR_CACHE_SIZE ||
+        (sector_cache[victim].addr != 0 &&
+         (sector_cache[i].addr == 0 ||
+          sector_cache[i].data > sector_cache[victim].data ||
+          (sector_cache[i].data == sector_cache[victim].data &&
+           (uint16_t) (sector_cache_clock - sector_cache[i].used) >
+           (uint16_t) (sector_cache_clock - sector_cache[victim].used))))) {
+      victim = i;
+    }
+  }
+
+  if (!found) {
+    i = victim;
+    if (sector_cache[i].dirty) {
+      write_back_sector(sector_cache[i].addr, sector_cache_buffers[i]);
+    }
+    sector_cache[i].addr = sector_addr;
+    sector_cache[i].dirty = 0;
+  }
+
+  sector_cache_current = i;
+  sector_cache[i].used = ++sector_cache_clock;
+  sector_cache[i].data = data;
+  sector_buffer = sector_cache_buffers[i];
+  sector_buffer_addr = sector_cache[i].addr;
+  sector_buffer_dirty = sector_cache[i].dirty;
+  return found;
+#else /* FAT_SECTOR_CACHE_SIZE > 1 */
+  if (sector_buffer_addr == sector_addr && sector_addr != 0) {
+    return 1;
+  }
+
+  cfs_fat_flush();
+
+  sector_buffer_addr = sector_addr;
+  return 0;
+#endif /* FAT_SECTOR_CACHE_SIZE > 1 */
+}
+/*----------------------------------------------------------------------------*/
+/* Drops all buffered sectors without writing them back. */
+static void
+invalidate_sectors()
+{
+#if FAT_SECTOR_CACHE_SIZE > 1
+  memset(sector_cache, 0, sizeof (sector_cache));
+#endif /* FAT_SECTOR_CACHE_SIZE > 1 */
+  sector_buffer_addr = 0;
   sector_buffer_dirty = 0;
 }
 /*----------------------------------------------------------------------------*/
@@ -642,15 +860,20 @@ cfs_fat_flush()
 static uint8_t
 read_sector(uint32_t sector_addr)
 {
-  if (sector_buffer_addr == sector_addr && sector_addr != 0) {
+  return load_sector(sector_addr, 0);
+}
+/*----------------------------------------------------------------------------*/
+/* Reads sector at given address. data tells whether the sector holds
+ * file data, which is replaced first when the sector cache is full.
+ */
+static uint8_t
+load_sector(uint32_t sector_addr, uint8_t data)
+{
+  if (select_sector(sector_addr, data)) {
     PRINTF("\nfat.c: fat_read_sector( sector_addr = 0x%lX ) = 0", sector_addr);
     return 0;
   }
 
-  cfs_fat_flush();
-
-  sector_buffer_addr = sector_addr;
-
 #ifdef FAT_COOPERATIVE
   if (!coop_step_allowed) {
     next_step_type = READ;
@@ -669,6 +892,40 @@ read_sector(uint32_t sector_addr)
   PRINTF("\nfat.c: read_sector( sector_addr = 0x%lX ) = 0", sector_addr);
   return 0;
 }
+#if FAT_MULTI_BLOCK_WRITE && !defined(FAT_COOPERATIVE)
+/*----------------------------------------------------------------------------*/
+/* Drops buffered sectors in the given range, which are overwritten on the
+ * disk. Changes of these sectors are not written back.
+ */
+static void
+drop_sectors(uint32_t sector_addr, uint32_t num)
+{
+#if FAT_SECTOR_CACHE_SIZE > 1
+  uint8_t i;
+
+  for (i = 0; i < FAT_SECTOR_CACHE_SIZE; i++) {
+    if (sector_cache[i].addr >= sector_addr && sector_cache[i].addr < sector_addr + num) {
+      sector_cache[i].addr = 0;
+      sector_cache[i].dirty = 0;
+    }
+  }
+#endif /* FAT_SECTOR_CACHE_SIZE > 1 */
+
+  if (sector_buffer_addr >= sector_addr && sector_buffer_addr < sector_addr + num) {
+    sector_buffer_addr = 0;
+    sector_buffer_dirty = 0;
+  }
+}
+#endif /* FAT_MULTI_BLOCK_WRITE && !defined(FAT_COOPERATIVE) */
+/*----------------------------------------------------------------------------*/
+/* Fills the sector at given address with zeros, without reading it. */
+static void
+clear_sector(uint32_t sector_addr)
+{
+  select_sector(sector_addr, 0);
+  memset(sector_buffer, 0x00, 512);
+  sector_buffer_dirty = 1;
+}
 /*----------------------------------------------------------------------------*/
 /** Loads the next sector of current sector_buffer_addr.
  * \return
@@ -679,7 +936,6 @@ static uint8_t
 read_next_sector()
 {
   PRINTF("\nread_next_sector()");
-  cfs_fat_flush();
 
   /* To restore start sector buffer address if reading next sector failed. */
   uint32_t save_sbuff_addr = sector_buffer_addr;
@@ -855,11 +1111,14 @@ cfs_fat_umount_device()
   // invalidate file-descriptors
   for (i = 0; i < FAT_FD_POOL_SIZE; i++) {
     fat_fd_pool[i].file = 0;
+#if FAT_EXTENT_CACHE_SIZE
+    fat_file_pool[i].num_extents = 0;
+#endif
   }
 
   // Reset the device pointer and sector buffer
   mounted.dev = 0;
-  sector_buffer_addr = 0;
+  invalidate_sectors();
 }
 /*----------------------------------------------------------------------------*/
 /*CFS frontend functions*/
@@ -910,6 +1169,12 @@ cfs_open(const char *name, int flags)
     return -1;
   }
 
+#if FAT_EXTENT_CACHE_SIZE
+  /* Keep the extents if the file was opened with this descriptor before */
+  if (fat_file_pool[fd].cluster != dir_ent.DIR_FstClusLO + (((uint32_t) dir_ent.DIR_FstClusHI) << 16)) {
+    fat_file_pool[fd].num_extents = 0;
+  }
+#endif
   fat_file_pool[fd].cluster = dir_ent.DIR_FstClusLO + (((uint32_t) dir_ent.DIR_FstClusHI) << 16);
   fat_file_pool[fd].nth_cluster = fat_file_pool[fd].cluster;
   fat_file_pool[fd].n = 0;
@@ -975,8 +1240,12 @@ fat_read_write(int fd, const void *buf, unsigned int len, unsigned char write)
   uint32_t clusters = (fat_fd_pool[fd].offset / mounted.info.BPB_BytesPerSec) / mounted.info.BPB_SecPerClus;
   /* offset within cluster [sectors] */
   uint8_t clus_offset = (fat_fd_pool[fd].offset / mounted.info.BPB_BytesPerSec) % mounted.info.BPB_SecPerClus;
-  uint16_t i, j = 0;
+  uint16_t i;
+  unsigned int j = 0;
   uint8_t *buffer = (uint8_t *) buf;
+#if FAT_MULTI_BLOCK_WRITE && !defined(FAT_COOPERATIVE)
+  uint32_t num;
+#endif
 
   /* For read acces, check file length. */
   if (write == 0) {
@@ -994,7 +1263,36 @@ fat_read_write(int fd, const void *buf, unsigned int len, unsigned char write)
     }
   }
 
-  while (load_next_sector_of_file(fd, clusters, clus_offset, write) == 0) {
+  while (1) {
+#if FAT_MULTI_BLOCK_WRITE && !defined(FAT_COOPERATIVE)
+    /* Whole sectors are written without the sector buffer */
+    if (write && offset == 0 && len - j >= mounted.info.BPB_BytesPerSec) {
+      num = write_file_sectors(fd, clusters, clus_offset, buffer + j, (len - j) / mounted.info.BPB_BytesPerSec);
+      if (num == 0) {
+        break;
+      }
+
+      j += num * mounted.info.BPB_BytesPerSec;
+      fat_fd_pool[fd].offset += num * mounted.info.BPB_BytesPerSec;
+      if (fat_fd_pool[fd].offset > fat_file_pool[fd].dir_entry.DIR_FileSize) {
+        fat_file_pool[fd].dir_entry.DIR_FileSize = fat_fd_pool[fd].offset;
+      }
+
+      num += clus_offset;
+      clusters += num / mounted.info.BPB_SecPerClus;
+      clus_offset = num % mounted.info.BPB_SecPerClus;
+
+      if (j >= len) {
+        break;
+      }
+      continue;
+    }
+#endif /* FAT_MULTI_BLOCK_WRITE && !defined(FAT_COOPERATIVE) */
+
+    if (load_next_sector_of_file(fd, clusters, clus_offset, write) != 0) {
+      break;
+    }
+
     PRINTF("\nfat.c: cfs_write(): Writing in sector %lu", sector_buffer_addr);
     for (i = offset; i < mounted.info.BPB_BytesPerSec && j < len; i++, j++, fat_fd_pool[fd].offset++) {
       if (write) {
@@ -1047,14 +1345,15 @@ cfs_seek(int fd, cfs_offset_t offset, int whence)
       fat_fd_pool[fd].offset += offset;
       break;
     case CFS_SEEK_END:
-      fat_fd_pool[fd].offset = (fat_file_pool[fd].dir_entry.DIR_FileSize - 1) + offset;
+      fat_fd_pool[fd].offset = fat_file_pool[fd].dir_entry.DIR_FileSize + offset;
       break;
     default:
       break;
   }
 
-  if (fat_fd_pool[fd].offset >= fat_file_pool[fd].dir_entry.DIR_FileSize) {
-    fat_fd_pool[fd].offset = (fat_file_pool[fd].dir_entry.DIR_FileSize - 1);
+  /* The end of the file is a valid position for appending */
+  if (fat_fd_pool[fd].offset > fat_file_pool[fd].dir_entry.DIR_FileSize) {
+    fat_fd_pool[fd].offset = fat_file_pool[fd].dir_entry.DIR_FileSize;
   }
 
   if (fat_fd_pool[fd].offset < 0) {
@@ -1285,14 +1584,10 @@ add_directory_entry_to_current(struct dir_entry *dir_ent, uint32_t *dir_entry_se
         write_fat_entry(free_cluster, EOC);
         PRINTF("\nfat.c: add_directory_entry_to_current(): cluster %lu added to chain of sector_buffer_addr cluster %lu", free_cluster, SECTOR_TO_CLUSTER(sector_buffer_addr));
 
-        cfs_fat_flush();
         /* Iterate over all sectors in new allocated cluster and clear them. */
         uint32_t first_free_sector = CLUSTER_TO_SECTOR(free_cluster);
-        memset(sector_buffer, 0x00, 512);
         for (i = 0; i < mounted.info.BPB_SecPerClus; i++) {
-          sector_buffer_addr = first_free_sector + i;
-          sector_buffer_dirty = 1;
-          cfs_fat_flush();
+          clear_sector(first_free_sector + i);
         }
 
         if (read_sector(CLUSTER_TO_SECTOR(free_cluster)) == 0) {
@@ -1342,13 +1637,37 @@ remove_dir_entry(uint32_t dir_entry_sector, uint16_t dir_entry_offset)
 static uint8_t
 load_next_sector_of_file(int fd, uint32_t clusters, uint8_t clus_offset, uint8_t write)
 {
-  uint32_t cluster = 0;
+  uint32_t cluster;
   PRINTF("\nfat.c: load_next_sector_of_file( fd = %d, clusters = %lu, clus_offset = %u, write = %u ) = ?", fd, clusters, clus_offset, write);
 
+  cluster = get_file_cluster(fd, clusters, write);
+  if (cluster == 0) {
+    return 1;
+  }
+
+  return load_sector(CLUSTER_TO_SECTOR(cluster) + clus_offset, 1);
+}
+/*----------------------------------------------------------------------------*/
+/* Returns the cluster with the given number in the cluster chain of a file.
+ * If the file ends before and write is set, a cluster is added to it,
+ * otherwise 0 is returned.
+ */
+static uint32_t
+get_file_cluster(int fd, uint32_t clusters, uint8_t write)
+{
+  uint32_t cluster = 0;
+
   //If we know the nth Cluster already we do not have to recalculate it
   if (clusters == fat_file_pool[fd].n) {
     PRINTF("\nfat.c: load_next_sector_of_file(): we know nth cluster already");
     cluster = fat_file_pool[fd].nth_cluster;
+#if FAT_EXTENT_CACHE_SIZE
+    //Otherwise start from the closest cluster we know
+  } else {
+    PRINTF("\nfat.c: load_next_sector_of_file(): We are somewhere else, looking up the extent cache");
+    cluster = find_file_cluster(fd, clusters);
+  }
+#else /* FAT_EXTENT_CACHE_SIZE */
     //If we are now at the nth-1 Cluster it is easy to get the next cluster
   } else if (clusters == fat_file_pool[fd].n + 1) {
     PRINTF("\nfat.c: load_next_sector_of_file(): we need the cluster n and are at n-1");
@@ -1358,6 +1677,7 @@ load_next_sector_of_file(int fd, uint32_t clusters, uint8_t clus_offset, uint8_t
     PRINTF("\nfat.c: load_next_sector_of_file(): We are somewhere else, need to iterate the chain until nth cluster");
     cluster = find_nth_cluster(fat_file_pool[fd].cluster, clusters);
   }
+#endif /* FAT_EXTENT_CACHE_SIZE */
   PRINTF("\nfat.c: load_next_sector_of_file(): fat_file_pool[%d].nth_cluster = %lu, fat_file_pool[%d].n = %lu", fd, fat_file_pool[fd].nth_cluster, fd, fat_file_pool[fd].n);
 
   // If there is no cluster allocated to the file or the current cluster is EOC then add another cluster to the file
@@ -1369,15 +1689,59 @@ load_next_sector_of_file(int fd, uint32_t clusters, uint8_t clus_offset, uint8_t
       // Remember that after the add_cluster_to_file-Function the nth_cluster and n is set to the added cluster
       cluster = fat_file_pool[fd].nth_cluster;
     } else {
-      return 1;
+      return 0;
     }
   } else {
     fat_file_pool[fd].nth_cluster = cluster;
     fat_file_pool[fd].n = clusters;
   }
 
-  return read_sector(CLUSTER_TO_SECTOR(cluster) + clus_offset);
+  return cluster;
 }
+#if FAT_MULTI_BLOCK_WRITE && !defined(FAT_COOPERATIVE)
+/*----------------------------------------------------------------------------*/
+/* Writes num whole sectors of a file from buffer, starting at the given
+ * position, with one multi block write. The write ends early at the first
+ * cluster that does not follow the previous one on the disk.
+ * Returns the number of sectors written, 0 on errors.
+ */
+static uint32_t
+write_file_sectors(int fd, uint32_t clusters, uint8_t clus_offset, uint8_t *buffer, uint32_t num)
+{
+  uint32_t cluster, next, sector_addr, run;
+
+  cluster = get_file_cluster(fd, clusters, 1);
+  if (cluster == 0) {
+    return 0;
+  }
+  sector_addr = CLUSTER_TO_SECTOR(cluster) + clus_offset;
+  run = mounted.info.BPB_SecPerClus - clus_offset;
+
+  while (run < num) {
+    next = get_file_cluster(fd, clusters + 1, 1);
+    if (next != cluster + 1) {
+      break;
+    }
+    cluster = next;
+    clusters++;
+    run += mounted.info.BPB_SecPerClus;
+  }
+
+  if (run > num) {
+    run = num;
+  }
+
+  drop_sectors(sector_addr, run);
+
+  PRINTF("\nfat.c: write_file_sectors(): Writing %lu sectors from %lu", run, sector_addr);
+  if (diskio_write_blocks(mounted.dev, sector_addr, run, buffer) != DISKIO_SUCCESS) {
+    PRINTERROR("\nfat.c: write_file_sectors(): DiskIO-Error occured");
+    return 0;
+  }
+
+  return run;
+}
+#endif /* FAT_MULTI_BLOCK_WRITE && !defined(FAT_COOPERATIVE) */
 /*----------------------------------------------------------------------------*/
 /*FAT Interface Functions*/
 uint32_t
@@ -1411,6 +1775,9 @@ cfs_fat_sync_fats()
       diskio_write_block(mounted.dev, (fat_block + mounted.info.BPB_RsvdSecCnt) + ((fat_number - 1) * mounted.info.BPB_FATSz), sector_buffer);
     }
   }
+
+  /* sector_buffer was used for copying */
+  invalidate_sectors();
 }
 /*----------------------------------------------------------------------------*/
 /*Helper Functions*/
@@ -94,6 +94,38 @@
 #define FAT_FD_POOL_SIZE 5
 #endif
 
+/** Number of sectors buffered in RAM. Changed sectors are only written
+ * back when they are replaced or on cfs_fat_flush(), so FAT and
+ * directory sectors stay buffered while a file is read or written.
+ * Sectors of file data are replaced first. 1 is a single sector buffer.
+ */
+#ifdef FAT_CONF_SECTOR_CACHE_SIZE
+#define FAT_SECTOR_CACHE_SIZE FAT_CONF_SECTOR_CACHE_SIZE
+#else
+#define FAT_SECTOR_CACHE_SIZE 1
+#endif
+
+/** Number of extents (runs of consecutive clusters) of the cluster chain
+ * remembered for each open file, so that seeking does not need to walk
+ * the chain from its start. 0 disables the extent cache.
+ */
+#ifdef FAT_CONF_EXTENT_CACHE_SIZE
+#define FAT_EXTENT_CACHE_SIZE FAT_CONF_EXTENT_CACHE_SIZE
+#else
+#define FAT_EXTENT_CACHE_SIZE 0
+#endif
+
+/** Write whole sectors of a cfs_write() straight from the caller's buffer,
+ * with one multi block write for each run of consecutive clusters. This
+ * saves the sector buffer copy and lets SD cards pre-erase the blocks.
+ * Not available with FAT_COOPERATIVE.
+ */
+#ifdef FAT_CONF_MULTI_BLOCK_WRITE
+#define FAT_MULTI_BLOCK_WRITE FAT_CONF_MULTI_BLOCK_WRITE
+#else
+#define FAT_MULTI_BLOCK_WRITE 0
+#endif
+
 /** Holds boot sector information. */
 struct FAT_Info {
   uint8_t type; /** Either FAT16, FAT32 or FAT_INVALID */
@@ -129,6 +161,18 @@ struct dir_entry {
   uint32_t DIR_FileSize;
 };
 
+#if FAT_EXTENT_CACHE_SIZE
+/** Consecutive clusters of a cluster chain */
+struct cluster_extent {
+  /** Position of the first cluster in the cluster chain */
+  uint32_t n;
+  /** First cluster on disk */
+  uint32_t cluster;
+  /** Number of clusters */
+  uint16_t length;
+};
+#endif
+
 struct file {
   //metadata
   /** Cluster Position on disk */
@@ -138,6 +182,10 @@ struct file {
   struct dir_entry dir_entry;
   uint32_t nth_cluster;
   uint32_t n;
+#if FAT_EXTENT_CACHE_SIZE
+  struct cluster_extent extents[FAT_EXTENT_CACHE_SIZE];
+  uint8_t num_extents;
+#endif
 };
 
 struct file_desc {
@@ -219,7 +267,8 @@ uint16_t cfs_fat_get_create_time(int fd);
 void cfs_fat_sync_fats();
 
 /**
- * Writes the current buffered block back to the disk if it was changed.
+ * Writes all buffered sectors back to the disk that were changed.
+ * Call this before the card may be removed or power may be lost.
  */
 void cfs_fat_flush();
 
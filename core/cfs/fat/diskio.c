@@ -46,6 +46,7 @@
 
 #include "diskio.h"
 #include "mbr.h"
+#include <stdio.h>
 #include <string.h>
 #include "diskio-arch.h"
 
@@ -82,6 +83,9 @@ diskio_print_device_info(struct diskio_device_info *dev)
     case DISKIO_DEVICE_TYPE_GENERIC_FLASH:
       printf("Generic_Flash");
       break;
+    case DISKIO_DEVICE_TYPE_FILE:
+      printf("File");
+      break;
     default:
       printf("Unknown: %d", dev->type & 0x7F);
       break;
@@ -135,6 +139,43 @@ diskio_write_blocks_done(struct diskio_device_info *dev)
   return diskio_rw_op(dev, 0, 0, NULL, DISKIO_OP_WRITE_BLOCKS_DONE);
 }
 /*----------------------------------------------------------------------------*/
+int
+diskio_write_blocks(struct diskio_device_info *dev, uint32_t block_start_address, uint32_t num_blocks, uint8_t *buffer)
+{
+  uint32_t i = 0;
+  int ret;
+
+  if (dev == NULL) {
+    if (default_device == 0) {
+      PRINTF("\nNo default device");
+      return DISKIO_ERROR_NO_DEVICE_SELECTED;
+    }
+    dev = default_device;
+  }
+
+  if (diskio_write_blocks_start(dev, block_start_address, num_blocks) == DISKIO_SUCCESS) {
+    for (i = 0; i < num_blocks; i++) {
+      if (diskio_write_blocks_next(dev, buffer + i * dev->sector_size) != DISKIO_SUCCESS) {
+        PRINTF("\ndiskio_write_blocks(): Multi block write failed at %ld", i);
+        break;
+      }
+    }
+    if (diskio_write_blocks_done(dev) != DISKIO_SUCCESS) {
+      i = 0;
+    }
+  }
+
+  /* Write the remaining blocks one by one, these are retried on errors */
+  for (; i < num_blocks; i++) {
+    ret = diskio_write_block(dev, block_start_address + i, buffer + i * dev->sector_size);
+    if (ret != DISKIO_SUCCESS) {
+      return ret;
+    }
+  }
+
+  return DISKIO_SUCCESS;
+}
+/*----------------------------------------------------------------------------*/
 static int
 diskio_rw_op(struct diskio_device_info *dev, uint32_t block_start_address, uint32_t num_blocks, uint8_t *buffer, uint8_t op)
 {
@@ -306,6 +347,33 @@ diskio_rw_op(struct diskio_device_info *dev, uint32_t block_start_address, uint3
       break;
 #endif /* FLASH_INIT */
 
+#ifdef FILE_INIT
+    case DISKIO_DEVICE_TYPE_FILE:
+      switch (op) {
+        case DISKIO_OP_READ_BLOCK:
+          ret_code = FILE_READ_BLOCK(block_start_address, buffer);
+          break;
+        case DISKIO_OP_WRITE_BLOCK:
+          ret_code = FILE_WRITE_BLOCK(block_start_address, buffer);
+          break;
+        case DISKIO_OP_WRITE_BLOCKS_START:
+          ret_code = FILE_WRITE_BLOCKS_START(block_start_address, num_blocks);
+          break;
+        case DISKIO_OP_WRITE_BLOCKS_NEXT:
+          ret_code = FILE_WRITE_BLOCKS_NEXT(buffer);
+          break;
+        case DISKIO_OP_WRITE_BLOCKS_DONE:
+          ret_code = FILE_WRITE_BLOCKS_DONE();
+          break;
+        default:
+          return DISKIO_ERROR_OPERATION_NOT_SUPPORTED;
+      }
+      if (ret_code != 0) {
+        return DISKIO_ERROR_INTERNAL_ERROR;
+      }
+      return DISKIO_SUCCESS;
+#endif /* FILE_INIT */
+
     case DISKIO_DEVICE_TYPE_NOT_RECOGNIZED:
     default:
       return DISKIO_ERROR_NO_DEVICE_SELECTED;
@@ -354,6 +422,17 @@ diskio_detect_devices()
     index += 1;
   }
 #endif /* FLASH_INIT */
+
+#ifdef FILE_INIT
+  if (FILE_INIT() == 0) {
+    devices[index].type = DISKIO_DEVICE_TYPE_FILE;
+    devices[index].number = dev_num;
+    devices[index].num_sectors = FILE_GET_BLOCK_NUM();
+    devices[index].sector_size = FILE_GET_BLOCK_SIZE();
+    devices[index].first_sector = 0;
+    index += 1;
+  }
+#endif /* FILE_INIT */
   
 #ifdef SD_INIT
   if (SD_INIT() == 0) {
@@ -59,6 +59,7 @@
 #define DISKIO_DEVICE_TYPE_NOT_RECOGNIZED 0
 #define DISKIO_DEVICE_TYPE_SD_CARD 1
 #define DISKIO_DEVICE_TYPE_GENERIC_FLASH 2
+#define DISKIO_DEVICE_TYPE_FILE 3
 #define DISKIO_DEVICE_TYPE_PARTITION 128
 
 /** Bigger sectors then this are not supported. May be reduced down to 512 to use less memory. */
@@ -187,6 +188,18 @@ int diskio_write_blocks_next(struct diskio_device_info *dev, uint8_t *buffer);
  */
 int diskio_write_blocks_done(struct diskio_device_info *dev);
 
+/**
+ * Writes multiple consecutive blocks to the specified device.
+ * Uses a multi block write if the device supports it, otherwise or if
+ * it fails, the blocks are written one by one.
+ * \param *dev the pointer to the device info
+ * \param block_start_address the address of the first block to be written
+ * \param num_blocks number of blocks to be written
+ * \param *buffer buffer holding num_blocks blocks
+ * \return DISKIO_SUCCESS on success, !0 on error
+ */
+int diskio_write_blocks(struct diskio_device_info *dev, uint32_t block_start_address, uint32_t num_blocks, uint8_t *buffer);
+
 /**
  * Returns the device-Database.
  *
@@ -356,6 +356,11 @@ tcp_socket_send(struct tcp_socket *s,
     s->output_senddata_len = s->output_data_len;
   }
 
+  /* Send now rather than at the next periodic poll */
+  if(s->c != NULL) {
+    tcpip_poll_tcp(s->c);
+  }
+
   return len;
 }
 /*---------------------------------------------------------------------------*/
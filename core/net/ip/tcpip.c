@@ -72,6 +72,28 @@ extern struct uip_fallback_interface UIP_FALLBACK_INTERFACE;
 #include "rpl/rpl.h"
 #endif
 
+/* Number of destinations whose next-hop neighbor is remembered, so that
+   packets of steady flows skip the route and neighbor lookups */
+#ifdef TCPIP_CONF_FWD_CACHE_SIZE
+#define TCPIP_FWD_CACHE_SIZE TCPIP_CONF_FWD_CACHE_SIZE
+#else
+#define TCPIP_FWD_CACHE_SIZE 0
+#endif
+
+#if NETSTACK_CONF_WITH_IPV6 && TCPIP_FWD_CACHE_SIZE > 0
+#if !UIP_DS6_NOTIFICATIONS
+#error "TCPIP_CONF_FWD_CACHE_SIZE needs UIP_CONF_UIP_DS6_NOTIFICATIONS"
+#endif
+struct fwd_cache_entry {
+  uip_ipaddr_t dest;
+  uip_ds6_nbr_t *nbr;
+  uip_ds6_route_t *route;       /* NULL if no route was used */
+};
+/* Direct mapped, a destination can only be in the entry it hashes to */
+static struct fwd_cache_entry fwd_cache[TCPIP_FWD_CACHE_SIZE];
+static struct uip_ds6_notification fwd_cache_notification;
+#endif /* NETSTACK_CONF_WITH_IPV6 && TCPIP_FWD_CACHE_SIZE > 0 */
+
 process_event_t tcpip_event;
 #if UIP_CONF_ICMP6
 process_event_t tcpip_icmp6_event;
@@ -128,6 +150,39 @@ tcpip_set_outputfunc(uint8_t (*f)(const uip_lladdr_t *))
 {
   outputfunc = f;
 }
+#if TCPIP_FWD_CACHE_SIZE > 0
+/*---------------------------------------------------------------------------*/
+static struct fwd_cache_entry *
+fwd_cache_entry(const uip_ipaddr_t *dest)
+{
+  return &fwd_cache[(dest->u8[15] ^ dest->u8[14] ^ dest->u8[13])
+                    % TCPIP_FWD_CACHE_SIZE];
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_nbr_t *
+fwd_cache_lookup(const uip_ipaddr_t *dest)
+{
+  struct fwd_cache_entry *e = fwd_cache_entry(dest);
+  if(e->nbr != NULL && uip_ipaddr_cmp(&e->dest, dest)) {
+    /* A hit stands in for the route lookup, so the route must not
+       become the least recently used one */
+    if(e->route != NULL) {
+      uip_ds6_route_refresh(e->route);
+    }
+    return e->nbr;
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+fwd_cache_flush(int event, uip_ipaddr_t *route, uip_ipaddr_t *nexthop,
+                int num_routes)
+{
+  /* Any change of routes, default routes or neighbors may change the
+     next hop of a destination or free the neighbor of an entry */
+  memset(fwd_cache, 0, sizeof(fwd_cache));
+}
+#endif /* TCPIP_FWD_CACHE_SIZE > 0 */
 #else
 
 static uint8_t (* outputfunc)(void);
@@ -540,7 +595,15 @@ void
 tcpip_ipv6_output(void)
 {
   uip_ds6_nbr_t *nbr = NULL;
+  uip_ds6_route_t *route = NULL;
   uip_ipaddr_t *nexthop;
+#if TCPIP_FWD_CACHE_SIZE > 0
+  uint8_t cacheable = 1;
+#endif /* TCPIP_FWD_CACHE_SIZE > 0 */
+#if UIP_CONF_IPV6_RPL && RPL_WITH_NON_STORING
+  uip_ipaddr_t srh_nexthop;
+  int srh;
+#endif /* UIP_CONF_IPV6_RPL && RPL_WITH_NON_STORING */
 
   if(uip_len == 0) {
     return;
@@ -562,20 +625,50 @@ tcpip_ipv6_output(void)
     /* Next hop determination */
     nbr = NULL;
 
+#if UIP_CONF_IPV6_RPL && RPL_WITH_NON_STORING
+    /* Packets going down a non-storing DAG follow their source route */
+    srh = rpl_srh_output(&srh_nexthop);
+    if(srh < 0) {
+      uip_len = 0;
+      return;
+    }
+    if(srh > 0) {
+      nexthop = &srh_nexthop;
+#if TCPIP_FWD_CACHE_SIZE > 0
+      cacheable = 0;
+#endif /* TCPIP_FWD_CACHE_SIZE > 0 */
+    } else
+#endif /* UIP_CONF_IPV6_RPL && RPL_WITH_NON_STORING */
+#if TCPIP_FWD_CACHE_SIZE > 0
+    if((nbr = fwd_cache_lookup(&UIP_IP_BUF->destipaddr)) != NULL) {
+      nexthop = &nbr->ipaddr;
+    } else
+#endif /* TCPIP_FWD_CACHE_SIZE > 0 */
     /* We first check if the destination address is on our immediate
        link. If so, we simply use the destination address as our
        nexthop address. */
     if(uip_ds6_is_addr_onlink(&UIP_IP_BUF->destipaddr)){
       nexthop = &UIP_IP_BUF->destipaddr;
     } else {
-      uip_ds6_route_t *route;
       /* Check if we have a route to the destination address. */
       route = uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr);
 
       /* No route was found - we send to the default route instead. */
       if(route == NULL) {
         PRINTF("tcpip_ipv6_output: no route found, using default route\n");
+#if UIP_CONF_IPV6_RPL && RPL_MULTIPATH
+        /* Spread upward traffic over the RPL parents. The parent is picked
+           per packet, so the choice must not be cached. */
+        nexthop = rpl_multipath_nexthop();
+#if TCPIP_FWD_CACHE_SIZE > 0
+        cacheable = 0;
+#endif /* TCPIP_FWD_CACHE_SIZE > 0 */
+        if(nexthop == NULL) {
+          nexthop = uip_ds6_defrt_choose();
+        }
+#else
         nexthop = uip_ds6_defrt_choose();
+#endif /* UIP_CONF_IPV6_RPL && RPL_MULTIPATH */
         if(nexthop == NULL) {
 #ifdef UIP_FALLBACK_INTERFACE
 	  PRINTF("FALLBACK: removing ext hdrs & setting proto %d %d\n", 
@@ -647,7 +740,17 @@ tcpip_ipv6_output(void)
       return;
     }
 #endif /* UIP_CONF_IPV6_RPL */
-    nbr = uip_ds6_nbr_lookup(nexthop);
+    if(nbr == NULL) {
+      nbr = uip_ds6_nbr_lookup(nexthop);
+#if TCPIP_FWD_CACHE_SIZE > 0
+      if(cacheable && nbr != NULL && nbr->state != NBR_INCOMPLETE) {
+        struct fwd_cache_entry *e = fwd_cache_entry(&UIP_IP_BUF->destipaddr);
+        uip_ipaddr_copy(&e->dest, &UIP_IP_BUF->destipaddr);
+        e->nbr = nbr;
+        e->route = route;
+      }
+#endif /* TCPIP_FWD_CACHE_SIZE > 0 */
+    }
     if(nbr == NULL) {
 #if UIP_ND6_SEND_NA
       if((nbr = uip_ds6_nbr_add(nexthop, NULL, 0, NBR_INCOMPLETE)) == NULL) {
@@ -814,6 +917,9 @@ PROCESS_THREAD(tcpip_process, ev, data)
   etimer_set(&periodic, CLOCK_SECOND / 2);
 
   uip_init();
+#if NETSTACK_CONF_WITH_IPV6 && TCPIP_FWD_CACHE_SIZE > 0
+  uip_ds6_notification_add(&fwd_cache_notification, fwd_cache_flush);
+#endif /* NETSTACK_CONF_WITH_IPV6 && TCPIP_FWD_CACHE_SIZE > 0 */
 #ifdef UIP_FALLBACK_INTERFACE
   UIP_FALLBACK_INTERFACE.init();
 #endif
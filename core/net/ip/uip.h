@@ -1828,6 +1828,13 @@ typedef struct uip_ext_hdr_opt_rpl {
   uint16_t senderrank;
 } uip_ext_hdr_opt_rpl;
 
+/* RPL source routing header, following the routing header (RFC 6554) */
+typedef struct uip_rpl_srh_hdr {
+  uint8_t cmpr; /* CmprI and CmprE */
+  uint8_t pad;
+  uint8_t reserved[2];
+} uip_rpl_srh_hdr;
+
 /* TCP header */
 struct uip_tcp_hdr {
   uint16_t srcport;
@@ -68,6 +68,9 @@
 #include "net/rime/rime.h"
 #include "net/ipv6/sicslowpan.h"
 #include "net/netstack.h"
+#if UIP_CONF_IPV6_RPL
+#include "net/rpl/rpl.h"
+#endif /* UIP_CONF_IPV6_RPL */
 
 #include <stdio.h>
 
@@ -223,13 +226,47 @@ static int last_tx_status;
 
 static uint16_t sicslowpan_len;
 
+/** Datagram tag to be put in the fragments I send. */
+static uint16_t my_tag;
+
+#if SICSLOWPAN_REASS_CONTEXTS > 0
+/** A datagram that is reassembled from the fragments of one sender */
+struct reass_context {
+  uip_buf_t buf;
+  linkaddr_t sender;
+  uint16_t tag;
+  /** The size of the datagram, 0 if the context is free */
+  uint16_t size;
+  /** One bit for each 8-byte unit of the datagram that was received */
+  uint8_t received[(UIP_BUFSIZE + 63) / 64];
+  struct timer timer;
+};
+
+static struct reass_context reass_contexts[SICSLOWPAN_REASS_CONTEXTS];
+
+/** The context of the fragment being processed */
+static struct reass_context *reass;
+
+/**
+ * The buffer the IPv6 packet is uncompressed into: the one of the
+ * reassembly context for a fragment, else uip_buf.
+ */
+static uint8_t *sicslowpan_buf;
+
+struct sicslowpan_reass_stats sicslowpan_reass_stats;
+#else /* SICSLOWPAN_REASS_CONTEXTS > 0 */
 /**
  * The buffer used for the 6lowpan reassembly.
  * This buffer contains only the IPv6 packet (no MAC header, 6lowpan, etc).
  * It has a fix size as we do not use dynamic memory allocation.
  */
 static uip_buf_t sicslowpan_aligned_buf;
+#if SICSLOWPAN_FRAG_FORWARDING > 0
+/* The first fragment of a datagram to forward is uncompressed elsewhere */
+static uint8_t *sicslowpan_buf = sicslowpan_aligned_buf.u8;
+#else /* SICSLOWPAN_FRAG_FORWARDING > 0 */
 #define sicslowpan_buf (sicslowpan_aligned_buf.u8)
+#endif /* SICSLOWPAN_FRAG_FORWARDING > 0 */
 
 /** The total length of the IPv6 packet in the sicslowpan_buf. */
 
@@ -239,9 +276,6 @@ static uip_buf_t sicslowpan_aligned_buf;
  */
 static uint16_t processed_ip_in_len;
 
-/** Datagram tag to be put in the fragments I send. */
-static uint16_t my_tag;
-
 /** When reassembling, the tag in the fragments being merged. */
 static uint16_t reass_tag;
 
@@ -250,6 +284,37 @@ linkaddr_t frag_sender;
 
 /** Reassembly %process %timer. */
 static struct timer reass_timer;
+#endif /* SICSLOWPAN_REASS_CONTEXTS > 0 */
+
+/* In RPL non-storing mode, the source routing header is inserted and
+   processed on whole datagrams, which fragments cannot be forwarded
+   without. */
+#if SICSLOWPAN_FRAG_FORWARDING > 0 && UIP_CONF_ROUTER \
+  && SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 \
+  && !(UIP_CONF_IPV6_RPL && RPL_WITH_NON_STORING)
+#define FRAG_FORWARDING 1
+/** A datagram whose fragments are sent on as they arrive */
+struct fwd_entry {
+  linkaddr_t sender;
+  linkaddr_t nexthop;
+  uint16_t tag;
+  /** The size of the datagram, 0 if the entry is free */
+  uint16_t size;
+  uint16_t out_tag;
+  /** The bytes of the datagram forwarded so far */
+  uint16_t forwarded;
+  struct timer timer;
+};
+
+static struct fwd_entry fwd_entries[SICSLOWPAN_FRAG_FORWARDING];
+
+struct sicslowpan_fwd_stats sicslowpan_fwd_stats;
+#else
+#define FRAG_FORWARDING 0
+#if SICSLOWPAN_FRAG_FORWARDING > 0
+struct sicslowpan_fwd_stats sicslowpan_fwd_stats;
+#endif /* SICSLOWPAN_FRAG_FORWARDING > 0 */
+#endif /* SICSLOWPAN_FRAG_FORWARDING > 0 && UIP_CONF_ROUTER && HC06 */
 
 /** @} */
 #else /* SICSLOWPAN_CONF_FRAG */
@@ -1499,6 +1564,8 @@ output(const uip_lladdr_t *localdest)
     queuebuf_to_packetbuf(q);
     queuebuf_free(q);
     q = NULL;
+    /* The packet may come back in another buffer (PACKETBUF_CONF_SEGMENTS). */
+    packetbuf_ptr = packetbuf_dataptr();
 
     /* Check tx result. */
     if((last_tx_status == MAC_TX_COLLISION) ||
@@ -1545,6 +1612,7 @@ output(const uip_lladdr_t *localdest)
       queuebuf_to_packetbuf(q);
       queuebuf_free(q);
       q = NULL;
+      packetbuf_ptr = packetbuf_dataptr();
       processed_ip_out_len += packetbuf_payload_len;
 
       /* Check tx result. */
@@ -1573,6 +1641,355 @@ output(const uip_lladdr_t *localdest)
   return 1;
 }
 
+#if SICSLOWPAN_CONF_FRAG && FRAG_FORWARDING
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Find the forwarding entry of the fragment in packetbuf
+ * \param tag The datagram tag of the fragment
+ * \param size The datagram size of the fragment
+ * \param free Set to a free entry if there is no match
+ */
+static struct fwd_entry *
+fwd_lookup(uint16_t tag, uint16_t size, struct fwd_entry **free)
+{
+  const linkaddr_t *sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  struct fwd_entry *f;
+
+  *free = NULL;
+  for(f = fwd_entries; f < fwd_entries + SICSLOWPAN_FRAG_FORWARDING; f++) {
+    if(f->size > 0 && timer_expired(&f->timer)) {
+      f->size = 0;
+    }
+    if(f->size == 0) {
+      if(*free == NULL) {
+        *free = f;
+      }
+    } else if(f->tag == tag && f->size == size
+              && linkaddr_cmp(&f->sender, sender)) {
+      return f;
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+/** \brief The room for 6lowpan headers and payload in a frame to a neighbor */
+static int
+fwd_max_payload(const linkaddr_t *dest)
+{
+  int framer_hdrlen;
+
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, dest);
+  framer_hdrlen = NETSTACK_FRAMER.length();
+  if(framer_hdrlen < 0) {
+    /* Framing failed, we assume the maximum header length */
+    framer_hdrlen = 21;
+  }
+  return MAC_MAX_PAYLOAD - framer_hdrlen - NETSTACK_LLSEC.get_overhead();
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Send part of a datagram on to the next hop in a FRAGN
+ * \param f The forwarding entry of the datagram
+ * \param offset The offset of the data in the datagram
+ * \param data The data, which must not be in packetbuf
+ * \param len The length of the data
+ */
+static void
+fwd_send_fragn(struct fwd_entry *f, uint16_t offset, const uint8_t *data,
+               uint16_t len)
+{
+  packetbuf_clear();
+  packetbuf_ptr = packetbuf_dataptr();
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                     SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+        ((SICSLOWPAN_DISPATCH_FRAGN << 8) | f->size));
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, f->out_tag);
+  PACKETBUF_FRAG_PTR[PACKETBUF_FRAG_OFFSET] = offset >> 3;
+  memcpy(packetbuf_ptr + SICSLOWPAN_FRAGN_HDR_LEN, data, len);
+  packetbuf_set_datalen(len + SICSLOWPAN_FRAGN_HDR_LEN);
+  send_packet(&f->nexthop);
+
+  sicslowpan_fwd_stats.fragments++;
+  f->forwarded += len;
+  if(f->forwarded >= f->size) {
+    f->size = 0;
+  }
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Forward the first fragment of a datagram for another node
+ * \param tag The datagram tag of the fragment
+ * \param size The datagram size of the fragment
+ * \return 1 if the fragment was forwarded or dropped, 0 if the
+ * datagram is to be reassembled
+ *
+ * The headers are uncompressed in uip_buf, processed as in uip_process()
+ * and compressed again for the next hop. The offsets of the fragments
+ * are the same on the next hop. If the headers compress worse, the
+ * first fragment carries less and a FRAGN is sent for the rest.
+ */
+static int
+fwd_frag1(uint16_t tag, uint16_t size)
+{
+  struct fwd_entry *f;
+  uip_ipaddr_t *nexthop;
+  const uip_lladdr_t *lladdr;
+  uip_ds6_route_t *route;
+  uint8_t *buf;
+  uint16_t len, offset;
+  int max_payload;
+
+  if(fwd_lookup(tag, size, &f) != NULL) {
+    /* A duplicate */
+    return 1;
+  }
+  if((PACKETBUF_IPHC_BUF[0] & 0xe0) != SICSLOWPAN_DISPATCH_IPHC) {
+    return 0;
+  }
+
+  /* Put the part of the datagram the fragment carries in uip_buf */
+  buf = sicslowpan_buf;
+  sicslowpan_buf = uip_buf;
+  uncompress_hdr_hc06(size);
+  sicslowpan_buf = buf;
+  len = packetbuf_datalen() - packetbuf_hdr_len;
+  if(packetbuf_datalen() < packetbuf_hdr_len
+     || uncomp_hdr_len + len > UIP_BUFSIZE - UIP_LLH_LEN) {
+    goto not_forwarded;
+  }
+  memcpy((uint8_t *)UIP_IP_BUF + uncomp_hdr_len,
+         packetbuf_ptr + packetbuf_hdr_len, len);
+  len += uncomp_hdr_len;
+
+  /* Only what uip_process() would forward, and no ICMP errors */
+  if(uip_ds6_is_my_addr(&UIP_IP_BUF->destipaddr)
+     || uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)
+     || uip_is_addr_link_local(&UIP_IP_BUF->destipaddr)
+     || uip_is_addr_link_local(&UIP_IP_BUF->srcipaddr)
+     || uip_is_addr_unspecified(&UIP_IP_BUF->srcipaddr)
+     || uip_is_addr_mcast(&UIP_IP_BUF->srcipaddr)
+     || uip_is_addr_loopback(&UIP_IP_BUF->destipaddr)
+     || size > UIP_LINK_MTU || UIP_IP_BUF->ttl <= 1) {
+    goto not_forwarded;
+  }
+  if(f == NULL) {
+    goto reassemble;
+  }
+#if UIP_CONF_IPV6_RPL && RPL_INSERT_HBH_OPTION
+  /* An RPL option inserted here would change the offsets */
+  if(UIP_IP_BUF->proto != UIP_PROTO_HBHO) {
+    goto reassemble;
+  }
+#endif /* UIP_CONF_IPV6_RPL && RPL_INSERT_HBH_OPTION */
+
+  /* The next hop as in tcpip_ipv6_output(), which also handles
+     neighbors that are not yet resolved. The following fragments go
+     to the same next hop, even with RPL multipath. */
+  if(uip_ds6_is_addr_onlink(&UIP_IP_BUF->destipaddr)) {
+    nexthop = &UIP_IP_BUF->destipaddr;
+  } else if((route = uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr)) != NULL) {
+    nexthop = uip_ds6_route_nexthop(route);
+  } else {
+#if UIP_CONF_IPV6_RPL && RPL_MULTIPATH
+    nexthop = rpl_multipath_nexthop();
+    if(nexthop == NULL) {
+      nexthop = uip_ds6_defrt_choose();
+    }
+#else
+    nexthop = uip_ds6_defrt_choose();
+#endif /* UIP_CONF_IPV6_RPL && RPL_MULTIPATH */
+  }
+  if(nexthop == NULL
+     || (lladdr = uip_ds6_nbr_lladdr_from_ipaddr(nexthop)) == NULL) {
+    goto reassemble;
+  }
+
+#if UIP_CONF_IPV6_RPL
+  uip_ext_len = 0;
+  if(UIP_IP_BUF->proto == UIP_PROTO_HBHO
+     && (len < UIP_IPH_LEN + sizeof(struct uip_hbho_hdr)
+         + sizeof(struct uip_ext_hdr_opt_rpl) || rpl_verify_header(2))) {
+    return 1;
+  }
+  if(rpl_update_header_empty()) {
+    return 1;
+  }
+#endif /* UIP_CONF_IPV6_RPL */
+  UIP_IP_BUF->ttl--;
+#if UIP_CONF_IPV6_RPL
+  if(rpl_update_header_final(nexthop)) {
+    return 1;
+  }
+#endif /* UIP_CONF_IPV6_RPL */
+
+  linkaddr_copy(&f->sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  linkaddr_copy(&f->nexthop, (const linkaddr_t *)lladdr);
+  f->tag = tag;
+  f->size = size;
+  f->out_tag = my_tag++;
+  f->forwarded = 0;
+  timer_set(&f->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND);
+  sicslowpan_fwd_stats.forwarded++;
+  UIP_STAT(++uip_stat.ip.forwarded);
+  PRINTFI("sicslowpan input: forwarding fragments (tag %d as %d)\n",
+          tag, f->out_tag);
+
+  /* Compress the headers for the next hop */
+  packetbuf_clear();
+  packetbuf_ptr = packetbuf_dataptr();
+  packetbuf_hdr_len = 0;
+  uncomp_hdr_len = 0;
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                     SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
+  compress_hdr_hc06(&f->nexthop);
+  memmove(packetbuf_ptr + SICSLOWPAN_FRAG1_HDR_LEN, packetbuf_ptr, packetbuf_hdr_len);
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+        ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | size));
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, f->out_tag);
+  packetbuf_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
+
+  max_payload = fwd_max_payload(&f->nexthop);
+  offset = MIN(len - uncomp_hdr_len,
+               (max_payload - packetbuf_hdr_len) & 0xfff8);
+  memcpy(packetbuf_ptr + packetbuf_hdr_len,
+         (uint8_t *)UIP_IP_BUF + uncomp_hdr_len, offset);
+  packetbuf_set_datalen(offset + packetbuf_hdr_len);
+  send_packet(&f->nexthop);
+  offset += uncomp_hdr_len;
+  sicslowpan_fwd_stats.fragments++;
+  f->forwarded = offset;
+
+  /* What did not fit */
+  max_payload = (max_payload - SICSLOWPAN_FRAGN_HDR_LEN) & 0xfff8;
+  while(offset < len) {
+    uint16_t n = MIN(len - offset, max_payload);
+    fwd_send_fragn(f, offset, (uint8_t *)UIP_IP_BUF + offset, n);
+    offset += n;
+  }
+  return 1;
+
+ reassemble:
+  sicslowpan_fwd_stats.reassembled++;
+ not_forwarded:
+  packetbuf_hdr_len = SICSLOWPAN_FRAG1_HDR_LEN;
+  uncomp_hdr_len = 0;
+  return 0;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Forward a fragment that follows the first one
+ * \return 1 if the fragment was forwarded, 0 if its datagram is not
+ * forwarded fragment by fragment
+ */
+static int
+fwd_fragn(uint16_t tag, uint16_t size, uint8_t offset)
+{
+  struct fwd_entry *f, *free;
+  uint16_t len;
+
+  f = fwd_lookup(tag, size, &free);
+  if(f == NULL || packetbuf_datalen() < SICSLOWPAN_FRAGN_HDR_LEN) {
+    return 0;
+  }
+  len = packetbuf_datalen() - SICSLOWPAN_FRAGN_HDR_LEN;
+  memcpy(uip_buf, packetbuf_ptr + SICSLOWPAN_FRAGN_HDR_LEN, len);
+  fwd_send_fragn(f, offset << 3, uip_buf, len);
+  return 1;
+}
+#endif /* SICSLOWPAN_CONF_FRAG && FRAG_FORWARDING */
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_REASS_CONTEXTS > 0
+/*--------------------------------------------------------------------*/
+/** \brief Free the reassembly contexts that timed out */
+static void
+reass_expire(void)
+{
+  struct reass_context *c;
+
+  for(c = reass_contexts; c < reass_contexts + SICSLOWPAN_REASS_CONTEXTS; c++) {
+    if(c->size > 0 && timer_expired(&c->timer)) {
+      PRINTFI("sicslowpan input: reassembly timed out (tag %d)\n", c->tag);
+      c->size = 0;
+      sicslowpan_reass_stats.dropped++;
+    }
+  }
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Find the reassembly context of the fragment in packetbuf
+ * \param tag The datagram tag of the fragment
+ * \param size The datagram size of the fragment
+ *
+ * A new context is set up if the fragment is the first one of its
+ * datagram to arrive. When all are in use, the oldest is dropped.
+ */
+static struct reass_context *
+reass_get(uint16_t tag, uint16_t size)
+{
+  const linkaddr_t *sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  struct reass_context *c, *oldest = NULL, *free = NULL;
+  clock_time_t now = clock_time();
+
+  for(c = reass_contexts; c < reass_contexts + SICSLOWPAN_REASS_CONTEXTS; c++) {
+    if(c->size == 0) {
+      if(free == NULL) {
+        free = c;
+      }
+    } else if(c->tag == tag && c->size == size
+              && linkaddr_cmp(&c->sender, sender)) {
+      return c;
+    } else if(oldest == NULL || (clock_time_t)(now - c->timer.start)
+              > (clock_time_t)(now - oldest->timer.start)) {
+      oldest = c;
+    }
+  }
+
+  if(free == NULL) {
+    PRINTFI("sicslowpan input: dropping reassembly (tag %d)\n", oldest->tag);
+    free = oldest;
+    sicslowpan_reass_stats.dropped++;
+  }
+
+  PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
+          size, tag);
+  linkaddr_copy(&free->sender, sender);
+  free->tag = tag;
+  free->size = size;
+  memset(free->received, 0, sizeof(free->received));
+  timer_set(&free->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND);
+  return free;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Note the part of a datagram that a fragment carried
+ * \param c The reassembly context
+ * \param start The offset of the fragment in the datagram
+ * \param end The offset after the fragment in the datagram
+ * \return 1 if all of the datagram was received, else 0
+ *
+ * Duplicate fragments are harmless. Extra bytes at the end of the last
+ * fragment are ignored.
+ */
+static int
+reass_add(struct reass_context *c, uint16_t start, uint16_t end)
+{
+  uint16_t unit;
+
+  if(end > c->size) {
+    end = c->size;
+  }
+  for(unit = start >> 3; unit < (end + 7) >> 3; unit++) {
+    c->received[unit >> 3] |= 1 << (unit & 7);
+  }
+
+  for(unit = 0; unit < (c->size + 7) >> 3; unit++) {
+    if(!(c->received[unit >> 3] & (1 << (unit & 7)))) {
+      return 0;
+    }
+  }
+  return 1;
+}
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_REASS_CONTEXTS > 0 */
 /*--------------------------------------------------------------------*/
 /** \brief Process a received 6lowpan packet.
  *  \param r The MAC layer
@@ -1597,7 +2014,9 @@ input(void)
 #if SICSLOWPAN_CONF_FRAG
   /* tag of the fragment */
   uint16_t frag_tag = 0;
+#if SICSLOWPAN_REASS_CONTEXTS == 0
   uint8_t first_fragment = 0, last_fragment = 0;
+#endif /* SICSLOWPAN_REASS_CONTEXTS == 0 */
 #endif /*SICSLOWPAN_CONF_FRAG*/
 
   /* init */
@@ -1611,11 +2030,15 @@ input(void)
      want to query us for it later. */
   last_rssi = (signed short)packetbuf_attr(PACKETBUF_ATTR_RSSI);
 #if SICSLOWPAN_CONF_FRAG
+#if SICSLOWPAN_REASS_CONTEXTS > 0
+  reass_expire();
+#else /* SICSLOWPAN_REASS_CONTEXTS > 0 */
   /* if reassembly timed out, cancel it */
   if(timer_expired(&reass_timer)) {
     sicslowpan_len = 0;
     processed_ip_in_len = 0;
   }
+#endif /* SICSLOWPAN_REASS_CONTEXTS > 0 */
   /*
    * Since we don't support the mesh and broadcast header, the first header
    * we look for is the fragmentation header
@@ -1632,7 +2055,9 @@ input(void)
              frag_size, frag_tag, frag_offset);
       packetbuf_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
       /*      printf("frag1 %d %d\n", reass_tag, frag_tag);*/
+#if SICSLOWPAN_REASS_CONTEXTS == 0
       first_fragment = 1;
+#endif /* SICSLOWPAN_REASS_CONTEXTS == 0 */
       is_fragment = 1;
       break;
     case SICSLOWPAN_DISPATCH_FRAGN:
@@ -1648,6 +2073,7 @@ input(void)
              frag_size, frag_tag, frag_offset);
       packetbuf_hdr_len += SICSLOWPAN_FRAGN_HDR_LEN;
 
+#if SICSLOWPAN_REASS_CONTEXTS == 0
       /* If this is the last fragment, we may shave off any extrenous
          bytes at the end. We must be liberal in what we accept. */
       PRINTFI("last_fragment?: processed_ip_in_len %d packetbuf_payload_len %d frag_size %d\n",
@@ -1656,12 +2082,40 @@ input(void)
       if(processed_ip_in_len + packetbuf_datalen() - packetbuf_hdr_len >= frag_size) {
         last_fragment = 1;
       }
+#endif /* SICSLOWPAN_REASS_CONTEXTS == 0 */
       is_fragment = 1;
       break;
     default:
       break;
   }
 
+#if FRAG_FORWARDING
+  /* Fragments of datagrams for other nodes are sent on right away */
+  if(packetbuf_hdr_len == SICSLOWPAN_FRAG1_HDR_LEN) {
+    if(fwd_frag1(frag_tag, frag_size)) {
+      return;
+    }
+  } else if(packetbuf_hdr_len == SICSLOWPAN_FRAGN_HDR_LEN) {
+    if(fwd_fragn(frag_tag, frag_size, frag_offset)) {
+      return;
+    }
+  }
+#endif /* FRAG_FORWARDING */
+
+#if SICSLOWPAN_REASS_CONTEXTS > 0
+  if(is_fragment) {
+    if(frag_size == 0 || frag_size > UIP_BUFSIZE - UIP_LLH_LEN) {
+      PRINTFI("sicslowpan input: Dropping fragment of bad size %d\n", frag_size);
+      return;
+    }
+    /* Fragments may come in any order, each is put in place in the
+       buffer of its datagram */
+    reass = reass_get(frag_tag, frag_size);
+    sicslowpan_buf = reass->buf.u8;
+  } else {
+    sicslowpan_buf = uip_buf;
+  }
+#else /* SICSLOWPAN_REASS_CONTEXTS > 0 */
   /* We are currently reassembling a packet, but have just received the first
    * fragment of another packet. We can either ignore it and hope to receive
    * the rest of the under-reassembly packet fragments, or we can discard the
@@ -1719,6 +2173,7 @@ input(void)
       linkaddr_copy(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
     }
   }
+#endif /* SICSLOWPAN_REASS_CONTEXTS > 0 */
 
   if(packetbuf_hdr_len == SICSLOWPAN_FRAGN_HDR_LEN) {
     /* this is a FRAGN, skip the header compression dispatch section */
@@ -1779,11 +2234,11 @@ input(void)
   {
     int req_size = UIP_LLH_LEN + uncomp_hdr_len + (uint16_t)(frag_offset << 3)
         + packetbuf_payload_len;
-    if(req_size > sizeof(sicslowpan_buf)) {
+    if(req_size > UIP_BUFSIZE) {
       PRINTF(
           "SICSLOWPAN: packet dropped, minimum required SICSLOWPAN_IP_BUF size: %d+%d+%d+%d=%d (current size: %d)\n",
           UIP_LLH_LEN, uncomp_hdr_len, (uint16_t)(frag_offset << 3),
-          packetbuf_payload_len, req_size, sizeof(sicslowpan_buf));
+          packetbuf_payload_len, req_size, UIP_BUFSIZE);
       return;
     }
   }
@@ -1794,6 +2249,15 @@ input(void)
 
 #if SICSLOWPAN_CONF_FRAG
   if(frag_size > 0) {
+#if SICSLOWPAN_REASS_CONTEXTS > 0
+    if(!reass_add(reass, (uint16_t)(frag_offset << 3),
+                  (uint16_t)(frag_offset << 3) + uncomp_hdr_len + packetbuf_payload_len)) {
+      return;
+    }
+    sicslowpan_len = reass->size;
+    reass->size = 0;
+    sicslowpan_reass_stats.completed++;
+#else /* SICSLOWPAN_REASS_CONTEXTS > 0 */
     /* Add the size of the header only for the first fragment. */
     if(first_fragment != 0) {
       processed_ip_in_len += uncomp_hdr_len;
@@ -1806,13 +2270,24 @@ input(void)
       processed_ip_in_len += packetbuf_payload_len;
     }
     PRINTF("processed_ip_in_len %d, packetbuf_payload_len %d\n", processed_ip_in_len, packetbuf_payload_len);
-
+#endif /* SICSLOWPAN_REASS_CONTEXTS > 0 */
   } else {
 #endif /* SICSLOWPAN_CONF_FRAG */
     sicslowpan_len = packetbuf_payload_len + uncomp_hdr_len;
 #if SICSLOWPAN_CONF_FRAG
   }
 
+#if SICSLOWPAN_REASS_CONTEXTS > 0
+  /* The packet is complete, a packet that was not fragmented was
+     uncompressed in uip_buf already */
+  PRINTFI("sicslowpan input: IP packet ready (length %d)\n",
+          sicslowpan_len);
+  if(sicslowpan_buf != uip_buf) {
+    memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)SICSLOWPAN_IP_BUF, sicslowpan_len);
+  }
+  uip_len = sicslowpan_len;
+  sicslowpan_len = 0;
+#else /* SICSLOWPAN_REASS_CONTEXTS > 0 */
   /*
    * If we have a full IP packet in sicslowpan_buf, deliver it to
    * the IP stack
@@ -1826,6 +2301,7 @@ input(void)
     uip_len = sicslowpan_len;
     sicslowpan_len = 0;
     processed_ip_in_len = 0;
+#endif /* SICSLOWPAN_REASS_CONTEXTS > 0 */
 #endif /* SICSLOWPAN_CONF_FRAG */
 
 #if DEBUG
@@ -1847,9 +2323,9 @@ input(void)
     }
 
     tcpip_input();
-#if SICSLOWPAN_CONF_FRAG
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_REASS_CONTEXTS == 0
   }
-#endif /* SICSLOWPAN_CONF_FRAG */
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_REASS_CONTEXTS == 0 */
 }
 /** @} */
 
@@ -319,6 +319,53 @@ struct sicslowpan_nh_compressor {
 
 };
 
+/**
+ * The number of datagrams that can be reassembled at the same time,
+ * each keyed by sender, tag and size and with a buffer of its own.
+ * With 0, the default, a single reassembly is done and a fragment of
+ * another datagram replaces it.
+ */
+#ifdef SICSLOWPAN_CONF_REASS_CONTEXTS
+#define SICSLOWPAN_REASS_CONTEXTS SICSLOWPAN_CONF_REASS_CONTEXTS
+#else
+#define SICSLOWPAN_REASS_CONTEXTS 0
+#endif
+
+#if SICSLOWPAN_REASS_CONTEXTS > 0
+struct sicslowpan_reass_stats {
+  /** Datagrams that were reassembled and passed on */
+  unsigned long completed;
+  /** Datagrams that timed out or were pushed out by a newer one */
+  unsigned long dropped;
+};
+extern struct sicslowpan_reass_stats sicslowpan_reass_stats;
+#endif /* SICSLOWPAN_REASS_CONTEXTS > 0 */
+
+/**
+ * The number of fragmented datagrams a router can forward at the same
+ * time without reassembling them. The first fragment is uncompressed
+ * to find the next hop, and the following ones are sent on as soon as
+ * they arrive. 0, the default, reassembles every datagram. Datagrams
+ * are always reassembled in RPL non-storing mode.
+ */
+#ifdef SICSLOWPAN_CONF_FRAG_FORWARDING
+#define SICSLOWPAN_FRAG_FORWARDING SICSLOWPAN_CONF_FRAG_FORWARDING
+#else
+#define SICSLOWPAN_FRAG_FORWARDING 0
+#endif
+
+#if SICSLOWPAN_FRAG_FORWARDING > 0
+struct sicslowpan_fwd_stats {
+  /** Datagrams whose fragments were forwarded as they arrived */
+  unsigned long forwarded;
+  /** Fragments that were forwarded */
+  unsigned long fragments;
+  /** Datagrams for another node that had to be reassembled */
+  unsigned long reassembled;
+};
+extern struct sicslowpan_fwd_stats sicslowpan_fwd_stats;
+#endif /* SICSLOWPAN_FRAG_FORWARDING > 0 */
+
 int sicslowpan_get_last_rssi(void);
 
 extern const struct network_driver sicslowpan_driver;
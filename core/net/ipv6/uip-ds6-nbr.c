@@ -70,6 +70,90 @@ void LINK_NEIGHBOR_CALLBACK(const linkaddr_t *addr, int status, int numtx);
 
 NBR_TABLE_GLOBAL(uip_ds6_nbr_t, ds6_neighbors);
 
+#if UIP_DS6_NBR_IP_HASH
+#if NBR_TABLE_HASH_SIZE <= NBR_TABLE_MAX_NEIGHBORS
+#error "NBR_TABLE_CONF_HASH_SIZE must be larger than the number of neighbors"
+#endif
+#if (NBR_TABLE_HASH_SIZE & (NBR_TABLE_HASH_SIZE - 1)) != 0
+#error "NBR_TABLE_CONF_HASH_SIZE must be a power of two"
+#endif
+
+#if NBR_TABLE_MAX_NEIGHBORS < 255
+typedef uint8_t ip_hash_slot_t;
+#else
+typedef uint16_t ip_hash_slot_t;
+#endif
+
+/* Hash index over the IPv6 addresses of the neighbors with linear
+ * probing. A slot holds the neighbor index + 1, or 0 if it is empty. */
+static ip_hash_slot_t ip_slots[NBR_TABLE_HASH_SIZE];
+#define IP_HASH_NEXT(slot) (((slot) + 1) & (NBR_TABLE_HASH_SIZE - 1))
+#define IP_HASH_NBR(slot) (&_ds6_neighbors_mem[ip_slots[slot] - 1])
+
+/*---------------------------------------------------------------------------*/
+/* Get the home slot of an IPv6 address */
+static unsigned
+hash_ipaddr(const uip_ipaddr_t *ipaddr)
+{
+  uint16_t h;
+  int i;
+
+  /* Only the interface identifier: the neighbors share a few prefixes
+   * and most of them differ in the last bytes only */
+  h = 0;
+  for(i = 8; i < 16; i++) {
+    h = (h ^ ipaddr->u8[i]) * 0x9e5;
+  }
+  h ^= h >> 7;
+  return h & (NBR_TABLE_HASH_SIZE - 1);
+}
+/*---------------------------------------------------------------------------*/
+/* Insert a neighbor into the hash index */
+static void
+ip_hash_add(uip_ds6_nbr_t *nbr)
+{
+  unsigned slot, i;
+
+  slot = hash_ipaddr(&nbr->ipaddr);
+  for(i = 0; i < NBR_TABLE_HASH_SIZE; i++) {
+    if(ip_slots[slot] == 0) {
+      ip_slots[slot] = nbr - _ds6_neighbors_mem + 1;
+      return;
+    }
+    slot = IP_HASH_NEXT(slot);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a neighbor from the hash index */
+static void
+ip_hash_remove(uip_ds6_nbr_t *nbr)
+{
+  unsigned slot, next, home, i;
+
+  slot = hash_ipaddr(&nbr->ipaddr);
+  for(i = 0; ip_slots[slot] != nbr - _ds6_neighbors_mem + 1; i++) {
+    if(ip_slots[slot] == 0 || i == NBR_TABLE_HASH_SIZE) {
+      return;
+    }
+    slot = IP_HASH_NEXT(slot);
+  }
+
+  /* Move entries of the probe sequence back into the gap, so that
+   * lookups never stop early at an empty slot */
+  for(next = IP_HASH_NEXT(slot), i = 0;
+      ip_slots[next] != 0 && i < NBR_TABLE_HASH_SIZE;
+      next = IP_HASH_NEXT(next), i++) {
+    home = hash_ipaddr(&IP_HASH_NBR(next)->ipaddr);
+    /* Move the entry unless its home slot lies cyclically in (slot, next] */
+    if(((next - home) & (NBR_TABLE_HASH_SIZE - 1)) >=
+       ((next - slot) & (NBR_TABLE_HASH_SIZE - 1))) {
+      ip_slots[slot] = ip_slots[next];
+      slot = next;
+    }
+  }
+  ip_slots[slot] = 0;
+}
+#endif /* UIP_DS6_NBR_IP_HASH */
 /*---------------------------------------------------------------------------*/
 void
 uip_ds6_neighbors_init(void)
@@ -81,9 +165,23 @@ uip_ds6_nbr_t *
 uip_ds6_nbr_add(const uip_ipaddr_t *ipaddr, const uip_lladdr_t *lladdr,
                 uint8_t isrouter, uint8_t state)
 {
-  uip_ds6_nbr_t *nbr = nbr_table_add_lladdr(ds6_neighbors, (linkaddr_t*)lladdr);
+  uip_ds6_nbr_t *nbr;
+#if UIP_DS6_NBR_IP_HASH
+  /* An existing entry for the link-layer address is reused */
+  nbr = nbr_table_get_from_lladdr(ds6_neighbors, (linkaddr_t*)lladdr);
+  if(nbr) {
+    ip_hash_remove(nbr);
+  }
+#endif /* UIP_DS6_NBR_IP_HASH */
+  nbr = nbr_table_add_lladdr(ds6_neighbors, (linkaddr_t*)lladdr);
   if(nbr) {
     uip_ipaddr_copy(&nbr->ipaddr, ipaddr);
+#if UIP_DS6_NBR_IP_HASH
+    ip_hash_add(nbr);
+#endif /* UIP_DS6_NBR_IP_HASH */
+#if UIP_DS6_NOTIFICATIONS
+    uip_ds6_notification_nbr(UIP_DS6_NOTIFICATION_NBR_ADD, &nbr->ipaddr);
+#endif /* UIP_DS6_NOTIFICATIONS */
     nbr->isrouter = isrouter;
     nbr->state = state;
   #if UIP_CONF_IPV6_QUEUE_PKT
@@ -119,7 +217,13 @@ uip_ds6_nbr_rm(uip_ds6_nbr_t *nbr)
     uip_packetqueue_free(&nbr->packethandle);
 #endif /* UIP_CONF_IPV6_QUEUE_PKT */
     NEIGHBOR_STATE_CHANGED(nbr);
+#if UIP_DS6_NBR_IP_HASH
+    ip_hash_remove(nbr);
+#endif /* UIP_DS6_NBR_IP_HASH */
     nbr_table_remove(ds6_neighbors, nbr);
+#if UIP_DS6_NOTIFICATIONS
+    uip_ds6_notification_nbr(UIP_DS6_NOTIFICATION_NBR_RM, &nbr->ipaddr);
+#endif /* UIP_DS6_NOTIFICATIONS */
   }
   return;
 }
@@ -156,6 +260,20 @@ uip_ds6_nbr_num(void)
 uip_ds6_nbr_t *
 uip_ds6_nbr_lookup(const uip_ipaddr_t *ipaddr)
 {
+#if UIP_DS6_NBR_IP_HASH
+  unsigned slot, i;
+
+  if(ipaddr != NULL) {
+    for(slot = hash_ipaddr(ipaddr), i = 0;
+        ip_slots[slot] != 0 && i < NBR_TABLE_HASH_SIZE;
+        slot = IP_HASH_NEXT(slot), i++) {
+      if(uip_ipaddr_cmp(&IP_HASH_NBR(slot)->ipaddr, ipaddr)) {
+        return IP_HASH_NBR(slot);
+      }
+    }
+  }
+  return NULL;
+#else /* UIP_DS6_NBR_IP_HASH */
   uip_ds6_nbr_t *nbr = nbr_table_head(ds6_neighbors);
   if(ipaddr != NULL) {
     while(nbr != NULL) {
@@ -166,6 +284,7 @@ uip_ds6_nbr_lookup(const uip_ipaddr_t *ipaddr)
     }
   }
   return NULL;
+#endif /* UIP_DS6_NBR_IP_HASH */
 }
 /*---------------------------------------------------------------------------*/
 uip_ds6_nbr_t *
@@ -64,6 +64,15 @@
 #define  NBR_DELAY 3
 #define  NBR_PROBE 4
 
+/** \brief Index the neighbors by IPv6 address in an open-addressing
+ * hash table of NBR_TABLE_HASH_SIZE slots, so that uip_ds6_nbr_lookup()
+ * does not walk the neighbor table */
+#ifdef UIP_DS6_NBR_CONF_IP_HASH
+#define UIP_DS6_NBR_IP_HASH UIP_DS6_NBR_CONF_IP_HASH
+#else /* UIP_DS6_NBR_CONF_IP_HASH */
+#define UIP_DS6_NBR_IP_HASH 0
+#endif /* UIP_DS6_NBR_CONF_IP_HASH */
+
 NBR_TABLE_DECLARE(ds6_neighbors);
 
 /** \brief An entry in the nbr cache */
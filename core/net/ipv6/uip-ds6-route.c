@@ -72,6 +72,19 @@ LIST(notificationlist);
 
 static int num_routes = 0;
 
+#if UIP_DS6_ROUTE_HASH
+#if (UIP_DS6_ROUTE_HASH_SIZE & (UIP_DS6_ROUTE_HASH_SIZE - 1)) != 0 || \
+  UIP_DS6_ROUTE_HASH_SIZE <= UIP_DS6_ROUTE_NB
+#error "UIP_CONF_DS6_ROUTE_HASH_SIZE must be a power of two larger than the number of routes"
+#endif
+/* Routes hashed by prefix and prefix length, with linear probing. */
+static uip_ds6_route_t *route_hash[UIP_DS6_ROUTE_HASH_SIZE];
+/* Bitmap of the prefix lengths (0 to 128) used by any route. */
+static uint8_t route_lengths[129 / 8 + 1];
+static uint16_t lookup_counter;
+#define ROUTE_HASH_NEXT(slot) (((slot) + 1) & (UIP_DS6_ROUTE_HASH_SIZE - 1))
+#endif /* UIP_DS6_ROUTE_HASH */
+
 #undef DEBUG
 #define DEBUG DEBUG_NONE
 #include "net/ip/uip-debug.h"
@@ -141,13 +154,127 @@ uip_ds6_notification_rm(struct uip_ds6_notification *n)
 {
   list_remove(notificationlist, n);
 }
+/*---------------------------------------------------------------------------*/
+void
+uip_ds6_notification_nbr(int event, uip_ipaddr_t *ipaddr)
+{
+  call_route_callback(event, ipaddr, ipaddr);
+}
 #endif
+#if UIP_DS6_ROUTE_HASH
+/*---------------------------------------------------------------------------*/
+/* Home slot of the first length bits of an address */
+static unsigned
+route_hash_slot(const uip_ipaddr_t *addr, uint8_t length)
+{
+  uint16_t h;
+  uint8_t i;
+
+  h = length;
+  for(i = 0; i < length / 8; i++) {
+    h = (h ^ addr->u8[i]) * 0x9e5;
+  }
+  if(length % 8) {
+    h = (h ^ (addr->u8[i] & (0xff << (8 - length % 8)))) * 0x9e5;
+  }
+  h ^= h >> 7;
+  return h & (UIP_DS6_ROUTE_HASH_SIZE - 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_hash_add(uip_ds6_route_t *r)
+{
+  unsigned slot;
+
+  for(slot = route_hash_slot(&r->ipaddr, r->length);
+      route_hash[slot] != NULL;
+      slot = ROUTE_HASH_NEXT(slot));
+  route_hash[slot] = r;
+  route_lengths[r->length / 8] |= 0x80 >> (r->length % 8);
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a route from the index. The route must already be removed
+   from the route list. */
+static void
+route_hash_rm(uip_ds6_route_t *route)
+{
+  unsigned slot, next, home;
+  uip_ds6_route_t *r;
+
+  for(slot = route_hash_slot(&route->ipaddr, route->length);
+      route_hash[slot] != route;
+      slot = ROUTE_HASH_NEXT(slot)) {
+    if(route_hash[slot] == NULL) {
+      return;
+    }
+  }
+
+  /* Shift the following entries of the probe sequence back into the
+     gap, so that lookups do not stop early at an empty slot. */
+  for(next = ROUTE_HASH_NEXT(slot);
+      route_hash[next] != NULL;
+      next = ROUTE_HASH_NEXT(next)) {
+    home = route_hash_slot(&route_hash[next]->ipaddr,
+                           route_hash[next]->length);
+    if(((next - home) & (UIP_DS6_ROUTE_HASH_SIZE - 1)) >=
+       ((next - slot) & (UIP_DS6_ROUTE_HASH_SIZE - 1))) {
+      route_hash[slot] = route_hash[next];
+      slot = next;
+    }
+  }
+  route_hash[slot] = NULL;
+
+  /* Stop probing this prefix length if no other route uses it. */
+  for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
+    if(r->length == route->length) {
+      return;
+    }
+  }
+  route_lengths[route->length / 8] &= ~(0x80 >> (route->length % 8));
+}
+/*---------------------------------------------------------------------------*/
+/* Longest prefix match: probe the prefix lengths in use from the
+   longest to the shortest one. */
+static uip_ds6_route_t *
+route_hash_lookup(uip_ipaddr_t *addr)
+{
+  int i;
+  uint8_t bit, length;
+  unsigned slot;
+  uip_ds6_route_t *r;
+
+  for(i = sizeof(route_lengths) - 1; i >= 0; i--) {
+    if(route_lengths[i] == 0) {
+      continue;
+    }
+    for(bit = 8; bit > 0; bit--) {
+      if((route_lengths[i] & (0x80 >> (bit - 1))) == 0) {
+        continue;
+      }
+      length = i * 8 + bit - 1;
+      for(slot = route_hash_slot(addr, length);
+          (r = route_hash[slot]) != NULL;
+          slot = ROUTE_HASH_NEXT(slot)) {
+        if(r->length == length &&
+           uip_ipaddr_prefixcmp(addr, &r->ipaddr, length)) {
+          return r;
+        }
+      }
+    }
+  }
+  return NULL;
+}
+#endif /* UIP_DS6_ROUTE_HASH */
 /*---------------------------------------------------------------------------*/
 void
 uip_ds6_route_init(void)
 {
   memb_init(&routememb);
   list_init(routelist);
+#if UIP_DS6_ROUTE_HASH
+  memset(route_hash, 0, sizeof(route_hash));
+  memset(route_lengths, 0, sizeof(route_lengths));
+#endif /* UIP_DS6_ROUTE_HASH */
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 
@@ -205,15 +332,20 @@ uip_ds6_route_num_routes(void)
 uip_ds6_route_t *
 uip_ds6_route_lookup(uip_ipaddr_t *addr)
 {
-  uip_ds6_route_t *r;
   uip_ds6_route_t *found_route;
+#if !UIP_DS6_ROUTE_HASH
+  uip_ds6_route_t *r;
   uint8_t longestmatch;
+#endif /* !UIP_DS6_ROUTE_HASH */
 
   PRINTF("uip-ds6-route: Looking up route for ");
   PRINT6ADDR(addr);
   PRINTF("\n");
 
 
+#if UIP_DS6_ROUTE_HASH
+  found_route = route_hash_lookup(addr);
+#else /* UIP_DS6_ROUTE_HASH */
   found_route = NULL;
   longestmatch = 0;
   for(r = uip_ds6_route_head();
@@ -229,6 +361,7 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
       }
     }
   }
+#endif /* UIP_DS6_ROUTE_HASH */
 
   if(found_route != NULL) {
     PRINTF("uip-ds6-route: Found route: ");
@@ -240,17 +373,42 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     PRINTF("uip-ds6-route: No route found\n");
   }
 
-  if(found_route != NULL && found_route != list_head(routelist)) {
+  if(found_route != NULL) {
+    uip_ds6_route_refresh(found_route);
+  }
+
+  return found_route;
+}
+/*---------------------------------------------------------------------------*/
+void
+uip_ds6_route_refresh(uip_ds6_route_t *route)
+{
+#if UIP_DS6_ROUTE_HASH
+  uip_ds6_route_t *r;
+
+  /* Moving the route to the front of the list would cost a list
+     walk, so only remember when the route was used. Every 0x8000
+     lookups, older ages are capped at 0x7fff, so that no age reaches
+     0x10000 and ages still compare correctly when the counter wraps. */
+  if((++lookup_counter & 0x7fff) == 0) {
+    for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
+      if((uint16_t)(lookup_counter - r->last_used) > 0x7fff) {
+        r->last_used = lookup_counter - 0x7fff;
+      }
+    }
+  }
+  route->last_used = lookup_counter;
+#else /* UIP_DS6_ROUTE_HASH */
+  if(route != list_head(routelist)) {
     /* If we found a route, we put it at the start of the routeslist
        list. The list is ordered by how recently we looked them up:
        the least recently used route will be at the end of the
        list - for fast lookups (assuming multiple packets to the same node). */
 
-    list_remove(routelist, found_route);
-    list_push(routelist, found_route);
+    list_remove(routelist, route);
+    list_push(routelist, route);
   }
-
-  return found_route;
+#endif /* UIP_DS6_ROUTE_HASH */
 }
 /*---------------------------------------------------------------------------*/
 uip_ds6_route_t *
@@ -301,7 +459,20 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
          least recently used route is the first route on the list. */
       uip_ds6_route_t *oldest;
 
+#if UIP_DS6_ROUTE_HASH
+      uip_ds6_route_t *o;
+
+      oldest = uip_ds6_route_head();
+      for(o = uip_ds6_route_next(oldest); o != NULL;
+          o = uip_ds6_route_next(o)) {
+        if((uint16_t)(lookup_counter - o->last_used) >
+           (uint16_t)(lookup_counter - oldest->last_used)) {
+          oldest = o;
+        }
+      }
+#else /* UIP_DS6_ROUTE_HASH */
       oldest = list_tail(routelist); /* uip_ds6_route_head(); */
+#endif /* UIP_DS6_ROUTE_HASH */
       PRINTF("uip_ds6_route_add: dropping route to ");
       PRINT6ADDR(&oldest->ipaddr);
       PRINTF("\n");
@@ -371,6 +542,10 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
+#if UIP_DS6_ROUTE_HASH
+  r->last_used = lookup_counter;
+  route_hash_add(r);
+#endif /* UIP_DS6_ROUTE_HASH */
 
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
@@ -409,6 +584,9 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
 
     /* Remove the route from the route list */
     list_remove(routelist, route);
+#if UIP_DS6_ROUTE_HASH
+    route_hash_rm(route);
+#endif /* UIP_DS6_ROUTE_HASH */
 
     /* Find the corresponding neighbor_route and remove it. */
     for(neighbor_route = list_head(route->neighbor_routes->route_list);
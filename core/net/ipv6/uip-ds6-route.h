@@ -60,6 +60,8 @@ void uip_ds6_route_init(void);
 #define UIP_DS6_NOTIFICATION_DEFRT_RM  1
 #define UIP_DS6_NOTIFICATION_ROUTE_ADD 2
 #define UIP_DS6_NOTIFICATION_ROUTE_RM  3
+#define UIP_DS6_NOTIFICATION_NBR_ADD   4
+#define UIP_DS6_NOTIFICATION_NBR_RM    5
 
 typedef void (* uip_ds6_notification_callback)(int event,
 					       uip_ipaddr_t *route,
@@ -74,6 +76,9 @@ void uip_ds6_notification_add(struct uip_ds6_notification *n,
 			      uip_ds6_notification_callback c);
 
 void uip_ds6_notification_rm(struct uip_ds6_notification *n);
+
+/* Lets the neighbor cache notify of the neighbors it adds and removes */
+void uip_ds6_notification_nbr(int event, uip_ipaddr_t *ipaddr);
 /*--------------------------------------------------*/
 #endif
 
@@ -88,6 +93,34 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB UIP_CONF_MAX_ROUTES
 #endif /* UIP_CONF_MAX_ROUTES */
 
+/* Index the routing table with one hash lookup per prefix length in
+   use, instead of scanning all routes for the longest prefix match. */
+#ifdef UIP_CONF_DS6_ROUTE_HASH
+#define UIP_DS6_ROUTE_HASH UIP_CONF_DS6_ROUTE_HASH
+#else /* UIP_CONF_DS6_ROUTE_HASH */
+#define UIP_DS6_ROUTE_HASH 0
+#endif /* UIP_CONF_DS6_ROUTE_HASH */
+
+/* Number of hash slots, a power of two larger than the number of
+   routes. Each slot costs one pointer. */
+#ifdef UIP_CONF_DS6_ROUTE_HASH_SIZE
+#define UIP_DS6_ROUTE_HASH_SIZE UIP_CONF_DS6_ROUTE_HASH_SIZE
+#elif UIP_DS6_ROUTE_NB <= 8
+#define UIP_DS6_ROUTE_HASH_SIZE 16
+#elif UIP_DS6_ROUTE_NB <= 16
+#define UIP_DS6_ROUTE_HASH_SIZE 32
+#elif UIP_DS6_ROUTE_NB <= 32
+#define UIP_DS6_ROUTE_HASH_SIZE 64
+#elif UIP_DS6_ROUTE_NB <= 64
+#define UIP_DS6_ROUTE_HASH_SIZE 128
+#elif UIP_DS6_ROUTE_NB <= 128
+#define UIP_DS6_ROUTE_HASH_SIZE 256
+#elif UIP_DS6_ROUTE_NB <= 256
+#define UIP_DS6_ROUTE_HASH_SIZE 512
+#else
+#define UIP_DS6_ROUTE_HASH_SIZE 1024
+#endif /* UIP_CONF_DS6_ROUTE_HASH_SIZE */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -120,6 +153,11 @@ typedef struct uip_ds6_route {
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   UIP_DS6_ROUTE_STATE_TYPE state;
 #endif
+#if UIP_DS6_ROUTE_HASH
+  /* Lookup counter value of the last use, for replacing the least
+     recently used route when the table is full. */
+  uint16_t last_used;
+#endif /* UIP_DS6_ROUTE_HASH */
   uint8_t length;
 } uip_ds6_route_t;
 
@@ -153,6 +191,8 @@ void uip_ds6_defrt_periodic(void);
 /** \name Routing Table basic routines */
 /** @{ */
 uip_ds6_route_t *uip_ds6_route_lookup(uip_ipaddr_t *destipaddr);
+/* Marks a route as just used, like a lookup that finds it does */
+void uip_ds6_route_refresh(uip_ds6_route_t *route);
 uip_ds6_route_t *uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
                                    uip_ipaddr_t *next_hop);
 void uip_ds6_route_rm(uip_ds6_route_t *route);
@@ -196,8 +196,8 @@ ns_input(void)
           uip_lladdr_t *lladdr = (uip_lladdr_t *)uip_ds6_nbr_get_ll(nbr);
           if(memcmp(&nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET],
 		    lladdr, UIP_LLADDR_LEN) != 0) {
-            memcpy(lladdr, &nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET],
-		   UIP_LLADDR_LEN);
+            nbr_table_update_lladdr(ds6_neighbors, nbr,
+                                    (linkaddr_t *)&nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET]);
             nbr->state = NBR_STALE;
           } else {
             if(nbr->state == NBR_INCOMPLETE) {
@@ -493,8 +493,8 @@ na_input(void)
       if(nd6_opt_llao == NULL) {
         goto discard;
       }
-      memcpy(lladdr, &nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET],
-	     UIP_LLADDR_LEN);
+      nbr_table_update_lladdr(ds6_neighbors, nbr,
+                              (linkaddr_t *)&nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET]);
       if(is_solicited) {
         nbr->state = NBR_REACHABLE;
         nbr->nscount = 0;
@@ -516,8 +516,8 @@ na_input(void)
         if(is_override || (!is_override && nd6_opt_llao != 0 && !is_llchange)
            || nd6_opt_llao == 0) {
           if(nd6_opt_llao != 0) {
-            memcpy(lladdr, &nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET],
-		   UIP_LLADDR_LEN);
+            nbr_table_update_lladdr(ds6_neighbors, nbr,
+                                    (linkaddr_t *)&nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET]);
           }
           if(is_solicited) {
             nbr->state = NBR_REACHABLE;
@@ -869,8 +869,8 @@ ra_input(void)
         }
         if(memcmp(&nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET],
 		  lladdr, UIP_LLADDR_LEN) != 0) {
-          memcpy(lladdr, &nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET],
-		 UIP_LLADDR_LEN);
+          nbr_table_update_lladdr(ds6_neighbors, nbr,
+                                  (linkaddr_t *)&nd6_opt_llao[UIP_ND6_OPT_DATA_OFFSET]);
           nbr->state = NBR_STALE;
         }
         nbr->isrouter = 1;
@@ -1368,6 +1368,24 @@ uip_process(uint8_t flag)
          */
 
         PRINTF("Processing Routing header\n");
+#if UIP_CONF_IPV6_RPL && RPL_WITH_NON_STORING
+        switch(rpl_process_srh_header()) {
+          case 1:
+            /* Forward to the next hop of the source route */
+            if(UIP_IP_BUF->ttl <= 1) {
+              uip_icmp6_error_output(ICMP6_TIME_EXCEEDED,
+                                     ICMP6_TIME_EXCEED_TRANSIT, 0);
+              UIP_STAT(++uip_stat.ip.drop);
+              goto send;
+            }
+            UIP_IP_BUF->ttl = UIP_IP_BUF->ttl - 1;
+            UIP_STAT(++uip_stat.ip.forwarded);
+            goto send;
+          case -1:
+            UIP_STAT(++uip_stat.ip.drop);
+            goto drop;
+        }
+#endif /* UIP_CONF_IPV6_RPL && RPL_WITH_NON_STORING */
         if(UIP_ROUTING_BUF->seg_left > 0) {
           uip_icmp6_error_output(ICMP6_PARAM_PROB, ICMP6_PARAMPROB_HEADER, UIP_IPH_LEN + uip_ext_len + 2);
           UIP_STAT(++uip_stat.ip.drop);
@@ -84,16 +84,53 @@
 #error Change CSMA_CONF_MAX_MAC_TRANSMISSIONS in contiki-conf.h or in your Makefile.
 #endif /* CSMA_CONF_MAX_MAC_TRANSMISSIONS < 1 */
 
+/* Serve the neighbor queues in deficit round robin order instead of
+   letting every neighbor transmit on its own timer */
+#ifdef CSMA_CONF_FAIR_QUEUEING
+#define CSMA_FAIR_QUEUEING CSMA_CONF_FAIR_QUEUEING
+#else
+#define CSMA_FAIR_QUEUEING 0
+#endif /* CSMA_CONF_FAIR_QUEUEING */
+
+#if CSMA_FAIR_QUEUEING
+/* Bytes a neighbor may send per round */
+#ifdef CSMA_CONF_FQ_QUANTUM
+#define CSMA_FQ_QUANTUM CSMA_CONF_FQ_QUANTUM
+#else
+#define CSMA_FQ_QUANTUM 127
+#endif /* CSMA_CONF_FQ_QUANTUM */
+
+/* Buckets of the neighbor address hash */
+#ifdef CSMA_CONF_NEIGHBOR_HASH_SIZE
+#define CSMA_NEIGHBOR_HASH_SIZE CSMA_CONF_NEIGHBOR_HASH_SIZE
+#else
+#define CSMA_NEIGHBOR_HASH_SIZE 8
+#endif /* CSMA_CONF_NEIGHBOR_HASH_SIZE */
+#endif /* CSMA_FAIR_QUEUEING */
+
 /* Packet metadata */
 struct qbuf_metadata {
   mac_callback_t sent;
   void *cptr;
   uint8_t max_transmissions;
+#if CSMA_STATS
+  clock_time_t queued;
+#endif
 };
 
 /* Every neighbor has its own packet queue */
 struct neighbor_queue {
   struct neighbor_queue *next;
+#if CSMA_FAIR_QUEUEING
+  struct neighbor_queue *hash_next;
+  /* Bytes left in this round, may go negative after a burst */
+  int16_t deficit;
+  /* The last transmission was acked, send the whole queue at once */
+  uint8_t burst;
+  /* The RDC holds a packet of this neighbor, e.g. deferred until the
+     wake-up of the receiver, and has not called back yet */
+  uint8_t in_flight;
+#endif /* CSMA_FAIR_QUEUEING */
   linkaddr_t addr;
   struct ctimer transmit_timer;
   uint8_t transmissions;
@@ -121,9 +158,46 @@ MEMB(packet_memb, struct rdc_buf_list, MAX_QUEUED_PACKETS);
 MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
 LIST(neighbor_list);
 
+#if CSMA_FAIR_QUEUEING
+static struct neighbor_queue *neighbor_hash[CSMA_NEIGHBOR_HASH_SIZE];
+/* The neighbor whose turn it is */
+static struct neighbor_queue *fq_next;
+static struct ctimer fq_timer;
+#endif /* CSMA_FAIR_QUEUEING */
+
+#if CSMA_STATS
+struct csma_stats csma_stats;
+#endif /* CSMA_STATS */
+
 static void packet_sent(void *ptr, int status, int num_transmissions);
+#if CSMA_FAIR_QUEUEING
+static void fq_schedule(void *ptr);
+#else /* CSMA_FAIR_QUEUEING */
 static void transmit_packet_list(void *ptr);
+#endif /* CSMA_FAIR_QUEUEING */
 
+#if CSMA_FAIR_QUEUEING
+/*---------------------------------------------------------------------------*/
+static struct neighbor_queue **
+neighbor_bucket(const linkaddr_t *addr)
+{
+  return &neighbor_hash[(addr->u8[LINKADDR_SIZE - 1] ^
+                         addr->u8[LINKADDR_SIZE > 1 ? LINKADDR_SIZE - 2 : 0])
+                        % CSMA_NEIGHBOR_HASH_SIZE];
+}
+/*---------------------------------------------------------------------------*/
+static struct neighbor_queue *
+neighbor_queue_from_addr(const linkaddr_t *addr)
+{
+  struct neighbor_queue *n;
+  for(n = *neighbor_bucket(addr); n != NULL; n = n->hash_next) {
+    if(linkaddr_cmp(&n->addr, addr)) {
+      return n;
+    }
+  }
+  return NULL;
+}
+#else /* CSMA_FAIR_QUEUEING */
 /*---------------------------------------------------------------------------*/
 static struct neighbor_queue *
 neighbor_queue_from_addr(const linkaddr_t *addr)
@@ -137,6 +211,27 @@ neighbor_queue_from_addr(const linkaddr_t *addr)
   }
   return NULL;
 }
+#endif /* CSMA_FAIR_QUEUEING */
+/*---------------------------------------------------------------------------*/
+static void
+neighbor_free(struct neighbor_queue *n)
+{
+#if CSMA_FAIR_QUEUEING
+  struct neighbor_queue **np;
+  for(np = neighbor_bucket(&n->addr); *np != NULL; np = &(*np)->hash_next) {
+    if(*np == n) {
+      *np = n->hash_next;
+      break;
+    }
+  }
+  if(fq_next == n) {
+    fq_next = list_item_next(n);
+  }
+#endif /* CSMA_FAIR_QUEUEING */
+  ctimer_stop(&n->transmit_timer);
+  list_remove(neighbor_list, n);
+  memb_free(&neighbor_memb, n);
+}
 /*---------------------------------------------------------------------------*/
 static clock_time_t
 default_timebase(void)
@@ -154,6 +249,75 @@ default_timebase(void)
   }
   return time;
 }
+#if CSMA_FAIR_QUEUEING
+/*---------------------------------------------------------------------------*/
+static int
+neighbor_ready(struct neighbor_queue *n)
+{
+  /* The transmit timer only runs while the neighbor backs off */
+  return !n->in_flight && ctimer_expired(&n->transmit_timer);
+}
+/*---------------------------------------------------------------------------*/
+static void
+fq_schedule(void *ptr)
+{
+  struct neighbor_queue *n;
+  struct rdc_buf_list *q, *p;
+  int ready = 0;
+
+  for(n = list_head(neighbor_list); n != NULL; n = list_item_next(n)) {
+    ready |= neighbor_ready(n);
+  }
+  if(!ready) {
+    /* Nothing to send, or everyone backs off and restarts us later */
+    return;
+  }
+
+  /* Deficit round robin: every visit tops up the deficit of a neighbor
+     by one quantum and the neighbor is served while it is positive. */
+  n = fq_next;
+  for(;;) {
+    if(n == NULL) {
+      n = list_head(neighbor_list);
+    }
+    if(neighbor_ready(n)) {
+      if(n->deficit > 0) {
+        break;
+      }
+      n->deficit += CSMA_FQ_QUANTUM;
+    }
+    n = list_item_next(n);
+  }
+
+  q = list_head(n->queued_packet_list);
+  if(n->burst) {
+    /* The neighbor acked the last frame, so it is listening: hand the
+       whole queue to the RDC to go out back-to-back. */
+    for(p = q; p != NULL; p = list_item_next(p)) {
+      n->deficit -= queuebuf_datalen(p->buf);
+    }
+  } else {
+    n->deficit -= queuebuf_datalen(q->buf);
+  }
+  fq_next = n->deficit > 0 ? n : list_item_next(n);
+
+  PRINTF("csma: serving %d.%d, queue len %d, deficit %d\n",
+         n->addr.u8[0], n->addr.u8[1],
+         list_length(n->queued_packet_list), n->deficit);
+  n->in_flight = 1;
+  if(n->burst) {
+    NETSTACK_RDC.send_list(packet_sent, n, q);
+  } else {
+    queuebuf_to_packetbuf(q->buf);
+    NETSTACK_RDC.send(packet_sent, n);
+  }
+
+  /* Serve the next neighbor once the current one is done */
+  if(list_head(neighbor_list) != NULL) {
+    ctimer_set(&fq_timer, 0, fq_schedule, NULL);
+  }
+}
+#else /* CSMA_FAIR_QUEUEING */
 /*---------------------------------------------------------------------------*/
 static void
 transmit_packet_list(void *ptr)
@@ -169,6 +333,7 @@ transmit_packet_list(void *ptr)
     }
   }
 }
+#endif /* CSMA_FAIR_QUEUEING */
 /*---------------------------------------------------------------------------*/
 static void
 free_packet(struct neighbor_queue *n, struct rdc_buf_list *p)
@@ -177,6 +342,17 @@ free_packet(struct neighbor_queue *n, struct rdc_buf_list *p)
     /* Remove packet from list and deallocate */
     list_remove(n->queued_packet_list, p);
 
+#if CSMA_STATS
+    {
+      clock_time_t wait;
+      wait = clock_time() - ((struct qbuf_metadata *)p->ptr)->queued;
+      csma_stats.wait_total += wait;
+      if(wait > csma_stats.wait_max) {
+        csma_stats.wait_max = wait;
+      }
+    }
+#endif /* CSMA_STATS */
+
     queuebuf_free(p->buf);
     memb_free(&metadata_memb, p->ptr);
     memb_free(&packet_memb, p);
@@ -187,14 +363,18 @@ free_packet(struct neighbor_queue *n, struct rdc_buf_list *p)
       n->transmissions = 0;
       n->collisions = 0;
       n->deferrals = 0;
+#if CSMA_FAIR_QUEUEING
+      /* The next packet need not wait out the backoff of this one */
+      ctimer_stop(&n->transmit_timer);
+      ctimer_set(&fq_timer, 0, fq_schedule, NULL);
+#else /* CSMA_FAIR_QUEUEING */
       /* Set a timer for next transmissions */
       ctimer_set(&n->transmit_timer, default_timebase(),
                  transmit_packet_list, n);
+#endif /* CSMA_FAIR_QUEUEING */
     } else {
       /* This was the last packet in the queue, we free the neighbor */
-      ctimer_stop(&n->transmit_timer);
-      list_remove(neighbor_list, n);
-      memb_free(&neighbor_memb, n);
+      neighbor_free(n);
     }
   }
 }
@@ -216,6 +396,16 @@ packet_sent(void *ptr, int status, int num_transmissions)
   if(n == NULL) {
     return;
   }
+#if CSMA_FAIR_QUEUEING
+  if(status == MAC_TX_OK) {
+    n->burst = 1;
+  } else if(status == MAC_TX_NOACK || status == MAC_TX_COLLISION) {
+    n->burst = 0;
+  }
+  if(status != MAC_TX_DEFERRED) {
+    n->in_flight = 0;
+  }
+#endif /* CSMA_FAIR_QUEUEING */
   switch(status) {
   case MAC_TX_OK:
   case MAC_TX_NOACK:
@@ -285,8 +475,13 @@ packet_sent(void *ptr, int status, int num_transmissions)
 
         if(n->transmissions < metadata->max_transmissions) {
           PRINTF("csma: retransmitting with time %lu %p\n", time, q);
+#if CSMA_FAIR_QUEUEING
+          /* Other neighbors are served while this one backs off */
+          ctimer_set(&n->transmit_timer, time, fq_schedule, NULL);
+#else /* CSMA_FAIR_QUEUEING */
           ctimer_set(&n->transmit_timer, time,
                      transmit_packet_list, n);
+#endif /* CSMA_FAIR_QUEUEING */
           /* This is needed to correctly attribute energy that we spent
              transmitting this packet. */
           queuebuf_update_attr_from_packetbuf(q->buf);
@@ -348,14 +543,35 @@ send_packet(mac_callback_t sent, void *ptr)
       n->deferrals = 0;
       /* Init packet list for this neighbor */
       LIST_STRUCT_INIT(n, queued_packet_list);
+#if CSMA_FAIR_QUEUEING
+      n->deficit = 0;
+      /* Assume the neighbor listens until it fails to ack */
+      n->burst = 1;
+      n->in_flight = 0;
+      ctimer_stop(&n->transmit_timer);
+      n->hash_next = *neighbor_bucket(addr);
+      *neighbor_bucket(addr) = n;
+#endif /* CSMA_FAIR_QUEUEING */
       /* Add neighbor to the list */
       list_add(neighbor_list, n);
     }
   }
 
   if(n != NULL) {
+#if CSMA_STATS
+    if(list_length(n->queued_packet_list) > csma_stats.depth_max) {
+      csma_stats.depth_max = list_length(n->queued_packet_list);
+    }
+    csma_stats.depth_total += list_length(n->queued_packet_list);
+#endif /* CSMA_STATS */
     /* Add packet to the neighbor's queue */
-    if(list_length(n->queued_packet_list) < CSMA_MAX_PACKET_PER_NEIGHBOR) {
+    if(list_length(n->queued_packet_list) < CSMA_MAX_PACKET_PER_NEIGHBOR
+#if CSMA_FAIR_QUEUEING
+       /* A neighbor may not hold more buffers than remain free, so that
+          a neighbor that does not ack cannot starve the others */
+       && list_length(n->queued_packet_list) < memb_numfree(&packet_memb)
+#endif /* CSMA_FAIR_QUEUEING */
+       ) {
       q = memb_alloc(&packet_memb);
       if(q != NULL) {
         q->ptr = memb_alloc(&metadata_memb);
@@ -373,6 +589,10 @@ send_packet(mac_callback_t sent, void *ptr)
             }
             metadata->sent = sent;
             metadata->cptr = ptr;
+#if CSMA_STATS
+            metadata->queued = clock_time();
+            csma_stats.queued++;
+#endif /* CSMA_STATS */
 #if PACKETBUF_WITH_PACKET_TYPE
             if(packetbuf_attr(PACKETBUF_ATTR_PACKET_TYPE) ==
                PACKETBUF_ATTR_PACKET_TYPE_ACK) {
@@ -385,10 +605,14 @@ send_packet(mac_callback_t sent, void *ptr)
 
             PRINTF("csma: send_packet, queue length %d, free packets %d\n",
                    list_length(n->queued_packet_list), memb_numfree(&packet_memb));
+#if CSMA_FAIR_QUEUEING
+            ctimer_set(&fq_timer, 0, fq_schedule, NULL);
+#else /* CSMA_FAIR_QUEUEING */
             /* If q is the first packet in the neighbor's queue, send asap */
             if(list_head(n->queued_packet_list) == q) {
               ctimer_set(&n->transmit_timer, 0, transmit_packet_list, n);
             }
+#endif /* CSMA_FAIR_QUEUEING */
             return;
           }
           memb_free(&metadata_memb, q->ptr);
@@ -399,8 +623,7 @@ send_packet(mac_callback_t sent, void *ptr)
       }
       /* The packet allocation failed. Remove and free neighbor entry if empty. */
       if(list_length(n->queued_packet_list) == 0) {
-        list_remove(neighbor_list, n);
-        memb_free(&neighbor_memb, n);
+        neighbor_free(n);
       }
     } else {
       PRINTF("csma: Neighbor queue full\n");
@@ -409,6 +632,9 @@ send_packet(mac_callback_t sent, void *ptr)
   } else {
     PRINTF("csma: could not allocate neighbor, dropping packet\n");
   }
+#if CSMA_STATS
+  csma_stats.dropped++;
+#endif /* CSMA_STATS */
   mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
 }
 /*---------------------------------------------------------------------------*/
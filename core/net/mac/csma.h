@@ -44,6 +44,33 @@
 #include "net/mac/mac.h"
 #include "dev/radio.h"
 
+/**
+ * \brief      Keep queue depth and waiting time statistics
+ */
+#ifdef CSMA_CONF_STATS
+#define CSMA_STATS CSMA_CONF_STATS
+#else
+#define CSMA_STATS 0
+#endif
+
+#if CSMA_STATS
+struct csma_stats {
+  /** Packets accepted into a neighbor queue */
+  unsigned long queued;
+  /** Packets refused for lack of a neighbor queue or buffer */
+  unsigned long dropped;
+  /** Sum of the neighbor queue lengths found by arriving packets */
+  unsigned long depth_total;
+  /** Sum of the clock ticks between queueing and completion */
+  unsigned long wait_total;
+  /** Longest time a packet spent in the queue */
+  clock_time_t wait_max;
+  /** Longest neighbor queue seen */
+  uint8_t depth_max;
+};
+extern struct csma_stats csma_stats;
+#endif /* CSMA_STATS */
+
 extern const struct mac_driver csma_driver;
 
 const struct mac_driver *csma_init(const struct mac_driver *r);
@@ -185,7 +185,9 @@ create_frame(int type, int do_create)
    */
   linkaddr_copy((linkaddr_t *)&params.src_addr, &linkaddr_node_addr);
 
-  params.payload = packetbuf_dataptr();
+  /* Only the length of the payload goes into the header. Not asking
+     for the data pointer spares a copy of a packet shared with a queue
+     buffer. */
   params.payload_len = packetbuf_datalen();
   hdr_len = frame802154_hdrlen(&params);
   if(!do_create) {
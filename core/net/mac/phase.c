@@ -44,15 +44,42 @@
 #include "net/queuebuf.h"
 #include "net/nbr-table.h"
 
+#include <string.h>
+
 #if PHASE_CONF_DRIFT_CORRECT
 #define PHASE_DRIFT_CORRECT PHASE_CONF_DRIFT_CORRECT
 #else
 #define PHASE_DRIFT_CORRECT 0
 #endif
 
+/* Number of observed phases a line is fitted through to predict the
+   drift of a neighbor, 0 to use the last phase only */
+#ifdef PHASE_CONF_DRIFT_HISTORY
+#define PHASE_DRIFT_HISTORY PHASE_CONF_DRIFT_HISTORY
+#else
+#define PHASE_DRIFT_HISTORY 0
+#endif
+
+#if PHASE_DRIFT_HISTORY
+struct phase_observation {
+  rtimer_clock_t time;
+  /* The rtimer may wrap between two observations, the clock does not */
+  clock_time_t ctime;
+};
+#endif /* PHASE_DRIFT_HISTORY */
+
 struct phase {
   rtimer_clock_t time;
-#if PHASE_DRIFT_CORRECT
+#if PHASE_DRIFT_HISTORY
+  struct phase_observation history[PHASE_DRIFT_HISTORY];
+  uint8_t observations;
+  uint8_t fitted;
+  /* Drift in rtimer ticks per cycle, times 256 */
+  int32_t drift;
+  /* A phase on the fitted line */
+  rtimer_clock_t sync;
+  clock_time_t sync_ctime;
+#elif PHASE_DRIFT_CORRECT
   rtimer_clock_t drift;
 #endif
   uint8_t noacks;
@@ -86,6 +113,88 @@ NBR_TABLE(struct phase, nbr_phase);
 #define PRINTF(...)
 #define PRINTDEBUG(...)
 #endif
+#if PHASE_DRIFT_HISTORY
+/*---------------------------------------------------------------------------*/
+static int32_t
+elapsed(rtimer_clock_t from, clock_time_t cfrom,
+        rtimer_clock_t to, clock_time_t cto)
+{
+  clock_time_t c;
+  int32_t coarse;
+
+  if(sizeof(rtimer_clock_t) >= sizeof(int32_t)) {
+    return (int32_t)(to - from);
+  }
+  c = cto - cfrom;
+  coarse = (int32_t)(c / CLOCK_SECOND) * RTIMER_ARCH_SECOND +
+    (int32_t)(c % CLOCK_SECOND) * RTIMER_ARCH_SECOND / CLOCK_SECOND;
+  /* The clock tells the number of rtimer wraps, the rtimer the rest */
+  return coarse + (int16_t)(rtimer_clock_t)(to - from - (rtimer_clock_t)coarse);
+}
+/*---------------------------------------------------------------------------*/
+static void
+record(struct phase *e, rtimer_clock_t time)
+{
+  if(e->observations == PHASE_DRIFT_HISTORY) {
+    memmove(&e->history[0], &e->history[1],
+            sizeof(e->history) - sizeof(e->history[0]));
+    e->observations--;
+  }
+  e->history[e->observations].time = time;
+  e->history[e->observations].ctime = clock_time();
+  e->observations++;
+  e->fitted = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Fits a line through the offsets of the observed phases from the
+   cycle of the first one, by least squares over the cycle number. Its
+   slope is the drift per cycle, and it smoothes out the jitter of the
+   observations. */
+static void
+fit(struct phase *e, rtimer_clock_t cycle_time)
+{
+  struct phase_observation *first, *last;
+  int64_t sk, sr, skk, skr, den;
+  int32_t x, k, r, a;
+  uint8_t i, n;
+
+  n = e->observations;
+  first = &e->history[0];
+  last = &e->history[n - 1];
+  e->sync = last->time;
+  e->sync_ctime = last->ctime;
+  e->drift = 0;
+  e->fitted = 1;
+  if(n < 2) {
+    return;
+  }
+
+  sk = sr = skk = skr = 0;
+  k = r = 0;
+  for(i = 0; i < n; i++) {
+    x = elapsed(first->time, first->ctime,
+                e->history[i].time, e->history[i].ctime);
+    /* Count cycles from the previous offset, so that drift may build
+       up over the history as long as it stays below half a cycle
+       between two observations */
+    k = (x - r + cycle_time / 2) / cycle_time;
+    r = x - k * (int32_t)cycle_time;
+    sk += k;
+    sr += r;
+    skk += (int64_t)k * k;
+    skr += (int64_t)k * r;
+  }
+
+  den = n * skk - sk * sk;
+  if(den == 0) {
+    return;
+  }
+  e->drift = (int32_t)((n * skr - sk * sr) * 256 / den);
+  a = (int32_t)((sr * 256 - e->drift * sk) / n);
+  /* Move the last phase onto the line */
+  e->sync += (rtimer_clock_t)((a + (int64_t)e->drift * k) / 256 - r);
+}
+#endif /* PHASE_DRIFT_HISTORY */
 /*---------------------------------------------------------------------------*/
 void
 phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
@@ -97,7 +206,9 @@ phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
   e = nbr_table_get_from_lladdr(nbr_phase, neighbor);
   if(e != NULL) {
     if(mac_status == MAC_TX_OK) {
-#if PHASE_DRIFT_CORRECT
+#if PHASE_DRIFT_HISTORY
+      record(e, time);
+#elif PHASE_DRIFT_CORRECT
       e->drift = time-e->time;
 #endif
       e->time = time;
@@ -125,7 +236,10 @@ phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
       e = nbr_table_add_lladdr(nbr_phase, neighbor);
       if(e) {
         e->time = time;
-#if PHASE_DRIFT_CORRECT
+#if PHASE_DRIFT_HISTORY
+        e->observations = 0;
+        record(e, time);
+#elif PHASE_DRIFT_CORRECT
       e->drift = 0;
 #endif
       e->noacks = 0;
@@ -185,7 +299,16 @@ phase_wait(const linkaddr_t *neighbor, rtimer_clock_t cycle_time,
 
     sync = (e == NULL) ? now : e->time;
 
-#if PHASE_DRIFT_CORRECT
+#if PHASE_DRIFT_HISTORY
+    if(!e->fitted) {
+      fit(e, cycle_time);
+    }
+    {
+      int32_t cycles;
+      cycles = elapsed(e->sync, e->sync_ctime, now, clock_time()) / cycle_time;
+      sync = e->sync + (rtimer_clock_t)((int64_t)cycles * e->drift / 256);
+    }
+#elif PHASE_DRIFT_CORRECT
     {
       int32_t s;
       if(e->drift > cycle_time) {
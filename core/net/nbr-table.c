@@ -62,6 +62,26 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_HASH
+#if NBR_TABLE_HASH_SIZE <= NBR_TABLE_MAX_NEIGHBORS
+#error "NBR_TABLE_CONF_HASH_SIZE must be larger than the number of neighbors"
+#endif
+#if (NBR_TABLE_HASH_SIZE & (NBR_TABLE_HASH_SIZE - 1)) != 0
+#error "NBR_TABLE_CONF_HASH_SIZE must be a power of two"
+#endif
+
+#if NBR_TABLE_MAX_NEIGHBORS < 255
+typedef uint8_t nbr_hash_slot_t;
+#else
+typedef uint16_t nbr_hash_slot_t;
+#endif
+
+/* Hash index over the keys with linear probing. A slot holds the
+ * neighbor index + 1, or 0 if it is empty. */
+static nbr_hash_slot_t hash_slots[NBR_TABLE_HASH_SIZE];
+#define HASH_NEXT(slot) (((slot) + 1) & (NBR_TABLE_HASH_SIZE - 1))
+#endif /* NBR_TABLE_HASH */
+
 /*---------------------------------------------------------------------------*/
 /* Get a key from a neighbor index */
 static nbr_table_key_t *
@@ -104,6 +124,72 @@ key_from_item(nbr_table_t *table, const nbr_table_item_t *item)
 {
   return key_from_index(index_from_item(table, item));
 }
+#if NBR_TABLE_HASH
+/*---------------------------------------------------------------------------*/
+/* Get the home slot of a link-layer address */
+static unsigned
+hash_lladdr(const linkaddr_t *lladdr)
+{
+  uint16_t h;
+  int i;
+
+  /* Multiplicative hash that mixes every byte into the low bits, as
+   * addresses of neighbors often differ in a single byte only */
+  h = 0;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = (h ^ lladdr->u8[i]) * 0x9e5;
+  }
+  h ^= h >> 7;
+  return h & (NBR_TABLE_HASH_SIZE - 1);
+}
+/*---------------------------------------------------------------------------*/
+/* Insert a key into the hash index. Every probe loop is bounded by the
+ * table size, so that a corrupt index cannot hang the node. */
+static void
+hash_add(nbr_table_key_t *key)
+{
+  unsigned slot, i;
+
+  slot = hash_lladdr(&key->lladdr);
+  for(i = 0; i < NBR_TABLE_HASH_SIZE; i++) {
+    if(hash_slots[slot] == 0) {
+      hash_slots[slot] = index_from_key(key) + 1;
+      return;
+    }
+    slot = HASH_NEXT(slot);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a key from the hash index */
+static void
+hash_remove(nbr_table_key_t *key)
+{
+  unsigned slot, next, home, i;
+
+  slot = hash_lladdr(&key->lladdr);
+  for(i = 0; hash_slots[slot] != index_from_key(key) + 1; i++) {
+    if(hash_slots[slot] == 0 || i == NBR_TABLE_HASH_SIZE) {
+      return;
+    }
+    slot = HASH_NEXT(slot);
+  }
+
+  /* Move entries of the probe sequence back into the gap, so that
+   * lookups never stop early at an empty slot */
+  for(next = HASH_NEXT(slot), i = 0;
+      hash_slots[next] != 0 && i < NBR_TABLE_HASH_SIZE;
+      next = HASH_NEXT(next), i++) {
+    home = hash_lladdr(&key_from_index(hash_slots[next] - 1)->lladdr);
+    /* Move the entry unless its home slot lies cyclically in (slot, next] */
+    if(((next - home) & (NBR_TABLE_HASH_SIZE - 1)) >=
+       ((next - slot) & (NBR_TABLE_HASH_SIZE - 1))) {
+      hash_slots[slot] = hash_slots[next];
+      slot = next;
+    }
+  }
+  hash_slots[slot] = 0;
+}
+#endif /* NBR_TABLE_HASH */
 /*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
@@ -115,6 +201,20 @@ index_from_lladdr(const linkaddr_t *lladdr)
   if(lladdr == NULL) {
     lladdr = &linkaddr_null;
   }
+#if NBR_TABLE_HASH
+  {
+    unsigned slot, i;
+
+    for(slot = hash_lladdr(lladdr), i = 0;
+        hash_slots[slot] != 0 && i < NBR_TABLE_HASH_SIZE;
+        slot = HASH_NEXT(slot), i++) {
+      key = key_from_index(hash_slots[slot] - 1);
+      if(linkaddr_cmp(lladdr, &key->lladdr)) {
+        return hash_slots[slot] - 1;
+      }
+    }
+  }
+#else /* NBR_TABLE_HASH */
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && linkaddr_cmp(lladdr, &key->lladdr)) {
@@ -122,6 +222,7 @@ index_from_lladdr(const linkaddr_t *lladdr)
     }
     key = list_item_next(key);
   }
+#endif /* NBR_TABLE_HASH */
   return -1;
 }
 /*---------------------------------------------------------------------------*/
@@ -218,6 +319,9 @@ nbr_table_allocate(void)
       used_map[index_from_key(least_used_key)] = 0;
       /* Remove neighbor from list */
       list_remove(nbr_table_keys, least_used_key);
+#if NBR_TABLE_HASH
+      hash_remove(least_used_key);
+#endif /* NBR_TABLE_HASH */
       /* Return associated key */
       return least_used_key;
     }
@@ -298,6 +402,9 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_HASH
+    hash_add(key);
+#endif /* NBR_TABLE_HASH */
   }
 
   /* Get item in the current table */
@@ -341,6 +448,25 @@ nbr_table_unlock(nbr_table_t *table, void *item)
   return nbr_set_bit(locked_map, table, item, 0);
 }
 /*---------------------------------------------------------------------------*/
+/* Change the link-layer address of an item, for all tables */
+void
+nbr_table_update_lladdr(nbr_table_t *table, const void *item,
+                        const linkaddr_t *lladdr)
+{
+  nbr_table_key_t *key = key_from_item(table, item);
+
+  if(key == NULL) {
+    return;
+  }
+#if NBR_TABLE_HASH
+  hash_remove(key);
+#endif /* NBR_TABLE_HASH */
+  linkaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_HASH
+  hash_add(key);
+#endif /* NBR_TABLE_HASH */
+}
+/*---------------------------------------------------------------------------*/
 /* Get link-layer address of an item */
 linkaddr_t *
 nbr_table_get_lladdr(nbr_table_t *table, const void *item)
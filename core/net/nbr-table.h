@@ -46,6 +46,34 @@
 #define NBR_TABLE_MAX_NEIGHBORS 8
 #endif /* NBR_TABLE_CONF_MAX_NEIGHBORS */
 
+/* Index the neighbors by link-layer address in an open-addressing hash
+ * table, so that lookups do not walk the list of all neighbors */
+#ifdef NBR_TABLE_CONF_HASH
+#define NBR_TABLE_HASH NBR_TABLE_CONF_HASH
+#else /* NBR_TABLE_CONF_HASH */
+#define NBR_TABLE_HASH 0
+#endif /* NBR_TABLE_CONF_HASH */
+
+/* Number of hash slots, must be a power of two larger than the number
+ * of neighbors. Defaults to at least twice the number of neighbors. */
+#ifdef NBR_TABLE_CONF_HASH_SIZE
+#define NBR_TABLE_HASH_SIZE NBR_TABLE_CONF_HASH_SIZE
+#elif NBR_TABLE_MAX_NEIGHBORS <= 8
+#define NBR_TABLE_HASH_SIZE 16
+#elif NBR_TABLE_MAX_NEIGHBORS <= 16
+#define NBR_TABLE_HASH_SIZE 32
+#elif NBR_TABLE_MAX_NEIGHBORS <= 32
+#define NBR_TABLE_HASH_SIZE 64
+#elif NBR_TABLE_MAX_NEIGHBORS <= 64
+#define NBR_TABLE_HASH_SIZE 128
+#elif NBR_TABLE_MAX_NEIGHBORS <= 128
+#define NBR_TABLE_HASH_SIZE 256
+#elif NBR_TABLE_MAX_NEIGHBORS <= 256
+#define NBR_TABLE_HASH_SIZE 512
+#else
+#define NBR_TABLE_HASH_SIZE 1024
+#endif /* NBR_TABLE_CONF_HASH_SIZE */
+
 /* An item in a neighbor table */
 typedef void nbr_table_item_t;
 
@@ -98,6 +126,8 @@ int nbr_table_unlock(nbr_table_t *table, nbr_table_item_t *item);
 /** \name Neighbor tables: address manipulation */
 /** @{ */
 linkaddr_t *nbr_table_get_lladdr(nbr_table_t *table, const nbr_table_item_t *item);
+void nbr_table_update_lladdr(nbr_table_t *table, const nbr_table_item_t *item,
+                             const linkaddr_t *lladdr);
 /** @} */
 
 #endif /* NBR_TABLE_H_ */
@@ -47,14 +47,34 @@
 #include "contiki-net.h"
 #include "net/packetbuf.h"
 #include "net/rime/rime.h"
+#if PACKETBUF_SEGMENTS
+#include "net/queuebuf.h"
+#include "lib/memb.h"
+#endif /* PACKETBUF_SEGMENTS */
 
 struct packetbuf_attr packetbuf_attrs[PACKETBUF_NUM_ATTRS];
 struct packetbuf_addr packetbuf_addrs[PACKETBUF_NUM_ADDRS];
 
+#if PACKETBUF_STATS
+struct packetbuf_stats packetbuf_stats;
+#endif /* PACKETBUF_STATS */
 
 static uint16_t buflen, bufptr;
-static uint8_t hdrptr;
+static uint16_t hdrptr;
 
+#if PACKETBUF_SEGMENTS
+/* The packetbuf is a reference to a segment, which queue buffers may
+   share. Every queue buffer holds at most one segment, and the
+   packetbuf may need a fresh one while it still holds its old one. */
+MEMB(segments, struct packetbuf_segment, QUEUEBUF_NUM + 2);
+
+static struct packetbuf_segment *segment;
+static uint8_t *packetbuf;
+
+/* The data starts here, the header is in front of it. */
+static uint16_t datastart;
+#define DATA_START datastart
+#else /* PACKETBUF_SEGMENTS */
 /* The declarations below ensure that the packet buffer is aligned on
    an even 32-bit boundary. On some platforms (most notably the
    msp430 or OpenRISC), having a potentially misaligned packet buffer may lead to
@@ -62,7 +82,8 @@ static uint8_t hdrptr;
 static uint32_t packetbuf_aligned[(PACKETBUF_SIZE + PACKETBUF_HDR_SIZE + 3) / 4];
 static uint8_t *packetbuf = (uint8_t *)packetbuf_aligned;
 
-static uint8_t *packetbufptr;
+#define DATA_START PACKETBUF_HDR_SIZE
+#endif /* PACKETBUF_SEGMENTS */
 
 #define DEBUG 0
 #if DEBUG
@@ -72,21 +93,129 @@ static uint8_t *packetbufptr;
 #define PRINTF(...)
 #endif
 
+#if PACKETBUF_SEGMENTS
+/*---------------------------------------------------------------------------*/
+static struct packetbuf_segment *
+new_segment(void)
+{
+  struct packetbuf_segment *s;
+
+  /* Cannot fail, the pool has room for every holder of a segment. */
+  s = memb_alloc(&segments);
+  s->refs = 1;
+  s->shared = PACKETBUF_SEGMENT_SIZE;
+  return s;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_segment(struct packetbuf_segment *s)
+{
+  if(segment != NULL) {
+    packetbuf_segment_free(segment);
+  }
+  segment = s;
+  packetbuf = (uint8_t *)s->data;
+}
+/*---------------------------------------------------------------------------*/
+/* Moves the header and data to a new segment, with the data starting
+   at start. */
+static void
+move_to_new_segment(uint16_t start)
+{
+  struct packetbuf_segment *s;
+  uint16_t hdrlen, len;
+
+  hdrlen = datastart - hdrptr;
+  len = hdrlen + bufptr + buflen;
+  s = new_segment();
+  memcpy((uint8_t *)s->data + start - hdrlen, packetbuf + hdrptr, len);
+  PACKETBUF_STATS_COPY(len);
+
+  set_segment(s);
+  hdrptr = start - hdrlen;
+  datastart = start;
+}
+/*---------------------------------------------------------------------------*/
+/* Makes a private copy of a segment that queue buffers refer to, before
+   the packetbuf modifies it. */
+static void
+make_writable(void)
+{
+  if(segment->refs > 1) {
+    PRINTF("packetbuf: copying shared segment\n");
+    move_to_new_segment(datastart);
+  }
+}
+/*---------------------------------------------------------------------------*/
+struct packetbuf_segment *
+packetbuf_share(uint16_t *offset, uint16_t *len)
+{
+  uint16_t hdrlen;
+
+  hdrlen = datastart - hdrptr;
+  if(hdrlen > 0 && bufptr > 0) {
+    /* The header and the data must be consecutive. */
+    packetbuf_compact();
+  }
+  *offset = hdrlen > 0 ? hdrptr : datastart + bufptr;
+  *len = hdrlen + buflen > PACKETBUF_SIZE ? 0 : hdrlen + buflen;
+  PACKETBUF_STATS_SHARE(*len);
+
+  if(*offset < segment->shared) {
+    segment->shared = *offset;
+  }
+  segment->refs++;
+  return segment;
+}
+/*---------------------------------------------------------------------------*/
+void
+packetbuf_attach(struct packetbuf_segment *s, uint16_t offset, uint16_t len)
+{
+  PACKETBUF_STATS_SHARE(len);
+  s->refs++;
+  set_segment(s);
+  buflen = len;
+  bufptr = 0;
+  hdrptr = datastart = offset;
+  packetbuf_attr_clear();
+}
+/*---------------------------------------------------------------------------*/
+void
+packetbuf_segment_free(struct packetbuf_segment *s)
+{
+  if(--s->refs == 0) {
+    memb_free(&segments, s);
+  }
+}
+#else /* PACKETBUF_SEGMENTS */
+/*---------------------------------------------------------------------------*/
+static void
+make_writable(void)
+{
+  /* The packetbuf always owns its buffer. */
+}
+#endif /* PACKETBUF_SEGMENTS */
 /*---------------------------------------------------------------------------*/
 void
 packetbuf_clear(void)
 {
+#if PACKETBUF_SEGMENTS
+  if(segment == NULL || segment->refs > 1) {
+    set_segment(new_segment());
+  }
+  segment->shared = PACKETBUF_SEGMENT_SIZE;
+  datastart = PACKETBUF_HDR_SIZE;
+#endif /* PACKETBUF_SEGMENTS */
   buflen = bufptr = 0;
-  hdrptr = PACKETBUF_HDR_SIZE;
+  hdrptr = DATA_START;
 
-  packetbufptr = &packetbuf[PACKETBUF_HDR_SIZE];
   packetbuf_attr_clear();
 }
 /*---------------------------------------------------------------------------*/
 void
 packetbuf_clear_hdr(void)
 {
-  hdrptr = PACKETBUF_HDR_SIZE;
+  hdrptr = DATA_START;
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -96,7 +225,8 @@ packetbuf_copyfrom(const void *from, uint16_t len)
 
   packetbuf_clear();
   l = len > PACKETBUF_SIZE? PACKETBUF_SIZE: len;
-  memcpy(packetbufptr, from, l);
+  memcpy(&packetbuf[DATA_START], from, l);
+  PACKETBUF_STATS_COPY(l);
   buflen = l;
   return l;
 }
@@ -107,10 +237,12 @@ packetbuf_compact(void)
   int i, len;
 
   if(bufptr > 0) {
-    len = packetbuf_datalen() + PACKETBUF_HDR_SIZE;
-    for(i = PACKETBUF_HDR_SIZE; i < len; i++) {
+    make_writable();
+    len = packetbuf_datalen() + DATA_START;
+    for(i = DATA_START; i < len; i++) {
       packetbuf[i] = packetbuf[bufptr + i];
     }
+    PACKETBUF_STATS_COPY(packetbuf_datalen());
 
     bufptr = 0;
   }
@@ -123,14 +255,15 @@ packetbuf_copyto_hdr(uint8_t *to)
   {
     int i;
     PRINTF("packetbuf_write_hdr: header:\n");
-    for(i = hdrptr; i < PACKETBUF_HDR_SIZE; ++i) {
+    for(i = hdrptr; i < DATA_START; ++i) {
       PRINTF("0x%02x, ", packetbuf[i]);
     }
     PRINTF("\n");
   }
 #endif /* DEBUG_LEVEL */
-  memcpy(to, packetbuf + hdrptr, PACKETBUF_HDR_SIZE - hdrptr);
-  return PACKETBUF_HDR_SIZE - hdrptr;
+  memcpy(to, packetbuf + hdrptr, DATA_START - hdrptr);
+  PACKETBUF_STATS_COPY(DATA_START - hdrptr);
+  return DATA_START - hdrptr;
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -143,32 +276,46 @@ packetbuf_copyto(void *to)
     char *bufferptr = buffer;
     
     bufferptr[0] = 0;
-    for(i = hdrptr; i < PACKETBUF_HDR_SIZE; ++i) {
+    for(i = hdrptr; i < DATA_START; ++i) {
       bufferptr += sprintf(bufferptr, "0x%02x, ", packetbuf[i]);
     }
     PRINTF("packetbuf_write: header: %s\n", buffer);
     bufferptr = buffer;
     bufferptr[0] = 0;
     for(i = bufptr; i < buflen + bufptr; ++i) {
-      bufferptr += sprintf(bufferptr, "0x%02x, ", packetbufptr[i]);
+      bufferptr += sprintf(bufferptr, "0x%02x, ", packetbuf[DATA_START + i]);
     }
     PRINTF("packetbuf_write: data: %s\n", buffer);
   }
 #endif /* DEBUG_LEVEL */
-  if(PACKETBUF_HDR_SIZE - hdrptr + buflen > PACKETBUF_SIZE) {
+  if(DATA_START - hdrptr + buflen > PACKETBUF_SIZE) {
     /* Too large packet */
     return 0;
   }
-  memcpy(to, packetbuf + hdrptr, PACKETBUF_HDR_SIZE - hdrptr);
-  memcpy((uint8_t *)to + PACKETBUF_HDR_SIZE - hdrptr, packetbufptr + bufptr,
+  memcpy(to, packetbuf + hdrptr, DATA_START - hdrptr);
+  memcpy((uint8_t *)to + DATA_START - hdrptr, packetbuf + DATA_START + bufptr,
 	 buflen);
-  return PACKETBUF_HDR_SIZE - hdrptr + buflen;
+  PACKETBUF_STATS_COPY(DATA_START - hdrptr + buflen);
+  return DATA_START - hdrptr + buflen;
 }
 /*---------------------------------------------------------------------------*/
 int
 packetbuf_hdralloc(int size)
 {
-  if(hdrptr >= size && packetbuf_totlen() + size <= PACKETBUF_SIZE) {
+  if(packetbuf_totlen() + size > PACKETBUF_SIZE) {
+    return 0;
+  }
+#if PACKETBUF_SEGMENTS
+  if(hdrptr < size && DATA_START - hdrptr + size <= PACKETBUF_HDR_SIZE) {
+    /* A packet from a queue buffer that already has headers: give it
+       the full header space, as a copy into the packetbuf would. */
+    move_to_new_segment(PACKETBUF_HDR_SIZE);
+  } else if(hdrptr > segment->shared) {
+    /* The new header would overwrite bytes of a queue buffer. */
+    make_writable();
+  }
+#endif /* PACKETBUF_SEGMENTS */
+  if(hdrptr >= size) {
     hdrptr -= size;
     return 1;
   }
@@ -197,13 +344,17 @@ void
 packetbuf_set_datalen(uint16_t len)
 {
   PRINTF("packetbuf_set_len: len %d\n", len);
+  if(len > buflen) {
+    make_writable();
+  }
   buflen = len;
 }
 /*---------------------------------------------------------------------------*/
 void *
 packetbuf_dataptr(void)
 {
-  return (void *)(&packetbuf[bufptr + PACKETBUF_HDR_SIZE]);
+  make_writable();
+  return (void *)(&packetbuf[bufptr + DATA_START]);
 }
 /*---------------------------------------------------------------------------*/
 void *
@@ -223,7 +374,7 @@ packetbuf_hdrlen(void)
 {
   uint8_t hdrlen;
   
-  hdrlen = PACKETBUF_HDR_SIZE - hdrptr;
+  hdrlen = DATA_START - hdrptr;
   if(hdrlen) {
     /* outbound packet */
     return hdrlen;
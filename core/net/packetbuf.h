@@ -80,6 +80,62 @@
 #define PACKETBUF_WITH_PACKET_TYPE NETSTACK_CONF_WITH_RIME
 #endif
 
+/**
+ * \brief      Keep the packet in reference-counted segments
+ *
+ *             The packetbuf refers to a segment of
+ *             PACKETBUF_HDR_SIZE + PACKETBUF_SIZE bytes instead of
+ *             owning a buffer. Queue buffers share the segment with
+ *             the packetbuf instead of copying the packet, and get it
+ *             back the same way. Headers are prepended in front of a
+ *             shared packet if the bytes there are unused; anything
+ *             else that modifies a shared packet, including every call
+ *             to packetbuf_dataptr(), works on a private copy. This
+ *             costs two segments more than there are queue buffers.
+ */
+#ifdef PACKETBUF_CONF_SEGMENTS
+#define PACKETBUF_SEGMENTS PACKETBUF_CONF_SEGMENTS
+#else
+#define PACKETBUF_SEGMENTS 0
+#endif
+
+/**
+ * \brief      Count the bytes that are copied and shared
+ */
+#ifdef PACKETBUF_CONF_STATS
+#define PACKETBUF_STATS PACKETBUF_CONF_STATS
+#else
+#define PACKETBUF_STATS 0
+#endif
+
+#if PACKETBUF_STATS
+struct packetbuf_stats {
+  /** Bytes copied into, out of and within the packetbuf */
+  uint32_t copied;
+  /** Bytes handed between the packetbuf and queue buffers by reference */
+  uint32_t shared;
+};
+extern struct packetbuf_stats packetbuf_stats;
+#define PACKETBUF_STATS_COPY(len) (packetbuf_stats.copied += (len))
+#define PACKETBUF_STATS_SHARE(len) (packetbuf_stats.shared += (len))
+#else /* PACKETBUF_STATS */
+#define PACKETBUF_STATS_COPY(len)
+#define PACKETBUF_STATS_SHARE(len)
+#endif /* PACKETBUF_STATS */
+
+#if PACKETBUF_SEGMENTS
+#define PACKETBUF_SEGMENT_SIZE (PACKETBUF_HDR_SIZE + PACKETBUF_SIZE)
+
+struct packetbuf_segment {
+  uint32_t data[(PACKETBUF_SEGMENT_SIZE + 3) / 4];
+  /* Lowest offset of the bytes that queue buffers refer to */
+  uint16_t shared;
+  uint8_t refs;
+};
+
+#define packetbuf_segment_ptr(s, offset) ((uint8_t *)(s)->data + (offset))
+#endif /* PACKETBUF_SEGMENTS */
+
 /**
  * \brief      Clear and reset the packetbuf
  *
@@ -278,6 +334,37 @@ int packetbuf_hdralloc(int size);
  */
 int packetbuf_hdrreduce(int size);
 
+#if PACKETBUF_SEGMENTS
+/**
+ * \brief      Share the packet in the packetbuf, for queue buffers
+ * \param offset Returns the offset of the packet in the segment
+ * \param len  Returns the length of the header and data
+ * \return     The segment, with one more reference
+ *
+ *             The packet is left in the packetbuf. The reference is
+ *             released with packetbuf_segment_free().
+ */
+struct packetbuf_segment *packetbuf_share(uint16_t *offset, uint16_t *len);
+
+/**
+ * \brief      Put a shared packet into the packetbuf
+ * \param s    The segment
+ * \param offset The offset of the packet in the segment
+ * \param len  The length of the packet
+ *
+ *             This is the counterpart of packetbuf_copyfrom() for a
+ *             packet that was shared with packetbuf_share(). Like
+ *             packetbuf_copyfrom(), it clears the attributes.
+ */
+void packetbuf_attach(struct packetbuf_segment *s, uint16_t offset,
+                      uint16_t len);
+
+/**
+ * \brief      Release a reference to a segment
+ */
+void packetbuf_segment_free(struct packetbuf_segment *s);
+#endif /* PACKETBUF_SEGMENTS */
+
 /* Packet attributes stuff below: */
 
 typedef uint16_t packetbuf_attr_t;
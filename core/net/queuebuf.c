@@ -50,6 +50,10 @@
 
 #include <string.h> /* for memcpy() */
 
+#if PACKETBUF_SEGMENTS && WITH_SWAP
+#error "PACKETBUF_CONF_SEGMENTS cannot be used with queuebuf swapping"
+#endif
+
 /* Structure pointing to a buffer either stored
    in RAM or swapped in CFS */
 struct queuebuf {
@@ -72,7 +76,12 @@ struct queuebuf {
 
 /* The actual queuebuf data */
 struct queuebuf_data {
+#if PACKETBUF_SEGMENTS
+  struct packetbuf_segment *segment;
+  uint16_t offset;
+#else /* PACKETBUF_SEGMENTS */
   uint8_t data[PACKETBUF_SIZE];
+#endif /* PACKETBUF_SEGMENTS */
   uint16_t len;
   struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
   struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
@@ -339,7 +348,11 @@ queuebuf_new_from_packetbuf(void)
     buframptr = buf->ram_ptr;
 #endif
 
+#if PACKETBUF_SEGMENTS
+    buframptr->segment = packetbuf_share(&buframptr->offset, &buframptr->len);
+#else /* PACKETBUF_SEGMENTS */
     buframptr->len = packetbuf_copyto(buframptr->data);
+#endif /* PACKETBUF_SEGMENTS */
     packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
 
 #if WITH_SWAP
@@ -383,7 +396,12 @@ queuebuf_update_from_packetbuf(struct queuebuf *buf)
 {
   struct queuebuf_data *buframptr = queuebuf_load_to_ram(buf);
   packetbuf_attr_copyto(buframptr->attrs, buframptr->addrs);
+#if PACKETBUF_SEGMENTS
+  packetbuf_segment_free(buframptr->segment);
+  buframptr->segment = packetbuf_share(&buframptr->offset, &buframptr->len);
+#else /* PACKETBUF_SEGMENTS */
   buframptr->len = packetbuf_copyto(buframptr->data);
+#endif /* PACKETBUF_SEGMENTS */
 #if WITH_SWAP
   if(buf->location == IN_CFS) {
     queuebuf_flush_tmpdata();
@@ -402,6 +420,9 @@ queuebuf_free(struct queuebuf *buf)
       queuebuf_remove_from_file(buf->swap_id);
     }
 #else
+#if PACKETBUF_SEGMENTS
+    packetbuf_segment_free(buf->ram_ptr->segment);
+#endif /* PACKETBUF_SEGMENTS */
     memb_free(&buframmem, buf->ram_ptr);
 #endif
     memb_free(&bufmem, buf);
@@ -420,7 +441,11 @@ queuebuf_to_packetbuf(struct queuebuf *b)
 {
   if(memb_inmemb(&bufmem, b)) {
     struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+#if PACKETBUF_SEGMENTS
+    packetbuf_attach(buframptr->segment, buframptr->offset, buframptr->len);
+#else /* PACKETBUF_SEGMENTS */
     packetbuf_copyfrom(buframptr->data, buframptr->len);
+#endif /* PACKETBUF_SEGMENTS */
     packetbuf_attr_copyfrom(buframptr->attrs, buframptr->addrs);
   }
 }
@@ -430,7 +455,11 @@ queuebuf_dataptr(struct queuebuf *b)
 {
   if(memb_inmemb(&bufmem, b)) {
     struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+#if PACKETBUF_SEGMENTS
+    return packetbuf_segment_ptr(buframptr->segment, buframptr->offset);
+#else /* PACKETBUF_SEGMENTS */
     return buframptr->data;
+#endif /* PACKETBUF_SEGMENTS */
   }
   return NULL;
 }
@@ -284,4 +284,81 @@
     + random_rand() % (RPL_PROBING_INTERVAL))
 #endif
 
+/*
+ * RPL non-storing mode. Nodes send their DAOs to the DAG root, which
+ * keeps the parent of every node and source routes packets down the DAG
+ * with RFC 6554 routing headers. Routers keep no downward routes, so
+ * UIP_CONF_MAX_ROUTES can be 0 on nodes that do not become root.
+ * */
+#ifdef RPL_CONF_WITH_NON_STORING
+#define RPL_WITH_NON_STORING RPL_CONF_WITH_NON_STORING
+#else
+#define RPL_WITH_NON_STORING 0
+#endif
+
+/*
+ * Number of nodes the DAG root can source route to in non-storing mode.
+ * Every node costs 16 bytes. Nodes that never become root can set it
+ * to 1.
+ * */
+#ifdef RPL_NS_CONF_LINK_NUM
+#define RPL_NS_LINK_NUM RPL_NS_CONF_LINK_NUM
+#else
+#define RPL_NS_LINK_NUM 32
+#endif
+
+/*
+ * DAO aggregation in storing mode. The targets of the DAOs received from
+ * children, and of the node's own DAOs, are held for
+ * RPL_DAO_AGGREGATION_DELAY and then sent to the preferred parent in DAOs
+ * that combine as many Target and Transit options as fit in a packet. A
+ * DAO is acknowledged once for all its targets. Nodes without aggregation
+ * only handle the last target of a DAO, so it must be enabled on all
+ * nodes of the network.
+ * */
+#ifdef RPL_CONF_DAO_AGGREGATION
+#define RPL_DAO_AGGREGATION RPL_CONF_DAO_AGGREGATION
+#else
+#define RPL_DAO_AGGREGATION 0
+#endif
+
+#ifdef RPL_CONF_DAO_AGGREGATION_DELAY
+#define RPL_DAO_AGGREGATION_DELAY RPL_CONF_DAO_AGGREGATION_DELAY
+#else
+#define RPL_DAO_AGGREGATION_DELAY (CLOCK_SECOND / 2)
+#endif
+
+/*
+ * Number of targets held for aggregation. When they are all in use,
+ * received DAOs are forwarded as they are.
+ * */
+#ifdef RPL_CONF_DAO_AGGREGATION_TARGETS
+#define RPL_DAO_AGGREGATION_TARGETS RPL_CONF_DAO_AGGREGATION_TARGETS
+#else
+#define RPL_DAO_AGGREGATION_TARGETS 16
+#endif
+
+/*
+ * RPL multipath forwarding. When enabled, packets going up the DAG are
+ * spread over all parents whose rank is below ours and through which our
+ * rank would be at most RPL_MULTIPATH_TOLERANCE above the current one.
+ * Parents are picked per packet by weighted round robin, the weight being
+ * the inverse of the link ETX. A parent whose last transmission was not
+ * acknowledged is skipped until it acknowledges a frame or sends a DIO.
+ * */
+#ifdef RPL_CONF_MULTIPATH
+#define RPL_MULTIPATH RPL_CONF_MULTIPATH
+#else
+#define RPL_MULTIPATH 0
+#endif
+
+/*
+ * Rank increase tolerated for an alternate parent in multipath mode.
+ * */
+#ifdef RPL_CONF_MULTIPATH_TOLERANCE
+#define RPL_MULTIPATH_TOLERANCE RPL_CONF_MULTIPATH_TOLERANCE
+#else
+#define RPL_MULTIPATH_TOLERANCE RPL_MIN_HOPRANKINC
+#endif
+
 #endif /* RPL_CONF_H */
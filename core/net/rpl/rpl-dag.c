@@ -820,6 +820,77 @@ rpl_select_parent(rpl_dag_t *dag)
 
   return best;
 }
+#if RPL_MULTIPATH
+/*---------------------------------------------------------------------------*/
+/* A parent belongs to the multipath set if it is closer to the root than
+   we are, so that upward packets sent to it pass the loop check, and if
+   routing through it would not raise our rank beyond the tolerance. */
+int
+rpl_multipath_parent(rpl_parent_t *p)
+{
+  rpl_dag_t *dag = p->dag;
+
+  if(dag == NULL || dag != dag->instance->current_dag ||
+     p->rank == INFINITE_RANK || p->rank >= dag->rank) {
+    return 0;
+  }
+  return p == dag->preferred_parent ||
+    dag->instance->of->calculate_rank(p, 0) <=
+    (uint32_t)dag->rank + RPL_MULTIPATH_TOLERANCE;
+}
+/*---------------------------------------------------------------------------*/
+static int
+multipath_weight(rpl_parent_t *p)
+{
+  uip_ds6_nbr_t *nbr = rpl_get_nbr(p);
+  uint16_t etx;
+
+  etx = nbr != NULL ? nbr->link_metric : 0;
+  if(etx < RPL_DAG_MC_ETX_DIVISOR) {
+    etx = RPL_DAG_MC_ETX_DIVISOR;
+  }
+  /* 16 for a perfect link, 1 for a link with an ETX of 10 or more. */
+  return (16 * RPL_DAG_MC_ETX_DIVISOR + etx - 1) / etx;
+}
+/*---------------------------------------------------------------------------*/
+/* Smooth weighted round robin: every usable parent earns its weight in
+   credit, the richest one is picked and pays back the total. Over a round
+   each parent is picked in proportion to its weight, and picks of the same
+   parent are interleaved with the others rather than sent in a row. */
+uip_ipaddr_t *
+rpl_multipath_nexthop(void)
+{
+  rpl_parent_t *p, *best;
+  int total, weight;
+
+  if(default_instance == NULL || default_instance->current_dag == NULL ||
+     !default_instance->current_dag->joined) {
+    return NULL;
+  }
+
+  best = NULL;
+  total = 0;
+  for(p = nbr_table_head(rpl_parents); p != NULL;
+      p = nbr_table_next(rpl_parents, p)) {
+    if((p->flags & RPL_PARENT_FLAG_LINK_FAILED) || !rpl_multipath_parent(p)) {
+      continue;
+    }
+    weight = multipath_weight(p);
+    total += weight;
+    p->credit += weight;
+    if(best == NULL || p->credit > best->credit) {
+      best = p;
+    }
+  }
+
+  if(best == NULL) {
+    /* No usable parent, fall back on the default route. */
+    return NULL;
+  }
+  best->credit -= total;
+  return rpl_get_parent_ipaddr(best);
+}
+#endif /* RPL_MULTIPATH */
 /*---------------------------------------------------------------------------*/
 void
 rpl_remove_parent(rpl_parent_t *parent)
@@ -1377,6 +1448,10 @@ rpl_process_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
 
   /* Parent info has been updated, trigger rank recalculation */
   p->flags |= RPL_PARENT_FLAG_UPDATED;
+#if RPL_MULTIPATH
+  /* The parent is alive, make it usable for multipath forwarding again. */
+  p->flags &= ~RPL_PARENT_FLAG_LINK_FAILED;
+#endif /* RPL_MULTIPATH */
 
   PRINTF("RPL: preferred DAG ");
   PRINT6ADDR(&instance->current_dag->dag_id);
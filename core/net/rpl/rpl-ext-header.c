@@ -48,6 +48,7 @@
 #include "net/ip/tcpip.h"
 #include "net/ipv6/uip-ds6.h"
 #include "net/rpl/rpl-private.h"
+#include "net/rpl/rpl-ns.h"
 #include "net/packetbuf.h"
 
 #define DEBUG DEBUG_NONE
@@ -64,6 +65,9 @@
 #define UIP_EXT_HDR_OPT_BUF       ((struct uip_ext_hdr_opt *)&uip_buf[uip_l2_l3_hdr_len + uip_ext_opt_offset])
 #define UIP_EXT_HDR_OPT_PADN_BUF  ((struct uip_ext_hdr_opt_padn *)&uip_buf[uip_l2_l3_hdr_len + uip_ext_opt_offset])
 #define UIP_EXT_HDR_OPT_RPL_BUF   ((struct uip_ext_hdr_opt_rpl *)&uip_buf[uip_l2_l3_hdr_len + uip_ext_opt_offset])
+#define UIP_RH_BUF                ((struct uip_routing_hdr *)&uip_buf[uip_l2_l3_hdr_len])
+#define UIP_SRH_BUF               ((struct uip_rpl_srh_hdr *)&uip_buf[uip_l2_l3_hdr_len + sizeof(struct uip_routing_hdr)])
+#define UIP_SRH_ADDR_BUF          ((uint8_t *)UIP_SRH_BUF + sizeof(struct uip_rpl_srh_hdr))
 /*---------------------------------------------------------------------------*/
 int
 rpl_verify_header(int uip_ext_opt_offset)
@@ -302,7 +306,11 @@ rpl_update_header_final(uip_ipaddr_t *addr)
           return 1;
         }
         parent = rpl_find_parent(default_instance->current_dag, addr);
+#if RPL_MULTIPATH
+        if(parent == NULL || !rpl_multipath_parent(parent)) {
+#else
         if(parent == NULL || parent != parent->dag->preferred_parent) {
+#endif /* RPL_MULTIPATH */
           UIP_EXT_HDR_OPT_RPL_BUF->flags = RPL_HDR_OPT_DOWN;
         }
         UIP_EXT_HDR_OPT_RPL_BUF->instance = default_instance->instance_id;
@@ -384,4 +392,157 @@ rpl_insert_header(void)
 }
 /*---------------------------------------------------------------------------*/
 
+#if RPL_WITH_NON_STORING
+/*---------------------------------------------------------------------------*/
+int
+rpl_process_srh_header(void)
+{
+  uint8_t cmpri, cmpre, cmpr, pad;
+  int n, i, size;
+
+  if(UIP_RH_BUF->routing_type != RPL_RH_TYPE_SRH ||
+     UIP_RH_BUF->seg_left == 0) {
+    return 0;
+  }
+
+  cmpri = UIP_SRH_BUF->cmpr >> 4;
+  cmpre = UIP_SRH_BUF->cmpr & 0x0f;
+  pad = UIP_SRH_BUF->pad >> 4;
+
+  /* All addresses but the last one have 16 - CmprI bytes */
+  size = UIP_RH_BUF->len * 8 - pad - (16 - cmpre);
+  if(size < 0 || size % (16 - cmpri) != 0) {
+    PRINTF("RPL: Malformed source routing header\n");
+    return -1;
+  }
+  n = size / (16 - cmpri) + 1;
+  if(UIP_RH_BUF->seg_left > n) {
+    PRINTF("RPL: Bad segments left in source routing header\n");
+    return -1;
+  }
+
+  /* The next address replaces the destination, of which it shares the
+     first CmprI (or CmprE for the last one) bytes. */
+  i = n - UIP_RH_BUF->seg_left;
+  cmpr = i == n - 1 ? cmpre : cmpri;
+  memcpy(&UIP_IP_BUF->destipaddr.u8[cmpr],
+         UIP_SRH_ADDR_BUF + i * (16 - cmpri), 16 - cmpr);
+  UIP_RH_BUF->seg_left--;
+
+  if(uip_is_addr_mcast(&UIP_IP_BUF->destipaddr) ||
+     uip_ds6_is_my_addr(&UIP_IP_BUF->destipaddr)) {
+    PRINTF("RPL: Loop in source routing header\n");
+    return -1;
+  }
+
+  PRINTF("RPL: Source routing to ");
+  PRINT6ADDR(&UIP_IP_BUF->destipaddr);
+  PRINTF(", %u segments left\n", UIP_RH_BUF->seg_left);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_nexthop(uip_ipaddr_t *nexthop, const uint8_t *iid)
+{
+  uip_ip6addr(nexthop, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+  memcpy(&nexthop->u8[8], iid, 8);
+}
+/*---------------------------------------------------------------------------*/
+/* At the root, source routes a packet to a node of the DAG: the first hop
+   becomes the destination and the following ones, down to the node, go
+   to a routing header. Nodes share the prefix of the DAG, so CmprI and
+   CmprE are 8. */
+static int
+insert_srh(uip_ipaddr_t *nexthop)
+{
+  rpl_dag_t *dag;
+  uint8_t *srh;
+  uint16_t len;
+  int hops;
+
+  if(default_instance == NULL ||
+     default_instance->mop != RPL_MOP_NON_STORING) {
+    return 0;
+  }
+  dag = default_instance->current_dag;
+  if(!dag->joined || dag->rank != ROOT_RANK(default_instance) ||
+     !uip_ipaddr_prefixcmp(&dag->prefix_info.prefix,
+                           &UIP_IP_BUF->destipaddr, 64)) {
+    return 0;
+  }
+
+  hops = rpl_ns_get_route(&UIP_IP_BUF->destipaddr, NULL, RPL_NS_LINK_NUM);
+  if(hops == 0) {
+    PRINTF("RPL: No source route to ");
+    PRINT6ADDR(&UIP_IP_BUF->destipaddr);
+    PRINTF("\n");
+    return 0;
+  }
+  if(hops == 1) {
+    /* A child of the root */
+    set_nexthop(nexthop, &UIP_IP_BUF->destipaddr.u8[8]);
+    return 1;
+  }
+
+  /* Packets going down carry no hop-by-hop option */
+  rpl_remove_header();
+  if(uip_len + hops * 8 > UIP_BUFSIZE - UIP_LLH_LEN) {
+    PRINTF("RPL: Packet too long for a source route of %d hops\n", hops);
+    return -1;
+  }
+
+  /* The interface identifiers of the hops are written from the start of
+     the routing header on: the first one, which the routing header
+     header then overwrites, goes to the destination, and the others are
+     the addresses of the routing header. */
+  srh = &uip_buf[UIP_LLH_LEN + UIP_IPH_LEN];
+  memmove(srh + hops * 8, srh, uip_len - UIP_IPH_LEN);
+  rpl_ns_get_route(&UIP_IP_BUF->destipaddr, srh, hops);
+  memcpy(&UIP_IP_BUF->destipaddr.u8[8], srh, 8);
+  set_nexthop(nexthop, srh);
+
+  UIP_RH_BUF->next = UIP_IP_BUF->proto;
+  UIP_RH_BUF->len = hops - 1;
+  UIP_RH_BUF->routing_type = RPL_RH_TYPE_SRH;
+  UIP_RH_BUF->seg_left = hops - 1;
+  UIP_SRH_BUF->cmpr = (8 << 4) | 8;
+  UIP_SRH_BUF->pad = 0;
+  UIP_SRH_BUF->reserved[0] = 0;
+  UIP_SRH_BUF->reserved[1] = 0;
+
+  UIP_IP_BUF->proto = UIP_PROTO_ROUTING;
+  len = ((uint16_t)UIP_IP_BUF->len[0] << 8) + UIP_IP_BUF->len[1] + hops * 8;
+  UIP_IP_BUF->len[0] = len >> 8;
+  UIP_IP_BUF->len[1] = len & 0xff;
+  uip_len += hops * 8;
+  uip_ext_len = hops * 8;
+
+  PRINTF("RPL: Source routing over %d hops to ", hops);
+  PRINT6ADDR(&UIP_IP_BUF->destipaddr);
+  PRINTF("\n");
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_srh_output(uip_ipaddr_t *nexthop)
+{
+  int last_uip_ext_len;
+
+  if(UIP_IP_BUF->proto == UIP_PROTO_ROUTING) {
+    last_uip_ext_len = uip_ext_len;
+    uip_ext_len = 0;
+    if(UIP_RH_BUF->routing_type == RPL_RH_TYPE_SRH) {
+      /* On the way down, the destination is the next hop */
+      set_nexthop(nexthop, &UIP_IP_BUF->destipaddr.u8[8]);
+      uip_ext_len = last_uip_ext_len;
+      return 1;
+    }
+    uip_ext_len = last_uip_ext_len;
+    return 0;
+  }
+  return insert_srh(nexthop);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* RPL_WITH_NON_STORING */
+
 /** @}*/
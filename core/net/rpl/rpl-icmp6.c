@@ -51,6 +51,7 @@
 #include "net/ipv6/uip-nd6.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/rpl/rpl-private.h"
+#include "net/rpl/rpl-ns.h"
 #include "net/packetbuf.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
 
@@ -75,6 +76,8 @@ static void dis_input(void);
 static void dio_input(void);
 static void dao_input(void);
 static void dao_ack_input(void);
+static int dao_header(rpl_instance_t *instance, rpl_dag_t *dag,
+                      unsigned char *buffer);
 
 /* some debug callbacks useful when debugging RPL networks */
 #ifdef RPL_DEBUG_DIO_INPUT
@@ -575,6 +578,244 @@ dio_output(rpl_instance_t *instance, uip_ipaddr_t *uc_addr)
 #endif /* RPL_LEAF_ONLY */
 }
 /*---------------------------------------------------------------------------*/
+/* What dao_input() does with a target once it is handled */
+#define DAO_TARGET_FORWARD 0x01
+#define DAO_TARGET_ACK     0x02
+
+static int
+dao_input_target(rpl_dag_t *dag, rpl_parent_t *parent,
+                 uip_ipaddr_t *dao_sender_addr, uip_ipaddr_t *prefix,
+                 uint8_t prefixlen, uint8_t lifetime, int learned_from)
+{
+  rpl_instance_t *instance;
+  uip_ds6_route_t *rep;
+  uip_ds6_nbr_t *nbr;
+
+  instance = dag->instance;
+
+#if RPL_CONF_MULTICAST
+  if(uip_is_addr_mcast_global(prefix)) {
+    mcast_group = uip_mcast6_route_add(prefix);
+    if(mcast_group) {
+      mcast_group->dag = dag;
+      mcast_group->lifetime = RPL_LIFETIME(instance, lifetime);
+    }
+    return learned_from == RPL_ROUTE_FROM_UNICAST_DAO ?
+      DAO_TARGET_FORWARD | DAO_TARGET_ACK : 0;
+  }
+#endif
+
+  rep = uip_ds6_route_lookup(prefix);
+
+  if(lifetime == RPL_ZERO_LIFETIME) {
+    PRINTF("RPL: No-Path DAO received\n");
+    /* No-Path DAO received; invoke the route purging routine. */
+    if(rep != NULL &&
+       rep->state.nopath_received == 0 &&
+       rep->length == prefixlen &&
+       uip_ds6_route_nexthop(rep) != NULL &&
+       uip_ipaddr_cmp(uip_ds6_route_nexthop(rep), dao_sender_addr)) {
+      PRINTF("RPL: Setting expiration timer for prefix ");
+      PRINT6ADDR(prefix);
+      PRINTF("\n");
+      rep->state.nopath_received = 1;
+      rep->state.lifetime = DAO_EXPIRATION_TIMEOUT;
+
+      /* We forward the incoming no-path DAO to our parent, if we have
+         one. */
+      return DAO_TARGET_FORWARD | DAO_TARGET_ACK;
+    }
+    return 0;
+  }
+
+  PRINTF("RPL: adding DAO route\n");
+
+  if((nbr = uip_ds6_nbr_lookup(dao_sender_addr)) == NULL) {
+    if((nbr = uip_ds6_nbr_add(dao_sender_addr,
+                              (uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                              0, NBR_REACHABLE)) != NULL) {
+      /* set reachable timer */
+      stimer_set(&nbr->reachable, UIP_ND6_REACHABLE_TIME / 1000);
+      PRINTF("RPL: Neighbor added to neighbor cache ");
+      PRINT6ADDR(dao_sender_addr);
+      PRINTF(", ");
+      PRINTLLADDR((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
+      PRINTF("\n");
+    } else {
+      PRINTF("RPL: Out of Memory, dropping DAO from ");
+      PRINT6ADDR(dao_sender_addr);
+      PRINTF(", ");
+      PRINTLLADDR((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
+      PRINTF("\n");
+      return 0;
+    }
+  } else {
+    PRINTF("RPL: Neighbor already in neighbor cache\n");
+  }
+
+  rpl_lock_parent(parent);
+
+  rep = rpl_add_route(dag, prefix, prefixlen, dao_sender_addr);
+  if(rep == NULL) {
+    RPL_STAT(rpl_stats.mem_overflows++);
+    PRINTF("RPL: Could not add a route after receiving a DAO\n");
+    return 0;
+  }
+
+  rep->state.lifetime = RPL_LIFETIME(instance, lifetime);
+  rep->state.learned_from = learned_from;
+  rep->state.nopath_received = 0;
+
+  return learned_from == RPL_ROUTE_FROM_UNICAST_DAO ?
+    DAO_TARGET_FORWARD | DAO_TARGET_ACK : 0;
+}
+/*---------------------------------------------------------------------------*/
+#if RPL_DAO_AGGREGATION
+/* Lifetime of the first transit option at or after pos */
+static uint8_t
+dao_transit_lifetime(unsigned char *buffer, int pos, int length,
+                     uint8_t lifetime)
+{
+  while(pos < length) {
+    if(buffer[pos] == RPL_OPTION_TRANSIT) {
+      return buffer[pos + 5];
+    }
+    pos += buffer[pos] == RPL_OPTION_PAD1 ? 1 : 2 + buffer[pos + 1];
+  }
+  return lifetime;
+}
+/*---------------------------------------------------------------------------*/
+/* Largest DAO payload that still fits in a packet with an RPL option */
+#define DAO_AGGREGATION_MAX_LEN (MIN(UIP_BUFSIZE - UIP_LLH_LEN, UIP_LINK_MTU) - \
+                                 UIP_IPH_LEN - UIP_ICMPH_LEN - RPL_HOP_BY_HOP_LEN)
+
+struct dao_target {
+  uip_ipaddr_t prefix;
+  uint8_t prefixlen;
+  uint8_t lifetime;
+};
+
+static struct dao_target dao_targets[RPL_DAO_AGGREGATION_TARGETS];
+static uint8_t dao_num_targets;
+static rpl_instance_t *dao_targets_instance;
+static struct ctimer dao_aggregation_timer;
+/*---------------------------------------------------------------------------*/
+static int
+dao_target_option(unsigned char *buffer, struct dao_target *t)
+{
+  int pos;
+
+  pos = 0;
+  buffer[pos++] = RPL_OPTION_TARGET;
+  buffer[pos++] = 2 + ((t->prefixlen + 7) / CHAR_BIT);
+  buffer[pos++] = 0; /* reserved */
+  buffer[pos++] = t->prefixlen;
+  memcpy(buffer + pos, &t->prefix, (t->prefixlen + 7) / CHAR_BIT);
+  return pos + (t->prefixlen + 7) / CHAR_BIT;
+}
+/*---------------------------------------------------------------------------*/
+static void
+dao_aggregation_flush(void *ptr)
+{
+  rpl_instance_t *instance;
+  rpl_dag_t *dag;
+  uip_ipaddr_t *parent_addr;
+  unsigned char *buffer;
+  struct dao_target tmp;
+  uint8_t lifetime;
+  int pos;
+  int i;
+  int j;
+
+  instance = dao_targets_instance;
+  dag = instance != NULL ? instance->current_dag : NULL;
+  parent_addr = NULL;
+  if(dag != NULL && dag->joined && dag->preferred_parent != NULL) {
+    parent_addr = rpl_get_parent_ipaddr(dag->preferred_parent);
+  }
+  if(parent_addr == NULL) {
+    PRINTF("RPL: No parent, dropping %u aggregated DAO targets\n",
+           dao_num_targets);
+    dao_num_targets = 0;
+    return;
+  }
+
+  /* Sort the targets by lifetime so that each group of targets with the
+     same lifetime shares one transit option. */
+  for(i = 1; i < dao_num_targets; i++) {
+    tmp = dao_targets[i];
+    for(j = i; j > 0 && dao_targets[j - 1].lifetime > tmp.lifetime; j--) {
+      dao_targets[j] = dao_targets[j - 1];
+    }
+    dao_targets[j] = tmp;
+  }
+
+  buffer = UIP_ICMP_PAYLOAD;
+  i = 0;
+  while(i < dao_num_targets) {
+    pos = dao_header(instance, dag, buffer);
+    /* Each group needs room for at least one target and its transit */
+    while(i < dao_num_targets &&
+          pos + 4 + 16 + 6 <= DAO_AGGREGATION_MAX_LEN) {
+      lifetime = dao_targets[i].lifetime;
+      do {
+        pos += dao_target_option(buffer + pos, &dao_targets[i++]);
+      } while(i < dao_num_targets && dao_targets[i].lifetime == lifetime &&
+              pos + 4 + 16 + 6 <= DAO_AGGREGATION_MAX_LEN);
+
+      buffer[pos++] = RPL_OPTION_TRANSIT;
+      buffer[pos++] = 4;
+      buffer[pos++] = 0; /* flags - ignored */
+      buffer[pos++] = 0; /* path control - ignored */
+      buffer[pos++] = 0; /* path seq - ignored */
+      buffer[pos++] = lifetime;
+    }
+
+    PRINTF("RPL: Sending aggregated DAO of %u bytes to ", pos);
+    PRINT6ADDR(parent_addr);
+    PRINTF("\n");
+    uip_icmp6_send(parent_addr, ICMP6_RPL, RPL_CODE_DAO, pos);
+  }
+  dao_num_targets = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Hold a target for the next aggregated DAO. Returns 0 if it cannot be
+   held and has to be sent now. */
+static int
+dao_aggregate(rpl_instance_t *instance, uip_ipaddr_t *prefix,
+              uint8_t prefixlen, uint8_t lifetime)
+{
+  struct dao_target *t;
+
+  if(dao_num_targets > 0 && instance != dao_targets_instance) {
+    return 0;
+  }
+
+  for(t = dao_targets; t < dao_targets + dao_num_targets; t++) {
+    if(t->prefixlen == prefixlen && uip_ipaddr_cmp(&t->prefix, prefix)) {
+      t->lifetime = lifetime;
+      return 1;
+    }
+  }
+
+  if(dao_num_targets == RPL_DAO_AGGREGATION_TARGETS) {
+    return 0;
+  }
+
+  t = &dao_targets[dao_num_targets++];
+  uip_ipaddr_copy(&t->prefix, prefix);
+  t->prefixlen = prefixlen;
+  t->lifetime = lifetime;
+  dao_targets_instance = instance;
+
+  if(dao_num_targets == 1) {
+    ctimer_set(&dao_aggregation_timer, RPL_DAO_AGGREGATION_DELAY,
+               dao_aggregation_flush, NULL);
+  }
+  return 1;
+}
+#endif /* RPL_DAO_AGGREGATION */
+/*---------------------------------------------------------------------------*/
 static void
 dao_input(void)
 {
@@ -593,14 +834,20 @@ dao_input(void)
   uint8_t pathsequence;
   */
   uip_ipaddr_t prefix;
-  uip_ds6_route_t *rep;
+#if RPL_WITH_NON_STORING
+  uip_ipaddr_t parent_addr;
+  uint8_t have_parent_addr = 0;
+#endif /* RPL_WITH_NON_STORING */
   uint8_t buffer_length;
   int pos;
   int len;
   int i;
   int learned_from;
+  int result;
+#if RPL_DAO_AGGREGATION
+  int target_result;
+#endif /* RPL_DAO_AGGREGATION */
   rpl_parent_t *parent;
-  uip_ds6_nbr_t *nbr;
 
   prefixlen = 0;
   parent = NULL;
@@ -692,7 +939,13 @@ dao_input(void)
       /*      pathcontrol = buffer[i + 3];
               pathsequence = buffer[i + 4];*/
       lifetime = buffer[i + 5];
-      /* The parent address is also ignored. */
+#if RPL_WITH_NON_STORING
+      /* The parent address is only present in non-storing mode */
+      if(len >= 6 + (int)sizeof(parent_addr)) {
+        memcpy(&parent_addr, buffer + i + 6, sizeof(parent_addr));
+        have_parent_addr = 1;
+      }
+#endif /* RPL_WITH_NON_STORING */
       break;
     }
   }
@@ -702,93 +955,57 @@ dao_input(void)
   PRINT6ADDR(&prefix);
   PRINTF("\n");
 
-#if RPL_CONF_MULTICAST
-  if(uip_is_addr_mcast_global(&prefix)) {
-    mcast_group = uip_mcast6_route_add(&prefix);
-    if(mcast_group) {
-      mcast_group->dag = dag;
-      mcast_group->lifetime = RPL_LIFETIME(instance, lifetime);
+#if RPL_WITH_NON_STORING
+  if(instance->mop == RPL_MOP_NON_STORING) {
+    /* DAOs go to the root, which only learns the parent of the sender */
+    if(dag->rank != ROOT_RANK(instance) || !have_parent_addr) {
+      PRINTF("RPL: Ignoring a non-storing DAO\n");
+      return;
     }
-    goto fwd_dao;
-  }
-#endif
-
-  rep = uip_ds6_route_lookup(&prefix);
-
-  if(lifetime == RPL_ZERO_LIFETIME) {
-    PRINTF("RPL: No-Path DAO received\n");
-    /* No-Path DAO received; invoke the route purging routine. */
-    if(rep != NULL &&
-       rep->state.nopath_received == 0 &&
-       rep->length == prefixlen &&
-       uip_ds6_route_nexthop(rep) != NULL &&
-       uip_ipaddr_cmp(uip_ds6_route_nexthop(rep), &dao_sender_addr)) {
-      PRINTF("RPL: Setting expiration timer for prefix ");
-      PRINT6ADDR(&prefix);
-      PRINTF("\n");
-      rep->state.nopath_received = 1;
-      rep->state.lifetime = DAO_EXPIRATION_TIMEOUT;
-
-      /* We forward the incoming no-path DAO to our parent, if we have
-         one. */
-      if(dag->preferred_parent != NULL &&
-         rpl_get_parent_ipaddr(dag->preferred_parent) != NULL) {
-        PRINTF("RPL: Forwarding no-path DAO to parent ");
-        PRINT6ADDR(rpl_get_parent_ipaddr(dag->preferred_parent));
-        PRINTF("\n");
-        uip_icmp6_send(rpl_get_parent_ipaddr(dag->preferred_parent),
-                       ICMP6_RPL, RPL_CODE_DAO, buffer_length);
-      }
-      if(flags & RPL_DAO_K_FLAG) {
-        dao_ack_output(instance, &dao_sender_addr, sequence);
-      }
+    if(!rpl_ns_update_node(&prefix, &parent_addr,
+                           RPL_LIFETIME(instance, lifetime))) {
+      RPL_STAT(rpl_stats.mem_overflows++);
+      PRINTF("RPL: Could not add a node after receiving a DAO\n");
+      return;
+    }
+    if(flags & RPL_DAO_K_FLAG) {
+      dao_ack_output(instance, &dao_sender_addr, sequence);
     }
     return;
   }
+#endif /* RPL_WITH_NON_STORING */
 
-  PRINTF("RPL: adding DAO route\n");
-
-  if((nbr = uip_ds6_nbr_lookup(&dao_sender_addr)) == NULL) {
-    if((nbr = uip_ds6_nbr_add(&dao_sender_addr,
-                              (uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER),
-                              0, NBR_REACHABLE)) != NULL) {
-      /* set reachable timer */
-      stimer_set(&nbr->reachable, UIP_ND6_REACHABLE_TIME / 1000);
-      PRINTF("RPL: Neighbor added to neighbor cache ");
-      PRINT6ADDR(&dao_sender_addr);
-      PRINTF(", ");
-      PRINTLLADDR((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
-      PRINTF("\n");
-    } else {
-      PRINTF("RPL: Out of Memory, dropping DAO from ");
-      PRINT6ADDR(&dao_sender_addr);
-      PRINTF(", ");
-      PRINTLLADDR((uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_SENDER));
-      PRINTF("\n");
-      return;
+#if RPL_DAO_AGGREGATION
+  /* Handle every target; each takes the lifetime of the transit option
+     that follows it. */
+  result = 0;
+  for(i = pos; i < buffer_length; i += len) {
+    len = buffer[i] == RPL_OPTION_PAD1 ? 1 : 2 + buffer[i + 1];
+    if(buffer[i] != RPL_OPTION_TARGET || buffer[i + 3] > 128) {
+      continue;
+    }
+    prefixlen = buffer[i + 3];
+    memset(&prefix, 0, sizeof(prefix));
+    memcpy(&prefix, buffer + i + 4, (prefixlen + 7) / CHAR_BIT);
+    lifetime = dao_transit_lifetime(buffer, i + len, buffer_length,
+                                    instance->default_lifetime);
+
+    target_result = dao_input_target(dag, parent, &dao_sender_addr,
+                                     &prefix, prefixlen, lifetime,
+                                     learned_from);
+    result |= target_result & DAO_TARGET_ACK;
+    if((target_result & DAO_TARGET_FORWARD) &&
+       !dao_aggregate(instance, &prefix, prefixlen, lifetime)) {
+      /* No room to hold the target; pass the DAO on as it is */
+      result |= DAO_TARGET_FORWARD;
     }
-  } else {
-    PRINTF("RPL: Neighbor already in neighbor cache\n");
-  }
-
-  rpl_lock_parent(parent);
-
-  rep = rpl_add_route(dag, &prefix, prefixlen, &dao_sender_addr);
-  if(rep == NULL) {
-    RPL_STAT(rpl_stats.mem_overflows++);
-    PRINTF("RPL: Could not add a route after receiving a DAO\n");
-    return;
   }
+#else /* RPL_DAO_AGGREGATION */
+  result = dao_input_target(dag, parent, &dao_sender_addr, &prefix,
+                            prefixlen, lifetime, learned_from);
+#endif /* RPL_DAO_AGGREGATION */
 
-  rep->state.lifetime = RPL_LIFETIME(instance, lifetime);
-  rep->state.learned_from = learned_from;
-  rep->state.nopath_received = 0;
-
-#if RPL_CONF_MULTICAST
-fwd_dao:
-#endif
-
-  if(learned_from == RPL_ROUTE_FROM_UNICAST_DAO) {
+  if(result & DAO_TARGET_FORWARD) {
     if(dag->preferred_parent != NULL &&
        rpl_get_parent_ipaddr(dag->preferred_parent) != NULL) {
       PRINTF("RPL: Forwarding DAO to parent ");
@@ -797,13 +1014,39 @@ fwd_dao:
       uip_icmp6_send(rpl_get_parent_ipaddr(dag->preferred_parent),
                      ICMP6_RPL, RPL_CODE_DAO, buffer_length);
     }
-    if(flags & RPL_DAO_K_FLAG) {
-      dao_ack_output(instance, &dao_sender_addr, sequence);
-    }
+  }
+  if((result & DAO_TARGET_ACK) && (flags & RPL_DAO_K_FLAG)) {
+    dao_ack_output(instance, &dao_sender_addr, sequence);
   }
   uip_len = 0;
 }
 /*---------------------------------------------------------------------------*/
+static int
+dao_header(rpl_instance_t *instance, rpl_dag_t *dag, unsigned char *buffer)
+{
+  int pos;
+
+  RPL_LOLLIPOP_INCREMENT(dao_sequence);
+  pos = 0;
+
+  buffer[pos++] = instance->instance_id;
+  buffer[pos] = 0;
+#if RPL_DAO_SPECIFY_DAG
+  buffer[pos] |= RPL_DAO_D_FLAG;
+#endif /* RPL_DAO_SPECIFY_DAG */
+#if RPL_CONF_DAO_ACK
+  buffer[pos] |= RPL_DAO_K_FLAG;
+#endif /* RPL_CONF_DAO_ACK */
+  ++pos;
+  buffer[pos++] = 0; /* reserved */
+  buffer[pos++] = dao_sequence;
+#if RPL_DAO_SPECIFY_DAG
+  memcpy(buffer + pos, &dag->dag_id, sizeof(dag->dag_id));
+  pos+=sizeof(dag->dag_id);
+#endif /* RPL_DAO_SPECIFY_DAG */
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
 void
 dao_output(rpl_parent_t *parent, uint8_t lifetime)
 {
@@ -860,26 +1103,17 @@ dao_output_target(rpl_parent_t *parent, uip_ipaddr_t *prefix, uint8_t lifetime)
   RPL_DEBUG_DAO_OUTPUT(parent);
 #endif
 
-  buffer = UIP_ICMP_PAYLOAD;
-
-  RPL_LOLLIPOP_INCREMENT(dao_sequence);
-  pos = 0;
+#if RPL_DAO_AGGREGATION
+  if(instance->mop != RPL_MOP_NON_STORING &&
+     lifetime != RPL_ZERO_LIFETIME && parent == dag->preferred_parent &&
+     dao_aggregate(instance, prefix, sizeof(*prefix) * CHAR_BIT, lifetime)) {
+    PRINTF("RPL: Holding own DAO target for aggregation\n");
+    return;
+  }
+#endif /* RPL_DAO_AGGREGATION */
 
-  buffer[pos++] = instance->instance_id;
-  buffer[pos] = 0;
-#if RPL_DAO_SPECIFY_DAG
-  buffer[pos] |= RPL_DAO_D_FLAG;
-#endif /* RPL_DAO_SPECIFY_DAG */
-#if RPL_CONF_DAO_ACK
-  buffer[pos] |= RPL_DAO_K_FLAG;
-#endif /* RPL_CONF_DAO_ACK */
-  ++pos;
-  buffer[pos++] = 0; /* reserved */
-  buffer[pos++] = dao_sequence;
-#if RPL_DAO_SPECIFY_DAG
-  memcpy(buffer + pos, &dag->dag_id, sizeof(dag->dag_id));
-  pos+=sizeof(dag->dag_id);
-#endif /* RPL_DAO_SPECIFY_DAG */
+  buffer = UIP_ICMP_PAYLOAD;
+  pos = dao_header(instance, dag, buffer);
 
   /* create target subopt */
   prefixlen = sizeof(*prefix) * CHAR_BIT;
@@ -892,12 +1126,38 @@ dao_output_target(rpl_parent_t *parent, uip_ipaddr_t *prefix, uint8_t lifetime)
 
   /* Create a transit information sub-option. */
   buffer[pos++] = RPL_OPTION_TRANSIT;
+#if RPL_WITH_NON_STORING
+  buffer[pos++] = instance->mop == RPL_MOP_NON_STORING ? 4 + 16 : 4;
+#else
   buffer[pos++] = 4;
+#endif /* RPL_WITH_NON_STORING */
   buffer[pos++] = 0; /* flags - ignored */
   buffer[pos++] = 0; /* path control - ignored */
   buffer[pos++] = 0; /* path seq - ignored */
   buffer[pos++] = lifetime;
 
+#if RPL_WITH_NON_STORING
+  if(instance->mop == RPL_MOP_NON_STORING) {
+    /* In non-storing mode, the DAO goes to the root and carries the
+       global address of the parent. */
+    if(rpl_get_parent_ipaddr(parent) == NULL) {
+      return;
+    }
+    memcpy(buffer + pos, &dag->prefix_info.prefix, 8);
+    memcpy(buffer + pos + 8, &rpl_get_parent_ipaddr(parent)->u8[8], 8);
+    pos += 16;
+
+    PRINTF("RPL: Sending non-storing DAO with prefix ");
+    PRINT6ADDR(prefix);
+    PRINTF(" to ");
+    PRINT6ADDR(&dag->dag_id);
+    PRINTF("\n");
+
+    uip_icmp6_send(&dag->dag_id, ICMP6_RPL, RPL_CODE_DAO, pos);
+    return;
+  }
+#endif /* RPL_WITH_NON_STORING */
+
   PRINTF("RPL: Sending DAO with prefix ");
   PRINT6ADDR(prefix);
   PRINTF(" to ");
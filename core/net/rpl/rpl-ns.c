@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Node table of the DAG root in RPL non-storing mode.
+ */
+
+/**
+ * \addtogroup uip6
+ * @{
+ */
+
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/rpl/rpl-private.h"
+#include "net/rpl/rpl-ns.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+#include <string.h>
+
+#if RPL_WITH_NON_STORING
+
+/* A node whose lifetime is 0 is unused */
+static rpl_ns_node_t nodes[RPL_NS_LINK_NUM];
+/*---------------------------------------------------------------------------*/
+static rpl_ns_node_t *
+find_node(const uip_ipaddr_t *addr)
+{
+  rpl_ns_node_t *n;
+
+  for(n = nodes; n < nodes + RPL_NS_LINK_NUM; n++) {
+    if(n->lifetime > 0 && memcmp(n->iid, &addr->u8[8], sizeof(n->iid)) == 0) {
+      return n;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static rpl_ns_node_t *
+add_node(const uip_ipaddr_t *addr, uint32_t lifetime)
+{
+  rpl_ns_node_t *n;
+
+  for(n = nodes; n < nodes + RPL_NS_LINK_NUM; n++) {
+    if(n->lifetime == 0) {
+      memcpy(n->iid, &addr->u8[8], sizeof(n->iid));
+      n->lifetime = lifetime;
+      n->parent = RPL_NS_PARENT_NONE;
+      return n;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_node(rpl_ns_node_t *node)
+{
+  rpl_ns_node_t *n;
+  uint16_t index = node - nodes;
+
+  PRINTF("RPL-NS: Removing node %u\n", index);
+  node->lifetime = 0;
+  /* The children of the node are unreachable until they send a DAO */
+  for(n = nodes; n < nodes + RPL_NS_LINK_NUM; n++) {
+    if(n->parent == index) {
+      n->parent = RPL_NS_PARENT_NONE;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_ns_init(void)
+{
+  memset(nodes, 0, sizeof(nodes));
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_ns_update_node(const uip_ipaddr_t *child, const uip_ipaddr_t *parent,
+                   uint32_t lifetime)
+{
+  rpl_ns_node_t *c, *p;
+
+  c = find_node(child);
+  if(lifetime == 0) {
+    if(c != NULL) {
+      remove_node(c);
+    }
+    return 1;
+  }
+
+  if(c == NULL) {
+    c = add_node(child, lifetime);
+    if(c == NULL) {
+      PRINTF("RPL-NS: Node table full\n");
+      return 0;
+    }
+  }
+  c->lifetime = lifetime;
+
+  if(uip_ds6_is_my_addr((uip_ipaddr_t *)parent)) {
+    c->parent = RPL_NS_PARENT_ROOT;
+    return 1;
+  }
+
+  /* A parent that has not sent its own DAO yet gets a placeholder, with
+     the lifetime of its child and no parent. */
+  p = find_node(parent);
+  if(p == NULL) {
+    p = add_node(parent, lifetime);
+  }
+  if(p == NULL || p == c) {
+    c->parent = RPL_NS_PARENT_NONE;
+    return p != NULL;
+  }
+  c->parent = p - nodes;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_ns_get_route(const uip_ipaddr_t *dest, uint8_t *route, int max)
+{
+  rpl_ns_node_t *n;
+  int hops;
+
+  /* Walk up to the root to count the hops */
+  hops = 0;
+  for(n = find_node(dest); n != NULL && n->parent != RPL_NS_PARENT_ROOT;
+      n = n->parent == RPL_NS_PARENT_NONE ? NULL : &nodes[n->parent]) {
+    if(++hops >= max) {
+      /* Too long, or a loop in the parent pointers */
+      return 0;
+    }
+  }
+  if(n == NULL) {
+    return 0;
+  }
+  hops++;
+
+  if(route != NULL) {
+    /* Walk up again, filling the route from its end */
+    route += hops * sizeof(n->iid);
+    for(n = find_node(dest); n != NULL && n->parent != RPL_NS_PARENT_ROOT;
+        n = &nodes[n->parent]) {
+      route -= sizeof(n->iid);
+      memcpy(route, n->iid, sizeof(n->iid));
+    }
+    memcpy(route - sizeof(n->iid), n->iid, sizeof(n->iid));
+  }
+  return hops;
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_ns_num_nodes(void)
+{
+  rpl_ns_node_t *n;
+  int num = 0;
+
+  for(n = nodes; n < nodes + RPL_NS_LINK_NUM; n++) {
+    if(n->lifetime > 0) {
+      num++;
+    }
+  }
+  return num;
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_ns_periodic(void)
+{
+  rpl_ns_node_t *n;
+
+  for(n = nodes; n < nodes + RPL_NS_LINK_NUM; n++) {
+    if(n->lifetime == 1) {
+      remove_node(n);
+    } else if(n->lifetime > 1) {
+      n->lifetime--;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+#endif /* RPL_WITH_NON_STORING */
+
+/** @}*/
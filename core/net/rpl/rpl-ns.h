@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Node table of the DAG root in RPL non-storing mode: the parent
+ *         of every node, as announced in its DAO.
+ */
+
+#ifndef RPL_NS_H_
+#define RPL_NS_H_
+
+#include "net/rpl/rpl-conf.h"
+#include "net/ip/uip.h"
+
+/* Nodes share the prefix of the DAG, so only their interface identifier is
+   kept. The parent is an index in the table. */
+struct rpl_ns_node {
+  uint8_t iid[8];
+  uint32_t lifetime;
+  uint16_t parent;
+};
+typedef struct rpl_ns_node rpl_ns_node_t;
+
+/* Values of the parent index that do not refer to a node */
+#define RPL_NS_PARENT_ROOT 0xfffe
+#define RPL_NS_PARENT_NONE 0xffff
+
+void rpl_ns_init(void);
+
+/**
+ * \brief  Records the parent of a node, as announced in a DAO to the root.
+ * \param child    Global address of the node
+ * \param parent   Global address of its parent
+ * \param lifetime Lifetime in seconds, 0 removes the node
+ * \return 1 on success, 0 if the table is full
+ */
+int rpl_ns_update_node(const uip_ipaddr_t *child, const uip_ipaddr_t *parent,
+                       uint32_t lifetime);
+
+/**
+ * \brief  Computes the source route from the root to a node.
+ * \param dest  Address of the node
+ * \param route Filled with the interface identifiers of the hops, 8 bytes
+ *              each, the first hop first and the node itself last. May be
+ *              NULL to only count the hops.
+ * \param max   Maximum number of hops
+ * \return The number of hops, or 0 if no route of at most max hops to the
+ *         node is known
+ */
+int rpl_ns_get_route(const uip_ipaddr_t *dest, uint8_t *route, int max);
+
+/**
+ * \brief  Returns the number of nodes in the table.
+ */
+int rpl_ns_num_nodes(void);
+
+/**
+ * \brief  Ages the table, called once per second.
+ */
+void rpl_ns_periodic(void);
+
+#endif /* RPL_NS_H_ */
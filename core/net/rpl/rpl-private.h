@@ -100,6 +100,9 @@
 #define RPL_HDR_OPT_RANK_ERR_SHIFT   	6
 #define RPL_HDR_OPT_FWD_ERR		0x20
 #define RPL_HDR_OPT_FWD_ERR_SHIFT   	5
+
+/* RPL source routing header. */
+#define RPL_RH_TYPE_SRH                 3
 /*---------------------------------------------------------------------------*/
 /* Default values for RPL constants and variables. */
 
@@ -156,7 +159,9 @@
 #ifdef  RPL_CONF_MOP
 #define RPL_MOP_DEFAULT                 RPL_CONF_MOP
 #else /* RPL_CONF_MOP */
-#if RPL_CONF_MULTICAST
+#if RPL_WITH_NON_STORING
+#define RPL_MOP_DEFAULT                 RPL_MOP_NON_STORING
+#elif RPL_CONF_MULTICAST
 #define RPL_MOP_DEFAULT                 RPL_MOP_STORING_MULTICAST
 #else
 #define RPL_MOP_DEFAULT                 RPL_MOP_STORING_NO_MULTICAST
@@ -295,6 +300,9 @@ void rpl_move_parent(rpl_dag_t *dag_src, rpl_dag_t *dag_dst, rpl_parent_t *paren
 rpl_parent_t *rpl_select_parent(rpl_dag_t *dag);
 rpl_dag_t *rpl_select_dag(rpl_instance_t *instance,rpl_parent_t *parent);
 void rpl_recalculate_ranks(void);
+#if RPL_MULTIPATH
+int rpl_multipath_parent(rpl_parent_t *p);
+#endif /* RPL_MULTIPATH */
 
 /* RPL routing table functions. */
 void rpl_remove_routes(rpl_dag_t *dag);
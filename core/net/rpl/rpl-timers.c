@@ -43,6 +43,7 @@
 
 #include "contiki-conf.h"
 #include "net/rpl/rpl-private.h"
+#include "net/rpl/rpl-ns.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
 #include "lib/random.h"
 #include "sys/ctimer.h"
@@ -67,6 +68,9 @@ static void
 handle_periodic_timer(void *ptr)
 {
   rpl_purge_routes();
+#if RPL_WITH_NON_STORING
+  rpl_ns_periodic();
+#endif /* RPL_WITH_NON_STORING */
   rpl_recalculate_ranks();
 
   /* handle DIS */
@@ -47,6 +47,7 @@
 #include "net/ipv6/uip-ds6.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/rpl/rpl-private.h"
+#include "net/rpl/rpl-ns.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
 
 #define DEBUG DEBUG_NONE
@@ -261,6 +262,15 @@ rpl_link_neighbor_callback(const linkaddr_t *addr, int status, int numtx)
         /* Trigger DAG rank recalculation. */
         PRINTF("RPL: rpl_link_neighbor_callback triggering update\n");
         parent->flags |= RPL_PARENT_FLAG_UPDATED;
+#if RPL_MULTIPATH
+        /* Fail over to the other parents as soon as a link breaks,
+           without waiting for the rank to be recalculated. */
+        if(status == MAC_TX_NOACK) {
+          parent->flags |= RPL_PARENT_FLAG_LINK_FAILED;
+        } else if(status == MAC_TX_OK) {
+          parent->flags &= ~RPL_PARENT_FLAG_LINK_FAILED;
+        }
+#endif /* RPL_MULTIPATH */
         if(instance->of->neighbor_link_callback != NULL) {
           instance->of->neighbor_link_callback(parent, status, numtx);
           parent->last_tx_time = clock_time();
@@ -301,6 +311,9 @@ rpl_init(void)
   default_instance = NULL;
 
   rpl_dag_init();
+#if RPL_WITH_NON_STORING
+  rpl_ns_init();
+#endif /* RPL_WITH_NON_STORING */
   rpl_reset_periodic_timer();
   rpl_icmp6_register_handlers();
 
@@ -106,6 +106,7 @@ struct rpl_dag;
 /*---------------------------------------------------------------------------*/
 #define RPL_PARENT_FLAG_UPDATED           0x1
 #define RPL_PARENT_FLAG_LINK_METRIC_VALID 0x2
+#define RPL_PARENT_FLAG_LINK_FAILED       0x4
 
 struct rpl_parent {
   struct rpl_parent *next;
@@ -117,6 +118,9 @@ struct rpl_parent {
   clock_time_t last_tx_time;
   uint8_t dtsn;
   uint8_t flags;
+#if RPL_MULTIPATH
+  int16_t credit;
+#endif /* RPL_MULTIPATH */
 };
 typedef struct rpl_parent rpl_parent_t;
 /*---------------------------------------------------------------------------*/
@@ -246,12 +250,19 @@ rpl_instance_t *rpl_get_instance(uint8_t instance_id);
 int rpl_update_header_empty(void);
 int rpl_update_header_final(uip_ipaddr_t *addr);
 int rpl_verify_header(int);
+#if RPL_WITH_NON_STORING
+int rpl_process_srh_header(void);
+int rpl_srh_output(uip_ipaddr_t *nexthop);
+#endif /* RPL_WITH_NON_STORING */
 void rpl_insert_header(void);
 void rpl_remove_header(void);
 uint8_t rpl_invert_header(void);
 uip_ipaddr_t *rpl_get_parent_ipaddr(rpl_parent_t *nbr);
 rpl_parent_t *rpl_get_parent(uip_lladdr_t *addr);
 rpl_rank_t rpl_get_parent_rank(uip_lladdr_t *addr);
+#if RPL_MULTIPATH
+uip_ipaddr_t *rpl_multipath_nexthop(void);
+#endif /* RPL_MULTIPATH */
 uint16_t rpl_get_parent_link_metric(const uip_lladdr_t *addr);
 void rpl_dag_init(void);
 uip_ds6_nbr_t *rpl_get_nbr(rpl_parent_t *parent);
@@ -52,7 +52,138 @@
 static struct etimer *timerlist;
 static clock_time_t next_expiration;
 
+#if ETIMER_CONF_HEAP
+static struct etimer *heap[ETIMER_CONF_HEAP_SIZE];
+static uint16_t heap_size;
+/* Reference time for ordering the heap, set before each operation. */
+static clock_time_t heap_now;
+#define HEAP_EMPTY() (heap_size == 0)
+#else /* ETIMER_CONF_HEAP */
+#define HEAP_EMPTY() 1
+#endif /* ETIMER_CONF_HEAP */
+
 PROCESS(etimer_process, "Event timer");
+#if ETIMER_CONF_HEAP
+/*---------------------------------------------------------------------------*/
+/*
+ * Time left until the timer expires, or zero if it already has. The
+ * order of two timers by this value never changes as time passes, so
+ * the heap stays valid between operations, also across clock wraps.
+ */
+static clock_time_t
+remaining(struct etimer *t)
+{
+  clock_time_t passed;
+
+  passed = heap_now - t->timer.start;
+  if(passed >= t->timer.interval) {
+    return 0;
+  }
+  return t->timer.interval - passed;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_place(struct etimer *t, uint16_t i)
+{
+  heap[i] = t;
+  t->heap_index = i + 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+sift_up(uint16_t i)
+{
+  struct etimer *t;
+  clock_time_t r;
+  uint16_t parent;
+
+  t = heap[i];
+  r = remaining(t);
+  while(i > 0) {
+    parent = (i - 1) / 2;
+    if(remaining(heap[parent]) <= r) {
+      break;
+    }
+    heap_place(heap[parent], i);
+    i = parent;
+  }
+  heap_place(t, i);
+}
+/*---------------------------------------------------------------------------*/
+static void
+sift_down(uint16_t i)
+{
+  struct etimer *t;
+  clock_time_t r;
+  uint16_t child;
+
+  t = heap[i];
+  r = remaining(t);
+  while((child = 2 * i + 1) < heap_size) {
+    if(child + 1 < heap_size &&
+       remaining(heap[child + 1]) < remaining(heap[child])) {
+      child++;
+    }
+    if(r <= remaining(heap[child])) {
+      break;
+    }
+    heap_place(heap[child], i);
+    i = child;
+  }
+  heap_place(t, i);
+}
+/*---------------------------------------------------------------------------*/
+/* Restore the heap order after the key of the timer at i changed. */
+static void
+heap_fix(uint16_t i)
+{
+  if(i > 0 && remaining(heap[i]) < remaining(heap[(i - 1) / 2])) {
+    sift_up(i);
+  } else {
+    sift_down(i);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+heap_contains(struct etimer *t)
+{
+  return t->heap_index > 0 && t->heap_index <= heap_size &&
+    heap[t->heap_index - 1] == t;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_remove(struct etimer *t)
+{
+  uint16_t i;
+
+  i = t->heap_index - 1;
+  t->heap_index = 0;
+  heap_size--;
+  if(i < heap_size) {
+    heap_place(heap[heap_size], i);
+    heap_fix(i);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_remove_process(struct process *p)
+{
+  uint16_t i, j;
+
+  /* Compact the array and build the heap again, which is linear in
+     the number of timers. */
+  for(i = j = 0; i < heap_size; i++) {
+    if(heap[i]->p == p) {
+      heap[i]->heap_index = 0;
+    } else {
+      heap_place(heap[i], j++);
+    }
+  }
+  heap_size = j;
+  for(i = heap_size / 2; i > 0; i--) {
+    sift_down(i - 1);
+  }
+}
+#endif /* ETIMER_CONF_HEAP */
 /*---------------------------------------------------------------------------*/
 static void
 update_time(void)
@@ -61,14 +192,25 @@ update_time(void)
   clock_time_t now;
   struct etimer *t;
 
-  if (timerlist == NULL) {
+  if (timerlist == NULL && HEAP_EMPTY()) {
     next_expiration = 0;
   } else {
     now = clock_time();
     t = timerlist;
-    /* Must calculate distance to next time into account due to wraps */
-    tdist = t->timer.start + t->timer.interval - now;
-    for(t = t->next; t != NULL; t = t->next) {
+#if ETIMER_CONF_HEAP
+    if(heap_size > 0) {
+      /* The first timer to expire is at the root of the heap, only
+         the timers that did not fit into it must be scanned. */
+      heap_now = now;
+      tdist = remaining(heap[0]);
+    } else
+#endif /* ETIMER_CONF_HEAP */
+    {
+      /* Must calculate distance to next time into account due to wraps */
+      tdist = t->timer.start + t->timer.interval - now;
+      t = t->next;
+    }
+    for(; t != NULL; t = t->next) {
       if(t->timer.start + t->timer.interval - now < tdist) {
 	tdist = t->timer.start + t->timer.interval - now;
       }
@@ -84,6 +226,9 @@ PROCESS_THREAD(etimer_process, ev, data)
   PROCESS_BEGIN();
 
   timerlist = NULL;
+#if ETIMER_CONF_HEAP
+  heap_size = 0;
+#endif /* ETIMER_CONF_HEAP */
   
   while(1) {
     PROCESS_YIELD();
@@ -91,6 +236,12 @@ PROCESS_THREAD(etimer_process, ev, data)
     if(ev == PROCESS_EVENT_EXITED) {
       struct process *p = data;
 
+#if ETIMER_CONF_HEAP
+      heap_now = clock_time();
+      heap_remove_process(p);
+      update_time();
+#endif /* ETIMER_CONF_HEAP */
+
       while(timerlist != NULL && timerlist->p == p) {
 	timerlist = timerlist->next;
       }
@@ -109,6 +260,21 @@ PROCESS_THREAD(etimer_process, ev, data)
       continue;
     }
 
+#if ETIMER_CONF_HEAP
+    /* Expire all timers at the top of the heap in one go. */
+    heap_now = clock_time();
+    while(heap_size > 0 && remaining(heap[0]) == 0) {
+      t = heap[0];
+      if(process_post(t->p, PROCESS_EVENT_TIMER, t) != PROCESS_ERR_OK) {
+        etimer_request_poll();
+        break;
+      }
+      heap_remove(t);
+      t->p = PROCESS_NONE;
+    }
+    update_time();
+#endif /* ETIMER_CONF_HEAP */
+
   again:
     
     u = NULL;
@@ -154,6 +320,17 @@ add_timer(struct etimer *timer)
 
   etimer_request_poll();
 
+#if ETIMER_CONF_HEAP
+  heap_now = clock_time();
+  if(timer->p != PROCESS_NONE && heap_contains(timer)) {
+    /* Timer already in the heap, move it to its new position. */
+    timer->p = PROCESS_CURRENT();
+    heap_fix(timer->heap_index - 1);
+    update_time();
+    return;
+  }
+#endif /* ETIMER_CONF_HEAP */
+
   if(timer->p != PROCESS_NONE) {
     for(t = timerlist; t != NULL; t = t->next) {
       if(t == timer) {
@@ -167,6 +344,15 @@ add_timer(struct etimer *timer)
 
   /* Timer not on list. */
   timer->p = PROCESS_CURRENT();
+#if ETIMER_CONF_HEAP
+  if(heap_size < ETIMER_CONF_HEAP_SIZE) {
+    heap_place(timer, heap_size++);
+    sift_up(heap_size - 1);
+    update_time();
+    return;
+  }
+  timer->heap_index = 0;
+#endif /* ETIMER_CONF_HEAP */
   timer->next = timerlist;
   timerlist = timer;
 
@@ -198,6 +384,12 @@ void
 etimer_adjust(struct etimer *et, int timediff)
 {
   et->timer.start += timediff;
+#if ETIMER_CONF_HEAP
+  if(et->p != PROCESS_NONE && heap_contains(et)) {
+    heap_now = clock_time();
+    heap_fix(et->heap_index - 1);
+  }
+#endif /* ETIMER_CONF_HEAP */
   update_time();
 }
 /*---------------------------------------------------------------------------*/
@@ -222,7 +414,7 @@ etimer_start_time(struct etimer *et)
 int
 etimer_pending(void)
 {
-  return timerlist != NULL;
+  return timerlist != NULL || !HEAP_EMPTY();
 }
 /*---------------------------------------------------------------------------*/
 clock_time_t
@@ -236,6 +428,16 @@ etimer_stop(struct etimer *et)
 {
   struct etimer *t;
 
+#if ETIMER_CONF_HEAP
+  if(et->p != PROCESS_NONE && heap_contains(et)) {
+    heap_now = clock_time();
+    heap_remove(et);
+    update_time();
+    et->p = PROCESS_NONE;
+    return;
+  }
+#endif /* ETIMER_CONF_HEAP */
+
   /* First check if et is the first event timer on the list. */
   if(et == timerlist) {
     timerlist = timerlist->next;
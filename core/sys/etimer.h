@@ -65,6 +65,24 @@
 #include "sys/timer.h"
 #include "sys/process.h"
 
+/*
+ * With ETIMER_CONF_HEAP enabled, pending event timers are kept in a
+ * binary min-heap ordered by expiration time instead of an unsorted
+ * list. Setting and stopping a timer then costs O(log n) and the next
+ * expiration time is read from the root of the heap. The heap holds
+ * up to ETIMER_CONF_HEAP_SIZE timers; further timers are kept in the
+ * unsorted list and scanned as before.
+ */
+#ifndef ETIMER_CONF_HEAP
+#define ETIMER_CONF_HEAP 0
+#endif /* ETIMER_CONF_HEAP */
+
+#if ETIMER_CONF_HEAP
+#ifndef ETIMER_CONF_HEAP_SIZE
+#define ETIMER_CONF_HEAP_SIZE 32
+#endif /* ETIMER_CONF_HEAP_SIZE */
+#endif /* ETIMER_CONF_HEAP */
+
 /**
  * A timer.
  *
@@ -77,6 +95,9 @@ struct etimer {
   struct timer timer;
   struct etimer *next;
   struct process *p;
+#if ETIMER_CONF_HEAP
+  uint16_t heap_index; /* Position in the heap + 1, 0 if not in it */
+#endif /* ETIMER_CONF_HEAP */
 };
 
 /**
@@ -65,8 +65,34 @@ struct event_data {
   struct process *p;
 };
 
+#if PROCESS_CONF_PRIORITY_QUEUES
+#if PROCESS_NUMPRIOS * PROCESS_CONF_PRIO_NUMEVENTS > 255
+#error "Too many queued events for process_num_events_t"
+#endif
+
+/*
+ * One ring of events per priority level. Bit n of prio_mask is set
+ * while the ring of priority n holds events, so the next event to
+ * dispatch is found by looking up the lowest set bit.
+ */
+static process_num_events_t nevents;
+static process_num_events_t fevents[PROCESS_NUMPRIOS];
+static process_num_events_t prio_nevents[PROCESS_NUMPRIOS];
+static struct event_data events[PROCESS_NUMPRIOS][PROCESS_CONF_PRIO_NUMEVENTS];
+static unsigned char prio_mask;
+
+/* Index of the lowest set bit in a nibble. */
+static const unsigned char lowest_bit[16] = {
+  0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0
+};
+#else /* PROCESS_CONF_PRIORITY_QUEUES */
 static process_num_events_t nevents, fevent;
 static struct event_data events[PROCESS_CONF_NUMEVENTS];
+#endif /* PROCESS_CONF_PRIORITY_QUEUES */
+
+#if PROCESS_CONF_SUBSCRIPTIONS
+static struct process_subscription *subscriptions;
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
 
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
@@ -157,6 +183,21 @@ exit_process(struct process *p, struct process *fromprocess)
     }
   }
 
+#if PROCESS_CONF_SUBSCRIPTIONS
+  {
+    struct process_subscription **s;
+
+    /* Drop the broadcast subscriptions of the exiting process. */
+    for(s = &subscriptions; *s != NULL;) {
+      if((*s)->p == p) {
+        *s = (*s)->next;
+      } else {
+        s = &(*s)->next;
+      }
+    }
+  }
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+
   if(p == process_list) {
     process_list = process_list->next;
   } else {
@@ -209,7 +250,22 @@ process_init(void)
 {
   lastevent = PROCESS_EVENT_MAX;
 
+#if PROCESS_CONF_PRIORITY_QUEUES
+  {
+    unsigned char i;
+
+    for(i = 0; i < PROCESS_NUMPRIOS; i++) {
+      fevents[i] = prio_nevents[i] = 0;
+    }
+    nevents = 0;
+    prio_mask = 0;
+  }
+#else /* PROCESS_CONF_PRIORITY_QUEUES */
   nevents = fevent = 0;
+#endif /* PROCESS_CONF_PRIORITY_QUEUES */
+#if PROCESS_CONF_SUBSCRIPTIONS
+  subscriptions = NULL;
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
 #if PROCESS_CONF_STATS
   process_maxevents = 0;
 #endif /* PROCESS_CONF_STATS */
@@ -236,6 +292,33 @@ do_poll(void)
     }
   }
 }
+#if PROCESS_CONF_SUBSCRIPTIONS
+/*---------------------------------------------------------------------------*/
+/*
+ * Deliver a broadcast event to the processes that have subscribed to
+ * it. Returns zero if no process has subscribed to the event.
+ */
+static int
+deliver_to_subscribers(process_event_t ev, process_data_t data)
+{
+  struct process_subscription *s, *next;
+  int found;
+
+  found = 0;
+  for(s = subscriptions; s != NULL; s = next) {
+    /* The subscriber may unsubscribe while handling the event. */
+    next = s->next;
+    if(s->ev == ev) {
+      found = 1;
+      if(poll_requested) {
+        do_poll();
+      }
+      call_process(s->p, ev, data);
+    }
+  }
+  return found;
+}
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
 /*---------------------------------------------------------------------------*/
 /*
  * Process the next event in the event queue and deliver it to
@@ -259,6 +342,28 @@ do_event(void)
    */
 
   if(nevents > 0) {
+#if PROCESS_CONF_PRIORITY_QUEUES
+    static unsigned char prio;
+    static struct event_data *e;
+
+    /* Pick the highest priority level that holds an event. */
+    if(prio_mask & 0x0f) {
+      prio = lowest_bit[prio_mask & 0x0f];
+    } else {
+      prio = 4 + lowest_bit[prio_mask >> 4];
+    }
+
+    e = &events[prio][fevents[prio]];
+    ev = e->ev;
+    data = e->data;
+    receiver = e->p;
+
+    fevents[prio] = (fevents[prio] + 1) % PROCESS_CONF_PRIO_NUMEVENTS;
+    if(--prio_nevents[prio] == 0) {
+      prio_mask &= ~(1 << prio);
+    }
+    --nevents;
+#else /* PROCESS_CONF_PRIORITY_QUEUES */
     
     /* There are events that we should deliver. */
     ev = events[fevent].ev;
@@ -270,6 +375,15 @@ do_event(void)
        and decrease the number of events. */
     fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
     --nevents;
+#endif /* PROCESS_CONF_PRIORITY_QUEUES */
+
+#if PROCESS_CONF_SUBSCRIPTIONS
+    /* If processes have subscribed to this broadcast event, we
+       deliver it to the subscribers only. */
+    if(receiver == PROCESS_BROADCAST && deliver_to_subscribers(ev, data)) {
+      return;
+    }
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
 
     /* If this is a broadcast event, we deliver it to all events, in
        order of their priority. */
@@ -320,6 +434,13 @@ process_nevents(void)
 /*---------------------------------------------------------------------------*/
 int
 process_post(struct process *p, process_event_t ev, process_data_t data)
+{
+  return process_post_prio(p, ev, data, PROCESS_EVENT_PRIO(ev));
+}
+/*---------------------------------------------------------------------------*/
+int
+process_post_prio(struct process *p, process_event_t ev, process_data_t data,
+                  unsigned char prio)
 {
   static process_num_events_t snum;
 
@@ -332,7 +453,14 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
 	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
   }
   
+#if PROCESS_CONF_PRIORITY_QUEUES
+  if(prio >= PROCESS_NUMPRIOS) {
+    prio = PROCESS_PRIO_LOW;
+  }
+  if(prio_nevents[prio] == PROCESS_CONF_PRIO_NUMEVENTS) {
+#else /* PROCESS_CONF_PRIORITY_QUEUES */
   if(nevents == PROCESS_CONF_NUMEVENTS) {
+#endif /* PROCESS_CONF_PRIORITY_QUEUES */
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
       printf("soft panic: event queue is full when broadcast event %d was posted from %s\n", ev, PROCESS_NAME_STRING(process_current));
@@ -343,10 +471,20 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
     return PROCESS_ERR_FULL;
   }
   
+#if PROCESS_CONF_PRIORITY_QUEUES
+  snum = (process_num_events_t)(fevents[prio] + prio_nevents[prio]) %
+    PROCESS_CONF_PRIO_NUMEVENTS;
+  events[prio][snum].ev = ev;
+  events[prio][snum].data = data;
+  events[prio][snum].p = p;
+  ++prio_nevents[prio];
+  prio_mask |= 1 << prio;
+#else /* PROCESS_CONF_PRIORITY_QUEUES */
   snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
   events[snum].ev = ev;
   events[snum].data = data;
   events[snum].p = p;
+#endif /* PROCESS_CONF_PRIORITY_QUEUES */
   ++nevents;
 
 #if PROCESS_CONF_STATS
@@ -378,6 +516,32 @@ process_poll(struct process *p)
     }
   }
 }
+#if PROCESS_CONF_SUBSCRIPTIONS
+/*---------------------------------------------------------------------------*/
+void
+process_subscribe(struct process_subscription *s, struct process *p,
+                  process_event_t ev)
+{
+  process_unsubscribe(s);
+  s->p = p;
+  s->ev = ev;
+  s->next = subscriptions;
+  subscriptions = s;
+}
+/*---------------------------------------------------------------------------*/
+void
+process_unsubscribe(struct process_subscription *s)
+{
+  struct process_subscription **q;
+
+  for(q = &subscriptions; *q != NULL; q = &(*q)->next) {
+    if(*q == s) {
+      *q = s->next;
+      return;
+    }
+  }
+}
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
 /*---------------------------------------------------------------------------*/
 int
 process_is_running(struct process *p)
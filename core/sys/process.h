@@ -88,6 +88,69 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/**
+ * \name Event priorities
+ *
+ * When PROCESS_CONF_PRIORITY_QUEUES is enabled, the kernel keeps one
+ * event ring per priority level and always dispatches the oldest
+ * event of the highest non-empty level first. Each ring holds
+ * PROCESS_CONF_PRIO_NUMEVENTS events, so a burst of application
+ * traffic cannot push timer events out of the queue. With the option
+ * disabled, all priorities share the single FIFO of
+ * PROCESS_CONF_NUMEVENTS events.
+ * @{
+ */
+#ifndef PROCESS_CONF_PRIORITY_QUEUES
+#define PROCESS_CONF_PRIORITY_QUEUES 0
+#endif /* PROCESS_CONF_PRIORITY_QUEUES */
+
+#if PROCESS_CONF_PRIORITY_QUEUES
+#ifdef PROCESS_CONF_NUMPRIOS
+#define PROCESS_NUMPRIOS PROCESS_CONF_NUMPRIOS
+#else /* PROCESS_CONF_NUMPRIOS */
+#define PROCESS_NUMPRIOS 3
+#endif /* PROCESS_CONF_NUMPRIOS */
+
+#if PROCESS_NUMPRIOS > 8
+#error "PROCESS_CONF_NUMPRIOS must not be larger than 8"
+#endif
+
+#ifndef PROCESS_CONF_PRIO_NUMEVENTS
+#define PROCESS_CONF_PRIO_NUMEVENTS 16
+#endif /* PROCESS_CONF_PRIO_NUMEVENTS */
+#else /* PROCESS_CONF_PRIORITY_QUEUES */
+#define PROCESS_NUMPRIOS 1
+#endif /* PROCESS_CONF_PRIORITY_QUEUES */
+
+#define PROCESS_PRIO_HIGH     0
+#define PROCESS_PRIO_NORMAL   (PROCESS_NUMPRIOS / 2)
+#define PROCESS_PRIO_LOW      (PROCESS_NUMPRIOS - 1)
+
+/*
+ * Priority used by process_post() for an event. Timer events are
+ * dispatched ahead of application traffic and PROCESS_PAUSE() yields
+ * to everything else.
+ */
+#ifdef PROCESS_CONF_EVENT_PRIO
+#define PROCESS_EVENT_PRIO(ev) PROCESS_CONF_EVENT_PRIO(ev)
+#else /* PROCESS_CONF_EVENT_PRIO */
+#define PROCESS_EVENT_PRIO(ev)                                  \
+  ((ev) == PROCESS_EVENT_TIMER ? PROCESS_PRIO_HIGH :            \
+   (ev) == PROCESS_EVENT_CONTINUE ? PROCESS_PRIO_LOW :          \
+   PROCESS_PRIO_NORMAL)
+#endif /* PROCESS_CONF_EVENT_PRIO */
+/** @} */
+
+/*
+ * Broadcast subscriptions. With PROCESS_CONF_SUBSCRIPTIONS enabled, a
+ * broadcast event for which at least one process has subscribed with
+ * process_subscribe() is only delivered to the subscribers instead
+ * of to every process in the system.
+ */
+#ifndef PROCESS_CONF_SUBSCRIPTIONS
+#define PROCESS_CONF_SUBSCRIPTIONS 0
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -364,6 +427,31 @@ CCIF void process_start(struct process *p, process_data_t data);
  */
 CCIF int process_post(struct process *p, process_event_t ev, process_data_t data);
 
+/**
+ * Post an asynchronous event with an explicit priority.
+ *
+ * This function works like process_post(), but puts the event in
+ * the queue of the given priority instead of the one derived from
+ * PROCESS_EVENT_PRIO(). Without PROCESS_CONF_PRIORITY_QUEUES, the
+ * priority is ignored.
+ *
+ * \param p The process to which the event should be posted, or
+ * PROCESS_BROADCAST if the event should be posted to all processes.
+ *
+ * \param ev The event to be posted.
+ *
+ * \param data The auxiliary data to be sent with the event
+ *
+ * \param prio The priority, from PROCESS_PRIO_HIGH to PROCESS_PRIO_LOW.
+ *
+ * \retval PROCESS_ERR_OK The event could be posted.
+ *
+ * \retval PROCESS_ERR_FULL The event queue for the priority was full
+ * and the event could not be posted.
+ */
+CCIF int process_post_prio(struct process *p, process_event_t ev,
+                           process_data_t data, unsigned char prio);
+
 /**
  * Post a synchronous event to a process.
  *
@@ -452,6 +540,39 @@ process_current = p
  */
 CCIF process_event_t process_alloc_event(void);
 
+#if PROCESS_CONF_SUBSCRIPTIONS
+/**
+ * A subscription of a process to a broadcast event. The structure
+ * is allocated by the caller and must stay valid until
+ * process_unsubscribe() is called or the process exits.
+ */
+struct process_subscription {
+  struct process_subscription *next;
+  struct process *p;
+  process_event_t ev;
+};
+
+/**
+ * \brief      Subscribe a process to a broadcast event.
+ * \param s    The subscription structure to use.
+ * \param p    The process that wants to receive the event.
+ * \param ev   The broadcast event.
+ *
+ *             Once a process has subscribed to an event, broadcasts
+ *             of that event are only delivered to its subscribers.
+ *             Subscriptions are removed automatically when the
+ *             subscribing process exits.
+ */
+CCIF void process_subscribe(struct process_subscription *s,
+                            struct process *p, process_event_t ev);
+
+/**
+ * \brief      Remove a subscription to a broadcast event.
+ * \param s    The subscription structure.
+ */
+CCIF void process_unsubscribe(struct process_subscription *s);
+#endif /* PROCESS_CONF_SUBSCRIPTIONS */
+
 /** @} */
 
 /**
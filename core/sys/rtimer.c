@@ -54,7 +54,15 @@
 #define PRINTF(...)
 #endif
 
+#if RTIMER_QUEUE_SIZE > 0
+/* The pending rtimers sorted by their time, the next one first */
+static struct rtimer *queue[RTIMER_QUEUE_SIZE];
+static uint8_t queued;
+
+struct rtimer_stats rtimer_stats;
+#else /* RTIMER_QUEUE_SIZE > 0 */
 static struct rtimer *next_rtimer;
+#endif /* RTIMER_QUEUE_SIZE > 0 */
 
 /*---------------------------------------------------------------------------*/
 void
@@ -63,6 +71,101 @@ rtimer_init(void)
   rtimer_arch_init();
 }
 /*---------------------------------------------------------------------------*/
+#if RTIMER_QUEUE_SIZE > 0
+static void
+queue_remove(uint8_t i)
+{
+  queued--;
+  for(; i < queued; i++) {
+    queue[i] = queue[i + 1];
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+rtimer_set(struct rtimer *rtimer, rtimer_clock_t time,
+	   rtimer_clock_t duration,
+	   rtimer_callback_t func, void *ptr)
+{
+  struct rtimer *head;
+  uint8_t i, irq;
+
+  PRINTF("rtimer_set time %d\n", time);
+
+  RTIMER_ARCH_LOCK(irq);
+
+  head = queued > 0 ? queue[0] : NULL;
+
+  /* A task that is set again is moved to its new time */
+  for(i = 0; i < queued; i++) {
+    if(queue[i] == rtimer) {
+      queue_remove(i);
+      break;
+    }
+  }
+
+  if(queued == RTIMER_QUEUE_SIZE) {
+    /* Only a task that was not queued gets here, so the head is the same */
+    rtimer_stats.full++;
+    RTIMER_ARCH_UNLOCK(irq);
+    PRINTF("rtimer_set: queue full\n");
+    return RTIMER_ERR_FULL;
+  }
+
+  rtimer->func = func;
+  rtimer->ptr = ptr;
+  rtimer->time = time;
+
+  /* Tasks with the same time run in the order they were set */
+  for(i = queued; i > 0 && RTIMER_CLOCK_LT(time, queue[i - 1]->time); i--) {
+    queue[i] = queue[i - 1];
+  }
+  queue[i] = rtimer;
+  queued++;
+
+  /* The hardware timer is only changed if the next deadline did, which
+     includes the first task being set again for another time */
+  if(queue[0] != head || rtimer == head) {
+    rtimer_arch_schedule(queue[0]->time);
+  }
+
+  RTIMER_ARCH_UNLOCK(irq);
+  return RTIMER_OK;
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_run_next(void)
+{
+  struct rtimer *t;
+  rtimer_clock_t now;
+  uint8_t irq, first;
+
+  /* The interrupt is for the first task, later ones are run as well if
+     their time has come while the earlier callbacks were running. An
+     interrupt that comes early, for a deadline that has moved, only
+     schedules the next one. The callbacks run unlocked, so that they
+     may be interrupted, and the queue is read again afterwards. */
+  first = 1;
+  RTIMER_ARCH_LOCK(irq);
+  while(queued > 0) {
+    now = RTIMER_NOW();
+    if(RTIMER_CLOCK_LT(now, queue[0]->time)) {
+      rtimer_arch_schedule(queue[0]->time);
+      break;
+    }
+    if(!first && RTIMER_CLOCK_LT(queue[0]->time, now)) {
+      rtimer_stats.missed++;
+    }
+    first = 0;
+    t = queue[0];
+    queue_remove(0);
+    RTIMER_ARCH_UNLOCK(irq);
+    t->func(t, t->ptr);
+    RTIMER_ARCH_LOCK(irq);
+  }
+  RTIMER_ARCH_UNLOCK(irq);
+}
+/*---------------------------------------------------------------------------*/
+#else /* RTIMER_QUEUE_SIZE > 0 */
 int
 rtimer_set(struct rtimer *rtimer, rtimer_clock_t time,
 	   rtimer_clock_t duration,
@@ -103,6 +206,7 @@ rtimer_run_next(void)
   }
   return;
 }
+#endif /* RTIMER_QUEUE_SIZE > 0 */
 /*---------------------------------------------------------------------------*/
 
 /** @}*/
@@ -63,6 +63,28 @@ typedef unsigned short rtimer_clock_t;
 
 #include "rtimer-arch.h"
 
+/**
+ * The number of rtimers that can be pending at the same time. With 0,
+ * the default, there is a single slot and setting an rtimer replaces
+ * the one that is pending; with more, the rtimers are kept sorted by
+ * their time and rtimer_set() fails with RTIMER_ERR_FULL when all
+ * slots are taken.
+ */
+#ifdef RTIMER_CONF_QUEUE_SIZE
+#define RTIMER_QUEUE_SIZE RTIMER_CONF_QUEUE_SIZE
+#else
+#define RTIMER_QUEUE_SIZE 0
+#endif
+
+/*
+ * The queue is changed with the rtimer interrupt held off. The
+ * architecture saves the interrupt state in a uint8_t and restores it.
+ */
+#ifndef RTIMER_ARCH_LOCK
+#define RTIMER_ARCH_LOCK(irq) ((irq) = 0)
+#define RTIMER_ARCH_UNLOCK(irq) ((void)(irq))
+#endif
+
 /**
  * \brief      Initialize the real-time scheduler.
  *
@@ -95,6 +117,16 @@ enum {
   RTIMER_ERR_ALREADY_SCHEDULED,
 };
 
+#if RTIMER_QUEUE_SIZE > 0
+struct rtimer_stats {
+  /** Tasks that ran after their time, behind a callback that overran */
+  unsigned long missed;
+  /** Calls to rtimer_set() that found the queue full */
+  unsigned long full;
+};
+extern struct rtimer_stats rtimer_stats;
+#endif /* RTIMER_QUEUE_SIZE > 0 */
+
 /**
  * \brief      Post a real-time task.
  * \param task A pointer to the task variable previously declared with RTIMER_TASK().
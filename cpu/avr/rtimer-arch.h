@@ -81,4 +81,8 @@
 #endif /* XMEGA */
 
 void rtimer_arch_sleep(rtimer_clock_t howlong);
+
+/* Hold off all interrupts while the rtimer queue is changed */
+#define RTIMER_ARCH_LOCK(irq) do { (irq) = SREG; cli(); } while(0)
+#define RTIMER_ARCH_UNLOCK(irq) (SREG = (irq))
 #endif /* RTIMER_ARCH_H_ */
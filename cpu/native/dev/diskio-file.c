@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Disk image on the host for the diskio layer.
+ */
+
+#include "contiki.h"
+#include "dev/diskio-file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+const struct diskio_file_model diskio_file_model_sd = {
+  .command_us = 50,
+  .transfer_us = 1050,
+  .read_us = 300,
+  .program_us = 250,
+  .erase_us = 2000,
+  .erase_blocks = 64,
+  .multi_block = 1,
+};
+
+const struct diskio_file_model diskio_file_model_at45db = {
+  .command_us = 20,
+  .transfer_us = 1050,
+  .read_us = 0,
+  .program_us = 3000,
+  .erase_us = 14000,
+  .erase_blocks = 1,
+  .multi_block = 0,
+};
+
+static int image_fd = -1;
+static uint8_t *image;
+static const struct diskio_file_model *model = DISKIO_FILE_MODEL;
+static struct diskio_file_stats stats;
+/* Next block of a multi block write, 0 if none is in progress */
+static uint32_t multi_block_addr;
+static uint32_t multi_block_left;
+/* Blocks erased by the multi block write in progress */
+static uint32_t erased_start, erased_end;
+/*---------------------------------------------------------------------------*/
+static void
+device_time(uint32_t us)
+{
+#if DISKIO_FILE_DELAY
+  struct timespec start, now;
+#endif
+
+  if(us == 0) {
+    return;
+  }
+  stats.device_us += us;
+
+#if DISKIO_FILE_DELAY
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  do {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+  } while((now.tv_sec - start.tv_sec) * 1000000L +
+          (now.tv_nsec - start.tv_nsec) / 1000 < us);
+#endif
+}
+/*---------------------------------------------------------------------------*/
+static void
+command(void)
+{
+  stats.commands++;
+  if(model != NULL) {
+    device_time(model->command_us);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+program(uint32_t addr)
+{
+  stats.blocks_written++;
+  if(model == NULL) {
+    return;
+  }
+  if(addr < erased_start || addr >= erased_end) {
+    stats.erases++;
+    device_time(model->erase_us);
+  }
+  device_time(model->transfer_us + model->program_us);
+}
+/*---------------------------------------------------------------------------*/
+int
+diskio_file_init(void)
+{
+  char *image_filename = getenv("CONTIKI_DISKIO");
+  struct stat st;
+  FILE *tmp;
+
+  if(image_fd >= 0) {
+    return 0;
+  }
+
+  if(image_filename) {
+    image_fd = open(image_filename, O_RDWR | O_CREAT, 0644);
+    if(image_fd < 0) {
+      perror("Unable to open disk image");
+      return 1;
+    }
+    fprintf(stderr, "diskio_file_init: Using \"%s\".\n", image_filename);
+  } else {
+    tmp = tmpfile();
+    if(tmp == NULL) {
+      perror("Unable to create temporary disk image");
+      return 1;
+    }
+    image_fd = fileno(tmp);
+  }
+
+  /* A new image reads as zeros, like an erased card. An existing one
+     is only grown, a larger image keeps the data beyond the blocks used
+     here. */
+  if(fstat(image_fd, &st) != 0) {
+    perror("Unable to stat disk image");
+    goto error;
+  }
+  if(st.st_size < (off_t)DISKIO_FILE_NUM_BLOCKS * DISKIO_FILE_BLOCK_SIZE &&
+     ftruncate(image_fd, (off_t)DISKIO_FILE_NUM_BLOCKS *
+               DISKIO_FILE_BLOCK_SIZE) != 0) {
+    perror("Unable to resize disk image");
+    goto error;
+  }
+
+  image = mmap(NULL, (size_t)DISKIO_FILE_NUM_BLOCKS * DISKIO_FILE_BLOCK_SIZE,
+               PROT_READ | PROT_WRITE, MAP_SHARED, image_fd, 0);
+  if(image == MAP_FAILED) {
+    perror("Unable to map disk image");
+    image = NULL;
+    goto error;
+  }
+  return 0;
+
+ error:
+  close(image_fd);
+  image_fd = -1;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+diskio_file_set_model(const struct diskio_file_model *m)
+{
+  model = m;
+}
+/*---------------------------------------------------------------------------*/
+const struct diskio_file_stats *
+diskio_file_get_stats(void)
+{
+  return &stats;
+}
+/*---------------------------------------------------------------------------*/
+void
+diskio_file_reset_stats(void)
+{
+  memset(&stats, 0, sizeof(stats));
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+diskio_file_get_block_num(void)
+{
+  return DISKIO_FILE_NUM_BLOCKS;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+diskio_file_get_block_size(void)
+{
+  return DISKIO_FILE_BLOCK_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+int
+diskio_file_read_block(uint32_t addr, uint8_t *buffer)
+{
+  if(image == NULL || addr >= DISKIO_FILE_NUM_BLOCKS) {
+    return 1;
+  }
+  memcpy(buffer, image + (size_t)addr * DISKIO_FILE_BLOCK_SIZE,
+         DISKIO_FILE_BLOCK_SIZE);
+
+  command();
+  stats.blocks_read++;
+  if(model != NULL) {
+    device_time(model->read_us + model->transfer_us);
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+diskio_file_write_block(uint32_t addr, uint8_t *buffer)
+{
+  if(image == NULL || addr >= DISKIO_FILE_NUM_BLOCKS) {
+    return 1;
+  }
+  memcpy(image + (size_t)addr * DISKIO_FILE_BLOCK_SIZE, buffer,
+         DISKIO_FILE_BLOCK_SIZE);
+
+  command();
+  program(addr);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+diskio_file_write_blocks_start(uint32_t addr, uint32_t num_blocks)
+{
+  if(image == NULL || multi_block_left != 0 ||
+     addr + num_blocks > DISKIO_FILE_NUM_BLOCKS) {
+    return 1;
+  }
+  multi_block_addr = addr;
+  multi_block_left = num_blocks;
+  stats.multi_block_writes++;
+
+  if(model != NULL && !model->multi_block) {
+    return 0;
+  }
+
+  /* Announcing the number of blocks pre-erases them, in units of
+   * erase_blocks, then the write is started */
+  command();
+  command();
+  if(model == NULL) {
+    return 0;
+  }
+  erased_start = addr;
+  erased_end = addr + num_blocks;
+  stats.erases += (num_blocks + model->erase_blocks - 1) / model->erase_blocks;
+  device_time(model->erase_us *
+              ((num_blocks + model->erase_blocks - 1) / model->erase_blocks));
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+diskio_file_write_blocks_next(uint8_t *buffer)
+{
+  uint32_t addr = multi_block_addr;
+
+  if(multi_block_left == 0) {
+    return 1;
+  }
+  multi_block_left--;
+  multi_block_addr++;
+  memcpy(image + (size_t)addr * DISKIO_FILE_BLOCK_SIZE, buffer,
+         DISKIO_FILE_BLOCK_SIZE);
+
+  if(model != NULL && !model->multi_block) {
+    command();
+  }
+  program(addr);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+diskio_file_write_blocks_done(void)
+{
+  if(model == NULL || model->multi_block) {
+    command();
+  }
+  multi_block_left = 0;
+  erased_start = erased_end = 0;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Disk image on the host, that the diskio layer uses like a
+ *         memory card, so that the FAT driver can run on native.
+ *
+ *         A timing model estimates how long the operations would take on
+ *         a real device, and counters record the I/O done.
+ */
+
+#ifndef DISKIO_FILE_H_
+#define DISKIO_FILE_H_
+
+#include <stdint.h>
+
+/* Size of the disk in 512 byte blocks. The default of 32 MB is
+ * formatted as FAT16 by cfs_fat_mkfs(). */
+#ifdef DISKIO_FILE_CONF_NUM_BLOCKS
+#define DISKIO_FILE_NUM_BLOCKS DISKIO_FILE_CONF_NUM_BLOCKS
+#else
+#define DISKIO_FILE_NUM_BLOCKS 65536UL
+#endif
+
+#define DISKIO_FILE_BLOCK_SIZE 512
+
+/* Timing model used from the start, e.g. diskio_file_model_sd. Without
+ * it, operations take no device time. */
+#ifdef DISKIO_FILE_CONF_MODEL
+#define DISKIO_FILE_MODEL (&DISKIO_FILE_CONF_MODEL)
+#else
+#define DISKIO_FILE_MODEL NULL
+#endif
+
+/* Busy wait for the device time of every operation, so that the model
+ * also shows in the run time of the program. */
+#ifdef DISKIO_FILE_CONF_DELAY
+#define DISKIO_FILE_DELAY DISKIO_FILE_CONF_DELAY
+#else
+#define DISKIO_FILE_DELAY 0
+#endif
+
+/**
+ * Device time of the operations in microseconds.
+ */
+struct diskio_file_model {
+  /** Sending a command and waiting for its response */
+  uint16_t command_us;
+  /** Transferring one block over the bus */
+  uint16_t transfer_us;
+  /** Accessing a block before it can be transferred */
+  uint16_t read_us;
+  /** Programming one erased block */
+  uint16_t program_us;
+  /** Erasing before a block is programmed, unless it was pre-erased */
+  uint16_t erase_us;
+  /** Blocks erased at once before a multi block write */
+  uint16_t erase_blocks;
+  /** Whether multiple blocks are written with one command. Otherwise
+   * each of them is a single block write. */
+  uint8_t multi_block;
+};
+
+/** SD card on a 4 MHz SPI bus */
+extern const struct diskio_file_model diskio_file_model_sd;
+/** AT45DB dataflash on a 4 MHz SPI bus, pages written with built-in erase */
+extern const struct diskio_file_model diskio_file_model_at45db;
+
+/**
+ * I/O done since the last diskio_file_reset_stats().
+ */
+struct diskio_file_stats {
+  uint32_t blocks_read;
+  uint32_t blocks_written;
+  /** Commands sent to the device */
+  uint32_t commands;
+  /** Multi block writes started */
+  uint32_t multi_block_writes;
+  /** Erases, of single blocks or ranges before a multi block write */
+  uint32_t erases;
+  /** Device time according to the model */
+  uint32_t device_us;
+};
+
+/**
+ * Opens the disk image named by the CONTIKI_DISKIO environment variable,
+ * which is created if it does not exist and grown if it is smaller
+ * than DISKIO_FILE_NUM_BLOCKS. Without it, an empty temporary image is
+ * used.
+ * \return 0 on success
+ */
+int diskio_file_init(void);
+
+/**
+ * Sets the timing model, NULL for none.
+ */
+void diskio_file_set_model(const struct diskio_file_model *model);
+
+const struct diskio_file_stats *diskio_file_get_stats(void);
+void diskio_file_reset_stats(void);
+
+uint32_t diskio_file_get_block_num(void);
+uint16_t diskio_file_get_block_size(void);
+
+/* All block functions return 0 on success. */
+int diskio_file_read_block(uint32_t addr, uint8_t *buffer);
+int diskio_file_write_block(uint32_t addr, uint8_t *buffer);
+int diskio_file_write_blocks_start(uint32_t addr, uint32_t num_blocks);
+int diskio_file_write_blocks_next(uint8_t *buffer);
+int diskio_file_write_blocks_done(void);
+
+#endif /* DISKIO_FILE_H_ */
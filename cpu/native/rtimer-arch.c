@@ -78,7 +78,12 @@ rtimer_arch_schedule(rtimer_clock_t t)
   rtimer_clock_t c;
 
   c = t - (unsigned short)clock_time();
-  
+  /* A zero timer would never fire, and one in the past only after the
+     clock wrapped */
+  if((signed short)c <= 0) {
+    c = 1;
+  }
+
   val.it_value.tv_sec = c / 1000;
   val.it_value.tv_usec = (c % 1000) * 1000;
 
@@ -90,3 +95,32 @@ rtimer_arch_schedule(rtimer_clock_t t)
 #endif /* !_WIN32 */
 }
 /*---------------------------------------------------------------------------*/
+uint8_t
+rtimer_arch_lock(void)
+{
+#ifndef _WIN32
+  sigset_t alarm, old;
+
+  sigemptyset(&alarm);
+  sigaddset(&alarm, SIGALRM);
+  sigprocmask(SIG_BLOCK, &alarm, &old);
+  return sigismember(&old, SIGALRM);
+#else /* !_WIN32 */
+  return 0;
+#endif /* !_WIN32 */
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_unlock(uint8_t irq)
+{
+#ifndef _WIN32
+  sigset_t alarm;
+
+  if(!irq) {
+    sigemptyset(&alarm);
+    sigaddset(&alarm, SIGALRM);
+    sigprocmask(SIG_UNBLOCK, &alarm, NULL);
+  }
+#endif /* !_WIN32 */
+}
+/*---------------------------------------------------------------------------*/
@@ -46,4 +46,10 @@
 
 #define rtimer_arch_now() clock_time()
 
+#define RTIMER_ARCH_LOCK(irq) ((irq) = rtimer_arch_lock())
+#define RTIMER_ARCH_UNLOCK(irq) rtimer_arch_unlock(irq)
+
+uint8_t rtimer_arch_lock(void);
+void rtimer_arch_unlock(uint8_t irq);
+
 #endif /* RTIMER_ARCH_H_ */
@@ -0,0 +1,420 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of blockwise transfers to and from a CoAP resource.
+ *         Files of 1 KB and 32 KB are uploaded with Block1, once in
+ *         order, once with every two blocks swapped and once with
+ *         block 0 sent again after block 2, and read back with Block2. The resource keeps the file in a RAM buffer of
+ *         1 KB, or in CFS with BENCH_BLOCK_CFS, which is cfs-fat on a
+ *         disk image with BENCH_BLOCK_FAT. The bytes stored, the time
+ *         per KB and the RAM the resource needs are reported.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/mac/mac.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "er-coap-engine.h"
+#include "er-coap-block1.h"
+#include "er-coap-block-cfs.h"
+#include "../bench.h"
+#if BENCH_BLOCK_FAT
+#include "fat/cfs-fat.h"
+#include "fat/diskio.h"
+#endif
+
+#include <string.h>
+
+#define CLIENT_ID     1
+#define BLOCK_SIZE    COAP_MAX_BLOCK_SIZE
+#define RAM_SIZE      1024
+#define MAX_FILE_SIZE 32768
+#define FILENAME      "blocks.dat"
+
+/* The order the blocks of an upload are sent in */
+enum { IN_ORDER, SWAPPED, REPLAYED, NUM_ORDERS };
+
+/* The last response of the server */
+static coap_packet_t response[1];
+static uint8_t response_payload[REST_MAX_CHUNK_SIZE];
+static int responded;
+
+static uint16_t mid;
+static uint32_t stored, rejected, wrong;
+
+PROCESS(bench_process, "CoAP blockwise transfer benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+#if BENCH_BLOCK_CFS
+static coap_block1_cfs_t upload;
+
+static void
+res_put_handler(void *request, void *response, uint8_t *buffer,
+                uint16_t preferred_size, int32_t *offset)
+{
+  if(coap_block1_cfs_handler(request, response, &upload, FILENAME,
+                             MAX_FILE_SIZE) == 0) {
+    REST.set_response_status(response, REST.status.CHANGED);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+res_get_handler(void *request, void *response, uint8_t *buffer,
+                uint16_t preferred_size, int32_t *offset)
+{
+  coap_block2_cfs_handler(request, response, FILENAME, buffer,
+                          preferred_size, offset);
+}
+#else
+static uint8_t ram[RAM_SIZE];
+static size_t ram_len;
+
+static void
+res_put_handler(void *request, void *response, uint8_t *buffer,
+                uint16_t preferred_size, int32_t *offset)
+{
+  if(coap_block1_handler(request, response, ram, &ram_len,
+                         sizeof(ram)) == 0) {
+    REST.set_response_status(response, REST.status.CHANGED);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+res_get_handler(void *request, void *response, uint8_t *buffer,
+                uint16_t preferred_size, int32_t *offset)
+{
+  int len = MIN(preferred_size, ram_len - *offset);
+
+  memcpy(buffer, ram + *offset, len);
+  REST.set_response_payload(response, buffer, len);
+  *offset += len;
+  if(*offset >= ram_len) {
+    *offset = -1;
+  }
+}
+#endif /* BENCH_BLOCK_CFS */
+
+RESOURCE(res_file, "title=\"File\"", res_get_handler, NULL, res_put_handler,
+         NULL);
+/*---------------------------------------------------------------------------*/
+static void
+make_addr(uip_ipaddr_t *ipaddr, uint8_t id)
+{
+  linkaddr_t lladdr;
+
+  memset(&lladdr, 0, sizeof(linkaddr_t));
+  lladdr.u8[0] = 0x02;
+  lladdr.u8[LINKADDR_SIZE - 1] = id;
+  uip_ip6addr(ipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(ipaddr, (uip_lladdr_t *)&lladdr);
+}
+/*---------------------------------------------------------------------------*/
+/* A request of the client, passed to the IP stack */
+static coap_packet_t *
+request_send(coap_packet_t *request)
+{
+  uint16_t len;
+
+  len = coap_serialize_message(request,
+                               &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN]);
+
+  memset(UIP_IP_BUF, 0, UIP_IPUDPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[0] = (UIP_UDPH_LEN + len) >> 8;
+  UIP_IP_BUF->len[1] = (UIP_UDPH_LEN + len) & 0xff;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 64;
+  make_addr(&UIP_IP_BUF->srcipaddr, CLIENT_ID);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr,
+                  &uip_ds6_get_link_local(-1)->ipaddr);
+  UIP_UDP_BUF->srcport = UIP_HTONS(COAP_DEFAULT_PORT + 1);
+  UIP_UDP_BUF->destport = UIP_HTONS(COAP_DEFAULT_PORT);
+  UIP_UDP_BUF->udplen = UIP_HTONS(UIP_UDPH_LEN + len);
+  uip_len = UIP_IPUDPH_LEN + len;
+  uip_ext_len = 0;
+  UIP_UDP_BUF->udpchksum = ~uip_udpchksum();
+
+  /* the server answers before tcpip_input() returns */
+  responded = 0;
+  tcpip_input();
+  return responded ? response : NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* A MAC that passes the responses of the server to the client */
+static void
+mac_send(mac_callback_t sent, void *ptr)
+{
+  const linkaddr_t *receiver = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  uint8_t *frame = packetbuf_hdrptr();
+  const uint8_t *payload;
+  int i, len;
+
+  if(receiver->u8[LINKADDR_SIZE - 1] == CLIENT_ID) {
+    /* the CoAP response is at the end of the frame */
+    for(i = 0; i + COAP_HEADER_LEN < packetbuf_totlen(); i++) {
+      if((frame[i] & 0xc0) == 0x40 && frame[i + 2] == (mid >> 8) &&
+         frame[i + 3] == (mid & 0xff) &&
+         coap_parse_message(response, frame + i,
+                            packetbuf_totlen() - i) == NO_ERROR) {
+        /* keep the payload, the frame is reused */
+        len = coap_get_payload(response, &payload);
+        memcpy(response_payload, payload, len);
+        coap_set_payload(response, response_payload, len);
+        responded = 1;
+        break;
+      }
+    }
+  }
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_off(int keep_radio_on)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+mac_channel_check_interval(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver bench_mac_driver = {
+  "bench",
+  mac_init,
+  mac_send,
+  mac_input,
+  mac_on,
+  mac_off,
+  mac_channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
+static uint8_t
+content(uint32_t offset, uint32_t size)
+{
+  return (offset * 7 + size / 1024) & 0xff;
+}
+/*---------------------------------------------------------------------------*/
+/* Sends block num of a file of size bytes */
+static coap_packet_t *
+put_block(uint32_t size, uint32_t num)
+{
+  static coap_packet_t request[1];
+  static uint8_t payload[BLOCK_SIZE];
+  uint32_t blocks;
+  uint16_t len;
+  int i;
+
+  blocks = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  len = MIN(BLOCK_SIZE, size - num * BLOCK_SIZE);
+  for(i = 0; i < len; i++) {
+    payload[i] = content(num * BLOCK_SIZE + i, size);
+  }
+  coap_init_message(request, COAP_TYPE_CON, COAP_PUT, ++mid);
+  coap_set_header_uri_path(request, "f");
+  coap_set_header_block1(request, num, num + 1 < blocks, BLOCK_SIZE);
+  coap_set_payload(request, payload, len);
+  return request_send(request);
+}
+/*---------------------------------------------------------------------------*/
+/* Uploads a file of size bytes, returns 1 if the server stored it */
+static int
+put_file(uint32_t size, int order)
+{
+  coap_packet_t *r;
+  uint32_t blocks, n, num;
+
+  blocks = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  for(n = 0; n < blocks; n++) {
+    /* block 0 first, then 2, 1, 4, 3, ... */
+    num = order == SWAPPED && n > 0 ? ((n - 1) ^ 1) + 1 : n;
+    if(num >= blocks) {
+      num = n;
+    }
+    r = put_block(size, num);
+    if(r == NULL || r->code >= BAD_REQUEST_4_00) {
+      return 0;
+    }
+    if(order == REPLAYED && n == 2) {
+      /* the client did not get the ACK of block 0 and sends it again */
+      r = put_block(size, 0);
+      if(r == NULL || r->code >= BAD_REQUEST_4_00) {
+        return 0;
+      }
+    }
+    if(n + 1 == blocks) {
+      return r->code == CHANGED_2_04;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Downloads the file and counts the bytes that differ */
+static void
+get_file(uint32_t size)
+{
+  static coap_packet_t request[1];
+  coap_packet_t *r;
+  const uint8_t *payload;
+  uint32_t num, offset;
+  uint8_t more;
+  int i, len;
+
+  offset = 0;
+  for(num = 0;; num++) {
+    coap_init_message(request, COAP_TYPE_CON, COAP_GET, ++mid);
+    coap_set_header_uri_path(request, "f");
+    coap_set_header_block2(request, num, 0, BLOCK_SIZE);
+    r = request_send(request);
+    if(r == NULL || r->code != CONTENT_2_05) {
+      break;
+    }
+    more = 0;
+    coap_get_header_block2(r, NULL, &more, NULL, NULL);
+    len = coap_get_payload(r, &payload);
+    for(i = 0; i < len; i++, offset++) {
+      if(offset >= size || payload[i] != content(offset, size)) {
+        wrong++;
+      }
+    }
+    if(!more) {
+      break;
+    }
+  }
+  if(offset < size) {
+    wrong += size - offset;
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static const uint32_t sizes[] = { 1024, 32768 };
+  static uip_ipaddr_t addr;
+  static uint32_t start, elapsed;
+#if BENCH_BLOCK_FAT
+  struct diskio_device_info *dev;
+#endif
+  linkaddr_t lladdr;
+  int i, order;
+
+  PROCESS_BEGIN();
+
+#if BENCH_BLOCK_FAT
+  TEST_RESULT("CoAP blockwise transfers", "CFS on FAT");
+  if(diskio_detect_devices() != DISKIO_SUCCESS) {
+    TEST_FAIL("diskio_detect_devices");
+  }
+  dev = NULL;
+  for(i = 0; i < DISKIO_MAX_DEVICES; i++) {
+    if(diskio_devices()[i].type == DISKIO_DEVICE_TYPE_FILE) {
+      dev = &diskio_devices()[i];
+      break;
+    }
+  }
+  if(dev == NULL || cfs_fat_mkfs(dev) != 0 ||
+     cfs_fat_mount_device(dev) != 0) {
+    TEST_FAIL("disk image");
+  }
+  diskio_set_default_device(dev);
+#elif BENCH_BLOCK_CFS
+  TEST_RESULT("CoAP blockwise transfers", "CFS");
+#else
+  TEST_RESULT("CoAP blockwise transfers", "RAM buffer");
+#endif
+
+  rest_init_engine();
+  rest_activate_resource(&res_file, "f");
+
+  memset(&lladdr, 0, sizeof(linkaddr_t));
+  lladdr.u8[0] = 0x02;
+  lladdr.u8[LINKADDR_SIZE - 1] = CLIENT_ID;
+  make_addr(&addr, CLIENT_ID);
+  if(uip_ds6_nbr_add(&addr, (uip_lladdr_t *)&lladdr, 1,
+                     NBR_REACHABLE) == NULL) {
+    TEST_FAIL("uip_ds6_nbr_add");
+  }
+
+  start = bench_now_us();
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    for(order = IN_ORDER; order < NUM_ORDERS; order++) {
+      if(put_file(sizes[i], order)) {
+        stored += sizes[i];
+        get_file(sizes[i]);
+      } else {
+        rejected++;
+      }
+    }
+  }
+  elapsed = bench_now_us() - start;
+
+#if BENCH_BLOCK_CFS
+  cfs_remove(FILENAME);
+#endif
+
+  bench_report("bytes stored", stored, 1, "");
+  bench_report("uploads rejected", rejected, 1, "");
+  bench_report("time per KB stored", elapsed, stored / 1024, "us");
+#if BENCH_BLOCK_CFS
+  bench_report("RAM of the resource", sizeof(upload), 1, "bytes");
+#else
+  bench_report("RAM of the resource", sizeof(ram) + sizeof(ram_len), 1,
+               "bytes");
+#endif
+  bench_report("wrong bytes read back", wrong, 1, "");
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
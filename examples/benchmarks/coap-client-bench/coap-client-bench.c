@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of a CoAP client that reads a resource of two blocks
+ *         from each of 64 servers. The servers are stood in for by the
+ *         MAC of the benchmark, which answers every request with a
+ *         piggybacked response 20 ms later. The time until all resources
+ *         are read and the requests per second are reported. The
+ *         asynchronous client then cancels a request from its callback,
+ *         after which no further block may be requested, and reads one
+ *         more resource to show that its tables are intact.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/mac/mac.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "er-coap-engine.h"
+#include "../bench.h"
+
+#include <string.h>
+
+#define NUM_SERVERS   64
+#define NUM_BLOCKS    2
+#define RTT           (CLOCK_SECOND / 50)
+
+/* A request the stand-in server has to answer */
+struct pending {
+  struct ctimer timer;
+  uint16_t mid;
+  uint8_t token_len;
+  uint8_t token[COAP_TOKEN_LEN];
+  uint32_t block;
+};
+
+static struct pending pending[NUM_SERVERS];
+static uint32_t requests, blocks, bytes, completed, wrong;
+
+PROCESS(bench_process, "CoAP client benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+make_addr(uip_ipaddr_t *ipaddr, uint8_t id)
+{
+  linkaddr_t lladdr;
+
+  memset(&lladdr, 0, sizeof(linkaddr_t));
+  lladdr.u8[0] = 0x02;
+  lladdr.u8[LINKADDR_SIZE - 1] = id;
+  uip_ip6addr(ipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(ipaddr, (uip_lladdr_t *)&lladdr);
+}
+/*---------------------------------------------------------------------------*/
+/* The response of a server, passed to the IP stack */
+static void
+respond(void *ptr)
+{
+  static coap_packet_t response[1];
+  static uint8_t payload[REST_MAX_CHUNK_SIZE];
+  struct pending *p = ptr;
+  uint8_t id = p - pending + 1;
+  uint16_t len;
+
+  coap_init_message(response, COAP_TYPE_ACK, CONTENT_2_05, p->mid);
+  coap_set_token(response, p->token, p->token_len);
+  coap_set_header_block2(response, p->block, p->block + 1 < NUM_BLOCKS,
+                         REST_MAX_CHUNK_SIZE);
+  memset(payload, id, sizeof(payload));
+  coap_set_payload(response, payload, sizeof(payload));
+  len = coap_serialize_message(response, &uip_buf[UIP_LLH_LEN + UIP_IPUDPH_LEN]);
+
+  memset(UIP_IP_BUF, 0, UIP_IPUDPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[0] = (UIP_UDPH_LEN + len) >> 8;
+  UIP_IP_BUF->len[1] = (UIP_UDPH_LEN + len) & 0xff;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 64;
+  make_addr(&UIP_IP_BUF->srcipaddr, id);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr,
+                  &uip_ds6_get_link_local(-1)->ipaddr);
+  UIP_UDP_BUF->srcport = UIP_HTONS(COAP_DEFAULT_PORT);
+  UIP_UDP_BUF->destport = UIP_HTONS(COAP_DEFAULT_PORT);
+  UIP_UDP_BUF->udplen = UIP_HTONS(UIP_UDPH_LEN + len);
+  uip_len = UIP_IPUDPH_LEN + len;
+  uip_ext_len = 0;
+  UIP_UDP_BUF->udpchksum = ~uip_udpchksum();
+
+  tcpip_input();
+}
+/*---------------------------------------------------------------------------*/
+/* A MAC that stands in for the servers */
+static void
+mac_send(mac_callback_t sent, void *ptr)
+{
+  static coap_packet_t request[1];
+  const linkaddr_t *receiver = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  uint8_t id = receiver->u8[LINKADDR_SIZE - 1];
+  uint8_t *frame = packetbuf_hdrptr();
+  const char *path;
+  uint32_t block;
+  int i;
+
+  if(!linkaddr_cmp(receiver, &linkaddr_null) && id > 0 && id <= NUM_SERVERS) {
+    /* the CoAP request is at the end of the frame */
+    for(i = 0; i + COAP_HEADER_LEN < packetbuf_totlen(); i++) {
+      if((frame[i] & 0xc0) == 0x40 && frame[i + 1] == COAP_GET &&
+         coap_parse_message(request, frame + i,
+                            packetbuf_totlen() - i) == NO_ERROR &&
+         coap_get_header_uri_path(request, &path) == 1 && path[0] == 's') {
+        requests++;
+        block = 0;
+        coap_get_header_block2(request, &block, NULL, NULL, NULL);
+        pending[id - 1].mid = request->mid;
+        pending[id - 1].token_len = request->token_len;
+        memcpy(pending[id - 1].token, request->token, request->token_len);
+        pending[id - 1].block = block;
+        ctimer_set(&pending[id - 1].timer, RTT, respond, &pending[id - 1]);
+        break;
+      }
+    }
+  }
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_off(int keep_radio_on)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+mac_channel_check_interval(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver bench_mac_driver = {
+  "bench",
+  mac_init,
+  mac_send,
+  mac_input,
+  mac_on,
+  mac_off,
+  mac_channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
+/* Counts a block and checks that it comes from the right server */
+static int
+block_received(uint8_t id, coap_packet_t *response)
+{
+  const uint8_t *payload;
+  uint32_t block;
+  uint8_t more;
+  int len, i;
+
+  if(response == NULL) {
+    wrong++;
+    return 0;
+  }
+  more = 0;
+  coap_get_header_block2(response, &block, &more, NULL, NULL);
+  len = coap_get_payload(response, &payload);
+  blocks++;
+  bytes += len;
+  for(i = 0; i < len; i++) {
+    if(payload[i] != id) {
+      wrong++;
+      break;
+    }
+  }
+  return more;
+}
+/*---------------------------------------------------------------------------*/
+#if COAP_ASYNC_CLIENT
+static void
+async_handler(void *data, void *response)
+{
+  uint8_t id = (uintptr_t)data;
+
+  if(!block_received(id, response)) {
+    completed++;
+    process_poll(&bench_process);
+  }
+}
+
+static coap_async_request_t *cancelled;
+
+static void
+cancel_handler(void *data, void *response)
+{
+  coap_async_cancel(cancelled);
+}
+#else
+static uint8_t current;
+
+static void
+blocking_handler(void *response)
+{
+  if(!block_received(current, response)) {
+    completed++;
+  }
+}
+#endif
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static coap_packet_t request[1];
+  static uip_ipaddr_t addr;
+#if COAP_ASYNC_CLIENT
+  static struct etimer et;
+  static uint32_t sent;
+#endif
+  static uint32_t start;
+  static uint8_t id;
+  uint32_t elapsed;
+
+  PROCESS_BEGIN();
+
+#if COAP_ASYNC_CLIENT
+  TEST_RESULT("CoAP client", "asynchronous");
+#else
+  TEST_RESULT("CoAP client", "blocking");
+#endif
+
+  rest_init_engine();
+
+  for(id = 1; id <= NUM_SERVERS; id++) {
+    linkaddr_t lladdr;
+
+    memset(&lladdr, 0, sizeof(linkaddr_t));
+    lladdr.u8[0] = 0x02;
+    lladdr.u8[LINKADDR_SIZE - 1] = id;
+    make_addr(&addr, id);
+    if(uip_ds6_nbr_add(&addr, (uip_lladdr_t *)&lladdr, 1,
+                       NBR_REACHABLE) == NULL) {
+      TEST_FAIL("uip_ds6_nbr_add");
+    }
+  }
+
+  start = bench_now_us();
+  for(id = 1; id <= NUM_SERVERS; id++) {
+    make_addr(&addr, id);
+    coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
+    coap_set_header_uri_path(request, "s");
+#if COAP_ASYNC_CLIENT
+    if(coap_async_request(&addr, UIP_HTONS(COAP_DEFAULT_PORT), request,
+                          async_handler, (void *)(uintptr_t)id) == NULL) {
+      TEST_FAIL("coap_async_request");
+    }
+#else
+    current = id;
+    COAP_BLOCKING_REQUEST(&addr, UIP_HTONS(COAP_DEFAULT_PORT), request,
+                          blocking_handler);
+#endif
+  }
+  PROCESS_WAIT_UNTIL(completed + wrong >= NUM_SERVERS);
+  elapsed = bench_now_us() - start;
+
+  bench_report("requests", requests, 1, "");
+  bench_report("bytes received", bytes, 1, "");
+  bench_report("time", elapsed / 1000, 1, "ms");
+  bench_report("throughput", requests * 1000, elapsed / 1000, "requests/s");
+  bench_report("wrong or missing responses", wrong + NUM_SERVERS - completed,
+               1, "");
+
+#if COAP_ASYNC_CLIENT
+  /* Cancelled after the first block, so only one request goes out */
+  sent = requests;
+  make_addr(&addr, 1);
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
+  coap_set_header_uri_path(request, "s");
+  cancelled = coap_async_request(&addr, UIP_HTONS(COAP_DEFAULT_PORT), request,
+                                 cancel_handler, NULL);
+  if(cancelled == NULL) {
+    TEST_FAIL("coap_async_request");
+  }
+  etimer_set(&et, 5 * RTT);
+  PROCESS_WAIT_UNTIL(etimer_expired(&et));
+  bench_report("requests after cancel in callback", requests - sent, 1, "");
+
+  /* The next request to the same server is answered in full */
+  completed = 0;
+  coap_init_message(request, COAP_TYPE_CON, COAP_GET, 0);
+  coap_set_header_uri_path(request, "s");
+  if(coap_async_request(&addr, UIP_HTONS(COAP_DEFAULT_PORT), request,
+                        async_handler, (void *)(uintptr_t)1) == NULL) {
+    TEST_FAIL("coap_async_request");
+  }
+  etimer_set(&et, 5 * RTT);
+  PROCESS_WAIT_UNTIL(completed > 0 || etimer_expired(&et));
+  if(requests - sent != 1 + NUM_BLOCKS || completed != 1) {
+    TEST_FAIL("cancel in callback");
+  }
+#endif
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of CoAP observe notifications to 32 observers of a
+ *         resource that acknowledge every confirmable notification at
+ *         once: how often the resource renders its state, how many
+ *         notifications go out, the time per notification, and whether
+ *         every observer gets the last state with its own token.
+ */
+
+#include "contiki.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/mac/mac.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "rest-engine.h"
+#include "er-coap.h"
+#include "er-coap-observe.h"
+#include "er-coap-transactions.h"
+#include "../bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_OBSERVERS 32
+#define NUM_ROUNDS    40
+#define FRAME_LEN     128
+
+static coap_observer_t *observers[NUM_OBSERVERS];
+static uint8_t frames[NUM_OBSERVERS][FRAME_LEN];
+static uint8_t frame_len[NUM_OBSERVERS];
+static uint32_t sent, renders, round;
+
+static void res_get_handler(void *request, void *response, uint8_t *buffer,
+                            uint16_t preferred_size, int32_t *offset);
+
+EVENT_RESOURCE(res_bench, "title=\"Bench\";obs", res_get_handler,
+               NULL, NULL, NULL, NULL);
+
+PROCESS(bench_process, "CoAP observe benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+/* A MAC that keeps the last frame to each observer */
+static void
+mac_send(mac_callback_t sent_callback, void *ptr)
+{
+  const linkaddr_t *receiver = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  uint8_t id = receiver->u8[LINKADDR_SIZE - 1];
+
+  if(!linkaddr_cmp(receiver, &linkaddr_null) && id > 0 &&
+     id <= NUM_OBSERVERS && packetbuf_totlen() <= FRAME_LEN) {
+    sent++;
+    frame_len[id - 1] = packetbuf_totlen();
+    memcpy(frames[id - 1], packetbuf_hdrptr(), packetbuf_totlen());
+  }
+  mac_call_sent_callback(sent_callback, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_off(int keep_radio_on)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+mac_channel_check_interval(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver bench_mac_driver = {
+  "bench",
+  mac_init,
+  mac_send,
+  mac_input,
+  mac_on,
+  mac_off,
+  mac_channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
+static void
+res_get_handler(void *request, void *response, uint8_t *buffer,
+                uint16_t preferred_size, int32_t *offset)
+{
+  renders++;
+  REST.set_header_content_type(response, REST.type.TEXT_PLAIN);
+  REST.set_response_payload(response, buffer,
+                            snprintf((char *)buffer, preferred_size,
+                                     "state %lu", (unsigned long)round));
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_observer(uint8_t id)
+{
+  uip_ipaddr_t ipaddr;
+  linkaddr_t lladdr;
+  uint8_t token[2];
+
+  memset(&lladdr, 0, sizeof(linkaddr_t));
+  lladdr.u8[0] = 0x02;
+  lladdr.u8[LINKADDR_SIZE - 1] = id;
+  uip_ip6addr(&ipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(&ipaddr, (uip_lladdr_t *)&lladdr);
+  if(uip_ds6_nbr_add(&ipaddr, (uip_lladdr_t *)&lladdr, 1,
+                     NBR_REACHABLE) == NULL) {
+    TEST_FAIL("uip_ds6_nbr_add");
+  }
+
+  token[0] = 0xbe;
+  token[1] = id;
+  observers[id - 1] = coap_add_observer(&ipaddr, UIP_HTONS(COAP_DEFAULT_PORT),
+                                        token, sizeof(token), res_bench.url);
+  if(observers[id - 1] == NULL) {
+    TEST_FAIL("coap_add_observer");
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The observers acknowledge the confirmable notifications */
+static void
+ack_notifications(void)
+{
+  coap_observer_t *obs;
+#if !COAP_OBSERVE_SHARED_NOTIFY
+  coap_transaction_t *t;
+#endif
+  uint8_t i;
+
+  for(i = 0; i < NUM_OBSERVERS; i++) {
+    obs = observers[i];
+#if COAP_OBSERVE_SHARED_NOTIFY
+    coap_observe_acked(&obs->addr, obs->port, obs->last_mid);
+#else
+    if((t = coap_get_transaction_by_mid(obs->last_mid)) != NULL) {
+      coap_clear_transaction(t);
+    }
+#endif
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Finds the notification in the last frame to an observer and checks it */
+static int
+check_notification(uint8_t id)
+{
+  static coap_packet_t message[1];
+  char expected[16];
+  const uint8_t *data;
+  uint16_t mid;
+  int i, len;
+
+  mid = observers[id - 1]->last_mid;
+  len = snprintf(expected, sizeof(expected), "state %lu",
+                 (unsigned long)round);
+  for(i = 0; i + COAP_HEADER_LEN < frame_len[id - 1]; i++) {
+    if(frames[id - 1][i + 1] == CONTENT_2_05 &&
+       frames[id - 1][i + 2] == (mid >> 8) &&
+       frames[id - 1][i + 3] == (mid & 0xff) &&
+       coap_parse_message(message, frames[id - 1] + i,
+                          frame_len[id - 1] - i) == NO_ERROR) {
+      data = message->payload;
+      return message->token_len == 2 && message->token[1] == id &&
+        IS_OPTION(message, COAP_OPTION_OBSERVE) &&
+        message->payload_len == len && memcmp(data, expected, len) == 0;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* The resource changes twice before the observers acknowledge the
+   confirmable notification, and they acknowledge the MID it went out
+   with. Returns the observers whose notification is still pending. */
+static uint32_t
+ack_after_two_notifies(void)
+{
+  static uint16_t mids[NUM_OBSERVERS];
+#if COAP_OBSERVE_SHARED_NOTIFY
+  coap_observer_t *obs;
+#else
+  coap_transaction_t *t;
+#endif
+  uint32_t pending;
+  uint8_t i;
+
+  /* the next notification is confirmable */
+  while(observers[0]->obs_counter % COAP_OBSERVE_REFRESH_INTERVAL != 0) {
+    round++;
+    coap_notify_observers(&res_bench);
+    ack_notifications();
+  }
+  round++;
+  coap_notify_observers(&res_bench);
+  for(i = 0; i < NUM_OBSERVERS; i++) {
+    mids[i] = observers[i]->last_mid;
+  }
+  round++;
+  coap_notify_observers(&res_bench);
+
+  pending = 0;
+  for(i = 0; i < NUM_OBSERVERS; i++) {
+#if COAP_OBSERVE_SHARED_NOTIFY
+    obs = observers[i];
+    coap_observe_acked(&obs->addr, obs->port, mids[i]);
+    if(obs->notification != NULL) {
+      pending++;
+    }
+#else
+    if((t = coap_get_transaction_by_mid(mids[i])) != NULL) {
+      coap_clear_transaction(t);
+    }
+    if(coap_get_transaction_by_mid(mids[i]) != NULL) {
+      pending++;
+    }
+#endif
+  }
+  ack_notifications();
+  return pending;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  uint32_t start, elapsed, wrong;
+  uint8_t id;
+
+  PROCESS_BEGIN();
+
+#if COAP_OBSERVE_SHARED_NOTIFY
+  TEST_RESULT("observe notifications", "shared");
+#else
+  TEST_RESULT("observe notifications", "per observer");
+#endif
+
+  rest_init_engine();
+  rest_activate_resource(&res_bench, "bench");
+
+  for(id = 1; id <= NUM_OBSERVERS; id++) {
+    add_observer(id);
+  }
+
+  elapsed = 0;
+  for(round = 0; round < NUM_ROUNDS; round++) {
+    start = bench_now_us();
+    coap_notify_observers(&res_bench);
+    elapsed += bench_now_us() - start;
+    ack_notifications();
+  }
+  round--;
+
+  bench_report("renders", renders, 1, "");
+  bench_report("notifications sent", sent, 1, "");
+  bench_report("time", elapsed * 1000, sent, "ns/notification");
+
+  wrong = 0;
+  for(id = 1; id <= NUM_OBSERVERS; id++) {
+    if(!check_notification(id)) {
+      wrong++;
+    }
+  }
+  bench_report("observers without last state", wrong, 1, "");
+  bench_report("pending after ACK of a replaced notification",
+               ack_after_two_notifies(), 1, "");
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of parsing and serializing CoAP messages. A corpus of
+ *         captured requests and responses is parsed and the options a
+ *         server looks at are read, either with coap_parse_message() or
+ *         with coap_index_message(). Then a response with a payload in
+ *         the headroom of its buffer is serialized, either with
+ *         coap_serialize_message() or in place. The time per message
+ *         and the size of the parse state on the stack are reported.
+ */
+
+#include "contiki.h"
+#include "er-coap.h"
+#include "../bench.h"
+
+#include <string.h>
+
+#define ROUNDS 20000
+
+struct corpus_message {
+  uint16_t len;
+  uint8_t data[96];
+};
+
+static const struct corpus_message corpus[] = {
+  /* GET /sensors/temperature */
+  { 26, {
+      0x42, 0x01, 0x1a, 0x2b, 0x4f, 0x01, 0xb7, 0x73, 0x65, 0x6e,
+      0x73, 0x6f, 0x72, 0x73, 0x0b, 0x74, 0x65, 0x6d, 0x70, 0x65,
+      0x72, 0x61, 0x74, 0x75, 0x72, 0x65
+    } },
+  /* GET with Observe and Accept */
+  { 25, {
+      0x44, 0x01, 0x1a, 0x2c, 0x4f, 0x02, 0x33, 0x10, 0x60, 0x57,
+      0x73, 0x65, 0x6e, 0x73, 0x6f, 0x72, 0x73, 0x05, 0x6c, 0x69,
+      0x67, 0x68, 0x74, 0x61, 0x32
+    } },
+  /* GET /.well-known/core?rt=temp */
+  { 30, {
+      0x41, 0x01, 0x1a, 0x2d, 0x01, 0xbb, 0x2e, 0x77, 0x65, 0x6c,
+      0x6c, 0x2d, 0x6b, 0x6e, 0x6f, 0x77, 0x6e, 0x04, 0x63, 0x6f,
+      0x72, 0x65, 0x47, 0x72, 0x74, 0x3d, 0x74, 0x65, 0x6d, 0x70
+    } },
+  /* GET Block2 request */
+  { 17, {
+      0x42, 0x01, 0x1a, 0x2e, 0x02, 0x7a, 0xb2, 0x66, 0x77, 0x05,
+      0x69, 0x6d, 0x61, 0x67, 0x65, 0xc1, 0x52
+    } },
+  /* PUT Block1 with payload */
+  { 86, {
+      0x41, 0x03, 0x1a, 0x2f, 0x03, 0xb6, 0x63, 0x6f, 0x6e, 0x66,
+      0x69, 0x67, 0x11, 0x2a, 0xd1, 0x02, 0x3a, 0xd2, 0x14, 0x01,
+      0x00, 0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+      0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11,
+      0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b,
+      0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25,
+      0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+      0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39,
+      0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f
+    } },
+  /* POST with query */
+  { 44, {
+      0x52, 0x02, 0x1a, 0x30, 0x11, 0x22, 0xb9, 0x61, 0x63, 0x74,
+      0x75, 0x61, 0x74, 0x6f, 0x72, 0x73, 0x04, 0x6c, 0x65, 0x64,
+      0x73, 0x47, 0x63, 0x6f, 0x6c, 0x6f, 0x72, 0x3d, 0x72, 0x07,
+      0x6d, 0x6f, 0x64, 0x65, 0x3d, 0x6f, 0x6e, 0xff, 0x74, 0x6f,
+      0x67, 0x67, 0x6c, 0x65
+    } },
+  /* 2.05 response with payload */
+  { 46, {
+      0x62, 0x45, 0x1a, 0x2b, 0x4f, 0x01, 0x44, 0x12, 0x34, 0x56,
+      0x78, 0x80, 0x21, 0x3c, 0xff, 0x7b, 0x22, 0x74, 0x65, 0x6d,
+      0x70, 0x65, 0x72, 0x61, 0x74, 0x75, 0x72, 0x65, 0x22, 0x3a,
+      0x32, 0x31, 0x2e, 0x35, 0x2c, 0x22, 0x75, 0x6e, 0x69, 0x74,
+      0x22, 0x3a, 0x22, 0x43, 0x22, 0x7d
+    } },
+  /* Observe notification */
+  { 16, {
+      0x54, 0x45, 0x50, 0x01, 0x4f, 0x02, 0x33, 0x10, 0x62, 0x12,
+      0x34, 0x60, 0xff, 0x34, 0x31, 0x37
+    } },
+  /* 2.05 Block2 response */
+  { 78, {
+      0x62, 0x45, 0x1a, 0x2e, 0x02, 0x7a, 0xc1, 0x2a, 0xb1, 0x5a,
+      0x52, 0x04, 0x00, 0xff, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5,
+      0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5,
+      0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5,
+      0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5,
+      0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5,
+      0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5,
+      0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5, 0xa5
+    } },
+  /* Empty ACK */
+  { 4, {
+      0x60, 0x00, 0x50, 0x01
+    } },
+};
+
+#define CORPUS_SIZE (sizeof(corpus) / sizeof(corpus[0]))
+
+static uint8_t work[COAP_MAX_PACKET_SIZE + 1];
+
+PROCESS(bench_process, "CoAP parse benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+/* Parses a message and sums up what a server reads from it */
+static uint32_t
+parse_one(uint8_t *data, uint16_t len)
+{
+  uint32_t sum = 0;
+  uint32_t value;
+#if COAP_ZERO_COPY
+  coap_index_t index[1];
+  int length;
+  int n;
+
+  if(coap_index_message(index, data, len) != NO_ERROR) {
+    return 0;
+  }
+  for(n = 0; (length = coap_index_get_option(index, COAP_OPTION_URI_PATH, n,
+                                             NULL)) >= 0; n++) {
+    /* the length of the path with separators */
+    sum += length + (n > 0);
+  }
+  if(coap_index_get_int_option(index, COAP_OPTION_OBSERVE, &value)) {
+    sum += value;
+  }
+  if(coap_index_get_int_option(index, COAP_OPTION_BLOCK2, &value)) {
+    sum += value >> 4;
+  }
+  if(coap_index_get_int_option(index, COAP_OPTION_CONTENT_FORMAT, &value)) {
+    sum += value;
+  }
+  sum += index->payload_len;
+#else
+  coap_packet_t packet[1];
+  unsigned int format;
+  const char *path;
+
+  if(coap_parse_message(packet, data, len) != NO_ERROR) {
+    return 0;
+  }
+  sum += coap_get_header_uri_path(packet, &path);
+  if(coap_get_header_observe(packet, &value)) {
+    sum += value;
+  }
+  if(coap_get_header_block2(packet, &value, NULL, NULL, NULL)) {
+    sum += value;
+  }
+  if(coap_get_header_content_format(packet, &format)) {
+    sum += format;
+  }
+  sum += packet->payload_len;
+#endif /* COAP_ZERO_COPY */
+  return sum;
+}
+/*---------------------------------------------------------------------------*/
+/* Serializes a response the way the engine does, returns its first byte */
+static uint8_t *
+serialize_one(uint8_t *buffer, uint16_t mid, size_t *len)
+{
+  static const uint8_t token[] = { 0x4f, 0x02, 0x33, 0x10 };
+  static const uint8_t etag[] = { 0x12, 0x34, 0x56, 0x78 };
+  coap_packet_t response[1];
+  int i;
+
+  coap_init_message(response, COAP_TYPE_ACK, CONTENT_2_05, mid);
+  coap_set_token(response, token, sizeof(token));
+  coap_set_header_content_format(response, TEXT_PLAIN);
+  coap_set_header_etag(response, etag, sizeof(etag));
+  coap_set_header_max_age(response, 60);
+  coap_set_header_block2(response, mid & 7, 1, REST_MAX_CHUNK_SIZE);
+
+  /* the resource writes its payload behind the headroom */
+  for(i = 0; i < REST_MAX_CHUNK_SIZE; i++) {
+    buffer[COAP_MAX_HEADER_SIZE + i] = mid + i;
+  }
+  coap_set_payload(response, buffer + COAP_MAX_HEADER_SIZE,
+                   REST_MAX_CHUNK_SIZE);
+
+#if COAP_ZERO_COPY
+  *len = coap_serialize_message_in_place(response, buffer);
+#else
+  *len = coap_serialize_message(response, buffer);
+#endif /* COAP_ZERO_COPY */
+  return response->buffer;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static uint32_t start, elapsed, checksum, wrong;
+  static uint8_t *message;
+  static size_t len;
+  static int i, r;
+
+  PROCESS_BEGIN();
+
+#if COAP_ZERO_COPY
+  TEST_RESULT("CoAP parse", "option index, in place");
+#else
+  TEST_RESULT("CoAP parse", "full parse, payload move");
+#endif
+
+  /* every message of the corpus must parse */
+  for(i = 0; i < CORPUS_SIZE; i++) {
+    memcpy(work, corpus[i].data, corpus[i].len);
+    if(parse_one(work, corpus[i].len) == 0 && corpus[i].data[1] != 0) {
+      wrong++;
+    }
+  }
+
+  checksum = 0;
+  start = bench_now_us();
+  for(r = 0; r < ROUNDS; r++) {
+    for(i = 0; i < CORPUS_SIZE; i++) {
+      /* copy, as the message would arrive in the IP buffer */
+      memcpy(work, corpus[i].data, corpus[i].len);
+      checksum += parse_one(work, corpus[i].len);
+    }
+  }
+  elapsed = bench_now_us() - start;
+  bench_report("parse time per message", elapsed * 1000,
+               ROUNDS * CORPUS_SIZE, "ns");
+  bench_report("parse checksum", checksum, 1, "");
+#if COAP_ZERO_COPY
+  bench_report("parse state on the stack", sizeof(coap_index_t), 1, "bytes");
+#else
+  bench_report("parse state on the stack", sizeof(coap_packet_t), 1, "bytes");
+#endif
+
+  checksum = 0;
+  start = bench_now_us();
+  for(r = 0; r < ROUNDS * CORPUS_SIZE; r++) {
+    message = serialize_one(work, r, &len);
+    checksum += message[len - 1] + len;
+  }
+  elapsed = bench_now_us() - start;
+  bench_report("serialize time per message", elapsed * 1000,
+               ROUNDS * CORPUS_SIZE, "ns");
+  bench_report("serialize checksum", checksum, 1, "");
+
+  /* the last response must parse back to what was set */
+  memmove(work, message, len);
+  if(parse_one(work, len) != (r - 1) % 8 + REST_MAX_CHUNK_SIZE + TEXT_PLAIN) {
+    wrong++;
+  }
+  bench_report("wrong messages", wrong, 1, "");
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of Coffee with a rotating set of log files that fill
+ *         25, 50, 75 and 90 percent of the flash.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/coffee/cfs-coffee.h"
+#include "dev/xmem-stats.h"
+#include "lib/random.h"
+#include "../bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define FILE_SIZE   4096
+#define FILE_PAGES  17
+#define FLASH_PAGES (1024 / 256 * 1024)
+#define MAX_FILES   (FLASH_PAGES / FILE_PAGES)
+
+/* Rotations per fill level, enough to wrap around the flash twice */
+#define NUM_ROTATIONS (2 * MAX_FILES)
+
+/* Timing of a serial flash like the M25P80: every command costs setup
+ * time, every byte is clocked over SPI, and programming and sector
+ * erasure are slow. */
+#define FLASH_COMMAND_US 5
+#define FLASH_BYTE_US    1
+#define FLASH_PROGRAM_US 640
+#define FLASH_ERASE_US   600000UL
+
+PROCESS(bench_process, "Coffee benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+
+static const uint8_t levels[] = { 25, 50, 75, 90 };
+
+static uint16_t oldest, newest;
+static char buf[FILE_SIZE];
+/*---------------------------------------------------------------------------*/
+static const char *
+file_name(uint16_t i)
+{
+  static char name[16];
+
+  sprintf(name, "log%u", i);
+  return name;
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+flash_us(const struct xmem_stats *before)
+{
+  return (xmem_stats.reads - before->reads) * FLASH_COMMAND_US +
+         (xmem_stats.writes - before->writes) *
+         (FLASH_COMMAND_US + FLASH_PROGRAM_US) +
+         (xmem_stats.read_bytes - before->read_bytes +
+          xmem_stats.write_bytes - before->write_bytes) * FLASH_BYTE_US +
+         (xmem_stats.erases - before->erases) * FLASH_ERASE_US;
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_file(uint16_t i)
+{
+  int fd;
+
+  fd = cfs_open(file_name(i), CFS_WRITE);
+  if(fd < 0) {
+    TEST_FAIL("cfs_open for writing");
+  }
+  memset(buf, 'a' + i % 26, sizeof(buf));
+  if(cfs_write(fd, buf, sizeof(buf)) != sizeof(buf)) {
+    TEST_FAIL("cfs_write");
+  }
+  cfs_close(fd);
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_file(uint16_t i)
+{
+  int fd;
+  int ok;
+
+  fd = cfs_open(file_name(i), CFS_READ);
+  if(fd < 0) {
+    return 0;
+  }
+  ok = cfs_read(fd, buf, sizeof(buf)) == sizeof(buf) &&
+       buf[0] == 'a' + i % 26 && buf[sizeof(buf) - 1] == 'a' + i % 26;
+  cfs_close(fd);
+  return ok;
+}
+/*---------------------------------------------------------------------------*/
+static void
+reserve_file(void)
+{
+  if(cfs_coffee_reserve(file_name(newest), FILE_SIZE) < 0) {
+    TEST_FAIL("cfs_coffee_reserve");
+  }
+  write_file(newest);
+  newest++;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static uint8_t l;
+  static uint16_t n, files;
+  static uint32_t t, open_us, open_flash_us, open_reads;
+  static uint32_t reserve_flash_us, reserve_max_us, reserve_erases;
+  static uint32_t erases;
+  static struct xmem_stats before;
+  char desc[40];
+  uint32_t us;
+  int fd;
+
+  PROCESS_BEGIN();
+
+#if COFFEE_INCREMENTAL_GC
+  TEST_RESULT("coffee gc", "incremental");
+#elif COFFEE_PAGE_INDEX
+  TEST_RESULT("coffee gc", "page index");
+#else
+  TEST_RESULT("coffee gc", "headers");
+#endif
+
+  for(l = 0; l < sizeof(levels); l++) {
+    cfs_coffee_format();
+    oldest = newest = 0;
+    files = MAX_FILES * levels[l] / 100;
+    while(newest < files) {
+      reserve_file();
+    }
+
+    open_us = open_flash_us = open_reads = 0;
+    reserve_flash_us = reserve_max_us = reserve_erases = 0;
+    erases = xmem_stats.erases;
+    for(n = 0; n < NUM_ROTATIONS; n++) {
+      /* Drop the oldest log and give other processes a chance to run,
+       * like a logger would between two records. */
+      cfs_remove(file_name(oldest++));
+      PROCESS_PAUSE();
+
+      before = xmem_stats;
+      if(cfs_coffee_reserve(file_name(newest), FILE_SIZE) < 0) {
+        TEST_FAIL("cfs_coffee_reserve");
+      }
+      us = flash_us(&before);
+      reserve_flash_us += us;
+      if(us > reserve_max_us) {
+        reserve_max_us = us;
+      }
+      reserve_erases += xmem_stats.erases - before.erases;
+      write_file(newest);
+      newest++;
+
+      before = xmem_stats;
+      t = bench_now_us();
+      fd = cfs_open(file_name(oldest + random_rand() % (newest - oldest)),
+                    CFS_READ);
+      open_us += bench_now_us() - t;
+      if(fd < 0) {
+        TEST_FAIL("cfs_open");
+      }
+      cfs_close(fd);
+      open_flash_us += flash_us(&before);
+      open_reads += xmem_stats.reads - before.reads;
+    }
+
+    sprintf(desc, "open %u%% full, host", levels[l]);
+    bench_report(desc, open_us, NUM_ROTATIONS, "us/op");
+    sprintf(desc, "open %u%% full, reads", levels[l]);
+    bench_report(desc, open_reads, NUM_ROTATIONS, "/op");
+    sprintf(desc, "open %u%% full, flash", levels[l]);
+    bench_report(desc, open_flash_us, NUM_ROTATIONS, "us/op");
+    sprintf(desc, "reserve %u%% full, flash", levels[l]);
+    bench_report(desc, reserve_flash_us, NUM_ROTATIONS, "us/op");
+    sprintf(desc, "reserve %u%% full, worst", levels[l]);
+    bench_report(desc, reserve_max_us, 1000, "ms");
+    sprintf(desc, "reserve %u%% full, erases", levels[l]);
+    bench_report(desc, reserve_erases, 1, "");
+    sprintf(desc, "background %u%% full, erases", levels[l]);
+    bench_report(desc, xmem_stats.erases - erases - reserve_erases, 1, "");
+
+    for(n = oldest; n < newest; n++) {
+      if(!check_file(n)) {
+        TEST_FAIL("file contents");
+      }
+    }
+  }
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
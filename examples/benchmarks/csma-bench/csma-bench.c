@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the CSMA neighbor queues of a node with six
+ *         children: one child takes bulk traffic, one hardly ever
+ *         acks and the others get a packet now and then. The radio
+ *         below CSMA takes the airtime of every frame.
+ */
+
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "net/netstack.h"
+#include "net/mac/csma.h"
+#include "../bench.h"
+
+#include <string.h>
+#include <stdio.h>
+
+#define DURATION (5 * CLOCK_SECOND)
+#define DRAIN (5 * CLOCK_SECOND)
+#define TICK (CLOCK_SECOND / 50)
+#define PAYLOAD_LEN 60
+/* 802.15.4 header and footer, at 32 us per byte */
+#define FRAME_OVERHEAD 11
+#define US_PER_BYTE 32
+
+#define NUM_CHILDREN 6
+#define LOSSY_CHILD 1
+#define BULK_CHILD 2
+#define BULK_PER_TICK 3
+/* The lossy child acks one attempt in this many */
+#define LOSSY_ACK_EVERY 4
+
+#define MAX_PACKETS (DURATION / TICK * (BULK_PER_TICK + 1))
+
+enum { BULK, LIGHT, LOSSY, NUM_CLASSES };
+static const char *class_names[] = { "bulk", "light", "lossy" };
+
+static struct packet {
+  uint8_t class;
+  uint32_t queued;
+} packets[MAX_PACKETS];
+static unsigned num_packets;
+
+static struct {
+  uint32_t sent, delivered, wait_total, wait_max;
+} classes[NUM_CLASSES];
+
+static uint32_t frames, rdc_calls, lossy_attempts;
+
+#if BENCH_RDC_DEFER
+/* The RDC holds every frame until the receiver wakes up and calls
+   back only once it went out, as ContikiMAC with phase optimization
+   does. One frame per child may be held at a time. */
+#define DEFER_TIME (CLOCK_SECOND / 100)
+static struct deferred {
+  struct ctimer timer;
+  mac_callback_t sent;
+  void *ptr;
+  struct queuebuf *q;
+} deferred[NUM_CHILDREN + 1];
+/* Packets handed to the RDC again while it still held them */
+static uint32_t duplicates;
+#endif /* BENCH_RDC_DEFER */
+
+PROCESS(bench_process, "CSMA benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static int
+send_one(mac_callback_t sent, void *ptr)
+{
+  const linkaddr_t *dest = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  uint32_t start;
+  int status;
+
+  start = bench_now_us();
+  while(bench_now_us() - start <
+        (packetbuf_totlen() + FRAME_OVERHEAD) * US_PER_BYTE);
+  frames++;
+
+  status = MAC_TX_OK;
+  if(dest->u8[0] == LOSSY_CHILD && ++lossy_attempts % LOSSY_ACK_EVERY) {
+    status = MAC_TX_NOACK;
+  }
+  mac_call_sent_callback(sent, ptr, status, 1);
+  return status == MAC_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *list)
+{
+  struct rdc_buf_list *next;
+
+  while(list != NULL) {
+    next = list->next;
+    queuebuf_to_packetbuf(list->buf);
+    if(!send_one(sent, ptr)) {
+      return;
+    }
+    list = next;
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if BENCH_RDC_DEFER
+static void
+send_deferred(void *ptr)
+{
+  struct deferred *d = ptr;
+
+  queuebuf_to_packetbuf(d->q);
+  queuebuf_free(d->q);
+  d->q = NULL;
+  send_one(d->sent, d->ptr);
+}
+/*---------------------------------------------------------------------------*/
+static int
+defer(mac_callback_t sent, void *ptr)
+{
+  struct deferred *d = &deferred[packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[0]];
+
+  if(d->q != NULL) {
+    /* The copy goes out on top of the one the RDC holds */
+    duplicates++;
+    return 0;
+  }
+  d->q = queuebuf_new_from_packetbuf();
+  if(d->q == NULL) {
+    return 0;
+  }
+  d->sent = sent;
+  d->ptr = ptr;
+  ctimer_set(&d->timer, DEFER_TIME, send_deferred, d);
+  return 1;
+}
+#endif /* BENCH_RDC_DEFER */
+/*---------------------------------------------------------------------------*/
+static void
+rdc_send(mac_callback_t sent, void *ptr)
+{
+  rdc_calls++;
+#if BENCH_RDC_DEFER
+  if(defer(sent, ptr)) {
+    return;
+  }
+#endif /* BENCH_RDC_DEFER */
+  send_one(sent, ptr);
+}
+/*---------------------------------------------------------------------------*/
+static void
+rdc_send_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *list)
+{
+  rdc_calls++;
+#if BENCH_RDC_DEFER
+  /* Only the first frame waits, the rest follow on the next turn */
+  queuebuf_to_packetbuf(list->buf);
+  if(defer(sent, ptr)) {
+    return;
+  }
+#endif /* BENCH_RDC_DEFER */
+  send_list(sent, ptr, list);
+}
+/*---------------------------------------------------------------------------*/
+static void
+rdc_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+rdc_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+rdc_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+rdc_off(int keep_radio_on)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+rdc_channel_check_interval(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+const struct rdc_driver bench_rdc_driver = {
+  "bench",
+  rdc_init,
+  rdc_send,
+  rdc_send_list,
+  rdc_input,
+  rdc_on,
+  rdc_off,
+  rdc_channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
+static void
+packet_sent(void *ptr, int status, int transmissions)
+{
+  struct packet *p = ptr;
+  uint32_t wait;
+
+  if(status == MAC_TX_OK) {
+    wait = bench_now_us() - p->queued;
+    classes[p->class].delivered++;
+    classes[p->class].wait_total += wait;
+    if(wait > classes[p->class].wait_max) {
+      classes[p->class].wait_max = wait;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_to(uint8_t child)
+{
+  static uint8_t payload[PAYLOAD_LEN];
+  struct packet *p;
+  linkaddr_t dest;
+
+  if(num_packets == MAX_PACKETS) {
+    return;
+  }
+  p = &packets[num_packets++];
+  p->class = child == BULK_CHILD ? BULK :
+    child == LOSSY_CHILD ? LOSSY : LIGHT;
+  classes[p->class].sent++;
+
+  memset(&dest, 0, sizeof(dest));
+  dest.u8[0] = child;
+  packetbuf_clear();
+  packetbuf_copyfrom(payload, sizeof(payload));
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &dest);
+  p->queued = bench_now_us();
+  NETSTACK_MAC.send(packet_sent, p);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static struct etimer et;
+  static struct timer duration;
+  static uint8_t i, light;
+  char desc[48];
+
+  PROCESS_BEGIN();
+
+#if CSMA_CONF_FAIR_QUEUEING
+  TEST_RESULT("csma", "fair queueing");
+#else
+  TEST_RESULT("csma", "per neighbor timers");
+#endif
+
+  timer_set(&duration, DURATION);
+  etimer_set(&et, TICK);
+  while(!timer_expired(&duration)) {
+    PROCESS_WAIT_UNTIL(etimer_expired(&et));
+    etimer_reset(&et);
+    for(i = 0; i < BULK_PER_TICK; i++) {
+      send_to(BULK_CHILD);
+    }
+    /* One packet to each of the other children in turn */
+    light = light % (NUM_CHILDREN - 1) + 1;
+    send_to(light < BULK_CHILD ? light : light + 1);
+  }
+  etimer_set(&et, DRAIN);
+  PROCESS_WAIT_UNTIL(etimer_expired(&et));
+
+  for(i = 0; i < NUM_CLASSES; i++) {
+    snprintf(desc, sizeof(desc), "%s delivered", class_names[i]);
+    bench_report(desc, classes[i].delivered * 100, classes[i].sent, "%");
+    if(classes[i].delivered > 0) {
+      snprintf(desc, sizeof(desc), "%s mean wait", class_names[i]);
+      bench_report(desc, classes[i].wait_total / 1000,
+                   classes[i].delivered, "ms");
+      snprintf(desc, sizeof(desc), "%s max wait", class_names[i]);
+      bench_report(desc, classes[i].wait_max / 1000, 1, "ms");
+    }
+  }
+  bench_report("frames per RDC call", frames, rdc_calls, "");
+#if BENCH_RDC_DEFER
+  bench_report("packets handed to the RDC twice", duplicates, 1, "");
+#endif /* BENCH_RDC_DEFER */
+  bench_report("queue refusals", csma_stats.dropped, 1, "");
+  bench_report("mean queue depth", csma_stats.depth_total,
+               csma_stats.queued + csma_stats.dropped, "");
+  bench_report("max queue depth", csma_stats.depth_max, 1, "");
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of IPv6 neighbor cache lookups by IPv6 address,
+ *         as done for every forwarded packet, with 16, 64 and 256
+ *         neighbors.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/ipv6/uip-ds6-nbr.h"
+#include "../bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_LOOKUPS       200000UL
+#define MISS_OFFSET       1000
+
+static const uint16_t sizes[] = { 16, 64, 256 };
+
+PROCESS(bench_process, "IPv6 neighbor benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+/* Global addresses of nodes of the same vendor under one prefix, with
+ * the interface identifier derived from the link-layer address. */
+static void
+make_addrs(uip_ipaddr_t *ipaddr, uip_lladdr_t *lladdr, uint16_t id)
+{
+  memset(lladdr, 0, sizeof(uip_lladdr_t));
+  lladdr->addr[0] = 0x02;
+  lladdr->addr[1] = 0x12;
+  lladdr->addr[2] = 0x4b;
+  lladdr->addr[sizeof(uip_lladdr_t) - 2] = id >> 8;
+  lladdr->addr[sizeof(uip_lladdr_t) - 1] = id & 0xff;
+  uip_ip6addr(ipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(ipaddr, lladdr);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_neighbors(uint16_t from, uint16_t to)
+{
+  uip_ipaddr_t ipaddr;
+  uip_lladdr_t lladdr;
+
+  for(; from < to; from++) {
+    make_addrs(&ipaddr, &lladdr, from);
+    if(uip_ds6_nbr_add(&ipaddr, &lladdr, 0, NBR_REACHABLE) == NULL) {
+      TEST_FAIL("uip_ds6_nbr_add");
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Checks that all neighbors that are in the table are found by their
+ * IPv6 address. */
+static int
+check_table(void)
+{
+  uip_ds6_nbr_t *n;
+  int count;
+
+  count = 0;
+  for(n = nbr_table_head(ds6_neighbors); n != NULL;
+      n = nbr_table_next(ds6_neighbors, n)) {
+    if(uip_ds6_nbr_lookup(&n->ipaddr) != n) {
+      TEST_FAIL("lookup of existing neighbor");
+      return -1;
+    }
+    count++;
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(uint16_t size)
+{
+  uip_ipaddr_t ipaddr;
+  uip_lladdr_t lladdr;
+  const uip_lladdr_t *found;
+  uint32_t i, start, elapsed;
+  uint16_t id;
+  char desc[48];
+
+  start = bench_now_us();
+  for(i = 0; i < NUM_LOOKUPS; i++) {
+    id = random_rand() % size;
+    make_addrs(&ipaddr, &lladdr, id);
+    found = uip_ds6_nbr_lladdr_from_ipaddr(&ipaddr);
+    if(found == NULL || memcmp(found, &lladdr, sizeof(lladdr)) != 0) {
+      TEST_FAIL("lookup hit");
+      return;
+    }
+  }
+  elapsed = bench_now_us() - start;
+  snprintf(desc, sizeof(desc), "lookup hit (%u neighbors)", size);
+  bench_report(desc, elapsed * 1000, NUM_LOOKUPS, "ns/op");
+
+  start = bench_now_us();
+  for(i = 0; i < NUM_LOOKUPS; i++) {
+    make_addrs(&ipaddr, &lladdr, MISS_OFFSET + random_rand() % size);
+    if(uip_ds6_nbr_lookup(&ipaddr) != NULL) {
+      TEST_FAIL("lookup miss");
+      return;
+    }
+  }
+  elapsed = bench_now_us() - start;
+  snprintf(desc, sizeof(desc), "lookup miss (%u neighbors)", size);
+  bench_report(desc, elapsed * 1000, NUM_LOOKUPS, "ns/op");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static uint8_t i;
+  static uint16_t added;
+  uip_ipaddr_t ipaddr, old;
+  uip_lladdr_t lladdr;
+
+  PROCESS_BEGIN();
+
+#if UIP_DS6_NBR_IP_HASH
+  TEST_RESULT("ipv6 neighbor index", "hash");
+#else
+  TEST_RESULT("ipv6 neighbor index", "table walk");
+#endif
+
+  added = 0;
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    add_neighbors(added, sizes[i]);
+    added = sizes[i];
+    run(sizes[i]);
+  }
+
+  /* A neighbor that shows up with a new address keeps its entry */
+  make_addrs(&old, &lladdr, 1);
+  uip_ip6addr(&ipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(&ipaddr, &lladdr);
+  uip_ds6_nbr_add(&ipaddr, &lladdr, 0, NBR_REACHABLE);
+  if(uip_ds6_nbr_lookup(&old) != NULL || uip_ds6_nbr_lookup(&ipaddr) == NULL) {
+    TEST_FAIL("address change");
+  }
+
+  /* Overflow the table so that neighbors are replaced, and check that
+   * the index still finds every remaining neighbor. */
+  add_neighbors(MISS_OFFSET, MISS_OFFSET + NBR_TABLE_MAX_NEIGHBORS / 2);
+  bench_report("neighbors after replacement", check_table(), 1, "");
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the event timer backend: cost of setting,
+ *         resetting and stopping timers, of a poll of the etimer
+ *         process without expired timers, and of expiring many timers
+ *         at once.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "../bench.h"
+
+#include <stdio.h>
+
+#define MAX_TIMERS        256
+#define NUM_RESETS        20000UL
+#define NUM_POLLS         20000UL
+
+static struct etimer timers[MAX_TIMERS];
+static uint32_t expired_count;
+static const uint16_t sizes[] = { 16, 64, 256 };
+
+PROCESS(bench_process, "Etimer benchmark");
+PROCESS(sink_process, "Timer sink");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sink_process, ev, data)
+{
+  PROCESS_BEGIN();
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+    expired_count++;
+  }
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+drain(void)
+{
+  while(process_run() > 0);
+}
+/*---------------------------------------------------------------------------*/
+/* Sets a timer that expires to the sink process. */
+static void
+set_timer(struct etimer *et, clock_time_t interval)
+{
+  PROCESS_CONTEXT_BEGIN(&sink_process);
+  etimer_set(et, interval);
+  PROCESS_CONTEXT_END(&sink_process);
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(const char *what, uint16_t n, uint32_t value, uint32_t scale,
+       const char *unit)
+{
+  char desc[48];
+
+  snprintf(desc, sizeof(desc), "%s (%u timers)", what, n);
+  bench_report(desc, value, scale, unit);
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(uint16_t n)
+{
+  uint32_t i, start, elapsed;
+  clock_time_t wait;
+
+  /* Set long running timers with random intervals. */
+  start = bench_now_us();
+  for(i = 0; i < n; i++) {
+    set_timer(&timers[i], CLOCK_SECOND * 60 + random_rand() % 1000);
+  }
+  elapsed = bench_now_us() - start;
+  report("set", n, elapsed * 1000, n, "ns/op");
+
+  start = bench_now_us();
+  for(i = 0; i < NUM_RESETS; i++) {
+    set_timer(&timers[random_rand() % n],
+               CLOCK_SECOND * 60 + random_rand() % 1000);
+  }
+  elapsed = bench_now_us() - start;
+  report("reset", n, elapsed * 1000, NUM_RESETS, "ns/op");
+
+  /* Poll the etimer process without any timer expiring. */
+  drain();
+  start = bench_now_us();
+  for(i = 0; i < NUM_POLLS; i++) {
+    etimer_request_poll();
+    process_run();
+  }
+  elapsed = bench_now_us() - start;
+  report("poll", n, elapsed * 1000, NUM_POLLS, "ns/op");
+
+  start = bench_now_us();
+  for(i = 0; i < n; i++) {
+    etimer_stop(&timers[i]);
+  }
+  elapsed = bench_now_us() - start;
+  report("stop", n, elapsed * 1000, n, "ns/op");
+
+  /* Let all timers expire at once and measure the time to deliver
+     the timer events. */
+  for(i = 0; i < n; i++) {
+    set_timer(&timers[i], 1 + random_rand() % 2);
+  }
+
+  wait = clock_time();
+  while(clock_time() - wait < 3);
+
+  expired_count = 0;
+  start = bench_now_us();
+  etimer_request_poll();
+  while(expired_count < n) {
+    process_run();
+  }
+  elapsed = bench_now_us() - start;
+  report("expire", n, elapsed * 1000, n, "ns/timer");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static uint8_t i;
+
+  PROCESS_BEGIN();
+
+#if ETIMER_CONF_HEAP
+  TEST_RESULT("etimer backend", "heap");
+#else
+  TEST_RESULT("etimer backend", "list");
+#endif
+
+  process_start(&sink_process, NULL);
+  drain();
+
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    run(sizes[i]);
+  }
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the FAT driver on a disk image: appending to a
+ *         log file, with and without reopening it, random seeks and
+ *         sequential writes of large chunks.
+ */
+
+#include "contiki.h"
+#include "fat/cfs-fat.h"
+#include "fat/diskio.h"
+#include "dev/diskio-file.h"
+#include "lib/random.h"
+#include "../bench.h"
+
+#include <stdio.h>
+
+#define FILE_NAME         "log.dat"
+#define RECORD_SIZE       64
+#define RECORDS_PER_OPEN  8
+#define LOG_SIZE          (2UL * 1024 * 1024)
+#define NUM_SEEKS         2000
+#define READ_SIZE         16
+#define STREAM_NAME       "stream.dat"
+#define STREAM_CHUNK      4096
+#define STREAM_SIZE       (4UL * 1024 * 1024)
+
+PROCESS(bench_process, "FAT benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static uint8_t
+pattern(uint32_t offset)
+{
+  return (uint8_t)(offset ^ (offset >> 8) ^ (offset >> 16));
+}
+/*---------------------------------------------------------------------------*/
+/* Reports the device time of the disk model since the last report. */
+static void
+report_device(const char *desc, uint32_t units, const char *unit)
+{
+  bench_report(desc, diskio_file_get_stats()->device_us, units, unit);
+  diskio_file_reset_stats();
+}
+/*---------------------------------------------------------------------------*/
+static int
+write_record(int fd, uint32_t offset)
+{
+  uint8_t record[RECORD_SIZE];
+  uint16_t i;
+
+  for(i = 0; i < RECORD_SIZE; i++) {
+    record[i] = pattern(offset + i);
+  }
+  if(cfs_write(fd, record, RECORD_SIZE) != RECORD_SIZE) {
+    TEST_FAIL("cfs_write");
+    return -1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Appends records to the log, opening and closing it for each few
+ * records like a logger that sleeps in between. */
+static void
+append_reopen(uint32_t size)
+{
+  uint32_t offset, start, elapsed, tail;
+  uint16_t i;
+  int fd;
+
+  start = bench_now_us();
+  tail = 0;
+  for(offset = 0; offset < size;) {
+    if(offset == size - size / 8) {
+      tail = bench_now_us();
+    }
+    fd = cfs_open(FILE_NAME, CFS_READ | CFS_APPEND);
+    if(fd < 0) {
+      TEST_FAIL("cfs_open");
+      return;
+    }
+    for(i = 0; i < RECORDS_PER_OPEN; i++, offset += RECORD_SIZE) {
+      if(write_record(fd, offset) < 0) {
+        return;
+      }
+    }
+    cfs_close(fd);
+  }
+  elapsed = bench_now_us() - start;
+  bench_report("append with reopen, average", elapsed,
+               size / (RECORD_SIZE * RECORDS_PER_OPEN), "us/open");
+  bench_report("append with reopen, last 1/8", bench_now_us() - tail,
+               size / 8 / (RECORD_SIZE * RECORDS_PER_OPEN), "us/open");
+  report_device("append with reopen, device time",
+                size / (RECORD_SIZE * RECORDS_PER_OPEN), "us/open");
+}
+/*---------------------------------------------------------------------------*/
+/* Appends records to the log, keeping it open. */
+static void
+append_open(uint32_t size)
+{
+  uint32_t offset, end, start, elapsed;
+  int fd;
+
+  fd = cfs_open(FILE_NAME, CFS_READ | CFS_APPEND);
+  if(fd < 0) {
+    TEST_FAIL("cfs_open");
+    return;
+  }
+  offset = cfs_fat_file_size(fd);
+  end = offset + size;
+  start = bench_now_us();
+  for(; offset < end; offset += RECORD_SIZE) {
+    if(write_record(fd, offset) < 0) {
+      return;
+    }
+  }
+  cfs_close(fd);
+  elapsed = bench_now_us() - start;
+  bench_report("append kept open", elapsed * 1000, size / RECORD_SIZE,
+               "ns/record");
+  report_device("append kept open, device time", size / RECORD_SIZE,
+                "us/record");
+}
+/*---------------------------------------------------------------------------*/
+static void
+seek_read(void)
+{
+  uint8_t buf[READ_SIZE];
+  uint32_t size, offset, start, elapsed;
+  uint16_t i, j;
+  int fd;
+
+  fd = cfs_open(FILE_NAME, CFS_READ);
+  if(fd < 0) {
+    TEST_FAIL("cfs_open");
+    return;
+  }
+  size = cfs_fat_file_size(fd);
+
+  start = bench_now_us();
+  for(i = 0; i < NUM_SEEKS; i++) {
+    offset = (((uint32_t)random_rand() << 16) | random_rand()) %
+      (size - READ_SIZE);
+    cfs_seek(fd, offset, CFS_SEEK_SET);
+    if(cfs_read(fd, buf, READ_SIZE) != READ_SIZE) {
+      TEST_FAIL("cfs_read");
+      return;
+    }
+    for(j = 0; j < READ_SIZE; j++) {
+      if(buf[j] != pattern(offset + j)) {
+        TEST_FAIL("content after seek");
+        return;
+      }
+    }
+  }
+  elapsed = bench_now_us() - start;
+  cfs_close(fd);
+  bench_report("random seek and read", elapsed, NUM_SEEKS, "us/op");
+  report_device("random seek and read, device time", NUM_SEEKS, "us/op");
+}
+/*---------------------------------------------------------------------------*/
+/* Writes a file in large chunks, like a logger flushing its RAM buffer. */
+static void
+write_stream(uint32_t size)
+{
+  static uint8_t chunk[STREAM_CHUNK];
+  uint32_t offset, start, elapsed;
+  uint16_t i;
+  int fd;
+
+  fd = cfs_open(STREAM_NAME, CFS_WRITE);
+  if(fd < 0) {
+    TEST_FAIL("cfs_open");
+    return;
+  }
+  elapsed = 0;
+  for(offset = 0; offset < size; offset += STREAM_CHUNK) {
+    for(i = 0; i < STREAM_CHUNK; i++) {
+      chunk[i] = pattern(offset + i);
+    }
+    start = bench_now_us();
+    if(cfs_write(fd, chunk, STREAM_CHUNK) != STREAM_CHUNK) {
+      TEST_FAIL("cfs_write");
+      return;
+    }
+    elapsed += bench_now_us() - start;
+  }
+  start = bench_now_us();
+  cfs_close(fd);
+  elapsed += bench_now_us() - start;
+  bench_report("sequential write, 4 KB chunks", elapsed, size / 1024,
+               "us/KB");
+  bench_report("sequential write, blocks read",
+               diskio_file_get_stats()->blocks_read, 1, "blocks");
+  bench_report("sequential write, blocks written",
+               diskio_file_get_stats()->blocks_written, 1, "blocks");
+  bench_report("sequential write, commands",
+               diskio_file_get_stats()->commands, 1, "commands");
+  bench_report("sequential write, multi block writes",
+               diskio_file_get_stats()->multi_block_writes, 1, "writes");
+  report_device("sequential write, device time", size / 1024, "us/KB");
+}
+/*---------------------------------------------------------------------------*/
+/* Reads a whole file back from the disk and checks it. */
+static uint32_t
+verify(const char *name)
+{
+  uint8_t buf[512];
+  uint32_t offset;
+  int fd, n, j;
+
+  fd = cfs_open(name, CFS_READ);
+  if(fd < 0) {
+    TEST_FAIL("cfs_open");
+    return 0;
+  }
+  offset = 0;
+  while((n = cfs_read(fd, buf, sizeof(buf))) > 0) {
+    for(j = 0; j < n; j++, offset++) {
+      if(buf[j] != pattern(offset)) {
+        TEST_FAIL("file content");
+        cfs_close(fd);
+        return offset;
+      }
+    }
+  }
+  cfs_close(fd);
+  return offset;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static struct diskio_device_info *dev;
+  uint8_t i;
+
+  PROCESS_BEGIN();
+
+  bench_report("sector cache", FAT_SECTOR_CACHE_SIZE, 1, "sectors");
+  bench_report("extent cache", FAT_EXTENT_CACHE_SIZE, 1, "extents");
+  bench_report("multi block write", FAT_MULTI_BLOCK_WRITE, 1, "");
+
+  if(diskio_detect_devices() != DISKIO_SUCCESS) {
+    TEST_FAIL("diskio_detect_devices");
+  }
+  dev = NULL;
+  for(i = 0; i < DISKIO_MAX_DEVICES; i++) {
+    if(diskio_devices()[i].type == DISKIO_DEVICE_TYPE_FILE) {
+      dev = &diskio_devices()[i];
+      break;
+    }
+  }
+  if(dev == NULL || cfs_fat_mkfs(dev) != 0 ||
+     cfs_fat_mount_device(dev) != 0) {
+    TEST_FAIL("disk image");
+  }
+  diskio_set_default_device(dev);
+  diskio_file_reset_stats();
+
+  append_reopen(LOG_SIZE);
+  append_open(LOG_SIZE);
+  seek_read();
+  write_stream(STREAM_SIZE);
+
+  /* Remount, so that the files are read from the disk image */
+  cfs_fat_umount_device();
+  cfs_fat_mount_device(dev);
+  bench_report("verified log size", verify(FILE_NAME), 1024, "KB");
+  bench_report("verified stream size", verify(STREAM_NAME), 1024, "KB");
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
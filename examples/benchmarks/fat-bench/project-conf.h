@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/* Build with DEFINES=FAT_CONF_SECTOR_CACHE_SIZE=8,FAT_CONF_EXTENT_CACHE_SIZE=4
+ * or DEFINES=FAT_CONF_MULTI_BLOCK_WRITE=1 to compare. The device time is
+ * that of an SD card, DEFINES=DISKIO_FILE_CONF_MODEL=diskio_file_model_at45db
+ * selects the dataflash. */
+#ifndef FAT_CONF_SECTOR_CACHE_SIZE
+#define FAT_CONF_SECTOR_CACHE_SIZE 1
+#endif
+#ifndef FAT_CONF_EXTENT_CACHE_SIZE
+#define FAT_CONF_EXTENT_CACHE_SIZE 0
+#endif
+#ifndef FAT_CONF_MULTI_BLOCK_WRITE
+#define FAT_CONF_MULTI_BLOCK_WRITE 0
+#endif
+#ifndef DISKIO_FILE_CONF_MODEL
+#define DISKIO_FILE_CONF_MODEL diskio_file_model_sd
+#endif
+
+#endif /* PROJECT_CONF_H_ */
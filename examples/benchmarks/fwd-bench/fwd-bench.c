@@ -0,0 +1,316 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of a 6LoWPAN router that forwards fragmented UDP
+ *         datagrams from one neighbor to another: the delay it adds
+ *         and its processing time. The fragments it sends are then
+ *         reassembled to check the datagrams.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/simple-udp.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/sicslowpan.h"
+#include "net/mac/mac.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "../bench.h"
+
+#include <string.h>
+
+#define NUM_DGRAMS    2000
+#define UDP_PORT      5678
+#define PAYLOAD_LEN   320
+#define DGRAM_LEN     (UIP_IPUDPH_LEN + PAYLOAD_LEN)
+
+/* The first fragment carries the first 96 bytes of the datagram, the
+   others 88 bytes each */
+#define FRAG1_LEN     96
+#define FRAGN_LEN     88
+#define NUM_FRAGS     (1 + (DGRAM_LEN - FRAG1_LEN + FRAGN_LEN - 1) / FRAGN_LEN)
+#define MAX_FRAMES    (2 * NUM_FRAGS)
+
+#define IPHC_INLINE   0x7b /* hop limit 255, next header inline */
+#define PREV_HOP      1
+#define NEXT_HOP      2
+
+static uint8_t dgram[DGRAM_LEN];
+static uip_ipaddr_t dest_addr;
+static linkaddr_t next_hop;
+
+/* The frames sent to the next hop and the fragment during which each
+   was sent */
+static uint8_t frames[MAX_FRAMES][PACKETBUF_SIZE];
+static uint16_t frame_lens[MAX_FRAMES];
+static uint8_t frame_slots[MAX_FRAMES];
+static uint8_t num_frames, slot;
+
+static uint32_t delivered, corrupted;
+
+PROCESS(bench_process, "Fragment forwarding benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+/* A MAC that keeps the frames to the next hop */
+static void
+mac_send(mac_callback_t sent, void *ptr)
+{
+  if(linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), &next_hop)
+     && num_frames < MAX_FRAMES) {
+    memcpy(frames[num_frames], packetbuf_dataptr(), packetbuf_datalen());
+    frame_lens[num_frames] = packetbuf_datalen();
+    frame_slots[num_frames] = slot;
+    num_frames++;
+  }
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_off(int keep_radio_on)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+mac_channel_check_interval(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver bench_mac_driver = {
+  "bench",
+  mac_init,
+  mac_send,
+  mac_input,
+  mac_on,
+  mac_off,
+  mac_channel_check_interval
+};
+/*---------------------------------------------------------------------------*/
+static uint8_t
+pattern(uint16_t n, uint16_t i)
+{
+  return (n * 7 + i) & 0xff;
+}
+/*---------------------------------------------------------------------------*/
+static void
+receiver(struct simple_udp_connection *c,
+         const uip_ipaddr_t *sender_addr, uint16_t sender_port,
+         const uip_ipaddr_t *receiver_addr, uint16_t receiver_port,
+         const uint8_t *data, uint16_t datalen)
+{
+  uint16_t n, i;
+
+  n = (data[0] << 8) | data[1];
+  for(i = 2; i < datalen; i++) {
+    if(data[i] != pattern(n, i)) {
+      break;
+    }
+  }
+  if(datalen == PAYLOAD_LEN && i == datalen) {
+    delivered++;
+  } else {
+    corrupted++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Builds datagram n in uip_buf to fill in the checksum. */
+static void
+make_dgram(uint16_t n)
+{
+  struct uip_ip_hdr *ip = (struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN];
+  struct uip_udp_hdr *udp = (struct uip_udp_hdr *)&uip_buf[UIP_LLIPH_LEN];
+  uint8_t *payload = &uip_buf[UIP_LLIPH_LEN + UIP_UDPH_LEN];
+  uint16_t i;
+
+  memset(ip, 0, UIP_IPUDPH_LEN);
+  ip->vtc = 0x60;
+  ip->len[0] = (DGRAM_LEN - UIP_IPH_LEN) >> 8;
+  ip->len[1] = (DGRAM_LEN - UIP_IPH_LEN) & 0xff;
+  ip->proto = UIP_PROTO_UDP;
+  ip->ttl = 255;
+  uip_ip6addr(&ip->srcipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 1);
+  uip_ipaddr_copy(&ip->destipaddr, &dest_addr);
+  udp->srcport = UIP_HTONS(UDP_PORT);
+  udp->destport = UIP_HTONS(UDP_PORT);
+  udp->udplen = UIP_HTONS(DGRAM_LEN - UIP_IPH_LEN);
+  payload[0] = n >> 8;
+  payload[1] = n & 0xff;
+  for(i = 2; i < PAYLOAD_LEN; i++) {
+    payload[i] = pattern(n, i);
+  }
+  uip_len = DGRAM_LEN;
+  udp->udpchksum = ~(uip_udpchksum());
+  if(udp->udpchksum == 0) {
+    udp->udpchksum = 0xffff;
+  }
+  memcpy(dgram, ip, DGRAM_LEN);
+  uip_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+input_frame(const uint8_t *frame, uint16_t len,
+            const linkaddr_t *sender, const linkaddr_t *receiver)
+{
+  packetbuf_clear();
+  memcpy(packetbuf_dataptr(), frame, len);
+  packetbuf_set_datalen(len);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, sender);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, receiver);
+  NETSTACK_NETWORK.input();
+}
+/*---------------------------------------------------------------------------*/
+/* Passes fragment n of the datagram from the previous hop to 6LoWPAN. */
+static void
+input_fragment(uint16_t tag, uint8_t n)
+{
+  uint8_t frame[PACKETBUF_SIZE];
+  uint16_t offset, len;
+  linkaddr_t prev_hop;
+
+  frame[0] = (n == 0 ? 0xc0 : 0xe0) | (DGRAM_LEN >> 8);
+  frame[1] = DGRAM_LEN & 0xff;
+  frame[2] = tag >> 8;
+  frame[3] = tag & 0xff;
+  if(n == 0) {
+    /* IPHC with the addresses and next header inline */
+    frame[4] = IPHC_INLINE;
+    frame[5] = 0;
+    frame[6] = UIP_PROTO_UDP;
+    memcpy(&frame[7], &dgram[8], 32);
+    memcpy(&frame[39], &dgram[UIP_IPH_LEN], FRAG1_LEN - UIP_IPH_LEN);
+    len = 39 + FRAG1_LEN - UIP_IPH_LEN;
+  } else {
+    offset = FRAG1_LEN + (n - 1) * FRAGN_LEN;
+    frame[4] = offset >> 3;
+    len = MIN(FRAGN_LEN, DGRAM_LEN - offset);
+    memcpy(&frame[5], &dgram[offset], len);
+    len += 5;
+  }
+
+  memset(&prev_hop, 0, sizeof(prev_hop));
+  prev_hop.u8[LINKADDR_SIZE - 1] = PREV_HOP;
+  input_frame(frame, len, &prev_hop, &linkaddr_node_addr);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static struct simple_udp_connection conn;
+  static uint16_t n;
+  static uint32_t elapsed, delay, sent;
+  uip_ipaddr_t nexthop_addr;
+  uip_ds6_addr_t *addr;
+  uint32_t start;
+  uint8_t i, done;
+
+  PROCESS_BEGIN();
+
+#if SICSLOWPAN_FRAG_FORWARDING > 0
+  TEST_RESULT("forwarding", "fragments");
+#else
+  TEST_RESULT("forwarding", "reassembly");
+#endif
+
+  /* aaaa::99 is reached through the next hop */
+  memset(&next_hop, 0, sizeof(next_hop));
+  next_hop.u8[LINKADDR_SIZE - 1] = NEXT_HOP;
+  uip_ip6addr(&nexthop_addr, 0xfe80, 0, 0, 0, 0, 0, 0, NEXT_HOP);
+  uip_ds6_nbr_add(&nexthop_addr, (uip_lladdr_t *)&next_hop, 1, NBR_REACHABLE);
+  uip_ip6addr(&dest_addr, 0xaaaa, 0, 0, 0, 0, 0, 0, 0x99);
+  if(uip_ds6_route_add(&dest_addr, 128, &nexthop_addr) == NULL) {
+    TEST_FAIL("uip_ds6_route_add");
+  }
+
+  simple_udp_register(&conn, UDP_PORT, NULL, UDP_PORT, receiver);
+
+  for(n = 0; n < NUM_DGRAMS; n++) {
+    make_dgram(n);
+    num_frames = 0;
+    start = bench_now_us();
+    for(slot = 1; slot <= NUM_FRAGS; slot++) {
+      input_fragment(n, slot - 1);
+    }
+    elapsed += bench_now_us() - start;
+
+    /* Each frame takes a slot on the air, after the fragment it was
+       sent during has been received */
+    done = 0;
+    for(i = 0; i < num_frames; i++) {
+      done = MAX(done, frame_slots[i]) + 1;
+    }
+    delay += done - NUM_FRAGS;
+    sent += num_frames;
+
+    /* Receive what was sent to check it */
+    addr = uip_ds6_addr_add(&dest_addr, 0, ADDR_MANUAL);
+    for(i = 0; i < num_frames; i++) {
+      input_frame(frames[i], frame_lens[i], &linkaddr_node_addr, &next_hop);
+    }
+    uip_ds6_addr_rm(addr);
+  }
+
+  bench_report("forwarded", delivered * 100, NUM_DGRAMS, "%");
+  bench_report("corrupted", corrupted, 1, "");
+  bench_report("frames", sent, NUM_DGRAMS, "frames/datagram");
+  bench_report("hop delay", delay, NUM_DGRAMS, "frames");
+  bench_report("input", elapsed * 1000, NUM_DGRAMS * NUM_FRAGS, "ns/fragment");
+#if SICSLOWPAN_FRAG_FORWARDING > 0
+  bench_report("fragment forwarded", sicslowpan_fwd_stats.forwarded, 1, "");
+  bench_report("reassembled", sicslowpan_fwd_stats.reassembled, 1, "");
+#endif
+  if(corrupted > 0) {
+    TEST_FAIL("corrupted datagram");
+  }
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
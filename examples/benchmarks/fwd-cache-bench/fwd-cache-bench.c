@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the IPv6 output of a router that forwards a few
+ *         steady flows, with a full route table and neighbor cache:
+ *         the time per packet from tcpip_ipv6_output() to the MAC,
+ *         whether the routes of the flows survive new routes that
+ *         replace the least recently used ones, and whether packets
+ *         still go to the right next hop once routes and neighbors
+ *         change.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/mac/mac.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "../bench.h"
+
+#include <string.h>
+
+#define NUM_PACKETS   200000UL
+#define NUM_NEIGHBORS 32
+#define NUM_ROUTES    128
+#define NUM_FLOWS     8
+#define PAYLOAD_LEN   32
+
+#define UIP_IP_BUF    ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+static uint16_t flows[NUM_FLOWS];
+static linkaddr_t receiver;
+static uint32_t frames;
+
+PROCESS(bench_process, "Forwarding cache benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+/* A MAC that remembers the receiver of the last frame */
+static void
+mac_send(mac_callback_t sent, void *ptr)
+{
+  linkaddr_copy(&receiver, packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+  frames++;
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_off(int keep_radio_on)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+mac_channel_check_interval(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver bench_mac_driver = {
+  "bench",
+  mac_init,
+  mac_send,
+  mac_input,
+  mac_on,
+  mac_off,
+  mac_channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
+static void
+make_lladdr(linkaddr_t *lladdr, uint8_t id)
+{
+  memset(lladdr, 0, sizeof(linkaddr_t));
+  lladdr->u8[0] = 0x02;
+  lladdr->u8[LINKADDR_SIZE - 1] = id;
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_nbr_addr(uip_ipaddr_t *ipaddr, uint8_t id)
+{
+  linkaddr_t lladdr;
+
+  make_lladdr(&lladdr, id);
+  uip_ip6addr(ipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(ipaddr, (uip_lladdr_t *)&lladdr);
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_dest(uip_ipaddr_t *ipaddr, uint16_t id)
+{
+  uip_ip6addr(ipaddr, 0xbbbb, 0, 0, 0, 0, 0, 0x1000, id);
+}
+/*---------------------------------------------------------------------------*/
+/* Sends a UDP packet to a destination and returns the next hop */
+static uint8_t
+send_to(uint16_t id)
+{
+  memset(UIP_IP_BUF, 0, UIP_IPUDPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[1] = UIP_UDPH_LEN + PAYLOAD_LEN;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 63;
+  uip_ip6addr(&UIP_IP_BUF->srcipaddr, 0xbbbb, 0, 0, 0, 0, 0, 0x2000, 1);
+  make_dest(&UIP_IP_BUF->destipaddr, id);
+  uip_len = UIP_IPUDPH_LEN + PAYLOAD_LEN;
+  uip_ext_len = 0;
+
+  memset(&receiver, 0, sizeof(receiver));
+  tcpip_ipv6_output();
+  return receiver.u8[LINKADDR_SIZE - 1];
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_route(uint16_t id, uint8_t nbr)
+{
+  uip_ipaddr_t dest, nexthop;
+
+  make_dest(&dest, id);
+  make_nbr_addr(&nexthop, nbr);
+  if(uip_ds6_route_add(&dest, 128, &nexthop) == NULL) {
+    TEST_FAIL("uip_ds6_route_add");
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_flow(uint16_t id)
+{
+  int i;
+
+  for(i = 0; i < NUM_FLOWS; i++) {
+    if(flows[i] == id) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static uint32_t i, wrong, evicted;
+  uip_ipaddr_t ipaddr;
+  linkaddr_t lladdr;
+  uint32_t start, elapsed;
+  uint16_t id;
+
+  PROCESS_BEGIN();
+
+#if TCPIP_CONF_FWD_CACHE_SIZE > 0
+  TEST_RESULT("next hop", "forwarding cache");
+#else
+  TEST_RESULT("next hop", "lookups");
+#endif
+
+  for(i = 1; i <= NUM_NEIGHBORS; i++) {
+    make_lladdr(&lladdr, i);
+    make_nbr_addr(&ipaddr, i);
+    uip_ds6_nbr_add(&ipaddr, (uip_lladdr_t *)&lladdr, 1, NBR_REACHABLE);
+  }
+  /* Destination i is reached through neighbor i % 32 + 1 */
+  for(i = 0; i < NUM_ROUTES; i++) {
+    add_route(i, i % NUM_NEIGHBORS + 1);
+  }
+  for(i = 0; i < NUM_FLOWS; i++) {
+    flows[i] = random_rand() % NUM_ROUTES;
+  }
+
+  start = bench_now_us();
+  for(i = 0; i < NUM_PACKETS; i++) {
+    id = flows[i % NUM_FLOWS];
+    if(send_to(id) != id % NUM_NEIGHBORS + 1) {
+      wrong++;
+    }
+  }
+  elapsed = bench_now_us() - start;
+  bench_report("output", elapsed * 1000, NUM_PACKETS, "ns/packet");
+
+  /* Every other route is used once, then the flows send again, so new
+     routes in the full table must replace the other ones */
+  for(id = 0; id < NUM_ROUTES; id++) {
+    if(!is_flow(id)) {
+      make_dest(&ipaddr, id);
+      uip_ds6_route_lookup(&ipaddr);
+    }
+  }
+  for(i = 0; i < NUM_FLOWS; i++) {
+    send_to(flows[i]);
+  }
+  for(id = NUM_ROUTES; id < NUM_ROUTES + NUM_FLOWS; id++) {
+    add_route(id, id % NUM_NEIGHBORS + 1);
+  }
+  for(i = 0; i < NUM_FLOWS; i++) {
+    make_dest(&ipaddr, flows[i]);
+    if(uip_ds6_route_lookup(&ipaddr) == NULL) {
+      evicted++;
+    }
+  }
+  bench_report("flow routes replaced", evicted, 1, "");
+
+  /* A flow moves to another neighbor */
+  id = flows[0];
+  make_dest(&ipaddr, id);
+  uip_ds6_route_rm(uip_ds6_route_lookup(&ipaddr));
+  add_route(id, (id + 1) % NUM_NEIGHBORS + 1);
+  if(send_to(id) != (id + 1) % NUM_NEIGHBORS + 1) {
+    wrong++;
+  }
+
+  /* The neighbor of a flow goes away, with the routes through it */
+  id = flows[1];
+  make_nbr_addr(&ipaddr, id % NUM_NEIGHBORS + 1);
+  uip_ds6_nbr_rm(uip_ds6_nbr_lookup(&ipaddr));
+  frames = 0;
+  send_to(id);
+  if(frames != 0) {
+    wrong++;
+  }
+
+  bench_report("wrong next hops", wrong, 1, "");
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the 6LoWPAN output of UDP and ICMPv6 packets of
+ *         four flows with IPHC compression, timed over the whole
+ *         output path.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/mac/mac.h"
+#include "net/packetbuf.h"
+#include "../bench.h"
+
+#include <string.h>
+
+#define NUM_PACKETS  100000UL
+#define NUM_ROUNDS   10
+#define NUM_FLOWS    4
+#define PAYLOAD_LEN  16
+
+#define UIP_IP_BUF   ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_UDP_BUF  ((struct uip_udp_hdr *)&uip_buf[UIP_LLIPH_LEN])
+
+PROCESS(bench_process, "IPHC compression benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+
+static uint32_t frames, frame_bytes, frame_hash;
+/*---------------------------------------------------------------------------*/
+/* A MAC that hashes the frames instead of sending them */
+static void
+mac_send(mac_callback_t sent, void *ptr)
+{
+  const uint8_t *data;
+  uint16_t i;
+
+  data = packetbuf_dataptr();
+  for(i = 0; i < packetbuf_datalen(); i++) {
+    frame_hash = (frame_hash ^ data[i]) * 16777619UL;
+  }
+  frames++;
+  frame_bytes += packetbuf_datalen();
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_off(int keep_radio_on)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+mac_channel_check_interval(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver bench_mac_driver = {
+  "bench",
+  mac_init,
+  mac_send,
+  mac_input,
+  mac_on,
+  mac_off,
+  mac_channel_check_interval
+};
+/*---------------------------------------------------------------------------*/
+/* Puts packet n into uip_buf. The flows are a link-local UDP flow,
+ * a UDP flow within the context prefix with 4-bit ports, a UDP flow
+ * to a global address with a changing hop limit, and ICMPv6 to a
+ * multicast address. */
+static void
+make_packet(uint32_t n, uip_lladdr_t *lladdr)
+{
+  uint8_t flow;
+  uint8_t *payload;
+  uint8_t i;
+
+  flow = n % NUM_FLOWS;
+  memset(UIP_IP_BUF, 0, UIP_IPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->ttl = 64;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  memset(lladdr, 0, sizeof(*lladdr));
+  lladdr->addr[0] = 0x02;
+  lladdr->addr[7] = flow + 1;
+
+  switch(flow) {
+  case 0:
+    uip_create_linklocal_prefix(&UIP_IP_BUF->srcipaddr);
+    uip_create_linklocal_prefix(&UIP_IP_BUF->destipaddr);
+    UIP_UDP_BUF->srcport = UIP_HTONS(5683);
+    UIP_UDP_BUF->destport = UIP_HTONS(5683);
+    break;
+  case 1:
+    uip_ip6addr(&UIP_IP_BUF->srcipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 0);
+    uip_ip6addr(&UIP_IP_BUF->destipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 0);
+    UIP_UDP_BUF->srcport = UIP_HTONS(0xf0b1);
+    UIP_UDP_BUF->destport = UIP_HTONS(0xf0b2);
+    break;
+  case 2:
+    uip_ip6addr(&UIP_IP_BUF->srcipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 0);
+    uip_ip6addr(&UIP_IP_BUF->destipaddr, 0xbbbb, 0, 0, 0, 0, 0, 0, 1);
+    UIP_IP_BUF->ttl = 60 + (n / NUM_FLOWS) % 4;
+    UIP_UDP_BUF->srcport = UIP_HTONS(1234);
+    UIP_UDP_BUF->destport = UIP_HTONS(0xf012);
+    break;
+  default:
+    uip_create_linklocal_prefix(&UIP_IP_BUF->srcipaddr);
+    uip_ip6addr(&UIP_IP_BUF->destipaddr, 0xff02, 0, 0, 0, 0, 0, 0, 0x1a);
+    UIP_IP_BUF->ttl = 255;
+    UIP_IP_BUF->proto = UIP_PROTO_ICMP6;
+    break;
+  }
+  uip_ds6_set_addr_iid(&UIP_IP_BUF->srcipaddr, &uip_lladdr);
+  if(flow < 2) {
+    uip_ds6_set_addr_iid(&UIP_IP_BUF->destipaddr, lladdr);
+  }
+
+  if(UIP_IP_BUF->proto == UIP_PROTO_UDP) {
+    UIP_UDP_BUF->udplen = UIP_HTONS(UIP_UDPH_LEN + PAYLOAD_LEN);
+    UIP_UDP_BUF->udpchksum = UIP_HTONS(n);
+    payload = &uip_buf[UIP_LLIPH_LEN + UIP_UDPH_LEN];
+    uip_len = UIP_IPH_LEN + UIP_UDPH_LEN + PAYLOAD_LEN;
+  } else {
+    payload = &uip_buf[UIP_LLIPH_LEN];
+    uip_len = UIP_IPH_LEN + PAYLOAD_LEN;
+  }
+  UIP_IP_BUF->len[0] = (uip_len - UIP_IPH_LEN) >> 8;
+  UIP_IP_BUF->len[1] = (uip_len - UIP_IPH_LEN) & 0xff;
+  for(i = 0; i < PAYLOAD_LEN; i++) {
+    payload[i] = n + i;
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static uip_lladdr_t lladdr;
+  uint32_t n, start, build, output;
+  uint8_t round;
+
+  PROCESS_BEGIN();
+
+  TEST_RESULT("iphc", "hc06");
+
+  /* The fastest of a few rounds, less the time to build the packets */
+  frame_hash = 2166136261UL;
+  build = output = UINT32_MAX;
+  for(round = 0; round < NUM_ROUNDS; round++) {
+    start = bench_now_us();
+    for(n = 0; n < NUM_PACKETS; n++) {
+      make_packet(n, &lladdr);
+    }
+    build = MIN(build, bench_now_us() - start);
+
+    start = bench_now_us();
+    for(n = 0; n < NUM_PACKETS; n++) {
+      make_packet(n, &lladdr);
+      tcpip_output(n % NUM_FLOWS == NUM_FLOWS - 1 ? NULL : &lladdr);
+    }
+    output = MIN(output, bench_now_us() - start);
+  }
+
+  bench_report("output", (output - build) * 1000, NUM_PACKETS, "ns/packet");
+  bench_report("frames", frames, NUM_ROUNDS, "");
+  bench_report("6lowpan bytes", frame_bytes, frames, "bytes/packet");
+  bench_report("frame hash", frame_hash, 1, "");
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,643 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of publishing telemetry over MQTT. The broker is stood
+ *         in for by the network layer of the benchmark, which terminates
+ *         the TCP connection and answers every segment 20 ms later. The
+ *         rate of QoS 1 messages is measured, then the broker resets the
+ *         connection in the middle of a stream, then the node reboots in
+ *         the middle of a stream, and then QoS 2 messages are sent. The
+ *         messages lost and delivered twice are reported. Last, the node
+ *         subscribes and unsubscribes while messages are being sent.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/uiplib.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/netstack.h"
+#include "cfs/cfs.h"
+#include "mqtt.h"
+#include "../bench.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define UIP_IP_BUF    ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_TCP_BUF   ((struct uip_tcp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+
+#define TCP_FIN 0x01
+#define TCP_SYN 0x02
+#define TCP_RST 0x04
+#define TCP_PSH 0x08
+#define TCP_ACK 0x10
+
+#define BROKER_IP       "fe80::200:0:0:2"
+#define BROKER_PORT     1883
+#define BROKER_ISS      1000
+#define RTT             (CLOCK_SECOND / 50)
+#define MAX_SEGMENT     UIP_TCP_MSS
+
+#define TOPIC           "bench/telemetry"
+#define PAYLOAD_LEN     32
+#define MAX_SEQ         256
+#define FAULT_AFTER     10
+#define NO_FAULT        0xffff
+#define RECONNECT_DELAY (CLOCK_SECOND / 100)
+#define SUBSCRIBE_AFTER 40
+
+enum {
+  FAULT_NONE,
+  FAULT_RESET,
+  FAULT_REBOOT,
+};
+
+static const struct phase {
+  const char *name;
+  uint16_t messages;
+  mqtt_qos_level_t qos;
+  uint8_t fault;
+  clock_time_t timeout;
+} phases[] = {
+  { "QoS 1", 100, MQTT_QOS_LEVEL_1, FAULT_NONE, 10 * CLOCK_SECOND },
+  { "broker reset", 40, MQTT_QOS_LEVEL_1, FAULT_RESET, 2 * CLOCK_SECOND },
+  { "reboot", 40, MQTT_QOS_LEVEL_1, FAULT_REBOOT, 2 * CLOCK_SECOND },
+  { "QoS 2", 20, MQTT_QOS_LEVEL_2, FAULT_NONE, 2 * CLOCK_SECOND },
+};
+#define NUM_PHASES (sizeof(phases) / sizeof(phases[0]))
+
+/* The stand-in broker, with one client */
+static struct {
+  struct ctimer timer;
+  uip_ipaddr_t addr;
+  uip_ipaddr_t client_addr;
+  uint16_t client_port;
+  uint32_t seq;
+  uint32_t ack;
+  uint8_t flags;
+  uint8_t rx[MQTT_TCP_OUTPUT_BUFF_SIZE];
+  uint16_t rx_len;
+  uint8_t tx[UIP_TCP_MSS];
+  uint16_t tx_len;
+  uint16_t qos2_mids[MQTT_MAX_INFLIGHT];
+  uint8_t qos2_count;
+  uint16_t fault_seq;
+} broker;
+
+static uint8_t delivered[MAX_SEQ];
+static uint16_t first_mids[MAX_SEQ];
+static uint32_t wrong, mid_changes;
+
+static struct mqtt_connection conn;
+static uint8_t connected, disconnected;
+static clock_time_t disconnected_at;
+static uint32_t pubacks, pubcomps;
+static uint8_t subacked, unsubacked;
+
+PROCESS(bench_process, "MQTT publish benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static uint32_t
+get32(const uint8_t *p)
+{
+  return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+    (uint32_t)p[2] << 8 | p[3];
+}
+/*---------------------------------------------------------------------------*/
+static void
+put32(uint8_t *p, uint32_t v)
+{
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+/*---------------------------------------------------------------------------*/
+/* Sends the pending flags and replies of the broker to the IP stack */
+static void
+broker_send(void *ptr)
+{
+  struct uip_tcp_hdr *tcp = UIP_TCP_BUF;
+  uint16_t hdr_len = UIP_TCPH_LEN;
+  uint16_t len = 0;
+  uint8_t flags = broker.flags;
+
+  memset(uip_buf, 0, UIP_IPTCPH_LEN);
+  if(flags & TCP_SYN) {
+    tcp->optdata[0] = 2;
+    tcp->optdata[1] = 4;
+    tcp->optdata[2] = UIP_TCP_MSS >> 8;
+    tcp->optdata[3] = UIP_TCP_MSS & 0xff;
+    hdr_len += 4;
+  } else if(!(flags & TCP_RST)) {
+    len = broker.tx_len;
+    memcpy(&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN + hdr_len], broker.tx, len);
+    if(len > 0) {
+      flags |= TCP_PSH | TCP_ACK;
+    }
+  }
+
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[0] = (hdr_len + len) >> 8;
+  UIP_IP_BUF->len[1] = (hdr_len + len) & 0xff;
+  UIP_IP_BUF->proto = UIP_PROTO_TCP;
+  UIP_IP_BUF->ttl = 64;
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, &broker.addr);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &broker.client_addr);
+  tcp->srcport = UIP_HTONS(BROKER_PORT);
+  tcp->destport = broker.client_port;
+  put32(tcp->seqno, broker.seq);
+  put32(tcp->ackno, broker.ack);
+  tcp->tcpoffset = (hdr_len / 4) << 4;
+  tcp->flags = flags;
+  tcp->wnd[0] = UIP_RECEIVE_WINDOW >> 8;
+  tcp->wnd[1] = UIP_RECEIVE_WINDOW & 0xff;
+  uip_len = UIP_IPH_LEN + hdr_len + len;
+  uip_ext_len = 0;
+  tcp->tcpchksum = ~uip_tcpchksum();
+
+  broker.seq += len + ((flags & (TCP_SYN | TCP_FIN)) ? 1 : 0);
+  broker.flags = 0;
+  broker.tx_len = 0;
+
+  tcpip_input();
+}
+/*---------------------------------------------------------------------------*/
+/* Replies after one round trip, together with what comes until then */
+static void
+broker_reply(uint8_t flags)
+{
+  broker.flags |= flags;
+  if(ctimer_expired(&broker.timer)) {
+    ctimer_set(&broker.timer, RTT, broker_send, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+broker_write(uint8_t type, uint16_t mid)
+{
+  uint8_t *p = &broker.tx[broker.tx_len];
+
+  if(broker.tx_len + 5 > sizeof(broker.tx)) {
+    wrong++;
+    return;
+  }
+  p[0] = type;
+  p[1] = 2;
+  p[2] = mid >> 8;
+  p[3] = mid & 0xff;
+  broker.tx_len += 4;
+  if(type == 0x90) {
+    /* SUBACK with the granted QoS */
+    p[1]++;
+    p[4] = 0;
+    broker.tx_len++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Returns 1 if the broker resets the connection instead */
+static int
+broker_publish(uint8_t fhdr, const uint8_t *body, uint16_t len)
+{
+  uint8_t qos = (fhdr >> 1) & 0x03;
+  uint16_t offset, mid = 0, seq;
+  const uint8_t *payload;
+  uint8_t i;
+
+  offset = 2 + (body[0] << 8 | body[1]);
+  if(qos > 0) {
+    mid = body[offset] << 8 | body[offset + 1];
+    offset += 2;
+  }
+  payload = body + offset;
+  seq = payload[0] << 8 | payload[1];
+  if(len - offset != PAYLOAD_LEN || seq >= MAX_SEQ) {
+    wrong++;
+    return 0;
+  }
+  for(i = 2; i < PAYLOAD_LEN; i++) {
+    if(payload[i] != (uint8_t)(seq + i)) {
+      wrong++;
+      return 0;
+    }
+  }
+
+  /* A message sent again keeps its message ID */
+  if(qos > 0) {
+    if(first_mids[seq] == 0) {
+      first_mids[seq] = mid;
+    } else if((fhdr & 0x08) && first_mids[seq] != mid) {
+      mid_changes++;
+    }
+  }
+
+  if(seq == broker.fault_seq) {
+    /* The segment with this message is lost and the broker restarts */
+    broker.fault_seq = NO_FAULT;
+    broker.tx_len = 0;
+    broker.flags = TCP_RST | TCP_ACK;
+    broker_reply(0);
+    return 1;
+  }
+
+  if(qos == 2) {
+    /* A message that is not released yet is only delivered once */
+    for(i = 0; i < broker.qos2_count && broker.qos2_mids[i] != mid; i++);
+    if(i == broker.qos2_count) {
+      if(broker.qos2_count < MQTT_MAX_INFLIGHT) {
+        broker.qos2_mids[broker.qos2_count++] = mid;
+      }
+      delivered[seq]++;
+    }
+    broker_write(0x50, mid);
+  } else {
+    delivered[seq]++;
+    if(qos == 1) {
+      broker_write(0x40, mid);
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+broker_release(uint16_t mid)
+{
+  uint8_t i;
+
+  for(i = 0; i < broker.qos2_count; i++) {
+    if(broker.qos2_mids[i] == mid) {
+      broker.qos2_mids[i] = broker.qos2_mids[--broker.qos2_count];
+      break;
+    }
+  }
+  broker_write(0x70, mid);
+}
+/*---------------------------------------------------------------------------*/
+/* Handles the complete MQTT packets received */
+static void
+broker_parse(void)
+{
+  uint16_t pos = 0, hdr_len, len;
+  uint8_t *packet;
+
+  while(broker.rx_len - pos >= 2) {
+    packet = &broker.rx[pos];
+    len = 0;
+    for(hdr_len = 1; hdr_len < 4 && pos + hdr_len < broker.rx_len; hdr_len++) {
+      len |= (packet[hdr_len] & 0x7f) << (7 * (hdr_len - 1));
+      if(!(packet[hdr_len] & 0x80)) {
+        break;
+      }
+    }
+    hdr_len++;
+    if(pos + hdr_len + len > broker.rx_len) {
+      break;
+    }
+
+    switch(packet[0] >> 4) {
+    case 1:
+      /* CONNECT */
+      broker_write(0x20, 0);
+      break;
+    case 3:
+      if(broker_publish(packet[0], packet + hdr_len, len)) {
+        broker.rx_len = 0;
+        return;
+      }
+      break;
+    case 6:
+      /* PUBREL */
+      broker_release(packet[hdr_len] << 8 | packet[hdr_len + 1]);
+      break;
+    case 8:
+      /* SUBSCRIBE */
+      broker_write(0x90, packet[hdr_len] << 8 | packet[hdr_len + 1]);
+      break;
+    case 10:
+      /* UNSUBSCRIBE */
+      broker_write(0xb0, packet[hdr_len] << 8 | packet[hdr_len + 1]);
+      break;
+    case 12:
+      /* PINGREQ */
+      broker.tx[broker.tx_len++] = 0xd0;
+      broker.tx[broker.tx_len++] = 0;
+      break;
+    }
+    pos += hdr_len + len;
+  }
+  memmove(broker.rx, &broker.rx[pos], broker.rx_len - pos);
+  broker.rx_len -= pos;
+}
+/*---------------------------------------------------------------------------*/
+/* The output of the IP stack, which is the input of the broker */
+static uint8_t
+broker_input(const uip_lladdr_t *lladdr)
+{
+  struct uip_tcp_hdr *tcp = UIP_TCP_BUF;
+  uint16_t len;
+  uint32_t seq;
+
+  if(UIP_IP_BUF->proto != UIP_PROTO_TCP ||
+     !uip_ipaddr_cmp(&UIP_IP_BUF->destipaddr, &broker.addr) ||
+     tcp->destport != UIP_HTONS(BROKER_PORT)) {
+    return 0;
+  }
+  len = uip_len - UIP_IPH_LEN - ((tcp->tcpoffset >> 4) << 2);
+  seq = get32(tcp->seqno);
+
+  if(tcp->flags & TCP_RST) {
+    ctimer_stop(&broker.timer);
+    return 0;
+  }
+  if(tcp->flags & TCP_SYN) {
+    ctimer_stop(&broker.timer);
+    uip_ipaddr_copy(&broker.client_addr, &UIP_IP_BUF->srcipaddr);
+    broker.client_port = tcp->srcport;
+    broker.seq = BROKER_ISS;
+    broker.ack = seq + 1;
+    broker.flags = 0;
+    broker.rx_len = 0;
+    broker.tx_len = 0;
+    broker.qos2_count = 0;
+    broker_reply(TCP_SYN | TCP_ACK);
+    return 0;
+  }
+  if(broker.flags & TCP_RST) {
+    return 0;
+  }
+
+  if(len > 0 && seq == broker.ack) {
+    if(broker.rx_len + len > sizeof(broker.rx)) {
+      wrong++;
+      return 0;
+    }
+    memcpy(&broker.rx[broker.rx_len],
+           (uint8_t *)tcp + ((tcp->tcpoffset >> 4) << 2), len);
+    broker.rx_len += len;
+    broker.ack += len;
+    broker_parse();
+    broker_reply(TCP_ACK);
+  }
+  if(tcp->flags & TCP_FIN) {
+    broker.ack = seq + len + 1;
+    broker_reply(TCP_FIN | TCP_ACK);
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+network_init(void)
+{
+  tcpip_set_outputfunc(broker_input);
+}
+/*---------------------------------------------------------------------------*/
+static void
+network_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+const struct network_driver bench_network_driver = {
+  "bench",
+  network_init,
+  network_input,
+};
+/*---------------------------------------------------------------------------*/
+static void
+mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data)
+{
+  switch(event) {
+  case MQTT_EVENT_CONNECTED:
+    connected = 1;
+    break;
+  case MQTT_EVENT_DISCONNECTED:
+    if(connected) {
+      connected = 0;
+      disconnected = 1;
+      disconnected_at = clock_time();
+    }
+    break;
+  case MQTT_EVENT_PUBACK:
+    pubacks++;
+    break;
+  case MQTT_EVENT_PUBCOMP:
+    pubcomps++;
+    break;
+  case MQTT_EVENT_SUBACK:
+    subacked = 1;
+    break;
+  case MQTT_EVENT_UNSUBACK:
+    unsubacked = 1;
+    break;
+  default:
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+connect(void)
+{
+  connected = 0;
+  disconnected = 0;
+  /* Reconnecting is up to the application, as in the MQTT demos */
+  conn.auto_reconnect = 0;
+  mqtt_connect(&conn, BROKER_IP, BROKER_PORT, 60);
+}
+/*---------------------------------------------------------------------------*/
+static mqtt_status_t
+publish(uint16_t seq, mqtt_qos_level_t qos)
+{
+  /* Without the window, the engine reads the payload when it sends */
+  static uint8_t payloads[MAX_SEQ][PAYLOAD_LEN];
+  uint8_t *payload = payloads[seq];
+  uint8_t i;
+
+  payload[0] = seq >> 8;
+  payload[1] = seq & 0xff;
+  for(i = 2; i < PAYLOAD_LEN; i++) {
+    payload[i] = seq + i;
+  }
+  return mqtt_publish(&conn, NULL, TOPIC, payload, PAYLOAD_LEN, qos,
+                      MQTT_RETAIN_OFF);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+count_delivered(uint16_t first, uint16_t last, uint16_t *duplicates)
+{
+  uint16_t seq, count = 0;
+
+  *duplicates = 0;
+  for(seq = first; seq < last; seq++) {
+    if(delivered[seq] > 0) {
+      count++;
+      *duplicates += delivered[seq] - 1;
+    }
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static struct etimer et, timeout;
+  static const struct phase *p;
+  static uint16_t next, first;
+  static uint32_t start;
+  static uip_lladdr_t lladdr;
+  static char desc[40];
+  static clock_t cpu;
+  static uint8_t subscribed, unsubscribed;
+  uint32_t elapsed;
+  uint16_t count, duplicates;
+
+  PROCESS_BEGIN();
+
+#if MQTT_PUBLISH_WINDOW && MQTT_SPOOL
+  TEST_RESULT("MQTT publish", "window with spool");
+#elif MQTT_PUBLISH_WINDOW
+  TEST_RESULT("MQTT publish", "window");
+#else
+  TEST_RESULT("MQTT publish", "one at a time");
+#endif
+
+  cfs_remove(MQTT_SPOOL_FILE);
+  cfs_remove(MQTT_SPOOL_FILE ".head");
+
+  uiplib_ip6addrconv(BROKER_IP, &broker.addr);
+  memset(&lladdr, 0, sizeof(lladdr));
+  lladdr.addr[0] = 0x02;
+  lladdr.addr[sizeof(lladdr.addr) - 1] = 2;
+  if(uip_ds6_nbr_add(&broker.addr, &lladdr, 0, NBR_REACHABLE) == NULL) {
+    TEST_FAIL("uip_ds6_nbr_add");
+  }
+
+  mqtt_register(&conn, &bench_process, "bench", mqtt_event, MAX_SEGMENT);
+  connect();
+  etimer_set(&timeout, CLOCK_SECOND);
+  PROCESS_WAIT_UNTIL(connected || etimer_expired(&timeout));
+  if(!connected) {
+    TEST_FAIL("connect");
+  }
+
+  bench_report("connection RAM", sizeof(struct mqtt_connection), 1, "B");
+
+  next = 0;
+  for(p = phases; p < &phases[NUM_PHASES]; p++) {
+    first = next;
+    pubacks = 0;
+    pubcomps = 0;
+    broker.fault_seq = p->fault != FAULT_NONE ? first + FAULT_AFTER :
+      NO_FAULT;
+
+    start = bench_now_us();
+    etimer_set(&timeout, p->timeout);
+    while(!etimer_expired(&timeout)) {
+      if(disconnected && clock_time() - disconnected_at >= RECONNECT_DELAY) {
+        if(p->fault == FAULT_REBOOT) {
+          /* Only what the engine keeps in CFS survives */
+          mqtt_register(&conn, &bench_process, "bench", mqtt_event,
+                        MAX_SEGMENT);
+        }
+        connect();
+      }
+      while(next < first + p->messages && publish(next, p->qos) ==
+            MQTT_STATUS_OK) {
+        next++;
+      }
+      if(next == first + p->messages &&
+         count_delivered(first, next, &duplicates) == p->messages &&
+         (p->qos == MQTT_QOS_LEVEL_1 ? pubacks : pubcomps) >= p->messages) {
+        break;
+      }
+      etimer_set(&et, 1);
+      PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER ||
+                               ev == mqtt_update_event);
+    }
+    elapsed = bench_now_us() - start;
+
+    count = count_delivered(first, next, &duplicates);
+    if(p == phases) {
+      bench_report("QoS 1 time", elapsed / 1000, 1, "ms");
+      bench_report("QoS 1 throughput", count * 1000, elapsed / 1000,
+                   "messages/s");
+    } else if(p->qos == MQTT_QOS_LEVEL_2) {
+      bench_report("QoS 2 messages delivered", count, 1, "");
+      bench_report("QoS 2 messages completed", pubcomps, 1, "");
+    } else {
+      sprintf(desc, "messages lost across a %s", p->name);
+      bench_report(desc, next - first - count, 1, "");
+    }
+    bench_report("duplicates", duplicates, 1, "");
+  }
+  bench_report("DUP resends with a new message ID", mid_changes, 1, "");
+
+  /* Subscribe and unsubscribe while the queued messages are sent */
+  first = next;
+  while(next < first + SUBSCRIBE_AFTER &&
+        publish(next, MQTT_QOS_LEVEL_1) == MQTT_STATUS_OK) {
+    next++;
+  }
+  subscribed = unsubscribed = 0;
+  start = bench_now_us();
+  cpu = clock();
+  etimer_set(&timeout, 2 * CLOCK_SECOND);
+  while(!unsubacked && !etimer_expired(&timeout)) {
+    if(!subscribed) {
+      subscribed = mqtt_subscribe(&conn, NULL, TOPIC,
+                                  MQTT_QOS_LEVEL_0) == MQTT_STATUS_OK;
+    } else if(subacked && !unsubscribed) {
+      unsubscribed = mqtt_unsubscribe(&conn, NULL, TOPIC) == MQTT_STATUS_OK;
+    }
+    etimer_set(&et, 1);
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER ||
+                             ev == mqtt_update_event);
+  }
+  elapsed = bench_now_us() - start;
+  cpu = clock() - cpu;
+  /* Without the window, a QoS 2 message that never completes holds the
+     only out packet */
+  bench_report("subscribe and unsubscribe acked", unsubacked, 1, "");
+  if(unsubacked) {
+    bench_report("subscribe and unsubscribe time", elapsed / 1000, 1, "ms");
+    bench_report("CPU time meanwhile", cpu * 1000 / CLOCKS_PER_SEC, 1, "ms");
+  }
+  bench_report("wrong messages", wrong, 1, "");
+
+  if(wrong > 0) {
+    TEST_FAIL("wrong messages");
+  }
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
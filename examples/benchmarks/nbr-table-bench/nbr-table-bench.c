@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of neighbor table lookups by link-layer address
+ *         with 16, 64 and 256 neighbors. The neighbors are then given
+ *         new addresses, as IPv6 ND does when an NA fills in the
+ *         address of an incomplete entry, and looked up again.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/nbr-table.h"
+#include "../bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_LOOKUPS       200000UL
+#define MISS_OFFSET       1000
+
+struct bench_nbr {
+  uint16_t id;
+};
+
+NBR_TABLE(struct bench_nbr, bench_nbrs);
+
+static const uint16_t sizes[] = { 16, 64, 256 };
+
+PROCESS(bench_process, "Neighbor table benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+/* Addresses of neighbors only differ in the node id, like EUI-64s of
+ * nodes of the same vendor. */
+static void
+make_lladdr(linkaddr_t *lladdr, uint16_t id)
+{
+  memset(lladdr, 0, sizeof(linkaddr_t));
+  lladdr->u8[0] = 0x02;
+  lladdr->u8[1] = 0x12;
+  lladdr->u8[2] = 0x4b;
+  lladdr->u8[LINKADDR_SIZE - 2] = id >> 8;
+  lladdr->u8[LINKADDR_SIZE - 1] = id & 0xff;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_neighbors(uint16_t from, uint16_t to)
+{
+  linkaddr_t lladdr;
+  struct bench_nbr *n;
+
+  for(; from < to; from++) {
+    make_lladdr(&lladdr, from);
+    n = nbr_table_add_lladdr(bench_nbrs, &lladdr);
+    if(n == NULL) {
+      TEST_FAIL("nbr_table_add_lladdr");
+      return;
+    }
+    n->id = from;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Checks that all neighbors that are in the table are found by their
+ * address. */
+static int
+check_table(void)
+{
+  struct bench_nbr *n, *m;
+  int count;
+
+  count = 0;
+  for(n = nbr_table_head(bench_nbrs); n != NULL;
+      n = nbr_table_next(bench_nbrs, n)) {
+    m = nbr_table_get_from_lladdr(bench_nbrs,
+                                  nbr_table_get_lladdr(bench_nbrs, n));
+    if(m != n) {
+      TEST_FAIL("lookup of existing neighbor");
+      return -1;
+    }
+    count++;
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+/* Moves every neighbor to a new address, returns the neighbors that are
+ * still found by their old one */
+static int
+move_neighbors(uint16_t offset)
+{
+  linkaddr_t lladdr;
+  struct bench_nbr *n;
+  int stale;
+
+  for(n = nbr_table_head(bench_nbrs); n != NULL;
+      n = nbr_table_next(bench_nbrs, n)) {
+    n->id += offset;
+    make_lladdr(&lladdr, n->id);
+    nbr_table_update_lladdr(bench_nbrs, n, &lladdr);
+  }
+  stale = 0;
+  for(n = nbr_table_head(bench_nbrs); n != NULL;
+      n = nbr_table_next(bench_nbrs, n)) {
+    make_lladdr(&lladdr, n->id - offset);
+    if(nbr_table_get_from_lladdr(bench_nbrs, &lladdr) != NULL) {
+      stale++;
+    }
+  }
+  return stale;
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(uint16_t size)
+{
+  linkaddr_t lladdr;
+  struct bench_nbr *n;
+  uint32_t i, start, elapsed;
+  uint16_t id;
+  char desc[48];
+
+  start = bench_now_us();
+  for(i = 0; i < NUM_LOOKUPS; i++) {
+    id = random_rand() % size;
+    make_lladdr(&lladdr, id);
+    n = nbr_table_get_from_lladdr(bench_nbrs, &lladdr);
+    if(n == NULL || n->id != id) {
+      TEST_FAIL("lookup hit");
+      return;
+    }
+  }
+  elapsed = bench_now_us() - start;
+  snprintf(desc, sizeof(desc), "lookup hit (%u neighbors)", size);
+  bench_report(desc, elapsed * 1000, NUM_LOOKUPS, "ns/op");
+
+  start = bench_now_us();
+  for(i = 0; i < NUM_LOOKUPS; i++) {
+    make_lladdr(&lladdr, MISS_OFFSET + random_rand() % size);
+    if(nbr_table_get_from_lladdr(bench_nbrs, &lladdr) != NULL) {
+      TEST_FAIL("lookup miss");
+      return;
+    }
+  }
+  elapsed = bench_now_us() - start;
+  snprintf(desc, sizeof(desc), "lookup miss (%u neighbors)", size);
+  bench_report(desc, elapsed * 1000, NUM_LOOKUPS, "ns/op");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static uint8_t i;
+  static uint16_t added;
+
+  PROCESS_BEGIN();
+
+#if NBR_TABLE_HASH
+  TEST_RESULT("neighbor index", "hash");
+#else
+  TEST_RESULT("neighbor index", "list");
+#endif
+
+  nbr_table_register(bench_nbrs, NULL);
+
+  added = 0;
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    add_neighbors(added, sizes[i]);
+    added = sizes[i];
+    run(sizes[i]);
+  }
+
+  /* Overflow the table so that neighbors are replaced, and check that
+   * the index still finds every remaining neighbor. */
+  add_neighbors(MISS_OFFSET, MISS_OFFSET + NBR_TABLE_MAX_NEIGHBORS / 2);
+  bench_report("neighbors after replacement", check_table(), 1, "");
+
+  bench_report("found by old address", move_neighbors(2 * MISS_OFFSET), 1, "");
+  bench_report("neighbors after new addresses", check_table(), 1, "");
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
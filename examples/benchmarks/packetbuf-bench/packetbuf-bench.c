@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the bytes that the buffer management copies for
+ *         every UDP packet sent over 6LoWPAN, CSMA and a null RDC.
+ */
+
+#include "contiki.h"
+#include "net/ip/simple-udp.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/mac/frame802154.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "dev/radio.h"
+#include "../bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_PACKETS 2000
+#define UDP_PORT    5678
+
+/* A single frame and a packet that is sent in five fragments */
+static const uint16_t sizes[] = { 64, 400 };
+
+PROCESS(bench_process, "Packet buffer benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+
+static uip_ipaddr_t dest;
+static const uip_lladdr_t dest_lladdr =
+  { { 0x02, 0x12, 0x4b, 0x00, 0x00, 0x00, 0x00, 0x02 } };
+
+static uint8_t payload[UIP_BUFSIZE];
+static uint8_t frame[PACKETBUF_SIZE + PACKETBUF_HDR_SIZE];
+static uint16_t frame_len;
+static uint32_t frames, frame_hash;
+/*---------------------------------------------------------------------------*/
+/* A radio that checks and hashes the unicast frames instead of sending
+ * them. Neighbor discovery may send broadcasts at any time. */
+static int
+radio_prepare(const void *payload, unsigned short payload_len)
+{
+  frame_len = MIN(payload_len, sizeof(frame));
+  memcpy(frame, payload, frame_len);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_transmit(unsigned short transmit_len)
+{
+  frame802154_t parsed;
+  uint16_t i;
+
+  if(frame802154_parse(frame, frame_len, &parsed) == 0 ||
+     memcmp(parsed.dest_addr, &dest_lladdr, sizeof(dest_lladdr)) != 0) {
+    return RADIO_TX_OK;
+  }
+  frames++;
+  /* FNV-1a, without the sequence number */
+  for(i = 0; i < frame_len; i++) {
+    if(i != 2) {
+      frame_hash = (frame_hash ^ frame[i]) * 16777619UL;
+    }
+  }
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_send(const void *payload, unsigned short payload_len)
+{
+  radio_prepare(payload, payload_len);
+  return radio_transmit(payload_len);
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_read(void *buf, unsigned short buf_len)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_true(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_false(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+radio_get_value(radio_param_t param, radio_value_t *value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+radio_set_value(radio_param_t param, radio_value_t value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+radio_get_object(radio_param_t param, void *dest, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+radio_set_object(radio_param_t param, const void *src, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+const struct radio_driver bench_radio_driver = {
+  radio_true,
+  radio_prepare,
+  radio_transmit,
+  radio_send,
+  radio_read,
+  radio_true,
+  radio_false,
+  radio_false,
+  radio_true,
+  radio_true,
+  radio_get_value,
+  radio_set_value,
+  radio_get_object,
+  radio_set_object
+};
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static struct simple_udp_connection conn;
+  static uint8_t s;
+  static uint16_t n, i;
+  static struct packetbuf_stats stats;
+  char desc[40];
+
+  PROCESS_BEGIN();
+
+#if PACKETBUF_SEGMENTS
+  TEST_RESULT("packetbuf", "segments");
+#else
+  TEST_RESULT("packetbuf", "copies");
+#endif
+
+  uip_ip6addr(&dest, 0xfe80, 0, 0, 0, 0x0012, 0x4b00, 0, 2);
+  if(uip_ds6_nbr_add(&dest, &dest_lladdr, 0, NBR_REACHABLE) == NULL) {
+    TEST_FAIL("uip_ds6_nbr_add");
+  }
+  simple_udp_register(&conn, UDP_PORT, NULL, UDP_PORT, NULL);
+
+  for(s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    frames = 0;
+    frame_hash = 2166136261UL;
+    stats = packetbuf_stats;
+    for(n = 0; n < NUM_PACKETS; n++) {
+      for(i = 0; i < sizes[s]; i++) {
+        payload[i] = n + i;
+      }
+      simple_udp_sendto(&conn, payload, sizes[s], &dest);
+
+      /* Let CSMA send the frames */
+      while(queuebuf_numfree() < QUEUEBUF_NUM) {
+        PROCESS_PAUSE();
+      }
+    }
+
+    snprintf(desc, sizeof(desc), "%u bytes, copied", sizes[s]);
+    bench_report(desc, packetbuf_stats.copied - stats.copied, NUM_PACKETS,
+                 "bytes/packet");
+    snprintf(desc, sizeof(desc), "%u bytes, shared", sizes[s]);
+    bench_report(desc, packetbuf_stats.shared - stats.shared, NUM_PACKETS,
+                 "bytes/packet");
+    snprintf(desc, sizeof(desc), "%u bytes, frames", sizes[s]);
+    bench_report(desc, frames, NUM_PACKETS, "/packet");
+    snprintf(desc, sizeof(desc), "%u bytes, frame hash", sizes[s]);
+    bench_report(desc, frame_hash, 1, "");
+  }
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
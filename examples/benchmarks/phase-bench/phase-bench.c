@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the phase lock of ContikiMAC with a neighbor
+ *         whose clock runs slow. Packets are strobed the way
+ *         contikimac.c does it, from the guard time before the phase
+ *         predicted by the phase module until the neighbor wakes up.
+ *         Time is compressed: the neighbor runs 1% slow, so that the
+ *         drift two 40 ppm crystals build up over minutes builds up
+ *         between packets here.
+ */
+
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/netstack.h"
+#include "net/mac/phase.h"
+#include "lib/random.h"
+#include "../bench.h"
+
+#include <string.h>
+#include <stdio.h>
+
+#define NUM_PACKETS 40
+/* Cycle of the neighbor as we know it and as it really is, in us */
+#define CYCLE_US 32000UL
+#define TRUE_CYCLE_US (CYCLE_US + CYCLE_US / 100)
+#define CYCLE_TIME (CYCLE_US * RTIMER_ARCH_SECOND / 1000000UL)
+#define GUARD_TIME (3 * RTIMER_ARCH_SECOND / 1000)
+/* As MAX_PHASE_STROBE_TIME and STROBE_TIME of contikimac.c */
+#define MAX_PHASE_STROBE_US 16000UL
+#define STROBE_US (CYCLE_US + 2000UL)
+/* Packets are this many cycles apart at most */
+#define MAX_GAP 20
+
+static linkaddr_t neighbor = { { 1 } };
+static uint32_t start, requested;
+static uint32_t strobe_total, latency_total, acked, misses;
+
+PROCESS(bench_process, "Phase benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+strobe(int known)
+{
+  uint32_t now, wake, limit;
+
+  /* The neighbor wakes up at the start of each of its cycles */
+  now = bench_now_us();
+  wake = start + ((now - start) / TRUE_CYCLE_US + 1) * TRUE_CYCLE_US;
+  limit = known ? MAX_PHASE_STROBE_US : STROBE_US;
+
+  if(wake - now <= limit) {
+    while(bench_now_us() - wake > 0x7fffffffUL);
+    strobe_total += wake - now;
+    latency_total += wake - requested;
+    acked++;
+    phase_update(&neighbor, RTIMER_NOW(), MAC_TX_OK);
+  } else {
+    while(bench_now_us() - now < limit);
+    strobe_total += limit;
+    misses++;
+    phase_update(&neighbor, RTIMER_NOW(), MAC_TX_NOACK);
+  }
+  process_poll(&bench_process);
+}
+/*---------------------------------------------------------------------------*/
+static void
+packet_sent(void *ptr, int status, int transmissions)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+rdc_send(mac_callback_t sent, void *ptr)
+{
+  /* A packet that the phase module deferred to the predicted phase */
+  strobe(1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+rdc_send_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *list)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+rdc_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+rdc_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+rdc_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+rdc_off(int keep_radio_on)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+rdc_channel_check_interval(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+const struct rdc_driver bench_rdc_driver = {
+  "bench",
+  rdc_init,
+  rdc_send,
+  rdc_send_list,
+  rdc_input,
+  rdc_on,
+  rdc_off,
+  rdc_channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static struct etimer et;
+  static uint8_t i;
+  phase_status_t status;
+
+  PROCESS_BEGIN();
+
+#if PHASE_CONF_DRIFT_HISTORY
+  TEST_RESULT("phase", "drift history");
+#elif PHASE_CONF_DRIFT_CORRECT
+  TEST_RESULT("phase", "drift correct");
+#else
+  TEST_RESULT("phase", "last phase");
+#endif
+
+  phase_init();
+  start = bench_now_us();
+
+  for(i = 0; i < NUM_PACKETS; i++) {
+    etimer_set(&et, (random_rand() % MAX_GAP + 1) * CYCLE_US
+               * CLOCK_SECOND / 1000000UL);
+    PROCESS_WAIT_UNTIL(etimer_expired(&et));
+
+    packetbuf_clear();
+    packetbuf_set_datalen(40);
+    packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &neighbor);
+    requested = bench_now_us();
+    status = phase_wait(&neighbor, CYCLE_TIME, GUARD_TIME,
+                        packet_sent, NULL, NULL);
+    if(status == PHASE_DEFERRED) {
+      PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+    } else {
+      strobe(status == PHASE_SEND_NOW);
+      PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+    }
+  }
+
+  bench_report("strobe time", strobe_total, NUM_PACKETS, "us");
+  bench_report("latency", latency_total / 1000, acked, "ms");
+  bench_report("misses", misses, 1, "");
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the process event queue: event throughput,
+ *         dispatch latency of timer events under application load
+ *         and cost of broadcast events.
+ */
+
+#include "contiki.h"
+#include "../bench.h"
+
+#include <stdio.h>
+
+#define NUM_EVENTS        200000UL
+#define NUM_PROBES        1000
+#define NUM_BROADCASTS    20000UL
+#define NUM_IDLE          16
+#define WORK_PER_EVENT    200
+
+#if PROCESS_CONF_PRIORITY_QUEUES
+#define QUEUE_FILL        PROCESS_CONF_PRIO_NUMEVENTS
+#else
+#define QUEUE_FILL        (PROCESS_CONF_NUMEVENTS - 1)
+#endif
+
+static process_event_t bench_event, sink_event;
+static uint32_t sink_count;
+static uint32_t idle_wakeups;
+static uint32_t probe_stamp, probe_latency;
+static volatile uint8_t probe_done;
+
+static struct process idle_processes[NUM_IDLE];
+#if PROCESS_CONF_SUBSCRIPTIONS
+static struct process_subscription sink_subscription;
+#endif
+
+PROCESS(bench_process, "Process benchmark");
+PROCESS(sink_process, "Event sink");
+PROCESS(probe_process, "Timer probe");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sink_process, ev, data)
+{
+  static volatile uint16_t i;
+
+  PROCESS_BEGIN();
+  while(1) {
+    PROCESS_WAIT_EVENT();
+    /* Simulate some application work per event. */
+    for(i = 0; i < WORK_PER_EVENT; i++);
+    sink_count++;
+  }
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(probe_process, ev, data)
+{
+  PROCESS_BEGIN();
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+    probe_latency = bench_now_us() - probe_stamp;
+    probe_done = 1;
+  }
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(idle_thread(struct pt *process_pt, process_event_t ev,
+                      process_data_t data))
+{
+  PROCESS_BEGIN();
+  while(1) {
+    PROCESS_WAIT_EVENT();
+    if(ev == bench_event) {
+      idle_wakeups++;
+    }
+  }
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+drain(void)
+{
+  while(process_run() > 0);
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_throughput(void)
+{
+  uint32_t i, start, elapsed;
+
+  sink_count = 0;
+  start = bench_now_us();
+  for(i = 0; i < NUM_EVENTS; i++) {
+    while(process_post(&sink_process, sink_event,
+                       NULL) != PROCESS_ERR_OK) {
+      process_run();
+    }
+  }
+  drain();
+  elapsed = bench_now_us() - start;
+
+  bench_report("events delivered", sink_count, 1, "events");
+  bench_report("throughput",
+               (uint32_t)((uint64_t)sink_count * 1000000 / elapsed), 1,
+               "events/s");
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_latency(void)
+{
+  uint32_t i, worst, total;
+  uint16_t dropped;
+
+  worst = total = 0;
+  dropped = 0;
+  for(i = 0; i < NUM_PROBES; i++) {
+    /* Keep the queue filled with application events. */
+    while(process_nevents() < QUEUE_FILL &&
+          process_post(&sink_process, sink_event,
+                       NULL) == PROCESS_ERR_OK);
+
+    probe_done = 0;
+    probe_stamp = bench_now_us();
+    if(process_post(&probe_process, PROCESS_EVENT_TIMER, NULL)
+       != PROCESS_ERR_OK) {
+      dropped++;
+      drain();
+      continue;
+    }
+    while(!probe_done) {
+      process_run();
+    }
+    total += probe_latency;
+    if(probe_latency > worst) {
+      worst = probe_latency;
+    }
+  }
+  drain();
+
+  bench_report("timer latency avg", total, NUM_PROBES - dropped, "us");
+  bench_report("timer latency max", worst, 1, "us");
+
+  /* Overload the queue with a burst and check if timer events survive. */
+  for(i = 0; i < NUM_PROBES; i++) {
+    while(process_post(&sink_process, sink_event,
+                       NULL) == PROCESS_ERR_OK);
+    if(process_post(&probe_process, PROCESS_EVENT_TIMER, NULL)
+       != PROCESS_ERR_OK) {
+      dropped++;
+    }
+    drain();
+  }
+  bench_report("timer events rejected", dropped, 2 * NUM_PROBES, "");
+}
+/*---------------------------------------------------------------------------*/
+static void
+run_broadcast(void)
+{
+  uint32_t i, start, elapsed;
+
+  sink_count = idle_wakeups = 0;
+  start = bench_now_us();
+  for(i = 0; i < NUM_BROADCASTS; i++) {
+    while(process_post(PROCESS_BROADCAST, bench_event, NULL)
+          != PROCESS_ERR_OK) {
+      process_run();
+    }
+  }
+  drain();
+  elapsed = bench_now_us() - start;
+
+  bench_report("broadcast throughput",
+               (uint32_t)((uint64_t)NUM_BROADCASTS * 1000000 / elapsed), 1,
+               "events/s");
+  bench_report("idle wakeups per broadcast", idle_wakeups, NUM_BROADCASTS,
+               "");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static int i;
+
+  PROCESS_BEGIN();
+
+#if PROCESS_CONF_PRIORITY_QUEUES
+  TEST_RESULT("event queue", "priority");
+#else
+  TEST_RESULT("event queue", "fifo");
+#endif
+
+  bench_event = process_alloc_event();
+  sink_event = process_alloc_event();
+  process_start(&sink_process, NULL);
+  process_start(&probe_process, NULL);
+  for(i = 0; i < NUM_IDLE; i++) {
+#if !PROCESS_CONF_NO_PROCESS_NAMES
+    idle_processes[i].name = "Idle";
+#endif
+    idle_processes[i].thread = idle_thread;
+    process_start(&idle_processes[i], NULL);
+  }
+#if PROCESS_CONF_SUBSCRIPTIONS
+  process_subscribe(&sink_subscription, &sink_process, bench_event);
+#endif
+
+  /* Let the system settle before measuring. */
+  drain();
+
+  run_throughput();
+  run_latency();
+  run_broadcast();
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
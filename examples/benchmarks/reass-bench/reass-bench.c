@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the 6LoWPAN reassembly: three neighbors send
+ *         fragmented UDP datagrams at the same time, their fragments
+ *         interleaved, one of them in reverse order and one with a
+ *         duplicate fragment.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ip/simple-udp.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/sicslowpan.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "../bench.h"
+
+#include <string.h>
+
+#define NUM_SENDERS   3
+#define NUM_ROUNDS    2000
+#define UDP_PORT      5678
+#define PAYLOAD_LEN   320
+#define DGRAM_LEN     (UIP_IPUDPH_LEN + PAYLOAD_LEN)
+
+/* The first fragment carries the first 96 bytes of the datagram, the
+   others 88 bytes each */
+#define FRAG1_LEN     96
+#define FRAGN_LEN     88
+#define NUM_FRAGS     (1 + (DGRAM_LEN - FRAG1_LEN + FRAGN_LEN - 1) / FRAGN_LEN)
+
+#define IPHC_INLINE   0x7b /* hop limit 255, next header inline */
+
+static uint8_t dgrams[NUM_SENDERS][DGRAM_LEN];
+static uint32_t delivered, corrupted, fragments;
+
+PROCESS(bench_process, "Reassembly benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static uint8_t
+pattern(uint8_t sender, uint16_t round, uint16_t i)
+{
+  return (sender * 31 + round * 7 + i) & 0xff;
+}
+/*---------------------------------------------------------------------------*/
+static void
+receiver(struct simple_udp_connection *c,
+         const uip_ipaddr_t *sender_addr, uint16_t sender_port,
+         const uip_ipaddr_t *receiver_addr, uint16_t receiver_port,
+         const uint8_t *data, uint16_t datalen)
+{
+  uint8_t sender = sender_addr->u8[15];
+  uint16_t round, i;
+
+  round = (data[0] << 8) | data[1];
+  for(i = 2; i < datalen; i++) {
+    if(data[i] != pattern(sender, round, i)) {
+      break;
+    }
+  }
+  if(datalen == PAYLOAD_LEN && i == datalen) {
+    delivered++;
+  } else {
+    corrupted++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Builds the datagram of a sender in uip_buf to fill in the checksum. */
+static void
+make_dgram(uint8_t sender, uint16_t round)
+{
+  struct uip_ip_hdr *ip = (struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN];
+  struct uip_udp_hdr *udp = (struct uip_udp_hdr *)&uip_buf[UIP_LLIPH_LEN];
+  uint8_t *payload = &uip_buf[UIP_LLIPH_LEN + UIP_UDPH_LEN];
+  uint16_t i;
+
+  memset(ip, 0, UIP_IPUDPH_LEN);
+  ip->vtc = 0x60;
+  ip->len[0] = (DGRAM_LEN - UIP_IPH_LEN) >> 8;
+  ip->len[1] = (DGRAM_LEN - UIP_IPH_LEN) & 0xff;
+  ip->proto = UIP_PROTO_UDP;
+  ip->ttl = 255;
+  uip_ip6addr(&ip->srcipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, sender);
+  uip_ipaddr_copy(&ip->destipaddr, &uip_ds6_get_link_local(-1)->ipaddr);
+  udp->srcport = UIP_HTONS(UDP_PORT);
+  udp->destport = UIP_HTONS(UDP_PORT);
+  udp->udplen = UIP_HTONS(DGRAM_LEN - UIP_IPH_LEN);
+  payload[0] = round >> 8;
+  payload[1] = round & 0xff;
+  for(i = 2; i < PAYLOAD_LEN; i++) {
+    payload[i] = pattern(sender, round, i);
+  }
+  uip_len = DGRAM_LEN;
+  udp->udpchksum = ~(uip_udpchksum());
+  if(udp->udpchksum == 0) {
+    udp->udpchksum = 0xffff;
+  }
+  memcpy(dgrams[sender], ip, DGRAM_LEN);
+  uip_len = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Passes fragment n of the datagram of a sender to 6LoWPAN. */
+static void
+input_fragment(uint8_t sender, uint16_t tag, uint8_t n)
+{
+  const uint8_t *dgram = dgrams[sender];
+  uint8_t *frame;
+  uint16_t offset, len;
+  linkaddr_t addr;
+
+  packetbuf_clear();
+  frame = packetbuf_dataptr();
+  frame[0] = (n == 0 ? 0xc0 : 0xe0) | (DGRAM_LEN >> 8);
+  frame[1] = DGRAM_LEN & 0xff;
+  frame[2] = tag >> 8;
+  frame[3] = tag & 0xff;
+  if(n == 0) {
+    /* IPHC with the addresses and next header inline */
+    frame[4] = IPHC_INLINE;
+    frame[5] = 0;
+    frame[6] = UIP_PROTO_UDP;
+    memcpy(&frame[7], &dgram[8], 32);
+    memcpy(&frame[39], &dgram[UIP_IPH_LEN], FRAG1_LEN - UIP_IPH_LEN);
+    len = 39 + FRAG1_LEN - UIP_IPH_LEN;
+  } else {
+    offset = FRAG1_LEN + (n - 1) * FRAGN_LEN;
+    frame[4] = offset >> 3;
+    len = MIN(FRAGN_LEN, DGRAM_LEN - offset);
+    memcpy(&frame[5], &dgram[offset], len);
+    len += 5;
+  }
+  packetbuf_set_datalen(len);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.u8[LINKADDR_SIZE - 1] = sender;
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &addr);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_node_addr);
+
+  NETSTACK_NETWORK.input();
+  fragments++;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static struct simple_udp_connection conn;
+  static uint16_t round;
+  uint32_t start, elapsed;
+  uint8_t n, s;
+
+  PROCESS_BEGIN();
+
+#if SICSLOWPAN_REASS_CONTEXTS > 0
+  TEST_RESULT("reassembly", "contexts");
+#else
+  TEST_RESULT("reassembly", "single");
+#endif
+
+  simple_udp_register(&conn, UDP_PORT, NULL, UDP_PORT, receiver);
+
+  elapsed = 0;
+  for(round = 0; round < NUM_ROUNDS; round++) {
+    for(s = 0; s < NUM_SENDERS; s++) {
+      make_dgram(s + 1, round);
+    }
+    start = bench_now_us();
+    for(n = 0; n < NUM_FRAGS; n++) {
+      /* Sender 1 in order, sender 2 repeats its second fragment and
+         sender 3 sends its fragments in reverse order */
+      input_fragment(1, round, n);
+      input_fragment(2, round, n);
+      if(n == 1) {
+        input_fragment(2, round, n);
+      }
+      input_fragment(3, round, NUM_FRAGS - 1 - n);
+    }
+    elapsed += bench_now_us() - start;
+  }
+
+  bench_report("delivered", delivered * 100, NUM_SENDERS * NUM_ROUNDS, "%");
+  bench_report("corrupted", corrupted, 1, "");
+  bench_report("input", elapsed * 1000, fragments, "ns/fragment");
+#if SICSLOWPAN_REASS_CONTEXTS > 0
+  bench_report("completed", sicslowpan_reass_stats.completed, 1, "");
+  bench_report("dropped", sicslowpan_reass_stats.dropped, 1, "");
+#endif
+  if(corrupted > 0) {
+    TEST_FAIL("corrupted datagram");
+  }
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of longest prefix match route lookups with 16, 64,
+ *         256 and 512 routes.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-ds6-route.h"
+#include "../bench.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_LOOKUPS       200000UL
+#define NUM_NEXTHOPS      4
+#define NUM_PREFIXES      4
+
+static const uint16_t sizes[] = { 16, 64, 256, 512 };
+
+PROCESS(bench_process, "Route table benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+make_nexthop(uip_ipaddr_t *addr, uint8_t id)
+{
+  uip_ip6addr(addr, 0xfe80, 0, 0, 0, 0x0212, 0x4b00, 0, id + 1);
+}
+/*---------------------------------------------------------------------------*/
+/* Routes 0 to NUM_PREFIXES - 1 are a /48 and /64 prefixes, all other
+ * routes are /128 host routes in a prefix of their own, like the
+ * routes of a RPL root in storing mode. */
+static uint8_t
+make_route(uip_ipaddr_t *addr, uint16_t id)
+{
+  if(id == 0) {
+    uip_ip6addr(addr, 0xfd00, 0, 0x1000, 0, 0, 0, 0, 0);
+    return 48;
+  } else if(id < NUM_PREFIXES) {
+    uip_ip6addr(addr, 0xfd00, 0, 0x2000, id, 0, 0, 0, 0);
+    return 64;
+  }
+  uip_ip6addr(addr, 0xfd00, 0, 0, 0, 0x0212, 0x4b00, 0, id);
+  return 128;
+}
+/*---------------------------------------------------------------------------*/
+/* An address that is covered by route id and no longer route. */
+static void
+make_dest(uip_ipaddr_t *addr, uint16_t id)
+{
+  make_route(addr, id);
+  if(id < NUM_PREFIXES) {
+    addr->u16[7] = UIP_HTONS(id + 1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_routes(uint16_t from, uint16_t to)
+{
+  uip_ipaddr_t addr, nexthop;
+  uint8_t length;
+
+  for(; from < to; from++) {
+    length = make_route(&addr, from);
+    make_nexthop(&nexthop, from % NUM_NEXTHOPS);
+    if(uip_ds6_route_add(&addr, length, &nexthop) == NULL) {
+      TEST_FAIL("uip_ds6_route_add");
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Checks that all routes in the table are found by their prefix. The
+ * routes are collected first, as lookups may reorder the route list. */
+static int
+check_table(void)
+{
+  static uip_ds6_route_t *routes[UIP_DS6_ROUTE_NB];
+  uip_ds6_route_t *r;
+  int count, i;
+
+  count = 0;
+  for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
+    routes[count++] = r;
+  }
+  for(i = 0; i < count; i++) {
+    if(uip_ds6_route_lookup(&routes[i]->ipaddr) != routes[i]) {
+      TEST_FAIL("lookup of existing route");
+      return -1;
+    }
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+/* Leaves one route unused for a little more than 65536 lookups while
+ * the others are used later, then adds a route to the full table.
+ * Returns 1 if the unused route is the one replaced. */
+static int
+check_lru(void)
+{
+  static uip_ds6_route_t *routes[UIP_DS6_ROUTE_NB];
+  uip_ipaddr_t stale, addr, nexthop;
+  uip_ds6_route_t *r;
+  uint32_t i;
+  int count;
+
+  count = 0;
+  for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
+    routes[count++] = r;
+  }
+  uip_ipaddr_copy(&stale, &routes[0]->ipaddr);
+  uip_ds6_route_lookup(&stale);
+  for(i = 0; i < 65536 + 200 - (count - 1); i++) {
+    uip_ds6_route_lookup(&routes[1]->ipaddr);
+  }
+  for(i = 1; i < count; i++) {
+    uip_ds6_route_lookup(&routes[i]->ipaddr);
+  }
+
+  uip_ip6addr(&addr, 0xfd00, 0, 0, 0, 0x0212, 0x4b00, 1, 0);
+  make_nexthop(&nexthop, 0);
+  if(uip_ds6_route_add(&addr, 128, &nexthop) == NULL) {
+    TEST_FAIL("uip_ds6_route_add");
+    return 0;
+  }
+  r = uip_ds6_route_lookup(&stale);
+  return r == NULL || !uip_ipaddr_cmp(&r->ipaddr, &stale);
+}
+/*---------------------------------------------------------------------------*/
+static void
+run(uint16_t size)
+{
+  uip_ipaddr_t addr;
+  uip_ds6_route_t *r;
+  uint32_t i, start, elapsed;
+  uint16_t id;
+  char desc[48];
+
+  start = bench_now_us();
+  for(i = 0; i < NUM_LOOKUPS; i++) {
+    id = random_rand() % size;
+    make_dest(&addr, id);
+    r = uip_ds6_route_lookup(&addr);
+    if(r == NULL || !uip_ipaddr_prefixcmp(&addr, &r->ipaddr, r->length) ||
+       r->length != (id == 0 ? 48 : (id < NUM_PREFIXES ? 64 : 128))) {
+      TEST_FAIL("lookup hit");
+      return;
+    }
+  }
+  elapsed = bench_now_us() - start;
+  snprintf(desc, sizeof(desc), "lookup hit (%u routes)", size);
+  bench_report(desc, elapsed * 1000, NUM_LOOKUPS, "ns/op");
+
+  start = bench_now_us();
+  for(i = 0; i < NUM_LOOKUPS; i++) {
+    make_dest(&addr, random_rand() % size);
+    addr.u8[0] = 0xfe;
+    if(uip_ds6_route_lookup(&addr) != NULL) {
+      TEST_FAIL("lookup miss");
+      return;
+    }
+  }
+  elapsed = bench_now_us() - start;
+  snprintf(desc, sizeof(desc), "lookup miss (%u routes)", size);
+  bench_report(desc, elapsed * 1000, NUM_LOOKUPS, "ns/op");
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static uint8_t i;
+  static uint16_t added;
+  uip_ipaddr_t nexthop;
+  uip_lladdr_t lladdr;
+
+  PROCESS_BEGIN();
+
+#if UIP_DS6_ROUTE_HASH
+  TEST_RESULT("route index", "hash");
+#else
+  TEST_RESULT("route index", "list");
+#endif
+
+  for(i = 0; i < NUM_NEXTHOPS; i++) {
+    make_nexthop(&nexthop, i);
+    memset(&lladdr, 0, sizeof(lladdr));
+    lladdr.addr[sizeof(lladdr) - 1] = i + 1;
+    if(uip_ds6_nbr_add(&nexthop, &lladdr, 1, NBR_REACHABLE) == NULL) {
+      TEST_FAIL("uip_ds6_nbr_add");
+    }
+  }
+
+  added = 0;
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    add_routes(added, sizes[i]);
+    added = sizes[i];
+    run(sizes[i]);
+  }
+
+  /* Overflow the table so that routes are replaced, and check that
+   * the index still finds every remaining route. */
+  add_routes(added, added + UIP_DS6_ROUTE_NB / 2);
+  bench_report("routes after replacement", check_table(), 1, "");
+  bench_report("least recently used route replaced", check_lru(), 1, "");
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,323 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the DAOs of a RPL router with eight children that
+ *         each announce eight nodes below them within 640 ms: the
+ *         messages and frames sent up to the parent, the DAO-ACKs sent
+ *         down, and the time until the last target has been passed up.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-icmp6.h"
+#include "net/mac/mac.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/rpl/rpl-private.h"
+#include "../bench.h"
+
+#include <limits.h>
+#include <string.h>
+
+#define PARENT_ID         1
+#define NUM_CHILDREN      8
+#define TARGETS_PER_CHILD 8
+#define NUM_TARGETS       (NUM_CHILDREN * TARGETS_PER_CHILD)
+#define PARENT_RANK       512
+
+/* Children that aggregate send one DAO for their subtree */
+#if RPL_CONF_DAO_AGGREGATION
+#define TARGETS_PER_DAO   TARGETS_PER_CHILD
+#else
+#define TARGETS_PER_DAO   1
+#endif
+#define NUM_DAOS          (NUM_TARGETS / TARGETS_PER_DAO)
+#define DAO_INTERVAL      ((CLOCK_SECOND * 64 / 100) / NUM_DAOS)
+
+#define UIP_IP_BUF        ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+#define UIP_ICMP_BUF      ((struct uip_icmp_hdr *)&uip_buf[UIP_LLH_LEN + UIP_IPH_LEN])
+#define UIP_ICMP_PAYLOAD  ((unsigned char *)&uip_buf[UIP_LLH_LEN + UIP_IPICMPH_LEN])
+
+/* The first byte of a 6LoWPAN fragment that is not the first */
+#define FRAGN_DISPATCH    0xe0
+
+static uint32_t up_frames, up_messages, acks, last_up;
+static uint8_t dao_sequence;
+
+PROCESS(bench_process, "RPL DAO aggregation benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+/* A MAC that counts the frames to the parent and to the children */
+static void
+mac_send(mac_callback_t sent, void *ptr)
+{
+  const linkaddr_t *receiver = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  const uint8_t *data = packetbuf_dataptr();
+  uint8_t id = receiver->u8[LINKADDR_SIZE - 1];
+
+  if(!linkaddr_cmp(receiver, &linkaddr_null)) {
+    if(id == PARENT_ID) {
+      up_frames++;
+      if((data[0] & 0xf8) != FRAGN_DISPATCH) {
+        up_messages++;
+      }
+      last_up = bench_now_us();
+    } else {
+      acks++;
+    }
+  }
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_off(int keep_radio_on)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+mac_channel_check_interval(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver bench_mac_driver = {
+  "bench",
+  mac_init,
+  mac_send,
+  mac_input,
+  mac_on,
+  mac_off,
+  mac_channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
+static void
+make_lladdr(linkaddr_t *lladdr, uint8_t id)
+{
+  memset(lladdr, 0, sizeof(linkaddr_t));
+  lladdr->u8[0] = 0x02;
+  lladdr->u8[LINKADDR_SIZE - 1] = id;
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_nbr_addr(uip_ipaddr_t *ipaddr, uint8_t id)
+{
+  linkaddr_t lladdr;
+
+  make_lladdr(&lladdr, id);
+  uip_ip6addr(ipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(ipaddr, (uip_lladdr_t *)&lladdr);
+}
+/*---------------------------------------------------------------------------*/
+/* Target n is a node below child 2 + n / TARGETS_PER_CHILD */
+static uint8_t
+target_child(uint8_t n)
+{
+  return PARENT_ID + 1 + n / TARGETS_PER_CHILD;
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_target_addr(uip_ipaddr_t *ipaddr, uint8_t n)
+{
+  uip_ip6addr(ipaddr, 0xaaaa, 0, 0, 0, 0, 0, target_child(n), n);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_nbr(uint8_t id)
+{
+  uip_ipaddr_t ipaddr;
+  linkaddr_t lladdr;
+
+  make_lladdr(&lladdr, id);
+  make_nbr_addr(&ipaddr, id);
+  if(uip_ds6_nbr_add(&ipaddr, (uip_lladdr_t *)&lladdr, 1,
+                     NBR_REACHABLE) == NULL) {
+    TEST_FAIL("uip_ds6_nbr_add");
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The DIO of the parent, one hop below the root */
+static void
+parent_dio(void)
+{
+  rpl_dio_t dio;
+  uip_ipaddr_t from;
+
+  make_nbr_addr(&from, PARENT_ID);
+
+  memset(&dio, 0, sizeof(dio));
+  uip_ip6addr(&dio.dag_id, 0xaaaa, 0, 0, 0, 0, 0, 0, 1);
+  dio.ocp = RPL_OF.ocp;
+  dio.rank = PARENT_RANK;
+  dio.grounded = 1;
+  dio.mop = RPL_MOP_DEFAULT;
+  dio.instance_id = RPL_DEFAULT_INSTANCE;
+  dio.dtsn = 240;
+  dio.dag_intdoubl = RPL_DIO_INTERVAL_DOUBLINGS;
+  dio.dag_intmin = RPL_DIO_INTERVAL_MIN;
+  dio.dag_redund = RPL_DIO_REDUNDANCY;
+  dio.default_lifetime = RPL_DEFAULT_LIFETIME;
+  dio.lifetime_unit = RPL_DEFAULT_LIFETIME_UNIT;
+  dio.dag_max_rankinc = RPL_MAX_RANKINC;
+  dio.dag_min_hoprankinc = RPL_MIN_HOPRANKINC;
+  rpl_process_dio(&from, &dio);
+}
+/*---------------------------------------------------------------------------*/
+/* Passes a DAO from the child of the first target to the IP stack */
+static void
+receive_dao(uint8_t first)
+{
+  unsigned char *buffer;
+  uip_ipaddr_t target;
+  uint16_t len;
+  int pos;
+  uint8_t n;
+
+  buffer = UIP_ICMP_PAYLOAD;
+  pos = 0;
+  buffer[pos++] = RPL_DEFAULT_INSTANCE;
+  buffer[pos++] = RPL_DAO_K_FLAG;
+  buffer[pos++] = 0; /* reserved */
+  buffer[pos++] = dao_sequence++;
+  for(n = first; n < first + TARGETS_PER_DAO; n++) {
+    make_target_addr(&target, n);
+    buffer[pos++] = RPL_OPTION_TARGET;
+    buffer[pos++] = 2 + sizeof(target);
+    buffer[pos++] = 0; /* reserved */
+    buffer[pos++] = sizeof(target) * CHAR_BIT;
+    memcpy(buffer + pos, &target, sizeof(target));
+    pos += sizeof(target);
+  }
+  buffer[pos++] = RPL_OPTION_TRANSIT;
+  buffer[pos++] = 4;
+  buffer[pos++] = 0; /* flags */
+  buffer[pos++] = 0; /* path control */
+  buffer[pos++] = 0; /* path sequence */
+  buffer[pos++] = RPL_DEFAULT_LIFETIME;
+
+  len = UIP_ICMPH_LEN + pos;
+  memset(UIP_IP_BUF, 0, UIP_IPICMPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[0] = len >> 8;
+  UIP_IP_BUF->len[1] = len & 0xff;
+  UIP_IP_BUF->proto = UIP_PROTO_ICMP6;
+  UIP_IP_BUF->ttl = 64;
+  make_nbr_addr(&UIP_IP_BUF->srcipaddr, target_child(first));
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr,
+                  &uip_ds6_get_link_local(-1)->ipaddr);
+  UIP_ICMP_BUF->type = ICMP6_RPL;
+  UIP_ICMP_BUF->icode = RPL_CODE_DAO;
+  uip_len = UIP_IPH_LEN + len;
+  uip_ext_len = 0;
+  UIP_ICMP_BUF->icmpchksum = ~uip_icmp6chksum();
+
+  tcpip_input();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static struct etimer et;
+  static uint32_t start;
+  static uint8_t i;
+  uip_ipaddr_t target, child;
+  uip_ds6_route_t *rep;
+  rpl_dag_t *dag;
+  uint8_t n, wrong;
+
+  PROCESS_BEGIN();
+
+#if RPL_CONF_DAO_AGGREGATION
+  TEST_RESULT("DAO forwarding", "aggregated");
+#else
+  TEST_RESULT("DAO forwarding", "per target");
+#endif
+
+  for(i = PARENT_ID; i <= PARENT_ID + NUM_CHILDREN; i++) {
+    add_nbr(i);
+  }
+  parent_dio();
+  dag = rpl_get_any_dag();
+  if(dag == NULL || dag->preferred_parent == NULL) {
+    TEST_FAIL("rpl_process_dio");
+  }
+
+  start = bench_now_us();
+  for(i = 0; i < NUM_DAOS; i++) {
+    receive_dao(i * TARGETS_PER_DAO);
+    etimer_set(&et, DAO_INTERVAL);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  }
+  /* Let the aggregated targets go */
+  etimer_set(&et, CLOCK_SECOND);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  bench_report("messages to parent", up_messages, 1, "");
+  bench_report("frames to parent", up_frames, 1, "");
+  bench_report("DAO-ACKs to children", acks, 1, "");
+  bench_report("last target passed up", (last_up - start) / 1000, 1, "ms");
+
+  wrong = 0;
+  for(n = 0; n < NUM_TARGETS; n++) {
+    make_target_addr(&target, n);
+    make_nbr_addr(&child, target_child(n));
+    rep = uip_ds6_route_lookup(&target);
+    if(rep == NULL || !uip_ipaddr_cmp(uip_ds6_route_nexthop(rep), &child)) {
+      wrong++;
+    }
+  }
+  bench_report("missing routes", wrong, 1, "");
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
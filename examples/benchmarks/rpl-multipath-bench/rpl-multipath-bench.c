@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of the upward traffic of a RPL node with five
+ *         candidate parents of equal rank behind links of different
+ *         quality: how the packets are spread over the parents, and how
+ *         many are lost when the link to the preferred parent breaks.
+ */
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/mac/mac.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/rpl/rpl-private.h"
+#include "../bench.h"
+
+#include <string.h>
+
+#define NUM_PARENTS   5
+#define NUM_PACKETS   10000UL
+#define NUM_FAILOVER  200
+#define PARENT_RANK   512
+#define PAYLOAD_LEN   32
+
+#define UIP_IP_BUF    ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+/* Transmissions needed per frame on the link to each parent */
+static const uint8_t link_etx[NUM_PARENTS] = { 1, 1, 2, 2, 3 };
+static uint32_t frames[NUM_PARENTS + 1];
+static uint32_t transmissions, lost;
+static uint8_t broken;
+
+PROCESS(bench_process, "RPL multipath benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+/* A MAC that needs link_etx transmissions per frame, and never gets an
+   ack on the broken link */
+static void
+mac_send(mac_callback_t sent, void *ptr)
+{
+  const linkaddr_t *receiver = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  uint8_t id = receiver->u8[LINKADDR_SIZE - 1];
+
+  if(linkaddr_cmp(receiver, &linkaddr_null) || id == 0 || id > NUM_PARENTS) {
+    mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+    return;
+  }
+  frames[id]++;
+  if(id == broken) {
+    transmissions += 3;
+    lost++;
+    mac_call_sent_callback(sent, ptr, MAC_TX_NOACK, 3);
+  } else {
+    transmissions += link_etx[id - 1];
+    mac_call_sent_callback(sent, ptr, MAC_TX_OK, link_etx[id - 1]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_off(int keep_radio_on)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+mac_channel_check_interval(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver bench_mac_driver = {
+  "bench",
+  mac_init,
+  mac_send,
+  mac_input,
+  mac_on,
+  mac_off,
+  mac_channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
+static void
+make_lladdr(linkaddr_t *lladdr, uint8_t id)
+{
+  memset(lladdr, 0, sizeof(linkaddr_t));
+  lladdr->u8[0] = 0x02;
+  lladdr->u8[LINKADDR_SIZE - 1] = id;
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_nbr_addr(uip_ipaddr_t *ipaddr, uint8_t id)
+{
+  linkaddr_t lladdr;
+
+  make_lladdr(&lladdr, id);
+  uip_ip6addr(ipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(ipaddr, (uip_lladdr_t *)&lladdr);
+}
+/*---------------------------------------------------------------------------*/
+/* A DIO of a parent one hop below the root */
+static void
+parent_dio(uint8_t id)
+{
+  rpl_dio_t dio;
+  uip_ipaddr_t from;
+  linkaddr_t lladdr;
+  uip_ds6_nbr_t *nbr;
+
+  make_lladdr(&lladdr, id);
+  make_nbr_addr(&from, id);
+  nbr = uip_ds6_nbr_lookup(&from);
+  if(nbr == NULL) {
+    nbr = uip_ds6_nbr_add(&from, (uip_lladdr_t *)&lladdr, 1, NBR_REACHABLE);
+  }
+  if(nbr == NULL) {
+    TEST_FAIL("uip_ds6_nbr_add");
+  }
+  nbr->link_metric = link_etx[id - 1] * RPL_DAG_MC_ETX_DIVISOR;
+
+  memset(&dio, 0, sizeof(dio));
+  uip_ip6addr(&dio.dag_id, 0xaaaa, 0, 0, 0, 0, 0, 0, 1);
+  dio.ocp = RPL_OF.ocp;
+  dio.rank = PARENT_RANK;
+  dio.grounded = 1;
+  dio.mop = RPL_MOP_DEFAULT;
+  dio.instance_id = RPL_DEFAULT_INSTANCE;
+  dio.dtsn = 240;
+  dio.dag_intdoubl = RPL_DIO_INTERVAL_DOUBLINGS;
+  dio.dag_intmin = RPL_DIO_INTERVAL_MIN;
+  dio.dag_redund = RPL_DIO_REDUNDANCY;
+  dio.default_lifetime = RPL_DEFAULT_LIFETIME;
+  dio.lifetime_unit = RPL_DEFAULT_LIFETIME_UNIT;
+  dio.dag_max_rankinc = RPL_MAX_RANKINC;
+  dio.dag_min_hoprankinc = RPL_MIN_HOPRANKINC;
+  rpl_process_dio(&from, &dio);
+}
+/*---------------------------------------------------------------------------*/
+/* Sends a UDP packet to the root */
+static void
+send_up(void)
+{
+  memset(UIP_IP_BUF, 0, UIP_IPUDPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[1] = UIP_UDPH_LEN + PAYLOAD_LEN;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 64;
+  uip_ip6addr(&UIP_IP_BUF->srcipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 2);
+  uip_ip6addr(&UIP_IP_BUF->destipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 1);
+  uip_len = UIP_IPUDPH_LEN + PAYLOAD_LEN;
+  uip_ext_len = 0;
+  tcpip_ipv6_output();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static struct etimer et;
+  static uint32_t i;
+  uint32_t start, elapsed, busiest;
+  rpl_dag_t *dag;
+
+  PROCESS_BEGIN();
+
+#if RPL_CONF_MULTIPATH
+  TEST_RESULT("upward traffic", "multipath");
+#else
+  TEST_RESULT("upward traffic", "preferred parent");
+#endif
+
+  for(i = 1; i <= NUM_PARENTS; i++) {
+    parent_dio(i);
+  }
+  dag = rpl_get_any_dag();
+  if(dag == NULL || dag->preferred_parent == NULL) {
+    TEST_FAIL("no DAG joined");
+  }
+
+  memset(frames, 0, sizeof(frames));
+  transmissions = 0;
+  start = bench_now_us();
+  for(i = 0; i < NUM_PACKETS; i++) {
+    send_up();
+  }
+  elapsed = bench_now_us() - start;
+  busiest = 0;
+  for(i = 1; i <= NUM_PARENTS; i++) {
+    if(frames[i] > busiest) {
+      busiest = frames[i];
+    }
+  }
+  bench_report("output", elapsed * 1000, NUM_PACKETS, "ns/packet");
+  bench_report("busiest parent", busiest * 100, NUM_PACKETS, "%");
+  bench_report("transmissions", transmissions * 100, NUM_PACKETS,
+               "/100 packets");
+
+  /* The link to the preferred parent breaks. The node sends a packet
+     every 10 ms, RPL recalculates its rank once per second. */
+  broken = dag->preferred_parent != NULL ?
+    rpl_get_nbr(dag->preferred_parent)->ipaddr.u8[15] : 0;
+  lost = 0;
+  for(i = 0; i < NUM_FAILOVER; i++) {
+    etimer_set(&et, CLOCK_SECOND / 100);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    send_up();
+  }
+  bench_report("lost after link break", lost, 1, "packets");
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
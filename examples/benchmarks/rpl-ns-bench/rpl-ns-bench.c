@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of downward routing at the root of a DAG of 400
+ *         nodes, four children per node: the routing state kept at the
+ *         root and at a router below it, the time per packet from
+ *         tcpip_ipv6_output() to the MAC, and whether packets take the
+ *         path of the DAG.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/mac/mac.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/rpl/rpl-private.h"
+#include "net/rpl/rpl-ns.h"
+#include "../bench.h"
+
+#include <string.h>
+
+#define NUM_NODES     400
+#define FANOUT        4
+#define NUM_PACKETS   20000UL
+#define PAYLOAD_LEN   32
+
+#define UIP_IP_BUF    ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+/* Node 0 is the root, the parent of node n is (n - 1) / FANOUT */
+#define PARENT(n)     (((n) - 1) / FANOUT)
+
+static uint16_t receiver;
+
+PROCESS(bench_process, "RPL non-storing benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+/* A MAC that remembers the receiver of the last frame */
+static void
+mac_send(mac_callback_t sent, void *ptr)
+{
+  const linkaddr_t *addr = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+
+  if(!linkaddr_cmp(addr, &linkaddr_null)) {
+    receiver = (addr->u8[LINKADDR_SIZE - 2] << 8) | addr->u8[LINKADDR_SIZE - 1];
+  }
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_off(int keep_radio_on)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+mac_channel_check_interval(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver bench_mac_driver = {
+  "bench",
+  mac_init,
+  mac_send,
+  mac_input,
+  mac_on,
+  mac_off,
+  mac_channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
+static void
+make_lladdr(linkaddr_t *lladdr, uint16_t id)
+{
+  memset(lladdr, 0, sizeof(linkaddr_t));
+  lladdr->u8[0] = 0x02;
+  lladdr->u8[LINKADDR_SIZE - 2] = id >> 8;
+  lladdr->u8[LINKADDR_SIZE - 1] = id & 0xff;
+}
+/*---------------------------------------------------------------------------*/
+static void
+make_addr(uip_ipaddr_t *ipaddr, uint16_t prefix, uint16_t id)
+{
+  linkaddr_t lladdr;
+
+  make_lladdr(&lladdr, id);
+  uip_ip6addr(ipaddr, prefix, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(ipaddr, (uip_lladdr_t *)&lladdr);
+}
+/*---------------------------------------------------------------------------*/
+/* The child of the root on the path to a node */
+static uint16_t
+first_hop(uint16_t id)
+{
+  while(PARENT(id) != 0) {
+    id = PARENT(id);
+  }
+  return id;
+}
+/*---------------------------------------------------------------------------*/
+#if !RPL_CONF_WITH_NON_STORING
+static uint16_t
+subtree_size(uint16_t id)
+{
+  uint16_t child, size;
+
+  size = 1;
+  for(child = id * FANOUT + 1; child <= id * FANOUT + FANOUT; child++) {
+    if(child <= NUM_NODES) {
+      size += subtree_size(child);
+    }
+  }
+  return size;
+}
+#endif /* !RPL_CONF_WITH_NON_STORING */
+/*---------------------------------------------------------------------------*/
+/* Sends a UDP packet from the root to a node and returns the next hop */
+static uint16_t
+send_to(uint16_t id)
+{
+  memset(UIP_IP_BUF, 0, UIP_IPUDPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->len[1] = UIP_UDPH_LEN + PAYLOAD_LEN;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 64;
+  uip_ds6_select_src(&UIP_IP_BUF->srcipaddr, &UIP_IP_BUF->destipaddr);
+  make_addr(&UIP_IP_BUF->destipaddr, 0xaaaa, id);
+  uip_len = UIP_IPUDPH_LEN + PAYLOAD_LEN;
+  uip_ext_len = 0;
+
+  receiver = 0;
+  tcpip_ipv6_output();
+  return receiver;
+}
+/*---------------------------------------------------------------------------*/
+#if RPL_CONF_WITH_NON_STORING
+/* Follows the source routing header of the packet in uip_buf as the
+   routers of the path would, and checks that it ends at the node. */
+static int
+check_source_route(uint16_t id)
+{
+  uip_ipaddr_t addr;
+  uint16_t hop;
+
+  hop = first_hop(id);
+  for(;;) {
+    make_addr(&addr, 0xaaaa, hop);
+    if(!uip_ipaddr_cmp(&addr, &UIP_IP_BUF->destipaddr)) {
+      return 0;
+    }
+    if(hop == id) {
+      /* The node must not forward the packet any further */
+      return UIP_IP_BUF->proto != UIP_PROTO_ROUTING ||
+        rpl_process_srh_header() == 0;
+    }
+    if(rpl_process_srh_header() != 1) {
+      return 0;
+    }
+    /* The next hop is the child of this one towards the node */
+    for(hop = id; PARENT(hop) != addr.u8[15] + (addr.u8[14] << 8);
+        hop = PARENT(hop));
+  }
+}
+#endif /* RPL_CONF_WITH_NON_STORING */
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static uint32_t i, wrong;
+  uip_ipaddr_t ipaddr, parent;
+  linkaddr_t lladdr;
+  uint32_t start, elapsed, entry;
+  rpl_dag_t *dag;
+  uint16_t id;
+
+  PROCESS_BEGIN();
+
+#if RPL_CONF_WITH_NON_STORING
+  TEST_RESULT("downward routing", "non-storing");
+#else
+  TEST_RESULT("downward routing", "storing");
+#endif
+
+  uip_ip6addr(&ipaddr, 0xaaaa, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(&ipaddr, &uip_lladdr);
+  uip_ds6_addr_add(&ipaddr, 0, ADDR_MANUAL);
+  dag = rpl_set_root(RPL_DEFAULT_INSTANCE, &ipaddr);
+  if(dag == NULL) {
+    TEST_FAIL("rpl_set_root");
+  }
+  rpl_set_prefix(dag, &ipaddr, 64);
+
+  /* The children of the root are its neighbors */
+  for(id = 1; id <= FANOUT; id++) {
+    make_lladdr(&lladdr, id);
+    make_addr(&ipaddr, 0xfe80, id);
+    uip_ds6_nbr_add(&ipaddr, (uip_lladdr_t *)&lladdr, 1, NBR_REACHABLE);
+  }
+
+  /* The DAOs of all nodes */
+  for(id = 1; id <= NUM_NODES; id++) {
+    make_addr(&ipaddr, 0xaaaa, id);
+#if RPL_CONF_WITH_NON_STORING
+    if(PARENT(id) == 0) {
+      uip_ds6_select_src(&parent, &ipaddr);
+    } else {
+      make_addr(&parent, 0xaaaa, PARENT(id));
+    }
+    if(!rpl_ns_update_node(&ipaddr, &parent, 3600)) {
+      TEST_FAIL("rpl_ns_update_node");
+    }
+#else
+    make_addr(&parent, 0xfe80, first_hop(id));
+    if(rpl_add_route(dag, &ipaddr, 128, &parent) == NULL) {
+      TEST_FAIL("rpl_add_route");
+    }
+#endif
+  }
+
+#if RPL_CONF_WITH_NON_STORING
+  entry = sizeof(rpl_ns_node_t);
+  bench_report("root state", rpl_ns_num_nodes() * entry, 1, "bytes");
+  /* Routers below the root keep nothing */
+  bench_report("router state", 0, 1, "bytes");
+#else
+  entry = sizeof(uip_ds6_route_t) + sizeof(struct uip_ds6_route_neighbor_route);
+  bench_report("root state", uip_ds6_route_num_routes() * entry, 1, "bytes");
+  /* A child of the root has a route to every node of its subtree */
+  bench_report("router state", (subtree_size(1) - 1) * entry, 1, "bytes");
+#endif
+
+  start = bench_now_us();
+  for(i = 0; i < NUM_PACKETS; i++) {
+    id = random_rand() % NUM_NODES + 1;
+    if(send_to(id) != first_hop(id)) {
+      wrong++;
+    }
+  }
+  elapsed = bench_now_us() - start;
+  bench_report("output", elapsed * 1000, NUM_PACKETS, "ns/packet");
+
+#if RPL_CONF_WITH_NON_STORING
+  for(id = 1; id <= NUM_NODES; id++) {
+    send_to(id);
+    if(!check_source_route(id)) {
+      wrong++;
+    }
+  }
+#endif
+  bench_report("wrong paths", wrong, 1, "");
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Benchmark of rtimers that run side by side: two sensors
+ *         sampled at a high rate and the 8 Hz channel check of a
+ *         duty cycling MAC, each rescheduling itself from its callback.
+ *         Then the first of two pending tasks is set again for a time
+ *         after the second one, and neither may run before its time.
+ */
+
+#include "contiki.h"
+#include "../bench.h"
+
+#include <stdio.h>
+
+#define DURATION (2 * CLOCK_SECOND)
+
+struct task {
+  const char *name;
+  rtimer_clock_t period;
+  struct rtimer rt;
+  uint32_t runs;
+};
+
+static struct task tasks[] = {
+  { "gyro", RTIMER_SECOND / 250 },
+  { "accel", RTIMER_SECOND / 100 },
+  { "channel check", RTIMER_SECOND / 8 },
+};
+#define NUM_TASKS (sizeof(tasks) / sizeof(tasks[0]))
+
+static volatile uint8_t running;
+
+#if RTIMER_QUEUE_SIZE > 0
+/* The tasks of the reset case */
+static struct rtimer reset_rt[2];
+static rtimer_clock_t reset_due[2];
+static volatile rtimer_clock_t reset_ran[2];
+static volatile uint8_t reset_done[2];
+#endif
+
+PROCESS(bench_process, "Rtimer benchmark");
+AUTOSTART_PROCESSES(&bench_process);
+/*---------------------------------------------------------------------------*/
+static void
+run_task(struct rtimer *rt, void *ptr)
+{
+  struct task *task = ptr;
+
+  task->runs++;
+  if(running) {
+    rtimer_set(rt, RTIMER_TIME(rt) + task->period, 0, run_task, task);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if RTIMER_QUEUE_SIZE > 0
+static void
+run_reset(struct rtimer *rt, void *ptr)
+{
+  uint8_t i = rt - reset_rt;
+
+  reset_ran[i] = RTIMER_NOW();
+  reset_done[i] = 1;
+}
+#endif
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static struct etimer et;
+  static uint8_t i;
+  static uint32_t runs, expected;
+  rtimer_clock_t now;
+  char desc[48];
+
+  PROCESS_BEGIN();
+
+#if RTIMER_QUEUE_SIZE > 0
+  TEST_RESULT("rtimer", "queue");
+#else
+  TEST_RESULT("rtimer", "single slot");
+#endif
+
+  running = 1;
+  now = RTIMER_NOW();
+  for(i = 0; i < NUM_TASKS; i++) {
+    rtimer_set(&tasks[i].rt, now + tasks[i].period, 0, run_task, &tasks[i]);
+  }
+
+  etimer_set(&et, DURATION);
+  PROCESS_WAIT_UNTIL(etimer_expired(&et));
+  running = 0;
+
+  for(i = 0; i < NUM_TASKS; i++) {
+    expected = (uint32_t)DURATION * RTIMER_SECOND / CLOCK_SECOND
+      / tasks[i].period;
+    snprintf(desc, sizeof(desc), "%s runs", tasks[i].name);
+    bench_report(desc, tasks[i].runs * 100, expected, "%");
+    runs += tasks[i].runs;
+  }
+  bench_report("runs", runs, 1, "");
+#if RTIMER_QUEUE_SIZE > 0
+  bench_report("missed", rtimer_stats.missed, 1, "");
+  bench_report("queue full", rtimer_stats.full, 1, "");
+
+  /* The tasks above run once more and leave the queue */
+  etimer_set(&et, CLOCK_SECOND / 4);
+  PROCESS_WAIT_UNTIL(etimer_expired(&et));
+
+  /* The first task is moved behind the second one */
+  now = RTIMER_NOW();
+  reset_due[0] = now + RTIMER_SECOND / 10;
+  reset_due[1] = now + RTIMER_SECOND / 5;
+  rtimer_set(&reset_rt[0], reset_due[0], 0, run_reset, NULL);
+  rtimer_set(&reset_rt[1], reset_due[1], 0, run_reset, NULL);
+  reset_due[0] = now + RTIMER_SECOND * 3 / 10;
+  rtimer_set(&reset_rt[0], reset_due[0], 0, run_reset, NULL);
+
+  etimer_set(&et, CLOCK_SECOND / 2);
+  PROCESS_WAIT_UNTIL(etimer_expired(&et));
+
+  runs = 0;
+  for(i = 0; i < 2; i++) {
+    if(!reset_done[i] || RTIMER_CLOCK_LT(reset_ran[i], reset_due[i])) {
+      runs++;
+    }
+  }
+  bench_report("reset head, early or lost", runs, 1, "");
+  if(runs > 0) {
+    TEST_FAIL("reset head");
+  }
+#endif
+
+  bench_done();
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
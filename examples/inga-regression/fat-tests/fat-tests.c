@@ -147,6 +147,32 @@ test_cfs_read_files()
 }
 /*---------------------------------------------------------------------------*/
 void
+test_cfs_seek_read()
+{
+  int fd, step;
+  char fnamebuf[12];
+  uint32_t size = file_sizes[FAT_TEST_CONF_NUM_FILES - 1];
+  uint8_t fill = file_inits[FAT_TEST_CONF_NUM_FILES - 1];
+  uint32_t offset;
+  uint8_t byte;
+
+  // Read single bytes going backwards through the largest file
+  sprintf(fnamebuf, "test%02d.dat", FAT_TEST_CONF_NUM_FILES - 1);
+  fd = cfs_open(fnamebuf, CFS_READ);
+  TEST_NEQ(fd, -1);
+
+  for (step = 0; step < 16; step++) {
+    offset = size - 1 - step * 4093UL;
+    TEST_EQUALS(cfs_seek(fd, offset, CFS_SEEK_SET), offset);
+    TEST_EQUALS(cfs_read(fd, &byte, 1), 1);
+    TEST_EQUALS(byte, ((offset % FAT_TEST_CONF_BUF_SIZE) + fill) % 0xFF);
+  }
+
+  cfs_close(fd);
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
+void
 test_cfs_remove()
 {
   int idx;
@@ -292,7 +318,7 @@ get_file_size(const char* name)
   //_delay_ms(10);
 
   // check file size
-  unsigned long read_size = cfs_seek(fd, 0L, CFS_SEEK_END) + 1;
+  unsigned long read_size = cfs_seek(fd, 0L, CFS_SEEK_END);
   TEST_REPORT("Size of seek", read_size, 1, "bytes");
   cfs_close(fd);
 
@@ -363,6 +389,7 @@ PROCESS_THREAD(test_process, ev, data)
   RUN_TEST("cfs_write_files", test_cfs_write_files);
   RUN_TEST("cfs_seek", test_cfs_seek);
   RUN_TEST("cfs_read_files", test_cfs_read_files);
+  RUN_TEST("cfs_seek_read", test_cfs_seek_read);
   RUN_TEST("test_cfs_remove", test_cfs_remove);
   RUN_TEST("cfs_write_many_files", test_cfs_write_many_files);
   RUN_TEST("test_cfs_seek_many", test_cfs_seek_many);
@@ -887,6 +887,7 @@ sdcard_write_multi_block_start(uint32_t addr, uint32_t num_blocks)
   mspi_chip_select(MICRO_SD_CS);
 
   if (sdcard_busy_wait() == SDCARD_BUSY_TIMEOUT) {
+    mspi_chip_release(MICRO_SD_CS);
     return SDCARD_BUSY_TIMEOUT;
   }
 
@@ -914,6 +915,7 @@ sdcard_write_multi_block_next(uint8_t *buffer)
   mspi_chip_select(MICRO_SD_CS);
 
   if (sdcard_busy_wait() == SDCARD_BUSY_TIMEOUT) {
+    mspi_chip_release(MICRO_SD_CS);
     return SDCARD_BUSY_TIMEOUT;
   }
 
@@ -962,6 +964,7 @@ sdcard_write_multi_block_stop()
   mspi_chip_select(MICRO_SD_CS);
 
   if (sdcard_busy_wait() == SDCARD_BUSY_TIMEOUT) {
+    mspi_chip_release(MICRO_SD_CS);
     return SDCARD_BUSY_TIMEOUT;
   }
 
@@ -34,6 +34,7 @@
 
 #include "contiki-conf.h"
 #include "dev/xmem.h"
+#include "dev/xmem-stats.h"
 
 #include <stdio.h>
 #include <fcntl.h>
@@ -44,6 +45,7 @@
 #define XMEM_SIZE 1024 * 1024
 
 static unsigned char xmem[XMEM_SIZE];
+struct xmem_stats xmem_stats;
 /*---------------------------------------------------------------------------*/
 int
 xmem_pwrite(const void *buf, int size, unsigned long offset)
@@ -60,6 +62,8 @@ xmem_pwrite(const void *buf, int size, unsigned long offset)
   /*  printf("xmem_write(offset 0x%02x, buf %p, size %l);\n", offset, buf, size);*/
 
   memcpy(&xmem[offset], buf, size);
+  xmem_stats.writes++;
+  xmem_stats.write_bytes += size;
   return size;
 }
 /*---------------------------------------------------------------------------*/
@@ -68,6 +72,8 @@ xmem_pread(void *buf, int size, unsigned long offset)
 {
   /*  printf("xmem_read(addr 0x%02x, buf %p, size %d);\n", addr, buf, size);*/
   memcpy(buf, &xmem[offset], size);
+  xmem_stats.reads++;
+  xmem_stats.read_bytes += size;
   return size;
 }
 /*---------------------------------------------------------------------------*/
@@ -76,6 +82,7 @@ xmem_erase(long nbytes, unsigned long offset)
 {
   /*  printf("xmem_read(addr 0x%02x, buf %p, size %d);\n", addr, buf, size);*/
   memset(&xmem[offset], 0, nbytes);
+  xmem_stats.erases++;
   return nbytes;
 }
 /*---------------------------------------------------------------------------*/
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2015, TU Braunschweig
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *      Diskio driver definitions - Platform Specific
+ */
+
+#ifndef DISKIO_ARCH_H
+#define DISKIO_ARCH_H
+
+#include "dev/diskio-file.h"
+
+#define FILE_READ_BLOCK(block_start_address, buffer) \
+        diskio_file_read_block(block_start_address, buffer)
+#define FILE_WRITE_BLOCK(block_start_address, buffer) \
+        diskio_file_write_block(block_start_address, buffer)
+#define FILE_INIT() \
+        diskio_file_init()
+#define FILE_GET_BLOCK_NUM() \
+        diskio_file_get_block_num()
+#define FILE_GET_BLOCK_SIZE() \
+        diskio_file_get_block_size()
+#define FILE_WRITE_BLOCKS_START(blocks_start_address, num_blocks) \
+        diskio_file_write_blocks_start(blocks_start_address, num_blocks)
+#define FILE_WRITE_BLOCKS_NEXT(buffer) \
+        diskio_file_write_blocks_next(buffer)
+#define FILE_WRITE_BLOCKS_DONE() \
+        diskio_file_write_blocks_done()
+
+#endif /* DISKIO_ARCH_H */